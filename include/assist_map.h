@@ -0,0 +1,124 @@
+#ifndef ASSIST_MAP_H
+#define ASSIST_MAP_H
+
+#include <stdint.h>
+
+// =============================================================================
+// ASSIST MAPS (speed x cadence x human power -> assist factor)
+// =============================================================================
+// A speed-only profile cannot give more support at high cadence or under
+// hard effort the way commercial drive units do. An AssistMap is a grid of
+// assist factors over up to three axes, evaluated with trilinear
+// interpolation and held at the axis ends:
+//
+//   speed_kmh    >= 2 points
+//   cadence_rpm  >= 1 point (1 point: no cadence dependency)
+//   human_w      >= 1 point (1 point: 2-D map over speed x cadence)
+//
+// The dimensions are template parameters, checked by static_assert, and a
+// constexpr map is checked at compile time with ASSIST_MAP_CHECK() (axes
+// strictly increasing, factors within 0..ASSIST_MAP_MAX_FACTOR).
+//
+// Evaluation keeps the cell of every axis in an AssistMapCursor: the inputs
+// change little from one 10ms tick to the next, so the cell search is
+// usually a single comparison per axis. Cost per call: 3 divisions, 8 grid
+// reads and 7 interpolations, a few hundred cycles (2 µs budget on the
+// ESP32; host timing in test_assist_map_benchmark).
+
+#define ASSIST_MAP_MAX_AXIS_POINTS   8
+#define ASSIST_MAP_MAX_FACTOR        4.0f    // Same limit as the speed profiles
+
+template <int NS, int NC, int NP>
+struct AssistMap {
+  static_assert(NS >= 2 && NS <= ASSIST_MAP_MAX_AXIS_POINTS, "AssistMap: 2..8 speed points");
+  static_assert(NC >= 1 && NC <= ASSIST_MAP_MAX_AXIS_POINTS, "AssistMap: 1..8 cadence points");
+  static_assert(NP >= 1 && NP <= ASSIST_MAP_MAX_AXIS_POINTS, "AssistMap: 1..8 human power points");
+
+  float speed_kmh[NS];
+  float cadence_rpm[NC];
+  float human_w[NP];
+  float factor[NS][NC][NP];
+};
+
+// Cell of each axis from the previous evaluation
+struct AssistMapCursor {
+  uint8_t speed;
+  uint8_t cadence;
+  uint8_t power;
+};
+
+// -----------------------------------------------------------------------------
+// Compile-time validation (C++11 constexpr: recursion, log depth over the grid)
+
+template <int N>
+constexpr bool assist_axis_valid(const float (&points)[N], int i = 1) {
+  return i >= N || (points[i] > points[i - 1] && assist_axis_valid(points, i + 1));
+}
+
+template <int NS, int NC, int NP>
+constexpr bool assist_factors_valid(const AssistMap<NS, NC, NP>& map, int first = 0, int end = NS * NC * NP) {
+  return end - first == 1
+      ? (map.factor[first / (NC * NP)][first / NP % NC][first % NP] >= 0.0f &&
+         map.factor[first / (NC * NP)][first / NP % NC][first % NP] <= ASSIST_MAP_MAX_FACTOR)
+      : (assist_factors_valid(map, first, (first + end) / 2) && assist_factors_valid(map, (first + end) / 2, end));
+}
+
+template <int NS, int NC, int NP>
+constexpr bool assist_map_valid(const AssistMap<NS, NC, NP>& map) {
+  return assist_axis_valid(map.speed_kmh) && assist_axis_valid(map.cadence_rpm) &&
+         assist_axis_valid(map.human_w) && assist_factors_valid(map);
+}
+
+#define ASSIST_MAP_CHECK(map) \
+  static_assert(assist_map_valid(map), #map ": axes must increase, factors within 0..ASSIST_MAP_MAX_FACTOR")
+
+// -----------------------------------------------------------------------------
+// Evaluation
+
+// Moves cell to the interval holding value and returns the position in it
+// (0..1, clamped at the ends). A single point: cell 0, position 0.
+template <int N>
+inline float assist_axis_locate(const float (&points)[N], uint8_t& cell, float value) {
+  const int last_cell = N > 1 ? N - 2 : 0;
+  if (N == 1 || !(value > points[0])) {          // Also NaN
+    cell = 0;
+    return 0.0f;
+  }
+  if (value >= points[last_cell + 1]) {
+    cell = last_cell;
+    return 1.0f;
+  }
+  if (cell > last_cell) {
+    cell = last_cell;
+  }
+  while (value < points[cell]) {
+    cell--;
+  }
+  while (value >= points[cell + 1]) {
+    cell++;
+  }
+  return (value - points[cell]) / (points[cell + 1] - points[cell]);
+}
+
+template <int NS, int NC, int NP>
+float assist_map_factor(const AssistMap<NS, NC, NP>& map, AssistMapCursor& cursor,
+                        float speed_kmh, float cadence_rpm, float human_w) {
+  float ts = assist_axis_locate(map.speed_kmh, cursor.speed, speed_kmh);
+  float tc = assist_axis_locate(map.cadence_rpm, cursor.cadence, cadence_rpm);
+  float tp = assist_axis_locate(map.human_w, cursor.power, human_w);
+
+  // Upper corner index: the same cell on a single-point axis
+  int s0 = cursor.speed, s1 = s0 + 1;
+  int c0 = cursor.cadence, c1 = c0 + (NC > 1);
+  int p0 = cursor.power, p1 = p0 + (NP > 1);
+
+  float f00 = map.factor[s0][c0][p0] + tp * (map.factor[s0][c0][p1] - map.factor[s0][c0][p0]);
+  float f01 = map.factor[s0][c1][p0] + tp * (map.factor[s0][c1][p1] - map.factor[s0][c1][p0]);
+  float f10 = map.factor[s1][c0][p0] + tp * (map.factor[s1][c0][p1] - map.factor[s1][c0][p0]);
+  float f11 = map.factor[s1][c1][p0] + tp * (map.factor[s1][c1][p1] - map.factor[s1][c1][p0]);
+  float f0 = f00 + tc * (f01 - f00);
+  float f1 = f10 + tc * (f11 - f10);
+  return f0 + ts * (f1 - f0);
+}
+
+#endif // ASSIST_MAP_H
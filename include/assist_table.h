@@ -0,0 +1,61 @@
+#ifndef ASSIST_TABLE_H
+#define ASSIST_TABLE_H
+
+#include <stdint.h>
+
+// =============================================================================
+// ASSIST FACTOR LOOKUP TABLE (speed -> assist factor, one per profile)
+// =============================================================================
+// A profile is a list of support points (speed [km/h], assist factor) with
+// the speeds increasing; between them the factor is interpolated linearly,
+// below the first and above the last point it is held.
+//
+// build() compiles the points once (initializeAssistProfiles()) so the
+// per-tick lookup is O(1) whatever the number of points: the slope of
+// every segment is precomputed, and a dense grid of ASSIST_TABLE_STEP_KMH
+// cells from the first to the last point holds the first segment reaching
+// into each cell. With points at least one cell apart the lookup moves on
+// by at most one segment.
+
+#define ASSIST_TABLE_MAX_POINTS   32       // Support points per profile
+#define ASSIST_TABLE_STEP_KMH     0.1f     // Grid resolution ...
+#define ASSIST_TABLE_MAX_CELLS    600      // ... coarser if the points span more than 60 km/h
+
+class AssistTable {
+public:
+  AssistTable();
+
+  // False (table unchanged) without 2..ASSIST_TABLE_MAX_POINTS points or
+  // with speeds not increasing
+  bool build(const float* speeds_kmh, const float* factors, uint32_t count);
+
+  float factor(float speed_kmh) const {
+    if (!(speed_kmh > x[0])) {
+      return y[0];                      // Also NaN
+    }
+    if (speed_kmh >= x_last) {
+      return y_last;
+    }
+    uint32_t i = cell_segment[cellOf(speed_kmh)];
+    while (i + 1 < segments && speed_kmh >= x[i + 1]) {
+      i++;
+    }
+    return y[i] + slope[i] * (speed_kmh - x[i]);
+  }
+
+private:
+  uint32_t cellOf(float speed_kmh) const {
+    return (uint32_t)((speed_kmh - x[0]) * cells_per_kmh);
+  }
+
+  uint32_t segments;
+  float cells_per_kmh;
+  float x_last;                         // Last point
+  float y_last;
+  float x[ASSIST_TABLE_MAX_POINTS];     // Segment start [km/h]
+  float y[ASSIST_TABLE_MAX_POINTS];     // Factor at the start
+  float slope[ASSIST_TABLE_MAX_POINTS]; // [1 / (km/h)]
+  uint8_t cell_segment[ASSIST_TABLE_MAX_CELLS + 1];   // + 1: float rounding just below x_last
+};
+
+#endif // ASSIST_TABLE_H
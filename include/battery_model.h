@@ -0,0 +1,81 @@
+#ifndef BATTERY_MODEL_H
+#define BATTERY_MODEL_H
+
+#include <stdint.h>
+
+// =============================================================================
+// BATTERY INTERNAL RESISTANCE AND SAG-AWARE CURRENT LIMIT
+// =============================================================================
+// The 13S2P pack is an open-circuit voltage behind an internal resistance:
+//
+//   inpVoltage = OCV - R * avgInputCurrent
+//
+// R grows with age, cold and low charge; near empty the sag under load can
+// pull the pack below the BMS undervoltage trip although the OCV is fine.
+//
+// Estimator (vescTask, every GET_VALUES answer): the OCV does not move
+// within BATTERY_R_STEP_WINDOW_MS, so a current step between two samples
+// gives dV = -R * dI. Steps of at least BATTERY_R_MIN_STEP_A are fitted by
+// least squares through the origin with exponential forgetting (R follows
+// temperature and charge), starting from BATTERY_R_NOMINAL_OHM with the
+// weight of a BATTERY_R_PRIOR_A2 step. The OCV follows from every sample.
+// Published as battery_resistance / battery_ocv in sharedVescData.
+//
+// Limit (sensorTask): the loaded voltage stays above BATTERY_CUTOFF_VOLTAGE
+// with an input current of at most (OCV - cutoff) / R. Input amps per motor
+// amp are learned from the VESC currents (about the duty cycle), which turns
+// that into a motor current limit on motor_current_limit_amps.
+
+#define BATTERY_R_NOMINAL_OHM       0.15f    // New 13S2P pack, wiring included
+#define BATTERY_R_MIN_OHM           0.03f    // Plausible range of the estimate
+#define BATTERY_R_MAX_OHM           1.5f
+#define BATTERY_R_PRIOR_A2          1.0f     // Weight of the nominal value [A^2]
+#define BATTERY_R_MIN_STEP_A        1.0f     // Input current step that counts
+#define BATTERY_R_STEP_WINDOW_MS    500      // Longest step (OCV constant)
+#define BATTERY_R_FORGETTING        0.98f    // Per step (~50 steps memory)
+#define BATTERY_RATIO_MIN_MOTOR_A   1.0f     // Learn input / motor amps above this
+#define BATTERY_RATIO_FILTER        0.2f     // Per VESC sample
+
+class BatteryResistanceEstimator {
+public:
+  BatteryResistanceEstimator();
+
+  // Back to BATTERY_R_NOMINAL_OHM, no steps seen
+  void reset();
+
+  // One VESC sample: inpVoltage, avgInputCurrent
+  void update(float voltage, float input_current_a, unsigned long now_ms);
+
+  float resistance() const { return r_ohm; }
+  float openCircuitVoltage() const { return ocv_v; }       // 0 before the first sample
+  uint32_t steps() const { return step_count; }
+
+private:
+  float anchor_v;
+  float anchor_a;
+  unsigned long anchor_ms;
+  bool has_anchor;
+  float sum_dv_di;              // Sum of -dV * dI (forgetting applied)
+  float sum_di_sq;              // Sum of dI^2
+  float r_ohm;
+  float ocv_v;
+  uint32_t step_count;
+};
+
+// vescTask: feed the estimator with this answer (handle_vesc_values())
+void update_battery_model(float voltage, float input_current_a, unsigned long now_ms);
+const BatteryResistanceEstimator& battery_estimator();
+
+// sensorTask: lower motor_current_limit_amps so the loaded voltage stays
+// above BATTERY_CUTOFF_VOLTAGE (run_sensor_cycle()). Disabled, nothing is
+// limited; the setting survives ebike_setup(), the state does not.
+struct SharedVescData;
+void limit_battery_current(const SharedVescData& vesc);
+void battery_model_reset();
+void battery_limit_enable(bool enabled);
+
+// Voltage for power -> current conversions: measured inpVoltage while the
+// VESC answers, VOLTAGE_BATTERY otherwise
+float battery_supply_voltage();
+
+#endif // BATTERY_MODEL_H
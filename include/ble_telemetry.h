@@ -36,6 +36,7 @@
 #define BLE_CHAR_UUID_POWER_DATA       "12345678-1234-1234-1234-12345678a008"
 #define BLE_CHAR_UUID_TEMPERATURES     "12345678-1234-1234-1234-12345678a009"
 #define BLE_CHAR_UUID_COMPLETE_TELEMETRY "12345678-1234-1234-1234-12345678a010"
+#define BLE_CHAR_UUID_TASK_PERF        "12345678-1234-1234-1234-12345678a011"
 
 // Control Characteristics UUIDs
 #define BLE_CHAR_UUID_MODE_CONTROL     "12345678-1234-1234-1234-12345678b001"
@@ -51,6 +52,7 @@
 #define BLE_UPDATE_RATE_MS 2000         // 0.5Hz für BLE Telemetrie (weniger frequent als WiFi)
 #define BLE_TASK_STACK_SIZE 4096
 #define BLE_TASK_PRIORITY 1             // Niedrige Priorität auf Core 1
+#define BLE_TELEMETRY_SERVICE_HANDLES 32  // 1 + 3 per Read/Notify characteristic (library default 15 holds only 4)
 
 // BLE Data Structures
 struct BLETelemetryData {
@@ -127,6 +129,7 @@ void setupBLETelemetry();
 void updateBLETelemetryData();
 void updateBLEVescData();
 void sendBLEModeList();
+void updateBLETaskPerf();
 
 // Global declarations for external access
 extern TaskHandle_t bleTaskHandle;
@@ -145,6 +148,7 @@ extern BLECharacteristic* pCharSystemStatus;
 extern BLECharacteristic* pCharPowerData;
 extern BLECharacteristic* pCharTemperatures;
 extern BLECharacteristic* pCharCompleteTelemetry;
+extern BLECharacteristic* pCharTaskPerf;
 extern BLECharacteristic* pCharModeControl;
 extern BLECharacteristic* pCharModeList;
 extern BLECharacteristic* pCharCommand;
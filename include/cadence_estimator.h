@@ -0,0 +1,90 @@
+#ifndef CADENCE_ESTIMATOR_H
+#define CADENCE_ESTIMATOR_H
+
+#include <stdint.h>
+
+// =============================================================================
+// CADENCE ESTIMATOR (us edge timestamps, per-edge spacing calibration)
+// =============================================================================
+// Fed by read_pas_sensors() with every forward step the PAS counter captured:
+// its micros() timestamp and the edge index reached (position modulo
+// CADENCE_EDGES_PER_REV identifies the physical edge on the crank). A step
+// is one edge (GPIO counter) or up to CADENCE_MAX_STEP_EDGES edges (PCNT
+// counter, one capture per magnet).
+//
+// Cadence = share of a revolution covered by the recent steps / their time
+// span. The window is the last full revolution, shortened to
+// CADENCE_WINDOW_US at low cadence so the value still follows the rider
+// within a few steps. No EMA on top.
+//
+// The 32 edges are not evenly spaced (magnet placement on the 8-pulse ring,
+// phase offset between the two hall sensors). Each edge has a learned share
+// of a revolution: whenever a full revolution of consecutive forward steps
+// at steady cadence is available, the step interval divided by the
+// revolution time pulls the share of the step's edges towards the measured
+// value. The shares always sum to one, so a full-revolution window is exact
+// from the start and short windows converge within a few dozen revolutions.
+//
+// sensorTask only - not thread safe.
+
+#define CADENCE_EDGES_PER_REV     32       // 8 pulses x 4 quadrature edges
+#define CADENCE_MAX_STEP_EDGES    4        // Longest step that continues a sequence (one magnet)
+#define CADENCE_WINDOW_US         250000   // Longest window below one revolution [us]
+#define CADENCE_CALIBRATION_GAIN  0.05f    // Share update per revolution (~20 rev time constant)
+#define CADENCE_STEADY_TOLERANCE  0.20f    // Max. cadence difference between the two half revolutions for learning
+
+class CadenceEstimator {
+public:
+  CadenceEstimator();
+
+  // Forget timing history and calibration
+  void reset();
+
+  // Forward sequence interrupted (backward step, lost edge, standstill).
+  // The calibration is kept.
+  void breakSequence();
+
+  // Forward step that ended at edge_index (any integer, taken modulo
+  // CADENCE_EDGES_PER_REV). A repeated index (contact bounce) is ignored, a
+  // gap starts a new sequence. Returns true if cadenceRpm() was updated.
+  bool addForwardEdge(int32_t edge_index, uint32_t time_us);
+
+  // Latest estimate (0 until two consecutive forward steps were seen)
+  float cadenceRpm() const { return cadence_rpm; }
+
+  // Time of the last forward step, and how long the next step (as many
+  // edges as the last one) should take at the current cadence with its
+  // learned share (0 = no cadence)
+  uint32_t lastEdgeUs() const;
+  uint32_t expectedIntervalUs() const;
+  uint32_t lastStepEdges() const { return last_step_edges; }
+
+  // Learned share of a revolution for the edge ending at edge_index (1/32 nominal)
+  float edgeShare(int32_t edge_index) const;
+
+  // Number of share updates so far (one per steady forward step with a full revolution of history)
+  uint32_t calibrationUpdates() const { return calibration_updates; }
+
+private:
+  struct Step {
+    uint32_t time_us;
+    int32_t edge_index;
+  };
+
+  static uint32_t slot(int32_t edge_index);
+  float sharesBetween(int32_t from_index, int32_t to_index) const;  // Edges from_index+1 .. to_index
+  const Step& stepBack(uint32_t steps) const;                       // 0 = latest
+  int32_t findStepBack(int32_t edge_index) const;                   // Steps back, -1 = not in history
+  bool isSteady() const;
+  void learnShares();
+
+  Step history[CADENCE_EDGES_PER_REV + 1];  // Ring of the last consecutive forward steps
+  uint32_t head;                            // Next write position in history
+  uint32_t count;                           // Valid entries in history
+  uint32_t last_step_edges;                 // Edges covered by the latest step
+  float share[CADENCE_EDGES_PER_REV];
+  float cadence_rpm;
+  uint32_t calibration_updates;
+};
+
+#endif // CADENCE_ESTIMATOR_H
@@ -0,0 +1,65 @@
+#ifndef CRANK_TORQUE_H
+#define CRANK_TORQUE_H
+
+#include <stdint.h>
+#include "cadence_estimator.h"
+
+// =============================================================================
+// CRANK-SYNCHRONOUS TORQUE AVERAGING
+// =============================================================================
+// Crank torque pulses twice per revolution (one stroke per leg), so
+// instantaneous torque x cadence makes the assist surge with every stroke.
+// Averaging over time would need a low-pass slower than the slowest cadence;
+// averaging over crank angle removes the pulse at any cadence with no
+// extra lag beyond the window itself.
+//
+// Fed once per sensor tick with the torque sample and the forward edges the
+// crank moved since the last tick (from pos). The samples between two edges
+// form the edge's bin (their mean and maximum); every edge closes a bin.
+// When a tick spans several edges, each of them gets that tick's bin.
+//
+//   average() = mean of the last CRANK_TORQUE_WINDOW_EDGES bins = torque
+//               averaged over crank angle, updated on every edge
+//   peak()    = highest sample in the last CRANK_TORQUE_STROKE_EDGES bins
+//
+// Before the window is full (start from standstill) the bins seen so far
+// are averaged; before the first edge, the samples of the open bin.
+//
+// sensorTask only - not thread safe.
+
+#define CRANK_TORQUE_WINDOW_EDGES  16   // Half revolution = one stroke (32 for a full revolution)
+#define CRANK_TORQUE_STROKE_EDGES  16   // Peak window: one stroke
+
+class CrankTorqueAverager {
+public:
+  CrankTorqueAverager();
+
+  // Crank stopped or turned backwards: forget all bins
+  void reset();
+
+  // One sensor tick: torque sample [Nm] and forward edges moved since the
+  // last tick (0 = still inside the same edge). Returns true if an edge
+  // closed, i.e. average() and peak() moved on.
+  bool addSample(float torque_nm, uint32_t forward_edges);
+
+  float average() const { return avg_nm; }
+  float peak() const { return peak_nm; }
+  uint32_t edgesInWindow() const { return count; }
+
+private:
+  void pushBin(float mean_nm, float max_nm);
+
+  float bin_mean[CADENCE_EDGES_PER_REV];
+  float bin_max[CADENCE_EDGES_PER_REV];
+  uint32_t head;          // Next bin to write
+  uint32_t count;         // Closed bins (at most CADENCE_EDGES_PER_REV)
+
+  float open_sum;         // Samples since the last edge
+  uint32_t open_samples;
+  float open_max;
+
+  float avg_nm;
+  float peak_nm;
+};
+
+#endif // CRANK_TORQUE_H
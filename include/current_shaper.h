@@ -0,0 +1,60 @@
+#ifndef CURRENT_SHAPER_H
+#define CURRENT_SHAPER_H
+
+// =============================================================================
+// MOTOR CURRENT SHAPING (between calculate_assist_power() and the command)
+// =============================================================================
+// target_current_amps can jump from 0 to MAX_MOTOR_CURRENT in one 10ms tick
+// (pedal start, mode change) and back when the rider eases off. The shaper
+// turns that into a smooth command, applied in this order every tick:
+//
+//   filter:  first-order low-pass on the target (CURRENT_FILTER per tick,
+//            not on the way to 0)
+//   rate:    the command moves by at most rise_a_per_s up, fall_a_per_s down
+//   jerk:    the rate itself changes by at most jerk_a_per_s2 and is braked
+//            to arrive at the target without overshoot (S-curve)
+//
+// Any limit set to 0 is off. A safety cut (crank stopped or reversed,
+// overspeed, stale VESC data - see update_motor_status()) bypasses all of
+// it: the command is 0 in the same tick.
+
+#define CURRENT_SHAPER_DT_S    0.01f     // Called once per sensorTask tick
+
+struct CurrentShaperConfig {
+  float filter;            // 0..1, higher = slower (0 = off)
+  float rise_a_per_s;      // [A/s]
+  float fall_a_per_s;      // [A/s]
+  float jerk_a_per_s2;     // [A/s^2]
+};
+
+class CurrentShaper {
+public:
+  CurrentShaper();
+
+  void configure(const CurrentShaperConfig& config);
+  const CurrentShaperConfig& config() const { return cfg; }
+  void reset();
+
+  // One tick: target [A] -> command [A]
+  float update(float target, bool cut);
+
+  float output() const { return out; }
+  float rate() const { return rate_a_per_s; }
+
+private:
+  CurrentShaperConfig cfg;
+  float filtered;
+  float out;
+  float rate_a_per_s;
+};
+
+// Defaults from ebike_controller.h
+CurrentShaperConfig current_shaper_default_config();
+
+// sensorTask: shape this tick's command (run_sensor_cycle()). The
+// configuration survives ebike_setup(), the state does not.
+float shape_motor_current(float target, bool cut);
+void current_shaper_reset();
+void current_shaper_configure(const CurrentShaperConfig& config);
+
+#endif // CURRENT_SHAPER_H
@@ -0,0 +1,91 @@
+#ifndef CURRENT_TRACKING_H
+#define CURRENT_TRACKING_H
+
+#include <stdint.h>
+
+// =============================================================================
+// CLOSED-LOOP CURRENT TRACKING (VESC feedback -> target_current_amps)
+// =============================================================================
+// calculate_assist_power() turns the assist power into a current through
+// the Q100C Kt(I, rpm) map (motor_map_current()), which already covers the
+// rise of Kt with current. The motor on the bike still differs from the one
+// load-tested (unit spread, winding temperature, gear wear, a different
+// motor altogether), and the VESC may not deliver the command at all
+// (back-EMF at high speed, its own battery / thermal limits). With every
+// VESC sample the tracker compares
+//
+//   current:  avgMotorCurrent      with the command sent (shaped)
+//   power:    delivered mechanical with assist_power_watts
+//
+// The delivered power comes from the electrical side, independent of Kt:
+//
+//   P_mech = (VESC_EFFICIENCY * inpVoltage * avgInputCurrent - I_motor^2 * R)
+//            * MOTOR_GEAR_EFFICIENCY
+//
+// A PI controller on the relative power error scales the open-loop target
+// (kt_scale, TRACKING_SCALE_MIN..MAX). The integral is the learned error of
+// the map for this motor and is kept between pedal strokes and stops. It only learns while the
+// comparison is meaningful: motor assisting above TRACKING_MIN_SPEED_KMH
+// and TRACKING_MIN_POWER_W, command caught up with the target (no shaper
+// ramp in progress). Anti-windup: the integral does not grow while more
+// current would not help - target at the current limit, or the VESC
+// delivering less than TRACKING_LIMITED_RATIO of the command.
+
+#define TRACKING_KP              0.1f     // Scale per relative power error
+#define TRACKING_KI              0.5f     // Scale per relative power error and second
+#define TRACKING_SCALE_MIN       0.5f     // Correction range (Kt error up to 2x either way)
+#define TRACKING_SCALE_MAX       2.0f
+#define TRACKING_MIN_POWER_W     40.0f    // Below: losses dominate the power estimate
+#define TRACKING_MIN_SPEED_KMH   5.0f     // Below: low-speed current branch, no Kt relation
+#define TRACKING_SETTLED_RATIO   0.05f    // Command within 5% of the target
+#define TRACKING_LIMITED_RATIO   0.85f    // VESC delivers less: it limits the current
+#define TRACKING_SAMPLE_S        0.02f    // VESC_FAST_POLL_MS
+
+struct CurrentTrackingInput {
+  float target_a;             // Open-loop target (calculate_assist_power())
+  float limit_a;              // Current limit (motor_current_limit_amps)
+  float requested_w;          // Mechanical power it stands for (assist_power_watts)
+  float commanded_a;          // Last command sent to the VESC (after shaping)
+  float speed_kmh;
+  bool active;                // Motor assisting, VESC data valid
+  bool new_sample;            // VESC answered since the last tick:
+  float motor_current_a;      //   avgMotorCurrent
+  float input_current_a;      //   avgInputCurrent
+  float input_voltage;        //   inpVoltage
+};
+
+class CurrentTracker {
+public:
+  CurrentTracker();
+
+  // Scale back to 1, nothing learned
+  void reset();
+
+  // One sensorTask tick: open-loop target -> corrected target [A]
+  float update(const CurrentTrackingInput& in);
+
+  float scale() const { return kt_scale; }
+  float deliveredWatts() const { return delivered_w; }
+  float currentError() const { return current_error_a; }  // Command - delivered [A]
+  bool limited() const { return vesc_limited; }            // The VESC does not deliver the command
+  bool saturated() const { return integral_held; }         // Anti-windup active
+
+private:
+  float integral;
+  float proportional;           // P term of the last VESC sample
+  float kt_scale;
+  float delivered_w;
+  float current_error_a;
+  float last_target_a;
+  bool vesc_limited;
+  bool integral_held;
+};
+
+// sensorTask: correct target_current_amps with this tick's VESC snapshot
+// (run_sensor_cycle())
+struct SharedVescData;
+float track_motor_current(const SharedVescData& vesc);
+void current_tracking_reset();
+const CurrentTracker& current_tracker();
+
+#endif // CURRENT_TRACKING_H
@@ -0,0 +1,157 @@
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <stdint.h>
+
+// =============================================================================
+// DEFERRED LOG (binary log ring for the control hot path)
+// =============================================================================
+// Serial.printf() formats floats and then waits for the UART TX FIFO - at
+// 115200 baud a 120 character status line holds sensorTask for ~10ms. The
+// hot path (sensorTask, vescTask) therefore only records a format ID, a
+// timestamp and the raw arguments:
+//
+//   logDeferred(LOG_POWER_CALC, filtered_torque, current_cadence_rpm, ...);
+//
+// logDrainTask (Core 1, lowest priority) pops the entries, formats them with
+// the format string from DEFERRED_LOG_FORMATS and writes them to Serial.
+// Entries flagged web_log are also passed to addLogMessage(), so the String
+// allocation and logMutex stay out of the hot path as well.
+//
+// The ring is a bounded multi-producer / single-consumer queue (per-slot
+// sequence numbers, lock-free): sensorTask (Core 0) and vescTask (Core 1)
+// may write concurrently, only the drain task reads. A full ring never
+// blocks - the entry is dropped and counted, and the drain task reports the
+// number of lost entries.
+//
+// String arguments are stored as pointers: only pass string literals.
+
+#define DEFERRED_LOG_CAPACITY   64   // Entries in the ring (power of two)
+#define DEFERRED_LOG_MAX_ARGS   12   // Maximum arguments per entry
+#define DEFERRED_LOG_DRAIN_MS   20   // Drain task period [ms]
+#define DEFERRED_LOG_LINE_MAX   256  // Longest formatted line [characters]
+
+// Format IDs - one per hot-path call site (order matches DEFERRED_LOG_FORMATS)
+enum DeferredLogId : uint8_t {
+  LOG_SENSOR_ALIVE,
+  LOG_PAS_PEDALING,
+  LOG_PAS_STOPPED,
+  LOG_PAS_POSITION_OVERFLOW,
+  LOG_MODE_CHANGED,
+  LOG_POWER_CALC,
+  LOG_MOTOR_DEBUG,
+  LOG_MOTOR_EXCESSIVE_CADENCE,
+  LOG_MOTOR_SPEED_EMERGENCY,
+  LOG_VESC_ALIVE,
+  LOG_VESC_LATENCY,
+  LOG_VESC_UART,
+  LOG_VESC_CONNECTION_LOST,
+  LOG_VESC_SAFE_MODE,
+  LOG_BATTERY_CRITICAL,
+  LOG_BATTERY_LOW,
+  LOG_BATTERY_RECOVERED_LOW,
+  LOG_BATTERY_OK,
+  LOG_DEBUG_MODE,
+  LOG_DEBUG_SENSORS,
+  LOG_DEBUG_OUTPUTS,
+  LOG_TORQUE_ZERO_CALIBRATED,
+  LOG_TORQUE_ZERO_SAVED,
+  LOG_CURRENT_TRACKING,
+  LOG_THERMAL_DERATING,
+  LOG_BATTERY_MODEL,
+  NUM_DEFERRED_LOG_IDS
+};
+
+struct DeferredLogFormat {
+  const char* format;    // printf format (d/i/u/x/f/e/g/s/c, optional 'l')
+  bool web_log;          // Also add to the web interface log (/api/logs)
+};
+
+extern const DeferredLogFormat DEFERRED_LOG_FORMATS[NUM_DEFERRED_LOG_IDS];
+
+// One raw argument (the format string tells the drain task which member)
+union DeferredLogArg {
+  int32_t i;
+  uint32_t u;
+  float f;
+  const char* s;
+};
+
+struct DeferredLogEntry {
+  uint32_t timestamp_us;
+  uint8_t id;
+  uint8_t num_args;
+  DeferredLogArg args[DEFERRED_LOG_MAX_ARGS];
+};
+
+// Counters (monotonic, readable from any task)
+struct DeferredLogStats {
+  uint32_t written;      // Entries accepted by the ring
+  uint32_t dropped;      // Entries lost because the ring was full
+  uint32_t drained;      // Entries formatted by the drain task
+};
+
+class DeferredLogRing {
+public:
+  DeferredLogRing();
+
+  // Producer side (any task, never blocks). Returns false if the ring was full.
+  bool push(uint8_t id, uint32_t timestamp_us, const DeferredLogArg* args, uint8_t num_args);
+
+  // Consumer side (drain task only). Returns false if the ring is empty.
+  bool pop(DeferredLogEntry& entry);
+
+  DeferredLogStats stats() const;
+
+  // Drops since the last call (drain task only - for the "entries lost" line)
+  uint32_t takeNewDrops();
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> sequence;
+    DeferredLogEntry entry;
+  };
+
+  Slot slots[DEFERRED_LOG_CAPACITY];
+  std::atomic<uint32_t> head;    // Next position to reserve (producers)
+  uint32_t tail;                 // Next position to read (consumer only)
+  uint32_t reported_drops;       // Consumer only
+  std::atomic<uint32_t> written;
+  std::atomic<uint32_t> dropped;
+  std::atomic<uint32_t> drained;
+};
+
+// Global ring used by logDeferred() and logDrainTask
+extern DeferredLogRing deferredLogRing;
+
+// Argument packing (overloads instead of varargs so floats stay 32-bit)
+inline DeferredLogArg deferredLogArg(int value)           { DeferredLogArg a; a.i = value; return a; }
+inline DeferredLogArg deferredLogArg(long value)          { DeferredLogArg a; a.i = (int32_t)value; return a; }
+inline DeferredLogArg deferredLogArg(unsigned int value)  { DeferredLogArg a; a.u = value; return a; }
+inline DeferredLogArg deferredLogArg(unsigned long value) { DeferredLogArg a; a.u = (uint32_t)value; return a; }
+inline DeferredLogArg deferredLogArg(float value)         { DeferredLogArg a; a.f = value; return a; }
+inline DeferredLogArg deferredLogArg(double value)        { DeferredLogArg a; a.f = (float)value; return a; }
+inline DeferredLogArg deferredLogArg(const char* value)   { DeferredLogArg a; a.s = value; return a; }
+
+// Record one log line in the global ring (hot path - no formatting, no I/O)
+template <typename... Args>
+inline bool logDeferred(DeferredLogId id, Args... args) {
+  static_assert(sizeof...(Args) <= DEFERRED_LOG_MAX_ARGS, "Too many deferred log arguments");
+  DeferredLogArg packed[sizeof...(Args) + 1] = { deferredLogArg(args)... };
+  return deferredLogRing.push(id, micros(), packed, sizeof...(Args));
+}
+
+// Format one entry into buffer (always terminated). Returns the length.
+size_t formatDeferredLogEntry(const DeferredLogEntry& entry, char* buffer, size_t size);
+
+// Pop up to max_entries, write them as lines to out (and the web log), report
+// new drops. Returns the number of entries written.
+size_t drainDeferredLog(DeferredLogRing& ring, Print& out, size_t max_entries);
+
+// Drain task (Core 1, priority 1) - created by setupDeferredLog()
+void logDrainTask(void *pvParameters);
+void setupDeferredLog();
+
+#endif // DEFERRED_LOG_H
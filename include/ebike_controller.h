@@ -2,12 +2,15 @@
 #define EBIKE_CONTROLLER_H
 
 #include <Arduino.h>
+#include "seqlock.h"
+#include "assist_map.h"
 
 // ESP32 FreeRTOS Headers - verwende die echten ESP32 FreeRTOS Typen
 #ifdef ESP32
   #include "freertos/FreeRTOS.h"
   #include "freertos/task.h"
   #include "freertos/semphr.h"
+  #include "freertos/queue.h"
 #else
   #error "This multi-core implementation is designed for ESP32 only"
 #endif
@@ -27,25 +30,31 @@
 #define BATTERY_CRITICAL_THRESHOLD 10.0 // Critical battery threshold [%] - fast blinking
 #define BATTERY_CRITICAL_VOLTAGE 40.8  // Critical voltage for 48V battery (20% = ~40.8V)
 #define BATTERY_FULL_VOLTAGE     54.6  // Full voltage for 48V battery (100% = 54.6V)
+#define BATTERY_CUTOFF_VOLTAGE   39.0  // Lowest loaded voltage (13S * 3.0V, above the BMS undervoltage trip)
 #define BATTERY_LED_BLINK_INTERVAL 500 // LED blink interval in ms for low battery
 #define BATTERY_LED_FAST_BLINK_INTERVAL 200 // LED fast blink interval in ms for critical battery
 
 // Torque sensor calibration (corrected values after GND connection)
 #define TORQUE_SENSOR_PIN   36     // Analog pin for torque sensor on ESP32 (ADC1_CH0, SVP)
-#define TORQUE_STANDSTILL   2880   // ADC value at neutral position (ESP32: 12-bit ADC = 0-4095, 3.3V)
+#define TORQUE_STANDSTILL   2880   // ADC value at neutral position (ESP32: 12-bit ADC = 0-4095, 3.3V) - auto-zero start value
 #define TORQUE_MAX_FORWARD  4095   // ADC value at maximum forward torque
 #define TORQUE_MAX_BACKWARD 0      // ADC value at maximum backward torque  
-#define TORQUE_MAX_NM       300.0  // Maximum torque [Nm] - Updated based on 60kg@175mm test (103Nm real)
-#define TORQUE_THRESHOLD    30     // Minimum deviation from standstill for valid signal (~3Nm sensitivity)
+#define TORQUE_MAX_NM       300.0  // Maximum torque [Nm] (clamp) and full scale of the linear default calibration - measured curve: torque_calibration.h
+#define TORQUE_THRESHOLD    15     // Minimum deviation from the learned zero for valid signal (~1.5Nm sensitivity)
 
 // PAS sensor configuration
 #define PAS_PULSES_PER_REV  8      // 8 Pulses per revolution on each pin (corrected)
 #define CADENCE_WINDOW_MS   1000   // Time window for cadence calculation [ms]
 #define PEDAL_TIMEOUT_MS    1000   // Max. time without pedal activity [ms]
 #define MODE_SWITCH_STEPS   3      // Number of reverse steps for mode switching
+#define PAS_BOUNCE_US       1500   // Edge reversing the last one within this time = contact bounce [us]
+#define PAS_STOP_INTERVALS  3.0    // Pedaling stopped when the next edge is this many expected intervals late
 
 // Speed-dependent assist configuration
 #define NUM_SPEED_POINTS    6      // Number of speed interpolation points
+#define MAX_ASSIST_PROFILES 10     // Size of ASSIST_PROFILES / LIGHT_MODES
+#define ASSIST_MAP_CADENCE_POINTS 4  // Cadence axis of the profile assist maps
+#define ASSIST_MAP_POWER_POINTS   3  // Human power axis of the profile assist maps
 
 // Hardware pins (ESP32 DevKit v1 Pin Layout)
 // Note: 5V sensors need logic level converter for ESP32 (3.3V)
@@ -57,9 +66,21 @@
 #define WHEEL_SPEED_PIN    5       // GPIO5 - Wheel speed sensor (future use, interrupt capable)
 // VESC uses Hardware UART2: RX=GPIO16 (RX2), TX=GPIO17 (TX2)
 
-// Ramping/Smoothing constants
-#define CURRENT_RAMP_RATE   2.0    // A/s - Current rise rate
-#define CURRENT_FILTER      0.8    // Low-pass filter (0.0-1.0, higher = slower)
+// Motor command path (sensorTask -> vescTask -> VESC UART)
+#define MOTOR_COMMAND_KEEPALIVE_MS  50     // Re-send unchanged current at least every 50ms (VESC timeout)
+#define MOTOR_COMMAND_DEADBAND_A    0.01   // Smaller changes are not worth a UART frame [A]
+
+// VESC UART polling (vescTask owns the UART, VescUart::update() never blocks)
+#define VESC_UART_POLL_MS           2      // Max. time between two RX drains (~23 bytes at 115200 baud)
+#define VESC_FAST_POLL_MS           20     // rpm / motor current / voltage (50Hz, selective request)
+#define VESC_SLOW_POLL_MS           1000   // + temperatures, duty, Ah, Wh, tachometer (1Hz)
+#define VESC_HOUSEKEEPING_MS        50     // Shared data publish / status output (20Hz)
+
+// Ramping/Smoothing constants (motor command shaping, current_shaper.h; 0 = off)
+#define CURRENT_RAMP_RATE   20.0   // A/s - Current rise rate
+#define CURRENT_FALL_RATE   40.0   // A/s - Current fall rate (safety cuts are immediate)
+#define CURRENT_JERK_LIMIT  400.0  // A/s^2 - Change of the ramp rate (S-curve)
+#define CURRENT_FILTER      0.5    // Low-pass filter per 10ms tick (0.0-1.0, higher = slower)
 
 // Motor parameters for Q100C (from Motor.md)
 #define MOTOR_GEAR_RATIO    14.2   // Q100C gear ratio
@@ -71,10 +92,17 @@
 // Max efficiency: 7.17 Nm @ 5.28 A → K_t = 1.36 Nm/A
 // Max torque: 20.04 Nm @ 13.37 A → K_t = 1.50 Nm/A
 // Average motor constant: K_t ≈ 1.43 Nm/A
+// calculate_assist_power() uses K_t(I, rpm) from the same data (motor_map.h),
+// this average is the start of the map inversion
 #define MOTOR_CONSTANT_KT   1.43   // Torque constant [Nm/A] - from Q100C performance data
 #define MOTOR_NOMINAL_WHEEL_RPM_36V  201  // Q100C nominal wheel RPM at 36V
 #define MOTOR_NOMINAL_WHEEL_RPM_48V  268  // Q100C nominal wheel RPM at 48V (201×48/36)
 
+// Losses for the delivered power estimate (closed-loop tracking, current_tracking.h)
+#define MOTOR_PHASE_RESISTANCE  0.3    // Phase resistance [Ohm]
+#define MOTOR_GEAR_EFFICIENCY   0.9    // Planetary gear
+#define VESC_EFFICIENCY         0.97   // Controller, battery -> phases
+
 // =============================================================================
 // FREERTOS MULTI-CORE DECLARATIONS
 // =============================================================================
@@ -83,16 +111,18 @@
 extern TaskHandle_t sensorTaskHandle;
 extern TaskHandle_t vescTaskHandle;
 
-// Semaphores for thread-safe data sharing
-extern SemaphoreHandle_t dataUpdateSemaphore;
-extern SemaphoreHandle_t motorCommandSemaphore;
+// Motor command mailbox (length 1, overwritten by sensorTask every tick)
+extern QueueHandle_t motorCommandQueue;
 
-// Shared data structures (protected by semaphores)
+// Shared data structures
+// SharedSensorData / SharedVescData are published as lock-free seqlock
+// snapshots (see seqlock.h): the writer never blocks, readers get a copy.
 struct SharedSensorData {
   float cadence_rpm;
   float cadence_rps;
   float torque_nm;
   float filtered_torque;
+  float torque_peak_nm;
   int current_mode;
   bool motor_enabled;
   unsigned long last_update;
@@ -102,8 +132,11 @@ struct SharedVescData {
   float speed_kmh;
   bool data_valid;
   float actual_current;
+  float input_current;            // avgInputCurrent (battery side)
   float battery_voltage;
   float battery_percentage;
+  float battery_resistance;       // Estimated pack internal resistance [Ohm]
+  float battery_ocv;              // Estimated open-circuit voltage [V] (0 = no sample yet)
   
   // Extended VESC data for web interface
   float rpm;
@@ -113,20 +146,33 @@ struct SharedVescData {
   float amp_hours;
   float watt_hours;
   
+  uint32_t values_count;          // GET_VALUES answers so far (new sample when it changes)
+  uint32_t temps_count;           // ... of them with temp_mosfet / temp_motor (slow poll)
   unsigned long last_update;
 };
 
 struct SharedMotorCommand {
-  float target_current;
-  bool command_ready;
+  float target_current;           // Already 0 when the motor is disabled
   unsigned long timestamp;
+  uint32_t sample_time_us;        // micros() when the sensor tick sampled PAS/torque
+  uint32_t queued_time_us;        // micros() when the command entered the mailbox
   bool test_mode;
   unsigned long test_end_time;
 };
 
-extern SharedSensorData sharedSensorData;
-extern SharedVescData sharedVescData;
-extern SharedMotorCommand sharedMotorCommand;
+// Achieved command latency, measured by vescTask after each UART write
+struct MotorCommandLatency {
+  uint32_t pedal_to_wire_us;      // Last: sensor sample -> SET_CURRENT frame handed to UART
+  uint32_t pedal_to_wire_max_us;  // Worst case since boot
+  float pedal_to_wire_avg_us;     // Moving average
+  uint32_t queue_to_wire_us;      // Last: mailbox write -> frame handed to UART
+  uint32_t queue_to_wire_max_us;  // Worst case since boot
+  uint32_t commands_sent;
+};
+
+extern SeqlockSnapshot<SharedSensorData> sharedSensorData;       // Written by sensorTask only
+extern SeqlockSnapshot<SharedVescData> sharedVescData;           // Written by vescTask only
+extern SeqlockSnapshot<MotorCommandLatency> motorCommandLatency; // Written by vescTask only
 
 // =============================================================================
 // TELEMETRY CONFIGURATION (optional)
@@ -146,12 +192,16 @@ extern bool enable_ble_telemetry;       // Enable BLE Interface with telemetry
 // SPEED-DEPENDENT ASSIST PROFILES
 // =============================================================================
 
+// Speed x cadence x human power map of a profile (assist_map.h)
+typedef AssistMap<NUM_SPEED_POINTS, ASSIST_MAP_CADENCE_POINTS, ASSIST_MAP_POWER_POINTS> AssistProfileMap;
+
 // Assist profile structure
 struct AssistProfile {
   const char* name;
   const char* description;
   bool hasLight;
   float profile[NUM_SPEED_POINTS];
+  const AssistProfileMap* map;     // Optional: replaces profile[] (nullptr = speed only)
 };
 
 // Available assist profiles (defined in config.cpp)
@@ -167,20 +217,23 @@ extern const int NUM_ACTIVE_PROFILES;
 // [0] = Profile 1, [1] = Profile 2, etc. (based on NUM_ACTIVE_PROFILES)
 extern float ASSIST_PROFILES[][NUM_SPEED_POINTS];
 
+// Assist maps per mode, nullptr for speed-only profiles
+extern const AssistProfileMap* ASSIST_MAPS[];
+
 // Light modes per assist mode (dynamically sized)
 extern bool LIGHT_MODES[];
 
 // PAS sensor state variables
 extern int pos;                    // Pedal position (for mode switching)
-extern int a, b;                   // Hall sensor states
+extern int a, b;                   // Hall sensor states (GPIO PAS counter)
 extern int pedal_direction;        // Current pedal direction: 1=forward, -1=backward, 0=standstill
 extern unsigned long last_pulse_time;
 extern unsigned long pulse_intervals[4];
 extern int pulse_index;
 
-// Interrupt-based PAS sensor variables
-extern volatile bool pas_interrupt_flag;  // Flag for new PAS data
-extern volatile unsigned long last_interrupt_time;  // Time of last interrupt
+// PAS counter statistics
+extern unsigned long pas_edges_decoded;        // Edges counted by the PAS counter (both directions)
+extern unsigned long pas_invalid_transitions;  // Both levels changed at once (GPIO PAS counter missed an edge)
 extern volatile int quadrature_pulses_per_rev;  // Actual pulses per revolution (32 with quadrature)
 extern volatile unsigned long last_revolution_time;  // Time of last full revolution
 
@@ -189,7 +242,8 @@ extern float current_cadence_rpm;     // Current cadence [RPM]
 extern float current_cadence_rps;     // Current cadence [RPS]
 extern int raw_torque_value;          // Raw ADC value (0-1023)
 extern float crank_torque_nm;         // Torque [Nm]
-extern float filtered_torque;         // Filtered torque
+extern float filtered_torque;         // Torque averaged over crank angle (instantaneous when the crank stands)
+extern float crank_torque_peak_nm;    // Highest torque in the last pedal stroke [Nm]
 
 // Speed and assist
 extern float current_speed_kmh;       // Current speed [km/h]
@@ -202,10 +256,13 @@ extern float human_power_watts;       // Human power [W]
 extern float assist_power_watts;      // Target motor power [W]
 extern float target_current_amps;     // Target motor current [A]
 extern float actual_current_amps;     // Actual motor current [A]
+extern float motor_current_limit_amps; // MAX_MOTOR_CURRENT after thermal derating [A]
 
 // System status
 extern int current_mode;              // Current assist mode (0 to NUM_ACTIVE_PROFILES-1)
 extern bool motor_enabled;            // Motor on/off
+extern bool motor_cut;                // Safety cut: command 0 now, no ramp down
+extern float commanded_current_amps;  // Shaped motor command [A]
 extern bool lightOn;                  // Light status
 extern unsigned long last_pedal_activity;
 extern unsigned long last_loop_time;
@@ -273,30 +330,37 @@ extern bool debug_test_completed;          // Flag if all tests completed
 void sensorTask(void *pvParameters);
 void vescTask(void *pvParameters);
 
+// One iteration of each task loop (control_cycle.cpp, also run by the host simulator)
+SharedMotorCommand run_sensor_cycle();                   // sensorTask - 10ms tick
+void run_vesc_cycle(const SharedMotorCommand* command);  // vescTask - command or NULL on poll timeout
+
 // Initialization
 void ebike_setup();
 void initializeAssistProfiles(); // Initialize assist profiles from active configuration
 
 // Sensor functions
 void read_pas_sensors();
-void pas_interrupt_handler();      // Interrupt handler for PAS sensors (ESP32 doesn't need IRAM_ATTR by default)
+void pas_interrupt_handler();      // GPIO PAS counter interrupt (both pins, CHANGE)
+void reset_pas_decoder();          // Restart PAS counter and decoder at position 0
 void update_cadence();
 void update_torque();
+void update_crank_torque();        // After update_cadence() and update_torque()
 
 // VESC communication
-void update_vesc_data();
+void update_vesc_data();           // Non-blocking - called by vescTask every few ms
 
 // Battery monitoring
 void update_battery_status();
 void update_battery_led();
 
 // Assist calculation
+void build_assist_tables();      // Compile ASSIST_PROFILES into lookup tables (assist_table.h)
 void calculate_speed_dependent_assist();
 void calculate_assist_power();
 
 // Motor control
 void update_motor_status();
-void send_motor_command();
+void send_motor_command(const SharedMotorCommand& command);  // vescTask only - owns the UART
 
 // Mode management
 void update_mode_selection();
@@ -0,0 +1,24 @@
+#ifndef LOG_MESSAGES_H
+#define LOG_MESSAGES_H
+
+#include <Arduino.h>
+
+// =============================================================================
+// LOG MESSAGES (ring of the last MAX_LOG_MESSAGES lines)
+// =============================================================================
+// Written from any task, shown by the web interface (/api/logs). Messages
+// are dropped until the WiFi task has created logMutex.
+
+#define MAX_LOG_MESSAGES 20          // Maximum Anzahl gespeicherter Log-Nachrichten
+
+// Log message functions
+void addLogMessage(const String& message);
+void addLogMessage(const char* message);
+
+// Log storage (protected by logMutex)
+extern SemaphoreHandle_t logMutex;
+extern String logMessages[MAX_LOG_MESSAGES];
+extern int logMessageCount;
+extern int logMessageIndex;
+
+#endif // LOG_MESSAGES_H
@@ -0,0 +1,35 @@
+#ifndef MOTOR_MAP_H
+#define MOTOR_MAP_H
+
+// =============================================================================
+// MOTOR MAP (Q100C: Kt and efficiency over current x wheel speed)
+// =============================================================================
+// MOTOR_CONSTANT_KT is one average over the Q100C load test, but the hub
+// torque per amp is 1.36 Nm/A at 5.28 A and 1.50 Nm/A at 13.37 A: the drag
+// of gear and iron (~1.2 Nm) eats a larger share of small currents. The
+// map holds Kt(I, rpm) and the efficiency on a grid of
+// MOTOR_MAP_CURRENT_STEP x MOTOR_MAP_RPM_STEP (motor_map_table.h, generated
+// by tools/motor_map_gen.py from _documentation/Motor/files/Q100C-Curve.csv),
+// interpolated bilinearly and held at the axis ends.
+//
+// The current for a wanted hub torque is found by Newton iteration on
+// T(I) = Kt(I, rpm) * I, starting from MOTOR_CONSTANT_KT: T(I) is smooth and
+// increasing, so it converges in 2-3 iterations (never more than
+// MOTOR_MAP_MAX_ITERATIONS).
+//
+// Currents are phase currents: the load test ran at full throttle, where
+// battery and phase current are the same.
+
+#define MOTOR_MAP_MAX_ITERATIONS   6
+#define MOTOR_MAP_TOLERANCE_A      0.005f   // Newton step small enough to stop [A]
+#define MOTOR_MAP_MIN_SLOPE        0.2f     // dT/dI floor below the drag [Nm/A]
+
+float motor_map_kt(float current_a, float wheel_rpm);           // [Nm/A]
+float motor_map_efficiency(float current_a, float wheel_rpm);   // 0..1, mechanical / electrical
+float motor_map_torque(float current_a, float wheel_rpm);       // Hub torque [Nm]
+
+// Current for a hub torque (0 for torque <= 0). iterations: Newton steps
+// taken, for tests and benchmarks.
+float motor_map_current(float torque_nm, float wheel_rpm, int* iterations = nullptr);
+
+#endif // MOTOR_MAP_H
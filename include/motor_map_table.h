@@ -0,0 +1,86 @@
+#ifndef MOTOR_MAP_TABLE_H
+#define MOTOR_MAP_TABLE_H
+
+// Generated by tools/motor_map_gen.py from _documentation/Motor/files/Q100C-Curve.csv - do not edit.
+// Model: R 0.621 Ohm, drag 22.3 W (1.18 Nm below 180 rpm), Kt 1.521 + 0.0051 * I Nm/A
+
+#define MOTOR_MAP_CURRENT_POINTS  33
+#define MOTOR_MAP_CURRENT_STEP    0.50f    // [A], axis from 0
+#define MOTOR_MAP_RPM_POINTS      9
+#define MOTOR_MAP_RPM_STEP        40.0f    // [wheel rpm], axis from 0
+
+// Hub torque per amp [Nm/A], [current][rpm]
+static const float MOTOR_MAP_KT[MOTOR_MAP_CURRENT_POINTS][MOTOR_MAP_RPM_POINTS] = {
+  {0.0000, 0.0000, 0.0000, 0.0000, 0.0000, 0.0000, 0.0000, 0.0000, 0.0000},
+  {0.0000, 0.0000, 0.0000, 0.0000, 0.0000, 0.0000, 0.0000, 0.0033, 0.1933},
+  {0.3456, 0.3456, 0.3456, 0.3456, 0.3456, 0.4619, 0.6392, 0.7658, 0.8608},
+  {0.7415, 0.7415, 0.7415, 0.7415, 0.7415, 0.8190, 0.9372, 1.0217, 1.0850},
+  {0.9408, 0.9408, 0.9408, 0.9408, 0.9408, 0.9989, 1.0875, 1.1509, 1.1984},
+  {1.0613, 1.0613, 1.0613, 1.0613, 1.0613, 1.1078, 1.1787, 1.2294, 1.2674},
+  {1.1425, 1.1425, 1.1425, 1.1425, 1.1425, 1.1813, 1.2404, 1.2826, 1.3142},
+  {1.2012, 1.2012, 1.2012, 1.2012, 1.2012, 1.2344, 1.2851, 1.3213, 1.3484},
+  {1.2459, 1.2459, 1.2459, 1.2459, 1.2459, 1.2750, 1.3193, 1.3510, 1.3747},
+  {1.2812, 1.2812, 1.2812, 1.2812, 1.2812, 1.3070, 1.3465, 1.3746, 1.3957},
+  {1.3100, 1.3100, 1.3100, 1.3100, 1.3100, 1.3332, 1.3687, 1.3940, 1.4130},
+  {1.3340, 1.3340, 1.3340, 1.3340, 1.3340, 1.3551, 1.3873, 1.4104, 1.4276},
+  {1.3544, 1.3544, 1.3544, 1.3544, 1.3544, 1.3737, 1.4033, 1.4244, 1.4402},
+  {1.3720, 1.3720, 1.3720, 1.3720, 1.3720, 1.3899, 1.4172, 1.4367, 1.4513},
+  {1.3875, 1.3875, 1.3875, 1.3875, 1.3875, 1.4041, 1.4295, 1.4475, 1.4611},
+  {1.4013, 1.4013, 1.4013, 1.4013, 1.4013, 1.4168, 1.4404, 1.4573, 1.4700},
+  {1.4136, 1.4136, 1.4136, 1.4136, 1.4136, 1.4282, 1.4503, 1.4662, 1.4780},
+  {1.4248, 1.4248, 1.4248, 1.4248, 1.4248, 1.4385, 1.4594, 1.4743, 1.4855},
+  {1.4351, 1.4351, 1.4351, 1.4351, 1.4351, 1.4480, 1.4677, 1.4818, 1.4923},
+  {1.4445, 1.4445, 1.4445, 1.4445, 1.4445, 1.4567, 1.4754, 1.4887, 1.4987},
+  {1.4532, 1.4532, 1.4532, 1.4532, 1.4532, 1.4649, 1.4826, 1.4953, 1.5048},
+  {1.4614, 1.4614, 1.4614, 1.4614, 1.4614, 1.4725, 1.4894, 1.5014, 1.5105},
+  {1.4690, 1.4690, 1.4690, 1.4690, 1.4690, 1.4796, 1.4957, 1.5072, 1.5159},
+  {1.4762, 1.4762, 1.4762, 1.4762, 1.4762, 1.4863, 1.5017, 1.5128, 1.5210},
+  {1.4830, 1.4830, 1.4830, 1.4830, 1.4830, 1.4927, 1.5075, 1.5180, 1.5260},
+  {1.4895, 1.4895, 1.4895, 1.4895, 1.4895, 1.4988, 1.5130, 1.5231, 1.5307},
+  {1.4956, 1.4956, 1.4956, 1.4956, 1.4956, 1.5046, 1.5182, 1.5280, 1.5353},
+  {1.5015, 1.5015, 1.5015, 1.5015, 1.5015, 1.5101, 1.5233, 1.5327, 1.5397},
+  {1.5072, 1.5072, 1.5072, 1.5072, 1.5072, 1.5155, 1.5281, 1.5372, 1.5440},
+  {1.5126, 1.5126, 1.5126, 1.5126, 1.5126, 1.5206, 1.5329, 1.5416, 1.5481},
+  {1.5179, 1.5179, 1.5179, 1.5179, 1.5179, 1.5256, 1.5374, 1.5459, 1.5522},
+  {1.5229, 1.5229, 1.5229, 1.5229, 1.5229, 1.5304, 1.5419, 1.5500, 1.5562},
+  {1.5278, 1.5278, 1.5278, 1.5278, 1.5278, 1.5351, 1.5462, 1.5541, 1.5600}
+};
+
+// Mechanical out / electrical in, [current][rpm]
+static const float MOTOR_MAP_EFFICIENCY[MOTOR_MAP_CURRENT_POINTS][MOTOR_MAP_RPM_POINTS] = {
+  {0.0000, 0.0000, 0.0000, 0.0000, 0.0000, 0.0000, 0.0000, 0.0000, 0.0000},
+  {0.0000, 0.0000, 0.0000, 0.0000, 0.0000, 0.0000, 0.0000, 0.0022, 0.1262},
+  {0.0000, 0.2065, 0.2160, 0.2194, 0.2211, 0.2969, 0.4122, 0.4951, 0.5574},
+  {0.0000, 0.4236, 0.4523, 0.4628, 0.4682, 0.5208, 0.5987, 0.6549, 0.6973},
+  {0.0000, 0.5149, 0.5603, 0.5773, 0.5862, 0.6282, 0.6882, 0.7316, 0.7643},
+  {0.0000, 0.5575, 0.6176, 0.6406, 0.6527, 0.6892, 0.7390, 0.7750, 0.8023},
+  {0.0000, 0.5769, 0.6498, 0.6784, 0.6937, 0.7270, 0.7704, 0.8019, 0.8258},
+  {0.0000, 0.5840, 0.6682, 0.7020, 0.7201, 0.7517, 0.7909, 0.8194, 0.8411},
+  {0.0000, 0.5840, 0.6781, 0.7167, 0.7376, 0.7683, 0.8046, 0.8311, 0.8512},
+  {0.0000, 0.5797, 0.6827, 0.7256, 0.7492, 0.7795, 0.8138, 0.8388, 0.8579},
+  {0.0000, 0.5729, 0.6836, 0.7306, 0.7567, 0.7870, 0.8198, 0.8439, 0.8623},
+  {0.0000, 0.5644, 0.6820, 0.7329, 0.7613, 0.7918, 0.8237, 0.8471, 0.8650},
+  {0.0000, 0.5551, 0.6787, 0.7331, 0.7638, 0.7946, 0.8259, 0.8488, 0.8665},
+  {0.0000, 0.5452, 0.6742, 0.7319, 0.7646, 0.7960, 0.8268, 0.8495, 0.8670},
+  {0.0000, 0.5351, 0.6688, 0.7296, 0.7643, 0.7962, 0.8268, 0.8494, 0.8668},
+  {0.0000, 0.5249, 0.6628, 0.7264, 0.7631, 0.7956, 0.8260, 0.8486, 0.8660},
+  {0.0000, 0.5147, 0.6564, 0.7226, 0.7611, 0.7942, 0.8247, 0.8473, 0.8647},
+  {0.0000, 0.5047, 0.6496, 0.7184, 0.7585, 0.7923, 0.8229, 0.8456, 0.8631},
+  {0.0000, 0.4949, 0.6427, 0.7137, 0.7555, 0.7900, 0.8207, 0.8435, 0.8612},
+  {0.0000, 0.4854, 0.6357, 0.7088, 0.7521, 0.7873, 0.8182, 0.8412, 0.8590},
+  {0.0000, 0.4761, 0.6286, 0.7037, 0.7485, 0.7844, 0.8154, 0.8387, 0.8567},
+  {0.0000, 0.4670, 0.6215, 0.6985, 0.7446, 0.7812, 0.8125, 0.8360, 0.8542},
+  {0.0000, 0.4582, 0.6144, 0.6931, 0.7405, 0.7778, 0.8094, 0.8331, 0.8516},
+  {0.0000, 0.4497, 0.6073, 0.6877, 0.7364, 0.7743, 0.8062, 0.8302, 0.8489},
+  {0.0000, 0.4415, 0.6004, 0.6822, 0.7321, 0.7707, 0.8029, 0.8271, 0.8461},
+  {0.0000, 0.4335, 0.5935, 0.6767, 0.7277, 0.7669, 0.7994, 0.8240, 0.8432},
+  {0.0000, 0.4258, 0.5867, 0.6712, 0.7233, 0.7631, 0.7960, 0.8208, 0.8403},
+  {0.0000, 0.4184, 0.5800, 0.6657, 0.7188, 0.7593, 0.7924, 0.8176, 0.8373},
+  {0.0000, 0.4112, 0.5734, 0.6602, 0.7143, 0.7554, 0.7889, 0.8143, 0.8343},
+  {0.0000, 0.4042, 0.5669, 0.6548, 0.7098, 0.7514, 0.7853, 0.8110, 0.8312},
+  {0.0000, 0.3975, 0.5606, 0.6494, 0.7053, 0.7475, 0.7817, 0.8077, 0.8282},
+  {0.0000, 0.3910, 0.5544, 0.6441, 0.7008, 0.7435, 0.7780, 0.8043, 0.8251},
+  {0.0000, 0.3847, 0.5483, 0.6388, 0.6963, 0.7396, 0.7744, 0.8010, 0.8220}
+};
+
+#endif // MOTOR_MAP_TABLE_H
@@ -0,0 +1,119 @@
+#ifndef PAS_COUNTER_H
+#define PAS_COUNTER_H
+
+#include <atomic>
+#include <stdint.h>
+#include "pas_edge_ring.h"
+
+// =============================================================================
+// PAS COUNTER (quadrature position + timed steps of the crank)
+// =============================================================================
+// read_pas_sensors() sees the two PAS hall sensors only through this
+// interface:
+//   - position(): quadrature position [edges, +1 = forward], as of now
+//   - nextStep(): timed positions (micros()) captured by the interrupt, in
+//                 order - the cadence estimator works on these
+//
+// Backends:
+//   PasPcntCounter (default): ESP32 pulse counter unit in quadrature mode
+//       with its hardware glitch filter. Every edge is counted and its
+//       direction decoded without the CPU; an interrupt only fires every
+//       PAS_PCNT_STEP_EDGES edges (one magnet), when the counter reaches its
+//       limit, and records (micros(), position).
+//   PasGpioCounter: CHANGE interrupts on both pins record every edge in the
+//       PAS edge ring, nextStep() decodes them in software (one step per
+//       edge). Fallback if the PCNT unit cannot be set up.
+//
+// All methods except the interrupt handlers belong to sensorTask (begin()
+// and end() run from setup() / the tests before the task uses the counter).
+
+#define PAS_PCNT_UNIT           0      // PCNT unit (PCNT_UNIT_0)
+#define PAS_PCNT_STEP_EDGES     4      // Counter limit = edges per capture (one magnet)
+#define PAS_PCNT_FILTER_CYCLES  1000   // Glitch filter: pulses < 1000 APB cycles (12.5us) are ignored (max. 1023)
+#define PAS_STEP_RING_CAPACITY  16     // PCNT captures (power of two) - 2 revolutions
+
+struct PasStep {
+  uint32_t time_us;    // micros() when the interrupt ran
+  int32_t position;    // Quadrature position after the step [edges]
+};
+
+class PasCounter {
+public:
+  virtual ~PasCounter() {}
+
+  virtual const char* name() const = 0;
+
+  // Configure pins/peripheral and start counting. Returns false if the
+  // hardware could not be set up (the counter is then unusable).
+  virtual bool begin() = 0;
+  virtual void end() = 0;
+
+  // Drop pending steps and restart at position 0
+  virtual void reset() = 0;
+
+  // Next captured step, oldest first. Returns false when none is pending.
+  virtual bool nextStep(PasStep& step) = 0;
+
+  // Current position (also between captures for the PCNT counter)
+  virtual int32_t position() = 0;
+
+  // Steps that could not be captured or decoded (monotonic). The edge
+  // index of the next step may no longer match the crank.
+  virtual uint32_t lostSteps() const = 0;
+};
+
+// -----------------------------------------------------------------------------
+// GPIO interrupts + PAS edge ring (pas_counter_gpio.cpp)
+// -----------------------------------------------------------------------------
+class PasGpioCounter : public PasCounter {
+public:
+  PasGpioCounter();
+
+  const char* name() const override { return "gpio"; }
+  bool begin() override;
+  void end() override;
+  void reset() override;
+  bool nextStep(PasStep& step) override;
+  int32_t position() override { return decoded_position; }
+  uint32_t lostSteps() const override { return lost_steps; }
+
+private:
+  int32_t decoded_position;
+  uint32_t lost_steps;
+  uint32_t ring_drops_seen;
+};
+
+// -----------------------------------------------------------------------------
+// ESP32 pulse counter (pas_counter_pcnt.cpp)
+// -----------------------------------------------------------------------------
+class PasPcntCounter : public PasCounter {
+public:
+  PasPcntCounter();
+
+  const char* name() const override { return "pcnt"; }
+  bool begin() override;
+  void end() override;
+  void reset() override;
+  bool nextStep(PasStep& step) override;
+  int32_t position() override;
+  uint32_t lostSteps() const override { return step_ring.dropped(); }
+
+  // Counter limit interrupt (PCNT ISR service)
+  void onLimit(uint32_t time_us, uint32_t status);
+
+private:
+  PasCaptureRing<PasStep, PAS_STEP_RING_CAPACITY> step_ring;
+  std::atomic<int32_t> limit_position;  // Position at the last counter reset [edges], ISR only writes
+};
+
+extern PasGpioCounter pasGpioCounter;
+extern PasPcntCounter pasPcntCounter;
+
+// Counter used by read_pas_sensors() (PCNT unless selected otherwise)
+extern PasCounter* pasCounter;
+
+// Start counter, stop the previous one and reset the decoder. Returns false
+// (and keeps the previous counter) if counter->begin() fails.
+bool select_pas_counter(PasCounter* counter);
+
+#endif // PAS_COUNTER_H
@@ -0,0 +1,91 @@
+#ifndef PAS_EDGE_RING_H
+#define PAS_EDGE_RING_H
+
+#include <atomic>
+#include <stdint.h>
+
+// =============================================================================
+// PAS CAPTURE RINGS (PAS interrupt -> sensorTask, single producer / single consumer)
+// =============================================================================
+// The PAS interrupts only record what happened and when; read_pas_sensors()
+// runs every 10ms in sensorTask and takes everything since the last tick in
+// order, with its own timestamps. One flag per tick would lose edges and
+// time them to the tick.
+//
+//   PasEdgeRing: GPIO PAS counter - every edge of PAS_PIN_A/PAS_PIN_B as
+//                (micros(), A/B levels after the edge). At 200 RPM the crank
+//                makes ~107 edges/s (32 per revolution).
+//   PCNT PAS counter: one (micros(), position) capture per magnet
+//                (pas_counter.h)
+//
+// Producer: the PAS interrupt (runs on Core 1, where setup() installed it)
+// Consumer: sensorTask (Core 0)
+//
+// head is only written by the producer, tail only by the consumer. The
+// release store of head publishes the entry, the release store of tail hands
+// the slot back. No locks, no read-modify-write: safe across cores and from
+// an ISR. A full ring drops the entry and counts it - the consumer then
+// resynchronizes.
+//
+// push() is always inlined so it ends up in the IRAM_ATTR interrupt handler.
+
+#define PAS_EDGE_RING_CAPACITY  64   // GPIO edges (power of two) - 0.6s at 200 RPM
+
+struct PasEdge {
+  uint32_t time_us;    // micros() when the interrupt ran
+  uint8_t levels;      // (A << 1) | B after the edge
+};
+
+template <typename Entry, uint32_t Capacity>
+class PasCaptureRing {
+public:
+  PasCaptureRing() : head(0), tail(0), dropped_entries(0) {
+    static_assert((Capacity & (Capacity - 1)) == 0, "PAS capture ring capacity must be a power of two");
+  }
+
+  // Producer (PAS interrupt only). Returns false if the ring was full.
+  inline __attribute__((always_inline)) bool push(const Entry& entry) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= Capacity) {
+      dropped_entries.store(dropped_entries.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    entries[h & (Capacity - 1)] = entry;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer (sensorTask only). Returns false if the ring is empty.
+  bool pop(Entry& out) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    out = entries[t & (Capacity - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only: discard everything recorded so far
+  void clear() {
+    tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+  }
+
+  // Entries lost because the ring was full (monotonic)
+  uint32_t dropped() const {
+    return dropped_entries.load(std::memory_order_relaxed);
+  }
+
+private:
+  Entry entries[Capacity];
+  std::atomic<uint32_t> head;             // Next slot to write (producer)
+  std::atomic<uint32_t> tail;             // Next slot to read (consumer)
+  std::atomic<uint32_t> dropped_entries;  // Written by the producer only
+};
+
+typedef PasCaptureRing<PasEdge, PAS_EDGE_RING_CAPACITY> PasEdgeRing;
+
+// Filled by pas_interrupt_handler(), drained by PasGpioCounter::nextStep()
+extern PasEdgeRing pasEdgeRing;
+
+#endif // PAS_EDGE_RING_H
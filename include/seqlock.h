@@ -0,0 +1,97 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+// =============================================================================
+// SEQLOCK SNAPSHOT PUBLISHER (single writer, many readers, lock-free)
+// =============================================================================
+// Used for SharedSensorData and SharedVescData. Exactly ONE task may call
+// publish() for a given snapshot:
+//   - sharedSensorData: sensorTask (Core 0)
+//   - sharedVescData:   vescTask   (Core 1)
+// Any task may call read() at any time.
+//
+// Writer: never waits. It makes the sequence odd, stores the payload and makes
+//         the sequence even again.
+// Reader: copies the payload and retries if the sequence was odd or changed
+//         during the copy (torn read). Copies are a few dozen bytes, so a
+//         retry only happens if the writer hit the exact same microsecond.
+//
+// The payload is kept as relaxed 32-bit atomics so a concurrent copy is well
+// defined on both the ESP32 and the host (no data race in the C++ sense).
+
+template <typename T>
+class SeqlockSnapshot {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SeqlockSnapshot requires a plain data struct");
+
+public:
+  SeqlockSnapshot() : sequence(0) {
+    for (size_t i = 0; i < NUM_WORDS; i++) {
+      words[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Publish a new snapshot (writer task only - never blocks)
+  void publish(const T& value) {
+    uint32_t buffer[NUM_WORDS] = {0};
+    memcpy(buffer, &value, sizeof(T));
+
+    uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);  // odd = write in progress
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (size_t i = 0; i < NUM_WORDS; i++) {
+      words[i].store(buffer[i], std::memory_order_relaxed);
+    }
+
+    sequence.store(seq + 2, std::memory_order_release);  // even = stable
+  }
+
+  // Single attempt - returns false if the copy was torn by a concurrent publish()
+  bool tryRead(T& out) const {
+    uint32_t seq_before = sequence.load(std::memory_order_acquire);
+    if (seq_before & 1) {
+      return false;  // Writer is in the middle of an update
+    }
+
+    uint32_t buffer[NUM_WORDS];
+    for (size_t i = 0; i < NUM_WORDS; i++) {
+      buffer[i] = words[i].load(std::memory_order_relaxed);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence.load(std::memory_order_relaxed) != seq_before) {
+      return false;  // Torn read
+    }
+
+    memcpy(&out, buffer, sizeof(T));
+    return true;
+  }
+
+  // Consistent copy of the latest snapshot (retries on torn reads)
+  T read() const {
+    T out;
+    while (!tryRead(out)) {
+      // Writer holds the sequence for well under a microsecond - just retry
+    }
+    return out;
+  }
+
+  // Number of snapshots published so far
+  uint32_t version() const {
+    return sequence.load(std::memory_order_acquire) >> 1;
+  }
+
+private:
+  static const size_t NUM_WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+  std::atomic<uint32_t> sequence;
+  std::atomic<uint32_t> words[NUM_WORDS];
+};
+
+#endif // SEQLOCK_H
@@ -0,0 +1,109 @@
+#ifndef TASK_PERF_H
+#define TASK_PERF_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <stdint.h>
+
+// =============================================================================
+// TASK PERFORMANCE HISTOGRAMS (/api/perf, BLE characteristic ...a011)
+// =============================================================================
+// Each instrumented task brackets one loop iteration:
+//
+//   taskPerfBeginPeriodic(TASK_PERF_SENSOR);   // or taskPerfBegin(id, release_us)
+//   ... one iteration ...
+//   taskPerfEnd(TASK_PERF_SENSOR);
+//
+// and records per iteration:
+//   - run time:  CPU cycle counter (ESP.getCycleCount()) from begin to end.
+//                Tasks are pinned, so both readings come from the same core.
+//                Includes preemption by higher-priority tasks/ISRs on that core.
+//   - jitter:    how late the iteration started after its release time (the
+//                vTaskDelayUntil grid, or the event that woke the task)
+//   - deadline:  iterations that ended later than release + deadline_us
+//
+// Histograms are log-bucketed and fixed size: 1us resolution below 8us, then
+// PERF_SUB_BUCKETS buckets per power of two up to ~2s. Only the owning task
+// writes its histograms (plain relaxed load/store, no locked RMW); any task
+// may read them. A reader can see one iteration half-counted, nothing worse.
+
+#define PERF_SUB_BUCKETS      4     // Buckets per power of two (max. 25% wide)
+#define PERF_NUM_BUCKETS      80    // Covers 0 .. ~2s [us], larger values go to the last bucket
+#define PERF_JSON_MAX         6144  // Buffer for the full /api/perf answer
+#define PERF_JSON_COMPACT_MAX 512   // BLE characteristic (max. attribute length)
+
+enum TaskPerfId : uint8_t {
+  TASK_PERF_SENSOR,
+  TASK_PERF_VESC,
+  TASK_PERF_WIFI,
+  TASK_PERF_BLE,
+  NUM_TASK_PERF
+};
+
+class PerfHistogram {
+public:
+  PerfHistogram();
+
+  // Owner task only
+  void record(uint32_t value_us);
+  void reset();
+
+  // Any task
+  uint32_t count() const;
+  uint32_t maxValue() const;
+  uint32_t bucketCount(uint32_t index) const;
+  float mean() const;                   // From the bucket midpoints
+  uint32_t percentile(float p) const;   // Upper bound of the bucket holding quantile p (0..1)
+
+  static uint32_t bucketIndex(uint32_t value_us);
+  static uint32_t bucketLower(uint32_t index);    // Smallest value in the bucket
+  static uint32_t bucketUpper(uint32_t index);    // Largest value in the bucket
+
+private:
+  std::atomic<uint32_t> buckets[PERF_NUM_BUCKETS];
+  std::atomic<uint32_t> total;
+  std::atomic<uint32_t> maximum;
+};
+
+struct TaskPerf {
+  const char* name;            // NULL = task not registered (not in the JSON)
+  uint32_t period_us;          // Nominal period (0 = event-driven)
+  uint32_t deadline_us;        // Iteration must end within release + deadline
+
+  PerfHistogram run_time_us;
+  PerfHistogram wake_jitter_us;
+  std::atomic<uint32_t> iterations;
+  std::atomic<uint32_t> deadline_misses;
+  std::atomic<bool> reset_requested;
+
+  // Owner task state
+  uint32_t release_us;
+  uint32_t start_cycles;
+  uint32_t grid_release_us;
+  bool grid_valid;
+};
+
+extern TaskPerf taskPerf[NUM_TASK_PERF];
+
+// Call once from the task before its loop
+void taskPerfRegister(TaskPerfId id, const char* name, uint32_t period_us, uint32_t deadline_us);
+
+// Start of an iteration that should have started at release_us (micros())
+void taskPerfBegin(TaskPerfId id, uint32_t release_us);
+
+// Start of an iteration of a vTaskDelayUntil loop: the release time follows
+// the period grid (re-anchored whenever the task wakes earlier than expected)
+void taskPerfBeginPeriodic(TaskPerfId id);
+
+// End of the iteration
+void taskPerfEnd(TaskPerfId id);
+
+// Clear all histograms (each task resets its own at the next begin)
+void taskPerfRequestReset();
+
+// JSON for /api/perf (with sparse buckets) or the compact BLE summary.
+// Returns the length needed (like snprintf); the output is truncated if >= size.
+size_t taskPerfToJson(char* buffer, size_t size);
+size_t taskPerfToCompactJson(char* buffer, size_t size);
+
+#endif // TASK_PERF_H
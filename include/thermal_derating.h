@@ -0,0 +1,106 @@
+#ifndef THERMAL_DERATING_H
+#define THERMAL_DERATING_H
+
+// =============================================================================
+// PREDICTIVE THERMAL DERATING (motor_current_limit_amps)
+// =============================================================================
+// On a long climb the motor winding and the VESC FETs heat up until the VESC
+// cuts the current back on its own (l_temp_*_start 85°C .. l_temp_*_end 100°C
+// by default) - late, and the rider feels it. Instead, each heat path is a
+// lumped first-order model driven by the current we command:
+//
+//   C dT/dt = k * I^2 - (T - T_ambient) / R_th      k: loss per amp^2 [W/A^2]
+//
+//   motor:  k = MOTOR_PHASE_RESISTANCE (copper)
+//   FET:    k = THERMAL_FET_LOSS_OHM (conduction + switching)
+//
+// The model runs every sensorTask tick and is pulled towards tempMotor /
+// tempMosfet with every 1Hz VESC poll that carries them
+// (THERMAL_CORRECTION_S), so a wrong R_th or C only costs a bit of margin.
+// A reading outside THERMAL_SENSOR_MIN_C .. MAX_C (no motor NTC fitted)
+// leaves that model on its own.
+//
+// Forecast: at current I the node reaches T_ss = T_ambient + k I^2 R_th, and
+// the limit after
+//
+//   t = tau * ln((T_ss - T) / (T_ss - T_limit))     tau = R_th * C
+//
+// The current limit is the highest current whose forecast is at least
+// THERMAL_HORIZON_S away - the current that ends the horizon exactly at the
+// limit. Far below the limit that is above MAX_MOTOR_CURRENT (no derating);
+// it falls smoothly while the node heats and reaches the current the node
+// can hold indefinitely at T_limit. The limits sit below the VESC's cutback,
+// so it never has to step in.
+
+#define THERMAL_AMBIENT_C            35.0f    // Assumed ambient (hot day - errs on the safe side)
+#define THERMAL_HORIZON_S            120.0f   // Derate when the limit is closer than this
+
+#define THERMAL_MOTOR_LIMIT_C        80.0f    // Winding target max (VESC motor cutback from 85°C)
+#define THERMAL_MOTOR_RTH_K_PER_W    3.0f     // Winding -> ambient
+#define THERMAL_MOTOR_CAPACITY_J_PER_K 100.0f // Winding + stator (tau 5 min)
+
+#define THERMAL_FET_LIMIT_C          75.0f    // FET target max (VESC FET cutback from 85°C)
+#define THERMAL_FET_LOSS_OHM         0.05f    // Conduction + switching per motor amp^2
+#define THERMAL_FET_RTH_K_PER_W      8.0f     // FETs -> ambient, controller in the frame
+#define THERMAL_FET_CAPACITY_J_PER_K 30.0f    // FETs + heat spreader (tau 4 min)
+
+#define THERMAL_CORRECTION_S         10.0f    // Model -> VESC reading time constant
+#define THERMAL_SENSOR_MIN_C         -30.0f   // Plausible reading range
+#define THERMAL_SENSOR_MAX_C         150.0f
+#define THERMAL_NO_LIMIT_S           3600.0f  // Forecast "never" (steady state below the limit)
+#define THERMAL_DT_S                 0.01f    // Called once per sensorTask tick
+
+struct ThermalNodeConfig {
+  float limit_c;
+  float loss_ohm;               // Heat per amp^2 [W/A^2]
+  float rth_k_per_w;
+  float capacity_j_per_k;
+};
+
+// One heat path: lumped model, reading correction, forecast
+class ThermalNode {
+public:
+  explicit ThermalNode(const ThermalNodeConfig& config);
+
+  // Back to ambient, no reading seen
+  void reset(float ambient_c);
+
+  // One tick with current_a flowing (dt_s, ambient_c)
+  void predict(float current_a, float ambient_c, float dt_s);
+
+  // VESC reading, dt_s since the last one: the first valid one replaces the
+  // estimate, later ones pull it over THERMAL_CORRECTION_S. Implausible
+  // readings are ignored.
+  void correct(float measured_c, float dt_s);
+
+  // Seconds until the limit at a constant current_a (0 = at or above it)
+  float timeToLimit(float current_a, float ambient_c) const;
+
+  // Highest current that keeps the limit horizon_s away
+  float allowedCurrent(float ambient_c, float horizon_s) const;
+
+  float temperature() const { return temp_c; }
+  bool measured() const { return has_reading; }
+  const ThermalNodeConfig& config() const { return cfg; }
+
+private:
+  ThermalNodeConfig cfg;
+  float temp_c;
+  bool has_reading;
+};
+
+ThermalNodeConfig thermal_motor_config();
+ThermalNodeConfig thermal_fet_config();
+
+// sensorTask: advance both models with the last command and this tick's
+// VESC snapshot, set motor_current_limit_amps (run_sensor_cycle()).
+// Disabled, the models still run but the limit stays MAX_MOTOR_CURRENT; the
+// setting survives ebike_setup(), the model state does not.
+struct SharedVescData;
+void update_thermal_derating(const SharedVescData& vesc);
+void thermal_derating_reset();
+void thermal_derating_enable(bool enabled);
+const ThermalNode& thermal_motor_node();
+const ThermalNode& thermal_fet_node();
+
+#endif // THERMAL_DERATING_H
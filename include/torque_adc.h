@@ -0,0 +1,78 @@
+#ifndef TORQUE_ADC_H
+#define TORQUE_ADC_H
+
+#include <stdint.h>
+
+// =============================================================================
+// TORQUE ADC (continuous DMA sampling + CIC decimation)
+// =============================================================================
+// The ADC converts TORQUE_SENSOR_PIN continuously at TORQUE_ADC_SAMPLE_HZ;
+// the driver's DMA interrupt moves the conversions into its ring buffer in
+// frames of TORQUE_ADC_FRAME_BYTES. update_torque() drains the buffer without
+// waiting (timeout 0) and runs every conversion through a CIC decimator:
+// TORQUE_ADC_CIC_ORDER cascaded moving averages over TORQUE_ADC_DECIMATION
+// conversions, one output per 10ms (100 Hz) with sub-count resolution.
+//
+// Noise: the ESP32 ADC scatters single reads by several counts. Averaging
+// 200 conversions twice cuts uncorrelated noise by ~17x, so
+// TORQUE_THRESHOLD only has to cover the sensor, not the ADC.
+// Delay: TORQUE_ADC_CIC_ORDER / 2 outputs (10ms) plus up to one DMA frame.
+//
+// While DMA sampling runs, ADC1 belongs to the driver (no analogRead() on
+// ADC1 pins). If the driver cannot be started, update_torque() keeps using
+// one analogRead() per tick.
+//
+// sensorTask only (the driver's interrupt fills the buffer).
+
+#define TORQUE_ADC_CHANNEL       0       // ADC1_CHANNEL_0 = GPIO36 = TORQUE_SENSOR_PIN
+#define TORQUE_ADC_SAMPLE_HZ     20000   // Conversions/s (ESP32 DMA minimum)
+#define TORQUE_ADC_DECIMATION    200     // Conversions per output: 100 Hz
+#define TORQUE_ADC_CIC_ORDER     2       // Cascaded moving averages
+#define TORQUE_ADC_FRAME_BYTES   128     // Per DMA interrupt: 64 conversions = 3.2ms
+#define TORQUE_ADC_BUFFER_BYTES  2048    // Driver ring buffer: 1024 conversions = 51ms
+#define TORQUE_ADC_READ_BYTES    256     // Bytes per non-blocking read (stack buffer)
+
+class CicDecimator {
+public:
+  explicit CicDecimator(uint32_t decimation);
+
+  void reset();
+
+  // One conversion. Returns true when it completed an output.
+  bool push(uint16_t sample);
+
+  // Latest output [input units] and whether the start-up transient is over
+  // (the first TORQUE_ADC_CIC_ORDER outputs after reset() are discarded)
+  float output() const { return latest; }
+  bool ready() const { return outputs > TORQUE_ADC_CIC_ORDER; }
+
+private:
+  uint32_t decimation;
+  float scale;                                  // 1 / decimation^order
+  uint32_t integrator[TORQUE_ADC_CIC_ORDER];    // Wrap-around arithmetic, exact as long as
+  uint32_t comb_delay[TORQUE_ADC_CIC_ORDER];    // the gain fits 32 bits
+  uint32_t phase;
+  uint32_t outputs;
+  float latest;
+};
+
+struct TorqueAdcStats {
+  uint32_t conversions;   // Decimated conversions
+  uint32_t outputs;       // Decimator outputs
+  uint32_t overruns;      // Reads that reported lost DMA frames (sensorTask too slow)
+  uint32_t foreign;       // Conversions of another channel (dropped)
+};
+
+// Start/stop DMA sampling. begin() returns false if the driver could not be
+// set up - update_torque() then reads the pin once per tick.
+bool torque_adc_begin();
+void torque_adc_end();
+bool torque_adc_active();
+
+// Drain the DMA buffer (never waits) and return the latest decimated value
+// [ADC counts]. False while the decimator settles after begin().
+bool torque_adc_read(float& counts);
+
+const TorqueAdcStats& torque_adc_stats();
+
+#endif // TORQUE_ADC_H
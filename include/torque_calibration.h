@@ -0,0 +1,88 @@
+#ifndef TORQUE_CALIBRATION_H
+#define TORQUE_CALIBRATION_H
+
+#include <stdint.h>
+
+// =============================================================================
+// TORQUE CALIBRATION TABLE (ADC deviation -> crank torque, piecewise linear)
+// =============================================================================
+// Maps the deviation from the learned zero [ADC counts] to crank torque [Nm]
+// with one table per deflection direction (forward = above the zero). Each
+// table is a list of measured points (counts, Nm), starting at (0, 0),
+// counts strictly increasing and at least TORQUE_CAL_GRID_STEP apart, Nm
+// not decreasing. Beyond the last point the last segment is extended.
+//
+// The points come from tools/torque_cal_fit.py (calibration weights on the
+// horizontal crank), are stored in NVS and can be replaced at run time via
+// POST /api/torque_cal. The default table is the original linear scale
+// (TORQUE_MAX_NM at the largest possible deviation).
+//
+// Lookup is O(1): build() precomputes every segment's slope and, per
+// TORQUE_CAL_GRID_STEP counts of deviation, the segment the grid cell starts
+// in. Points are at least one cell apart, so the segment is that one or the
+// next.
+
+#define TORQUE_CAL_MAX_POINTS      12     // Per direction, including (0, 0)
+#define TORQUE_CAL_GRID_SHIFT      5
+#define TORQUE_CAL_GRID_STEP       (1 << TORQUE_CAL_GRID_SHIFT)   // 32 counts (~3 Nm)
+#define TORQUE_CAL_GRID_CELLS      (4096 >> TORQUE_CAL_GRID_SHIFT)
+#define TORQUE_CAL_VERSION         1      // NVS blob layout
+
+struct TorqueCalPoint {
+  float counts;       // Deviation from the zero [ADC counts]
+  float nm;           // Crank torque [Nm]
+};
+
+// Both directions as stored in NVS / exchanged with the web interface
+struct TorqueCalTable {
+  uint32_t version;
+  uint32_t forward_points;
+  uint32_t backward_points;
+  TorqueCalPoint forward[TORQUE_CAL_MAX_POINTS];
+  TorqueCalPoint backward[TORQUE_CAL_MAX_POINTS];
+};
+
+// One direction, compiled
+class TorqueCalCurve {
+public:
+  TorqueCalCurve();
+
+  // False (curve unchanged) if the points break the rules above
+  bool build(const TorqueCalPoint* points, uint32_t count);
+
+  // deviation >= 0 [ADC counts]
+  float torqueNm(float deviation) const {
+    uint32_t cell = (uint32_t)deviation >> TORQUE_CAL_GRID_SHIFT;
+    uint32_t i = cell_segment[cell < TORQUE_CAL_GRID_CELLS ? cell : TORQUE_CAL_GRID_CELLS - 1];
+    if (i + 1 < segments && deviation >= x[i + 1]) {
+      i++;
+    }
+    return y[i] + slope[i] * (deviation - x[i]);
+  }
+
+private:
+  uint32_t segments;
+  float x[TORQUE_CAL_MAX_POINTS];          // Segment start [counts]
+  float y[TORQUE_CAL_MAX_POINTS];          // Torque at the start [Nm]
+  float slope[TORQUE_CAL_MAX_POINTS];      // [Nm per count]
+  uint8_t cell_segment[TORQUE_CAL_GRID_CELLS];
+};
+
+bool torque_cal_table_valid(const TorqueCalTable& table);
+TorqueCalTable torque_cal_default_table();
+
+// Load the table from NVS, default table if there is none (ebike_setup)
+void torque_calibration_begin();
+
+// Signed deviation from the zero [ADC counts] -> torque [Nm] >= 0
+// (sensorTask; applies a table handed over by torque_calibration_set())
+float torque_calibration_nm(float deviation);
+
+// Any task: validate, store in NVS (persist) and hand the table to
+// sensorTask for its next tick. False if the table is invalid.
+bool torque_calibration_set(const TorqueCalTable& table, bool persist);
+
+// Table in use (any task)
+TorqueCalTable torque_calibration_table();
+
+#endif // TORQUE_CALIBRATION_H
@@ -0,0 +1,117 @@
+#ifndef TORQUE_ZERO_H
+#define TORQUE_ZERO_H
+
+#include <stdint.h>
+
+// =============================================================================
+// TORQUE ZERO OFFSET (auto-zero with drift tracking, stored in NVS)
+// =============================================================================
+// The zero point (ADC counts at no torque) drifts with temperature and with
+// the 12V step-up supply, so a fixed TORQUE_STANDSTILL either shows phantom
+// torque (update_torque() takes the absolute deviation) or needs a wide
+// TORQUE_THRESHOLD. The zero is learned instead:
+//
+//   boot:     the zero stored in NVS (TORQUE_STANDSTILL on a fresh board) is
+//             replaced by the mean of the first quiet TORQUE_ZERO_BOOT_MS
+//             window. A window further than TORQUE_ZERO_BOOT_COUNTS from the
+//             stored zero is a foot on the pedal - retried until the pedals
+//             are free.
+//   tracking: afterwards every quiet TORQUE_ZERO_TRACK_WINDOW_MS window
+//             pulls the zero towards its mean with time constant
+//             TORQUE_ZERO_TRACK_TAU_S, but only within
+//             TORQUE_ZERO_TRACK_COUNTS of the zero. Drift is slow enough to
+//             stay inside, a resting foot is not followed.
+//
+// Quiet = crank idle (no cadence for TORQUE_ZERO_IDLE_MS) and the decimated
+// samples of the whole window within TORQUE_ZERO_QUIET_COUNTS of each other.
+//
+// The zero is written to NVS when it moved TORQUE_ZERO_SAVE_COUNTS, at
+// most every TORQUE_ZERO_SAVE_INTERVAL_MS (the boot calibration right
+// away), together with the last TORQUE_ZERO_HISTORY changes (/api/torque_zero).
+// Writes only happen while the crank is idle.
+//
+// TorqueZeroTracker is the calibration logic (no NVS, no globals); the
+// torque_zero_*() service runs it from update_torque() (sensorTask) and
+// publishes the status with a seqlock for the web interface.
+
+#define TORQUE_ZERO_IDLE_MS           1000     // Crank idle this long before samples count
+#define TORQUE_ZERO_QUIET_COUNTS      4.0f     // Max. spread of a quiet window [ADC counts]
+#define TORQUE_ZERO_BOOT_MS           1000     // Boot calibration window
+#define TORQUE_ZERO_BOOT_COUNTS       60.0f    // Boot window accepted within this of the stored zero (~6 Nm)
+#define TORQUE_ZERO_TRACK_WINDOW_MS   2000     // Tracking window
+#define TORQUE_ZERO_TRACK_COUNTS      8.0f     // Tracking follows offsets up to this (below TORQUE_THRESHOLD)
+#define TORQUE_ZERO_TRACK_TAU_S       60.0f    // Tracking time constant (idle time)
+#define TORQUE_ZERO_MAX_SHIFT         300.0f   // Zero stays within TORQUE_STANDSTILL +- this [ADC counts]
+#define TORQUE_ZERO_SAVE_COUNTS       2.0f     // NVS write when the zero moved this far since the last write
+#define TORQUE_ZERO_SAVE_INTERVAL_MS  600000   // ... at most every 10 min (flash wear)
+#define TORQUE_ZERO_HISTORY           16       // Zero changes kept (NVS + /api/torque_zero)
+#define TORQUE_ZERO_HISTORY_COUNTS    1.0f     // Tracking adds a history entry per this much change
+
+class TorqueZeroTracker {
+public:
+  enum Result {
+    NO_CHANGE,
+    BOOT_CALIBRATED,   // First quiet window accepted
+    TRACKED            // Zero moved towards a quiet window
+  };
+
+  TorqueZeroTracker();
+
+  // Start from a stored zero; the boot calibration is pending
+  void begin(float zero_counts);
+
+  // One decimated sample [ADC counts] per sensor tick
+  Result update(float counts, bool crank_idle, uint32_t now_ms);
+
+  float zero() const { return zero_counts; }
+  bool calibrated() const { return boot_done; }
+
+private:
+  void restartWindow();
+
+  float zero_counts;
+  bool boot_done;
+
+  uint32_t window_start_ms;
+  uint32_t window_samples;
+  float window_sum;
+  float window_min;
+  float window_max;
+};
+
+enum TorqueZeroSource : uint32_t {
+  TORQUE_ZERO_FROM_NVS,
+  TORQUE_ZERO_FROM_BOOT,
+  TORQUE_ZERO_FROM_TRACKING
+};
+
+struct TorqueZeroEntry {
+  uint32_t boot;          // Boot count (NVS) when the change happened
+  uint32_t uptime_s;      // Seconds since that boot
+  float zero_counts;
+  uint32_t source;        // TorqueZeroSource
+};
+
+struct TorqueZeroStatus {
+  float zero_counts;      // In use
+  float saved_counts;     // Last NVS write
+  uint32_t calibrated;    // Boot calibration done
+  uint32_t boot;
+  uint32_t saves;         // NVS writes since boot
+  uint32_t history_count; // Entries used, oldest first
+  TorqueZeroEntry history[TORQUE_ZERO_HISTORY];
+};
+
+// Load the zero and history from NVS and start the boot calibration
+// (ebike_setup). Without it torque_zero_counts() is TORQUE_STANDSTILL.
+void torque_zero_begin();
+void torque_zero_end();
+
+// Feed one sample (update_torque, sensorTask) and read the zero in use
+void torque_zero_update(float counts);
+float torque_zero_counts();
+
+// Any task
+TorqueZeroStatus torque_zero_status();
+
+#endif // TORQUE_ZERO_H
@@ -2,6 +2,7 @@
 #define WIFI_TELEMETRY_H
 
 #include <Arduino.h>
+#include "log_messages.h"
 
 #ifdef ESP32
   #include "freertos/FreeRTOS.h"
@@ -22,7 +23,6 @@
 #define WIFI_AP_SUBNET IPAddress(255, 255, 255, 0)
 #define WEB_SERVER_PORT 80
 #define TELEMETRY_UPDATE_RATE_MS 1000  // 1Hz für responsive Web Interface
-#define MAX_LOG_MESSAGES 20          // Maximum Anzahl gespeicherter Log-Nachrichten
 
 // WiFi/Web Server task function
 void wifiTelemetryTask(void *pvParameters);
@@ -30,10 +30,6 @@ void wifiTelemetryTask(void *pvParameters);
 // Setup function to create WiFi task
 void setupWifiTelemetry();
 
-// Log message functions
-void addLogMessage(const String& message);
-void addLogMessage(const char* message);
-
 // Global declarations for external access
 extern TaskHandle_t wifiTaskHandle;
 extern WebServer webServer;
@@ -0,0 +1,205 @@
+#include "Arduino.h"
+#include "driver/adc.h"
+#include "driver/pcnt.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+// =============================================================================
+// HOST HAL - virtual clock
+// =============================================================================
+
+static uint64_t hal_clock_us = 0;
+
+unsigned long millis() { return (unsigned long)(hal_clock_us / 1000); }
+unsigned long micros() { return (unsigned long)hal_clock_us; }
+void delay(unsigned long ms) { hal_clock_us += (uint64_t)ms * 1000; }
+void delayMicroseconds(unsigned int us) { hal_clock_us += us; }
+void yield() {}
+
+void hal_set_time_us(uint64_t us) { hal_clock_us = us; }
+void hal_advance_time_us(uint64_t us) { hal_clock_us += us; }
+void hal_set_millis(unsigned long ms) { hal_clock_us = (uint64_t)ms * 1000; }
+uint64_t hal_time_us() { return hal_clock_us; }
+
+EspClass ESP;
+
+uint32_t getCpuFrequencyMhz() { return HAL_CPU_MHZ; }
+uint32_t EspClass::getCycleCount() { return (uint32_t)(hal_clock_us * HAL_CPU_MHZ); }
+
+// =============================================================================
+// HOST HAL - String / Print
+// =============================================================================
+
+std::string String::formatFloat(double number, unsigned int decimals) {
+  char buffer[48];
+  snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, number);
+  return std::string(buffer);
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t written = 0;
+  while (size--) {
+    written += write(*buffer++);
+  }
+  return written;
+}
+
+size_t Print::print(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+size_t Print::print(const String& text) { return print(text.c_str()); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(int number) { return print(String(number)); }
+size_t Print::print(unsigned int number) { return print(String(number)); }
+size_t Print::print(long number) { return print(String(number)); }
+size_t Print::print(unsigned long number) { return print(String(number)); }
+size_t Print::print(double number, int decimals) { return print(String(number, decimals)); }
+size_t Print::println() { return print("\r\n"); }
+
+size_t Stream::readBytes(uint8_t* buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int value = read();
+    if (value < 0) break;
+    buffer[count++] = (uint8_t)value;
+  }
+  return count;
+}
+
+size_t Print::printf(const char* format, ...) {
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (len < 0) return 0;
+  return write((const uint8_t*)buffer, len < (int)sizeof(buffer) ? len : sizeof(buffer) - 1);
+}
+
+// =============================================================================
+// HOST HAL - GPIO / ADC / interrupts
+// =============================================================================
+
+struct HalPin {
+  int mode;
+  int level;
+  uint16_t analog;
+  uint16_t analogNoise;
+  voidFuncPtr handler;
+  int interruptMode;
+};
+
+static HalPin hal_pins[HAL_NUM_PINS];
+static uint32_t hal_noise_state = 1;
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= HAL_NUM_PINS) return;
+  hal_pins[pin].mode = mode;
+  if (mode == INPUT_PULLUP) hal_pins[pin].level = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin < HAL_NUM_PINS) hal_pins[pin].level = value ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < HAL_NUM_PINS ? hal_pins[pin].level : LOW;
+}
+
+uint16_t analogRead(uint8_t pin) {
+  return hal_sample_analog(pin);
+}
+
+void attachInterrupt(uint8_t pin, voidFuncPtr handler, int mode) {
+  if (pin >= HAL_NUM_PINS) return;
+  hal_pins[pin].handler = handler;
+  hal_pins[pin].interruptMode = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+  if (pin < HAL_NUM_PINS) hal_pins[pin].handler = nullptr;
+}
+
+// Single threaded: an injected edge runs its ISR to completion before the
+// caller continues, so there is nothing to mask.
+void noInterrupts() {}
+void interrupts() {}
+
+void hal_set_digital(uint8_t pin, int value) {
+  if (pin >= HAL_NUM_PINS) return;
+  HalPin& p = hal_pins[pin];
+  int level = value ? HIGH : LOW;
+  if (level == p.level) return;
+  p.level = level;
+  hal_pcnt_pin_changed(pin, level);   // Pulse counter units count first
+
+  if (!p.handler) return;
+  bool fire = (p.interruptMode == CHANGE) ||
+              (p.interruptMode == RISING && level == HIGH) ||
+              (p.interruptMode == FALLING && level == LOW);
+  if (fire) p.handler();
+}
+
+void hal_set_analog(uint8_t pin, uint16_t value) {
+  if (pin >= HAL_NUM_PINS) return;
+  hal_adc_pin_changing(pin);   // DMA conversions up to now see the old level
+  hal_pins[pin].analog = value;
+}
+
+void hal_set_analog_noise(uint8_t pin, uint16_t amplitude) {
+  if (pin >= HAL_NUM_PINS) return;
+  hal_adc_pin_changing(pin);
+  hal_pins[pin].analogNoise = amplitude;
+}
+
+uint16_t hal_get_analog_noise(uint8_t pin) {
+  return pin < HAL_NUM_PINS ? hal_pins[pin].analogNoise : 0;
+}
+
+uint16_t hal_sample_analog(uint8_t pin) {
+  if (pin >= HAL_NUM_PINS) return 0;
+  const HalPin& p = hal_pins[pin];
+  if (p.analogNoise == 0) return p.analog;
+
+  // Deterministic noise (LCG), so noisy runs repeat exactly
+  hal_noise_state = hal_noise_state * 1664525u + 1013904223u;
+  int noise = (int)((hal_noise_state >> 8) % (2u * p.analogNoise + 1)) - p.analogNoise;
+  return (uint16_t)constrain((int)p.analog + noise, 0, 4095);
+}
+
+int hal_get_digital(uint8_t pin) { return digitalRead(pin); }
+
+int hal_get_pin_mode(uint8_t pin) {
+  return pin < HAL_NUM_PINS ? hal_pins[pin].mode : 0;
+}
+
+void hal_reset_pins() {
+  memset(hal_pins, 0, sizeof(hal_pins));
+  hal_noise_state = 1;
+  hal_pcnt_reset();
+  hal_adc_reset();
+}
+
+// =============================================================================
+// HOST HAL - HardwareSerial
+// =============================================================================
+
+static bool hal_echo = false;
+static size_t hal_console_bytes = 0;
+
+HardwareSerial Serial(0);
+HardwareSerial Serial2(2);
+
+void hal_serial_echo(bool enabled) { hal_echo = enabled; }
+
+size_t hal_serial_bytes_written() { return hal_console_bytes; }
+
+size_t HardwareSerial::write(uint8_t value) {
+  if (uartNum == 0) hal_console_bytes++;
+  if (hal_echo && uartNum == 0) fputc(value, stdout);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  if (uartNum == 0) hal_console_bytes += size;
+  if (hal_echo && uartNum == 0) fwrite(buffer, 1, size, stdout);
+  return size;
+}
@@ -0,0 +1,204 @@
+#ifndef HOST_HAL_ARDUINO_H
+#define HOST_HAL_ARDUINO_H
+
+// =============================================================================
+// HOST HAL - Arduino core subset for native builds ([env:test])
+// =============================================================================
+// Lets the firmware sources (src/) and libraries (VescUart) compile on Linux.
+// Time is a virtual clock that only moves when a test advances it (or calls
+// delay()), so timeouts and latencies are deterministic.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "esp32-hal.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#define PI 3.1415926535897932384626433832795
+#define HIGH 0x1
+#define LOW  0x0
+
+// Pin and interrupt modes (same values as the ESP32 core)
+#define INPUT         0x01
+#define OUTPUT        0x03
+#define INPUT_PULLUP  0x05
+#define RISING        0x01
+#define FALLING       0x02
+#define CHANGE        0x03
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// Same definitions as the ESP32 Arduino core (constrain is a macro there)
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+using std::abs;
+using std::max;
+using std::min;
+
+// -----------------------------------------------------------------------------
+// Time (virtual clock)
+// -----------------------------------------------------------------------------
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);              // Advances the virtual clock
+void delayMicroseconds(unsigned int us);   // Advances the virtual clock
+void yield();
+
+void hal_set_time_us(uint64_t us);
+void hal_advance_time_us(uint64_t us);
+void hal_set_millis(unsigned long ms);
+uint64_t hal_time_us();
+
+// -----------------------------------------------------------------------------
+// CPU (cycle counter follows the virtual clock at HAL_CPU_MHZ)
+// -----------------------------------------------------------------------------
+#define HAL_CPU_MHZ 240
+
+uint32_t getCpuFrequencyMhz();
+
+class EspClass {
+public:
+  uint32_t getCycleCount();
+  uint32_t getFreeHeap() { return 200000; }
+};
+
+extern EspClass ESP;
+
+// -----------------------------------------------------------------------------
+// GPIO / ADC / interrupts
+// -----------------------------------------------------------------------------
+// Inputs are injected by the test (hal_set_digital / hal_set_analog), outputs
+// are read back with hal_get_digital. A level change on a pin with an
+// attached interrupt calls the handler synchronously, like an ISR that
+// preempts the running task.
+#define HAL_NUM_PINS 40
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+
+typedef void (*voidFuncPtr)(void);
+#define digitalPinToInterrupt(p) (((p) < HAL_NUM_PINS) ? (p) : -1)
+void attachInterrupt(uint8_t pin, voidFuncPtr handler, int mode);
+void detachInterrupt(uint8_t pin);
+void noInterrupts();
+void interrupts();
+
+void hal_set_digital(uint8_t pin, int value);   // Drive an input (fires an attached ISR)
+void hal_set_analog(uint8_t pin, uint16_t value);
+void hal_set_analog_noise(uint8_t pin, uint16_t amplitude);   // Uniform +-amplitude on every conversion
+uint16_t hal_sample_analog(uint8_t pin);                       // One conversion (level + noise, 12 bit)
+uint16_t hal_get_analog_noise(uint8_t pin);
+int hal_get_digital(uint8_t pin);                // Read back an output
+int hal_get_pin_mode(uint8_t pin);
+void hal_reset_pins();
+
+// -----------------------------------------------------------------------------
+// String (std::string backed)
+// -----------------------------------------------------------------------------
+class String {
+public:
+  String(const char* text = "") : value(text ? text : "") {}
+  String(const std::string& text) : value(text) {}
+  String(char c) : value(1, c) {}
+  String(int number) : value(std::to_string(number)) {}
+  String(unsigned int number) : value(std::to_string(number)) {}
+  String(long number) : value(std::to_string(number)) {}
+  String(unsigned long number) : value(std::to_string(number)) {}
+  String(float number, unsigned int decimals = 2) : value(formatFloat(number, decimals)) {}
+  String(double number, unsigned int decimals = 2) : value(formatFloat(number, decimals)) {}
+
+  const char* c_str() const { return value.c_str(); }
+  unsigned int length() const { return (unsigned int)value.length(); }
+
+  String& operator+=(const String& other) { value += other.value; return *this; }
+  bool operator==(const String& other) const { return value == other.value; }
+  bool operator==(const char* other) const { return value == other; }
+  bool operator!=(const String& other) const { return value != other.value; }
+
+  friend String operator+(const String& a, const String& b) { return String(a.value + b.value); }
+  friend String operator+(const String& a, const char* b) { return String(a.value + b); }
+  friend String operator+(const char* a, const String& b) { return String(a + b.value); }
+
+private:
+  static std::string formatFloat(double number, unsigned int decimals);
+  std::string value;
+};
+
+// -----------------------------------------------------------------------------
+// Print / Stream
+// -----------------------------------------------------------------------------
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t value) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+
+  size_t print(const char* text);
+  size_t print(const String& text);
+  size_t print(char c);
+  size_t print(int number);
+  size_t print(unsigned int number);
+  size_t print(long number);
+  size_t print(unsigned long number);
+  size_t print(double number, int decimals = 2);
+
+  size_t println();
+  template<typename T>
+  size_t println(T value) { size_t n = print(value); return n + println(); }
+  size_t println(double number, int decimals) { size_t n = print(number, decimals); return n + println(); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() {}
+
+  // Reads up to length bytes that are already available (no timeout on the host)
+  virtual size_t readBytes(uint8_t* buffer, size_t length);
+  size_t readBytes(char* buffer, size_t length) { return readBytes((uint8_t*)buffer, length); }
+};
+
+// -----------------------------------------------------------------------------
+// HardwareSerial (Serial = USB console, Serial2 = VESC UART)
+// -----------------------------------------------------------------------------
+// Output is dropped unless hal_serial_echo(true) - the firmware prints a lot
+// of status lines. There is no RX; tests hand VescUart a ScriptedStream.
+class HardwareSerial : public Stream {
+public:
+  explicit HardwareSerial(int uart) : uartNum(uart) {}
+  void begin(unsigned long baud) { (void)baud; }
+  void end() {}
+  size_t setRxBufferSize(size_t size) { return size; }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  size_t write(uint8_t value) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  operator bool() const { return true; }
+
+private:
+  int uartNum;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial2;
+
+void hal_serial_echo(bool enabled);
+size_t hal_serial_bytes_written();         // Total bytes written to Serial (console)
+
+#endif // HOST_HAL_ARDUINO_H
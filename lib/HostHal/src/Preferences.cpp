@@ -0,0 +1,104 @@
+#include "Preferences.h"
+#include <map>
+#include <string.h>
+#include <vector>
+
+// =============================================================================
+// HOST HAL - Preferences (in-memory NVS)
+// =============================================================================
+
+typedef std::map<std::string, std::vector<uint8_t> > HalNvsNamespace;
+
+static std::map<std::string, HalNvsNamespace> hal_nvs;
+static uint32_t hal_nvs_write_count = 0;
+
+Preferences::Preferences() : started(false), readOnly(false) {}
+
+Preferences::~Preferences() {
+  end();
+}
+
+bool Preferences::begin(const char* name, bool read_only, const char* partition_label) {
+  (void)partition_label;
+  if (started || !name || strlen(name) > 15) return false;   // NVS key/namespace limit
+  if (read_only && hal_nvs.find(name) == hal_nvs.end()) return false;
+  started = true;
+  readOnly = read_only;
+  nameSpace = name;
+  hal_nvs[nameSpace];
+  return true;
+}
+
+void Preferences::end() {
+  started = false;
+}
+
+bool Preferences::clear() {
+  if (!started || readOnly) return false;
+  hal_nvs[nameSpace].clear();
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  if (!started || readOnly) return false;
+  return hal_nvs[nameSpace].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+  if (!started) return false;
+  return hal_nvs[nameSpace].count(key) > 0;
+}
+
+size_t Preferences::put(const char* key, const void* value, size_t len) {
+  if (!started || readOnly || !key || strlen(key) > 15) return 0;
+  const uint8_t* bytes = (const uint8_t*)value;
+  hal_nvs[nameSpace][key].assign(bytes, bytes + len);
+  hal_nvs_write_count++;
+  return len;
+}
+
+bool Preferences::get(const char* key, void* buf, size_t len) {
+  if (!started) return false;
+  HalNvsNamespace& ns = hal_nvs[nameSpace];
+  HalNvsNamespace::const_iterator it = ns.find(key);
+  if (it == ns.end() || it->second.size() != len) return false;
+  memcpy(buf, it->second.data(), len);
+  return true;
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) { return put(key, &value, sizeof(value)); }
+size_t Preferences::putFloat(const char* key, float value) { return put(key, &value, sizeof(value)); }
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) { return put(key, value, len); }
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+  uint32_t value;
+  return get(key, &value, sizeof(value)) ? value : defaultValue;
+}
+
+float Preferences::getFloat(const char* key, float defaultValue) {
+  float value;
+  return get(key, &value, sizeof(value)) ? value : defaultValue;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  if (!started) return 0;
+  HalNvsNamespace& ns = hal_nvs[nameSpace];
+  HalNvsNamespace::const_iterator it = ns.find(key);
+  return it == ns.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  size_t len = getBytesLength(key);
+  if (len == 0 || len > maxLen) return 0;
+  memcpy(buf, hal_nvs[nameSpace][key].data(), len);
+  return len;
+}
+
+void hal_nvs_erase() {
+  hal_nvs.clear();
+  hal_nvs_write_count = 0;
+}
+
+uint32_t hal_nvs_writes() {
+  return hal_nvs_write_count;
+}
@@ -0,0 +1,51 @@
+#ifndef HOST_HAL_PREFERENCES_H
+#define HOST_HAL_PREFERENCES_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// =============================================================================
+// HOST HAL - Preferences (arduino-esp32 NVS key/value store subset)
+// =============================================================================
+// Same calls as arduino-esp32. The store lives in memory and survives
+// Preferences objects and hal_reset_pins() like NVS survives a reboot;
+// hal_nvs_erase() is the erased flash. Every put counts as one flash write
+// (hal_nvs_writes()) so tests can check the write rate.
+
+class Preferences {
+public:
+  Preferences();
+  ~Preferences();
+
+  bool begin(const char* name, bool readOnly = false, const char* partition_label = NULL);
+  void end();
+
+  bool clear();
+  bool remove(const char* key);
+  bool isKey(const char* key);
+
+  size_t putUInt(const char* key, uint32_t value);
+  size_t putFloat(const char* key, float value);
+  size_t putBytes(const char* key, const void* value, size_t len);
+
+  uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+  float getFloat(const char* key, float defaultValue = NAN);
+  size_t getBytesLength(const char* key);
+  size_t getBytes(const char* key, void* buf, size_t maxLen);
+
+private:
+  size_t put(const char* key, const void* value, size_t len);
+  bool get(const char* key, void* buf, size_t len);
+
+  bool started;
+  bool readOnly;
+  std::string nameSpace;
+};
+
+// Host only
+void hal_nvs_erase();          // All namespaces gone (fresh flash)
+uint32_t hal_nvs_writes();     // put*() calls since the last erase
+
+#endif // HOST_HAL_PREFERENCES_H
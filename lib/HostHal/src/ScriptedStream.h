@@ -0,0 +1,96 @@
+#ifndef HOST_HAL_SCRIPTED_STREAM_H
+#define HOST_HAL_SCRIPTED_STREAM_H
+
+#include "Arduino.h"
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+// =============================================================================
+// SCRIPTED STREAM - host stand-in for a UART (e.g. Serial2 to the VESC)
+// =============================================================================
+// Bytes queued with script() become readable one UART byte-time apart on the
+// HAL virtual clock (115200 baud 8N1 = 86.8us per byte by default), exactly
+// like a real RX FIFO filling up. Everything the device writes is captured
+// in `written`.
+
+class ScriptedStream : public Stream {
+public:
+  explicit ScriptedStream(uint32_t baud = 115200) : baudRate(baud), lastReadyUs(0) {}
+
+  // Queue bytes that start arriving at start_us (or now)
+  void script(const uint8_t* data, size_t len) { scriptAt(hal_time_us(), data, len); }
+  void scriptAt(uint64_t start_us, const uint8_t* data, size_t len) {
+    uint64_t ready = start_us > lastReadyUs ? start_us : lastReadyUs;
+    for (size_t i = 0; i < len; i++) {
+      ready += byteTimeUs();
+      rx.push_back(timedByte{ready, data[i]});
+    }
+    lastReadyUs = ready;
+  }
+
+  // Virtual time at which the last scripted byte is readable
+  uint64_t lastByteReadyUs() const { return lastReadyUs; }
+
+  uint64_t byteTimeUs() const { return (10ULL * 1000000ULL + baudRate - 1) / baudRate; }
+
+  int available() override {
+    // Ready times are ascending - binary search for the first byte still on the wire
+    uint64_t now = hal_time_us();
+    auto first_pending = std::upper_bound(rx.begin(), rx.end(), now,
+      [](uint64_t t, const timedByte& b) { return t < b.ready_us; });
+    return (int)(first_pending - rx.begin());
+  }
+
+  int read() override {
+    if (rx.empty() || rx.front().ready_us > hal_time_us()) return -1;
+    uint8_t value = rx.front().value;
+    rx.pop_front();
+    return value;
+  }
+
+  size_t readBytes(uint8_t* buffer, size_t length) override {
+    size_t count = 0;
+    uint64_t now = hal_time_us();
+    while (count < length && !rx.empty() && rx.front().ready_us <= now) {
+      buffer[count++] = rx.front().value;
+      rx.pop_front();
+    }
+    return count;
+  }
+
+  int peek() override {
+    if (rx.empty() || rx.front().ready_us > hal_time_us()) return -1;
+    return rx.front().value;
+  }
+
+  size_t write(uint8_t value) override {
+    written.push_back(value);
+    return 1;
+  }
+
+  size_t write(const uint8_t* buffer, size_t size) override {
+    written.insert(written.end(), buffer, buffer + size);
+    return size;
+  }
+
+  void clear() {
+    rx.clear();
+    written.clear();
+    lastReadyUs = 0;
+  }
+
+  std::vector<uint8_t> written;
+
+private:
+  struct timedByte {
+    uint64_t ready_us;
+    uint8_t value;
+  };
+
+  std::deque<timedByte> rx;
+  uint32_t baudRate;
+  uint64_t lastReadyUs;
+};
+
+#endif // HOST_HAL_SCRIPTED_STREAM_H
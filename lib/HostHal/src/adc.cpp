@@ -0,0 +1,167 @@
+#include "Arduino.h"
+#include "driver/adc.h"
+#include <algorithm>
+#include <vector>
+
+// =============================================================================
+// HOST HAL - ESP32 ADC continuous (DMA) mode
+// =============================================================================
+
+static const uint8_t HAL_ADC1_PINS[ADC1_CHANNEL_MAX] = {36, 37, 38, 39, 32, 33, 34, 35};
+
+struct HalAdcDigi {
+  bool initialized;
+  bool configured;
+  bool running;
+  uint32_t frameSamples;
+  uint32_t sampleHz;
+  uint8_t channel;
+  uint64_t startUs;         // Virtual time of conversion 0
+  uint64_t conversions;     // Conversions done since startUs
+  bool overflow;
+  std::vector<uint16_t> frame;    // Frame being filled (frameFill conversions)
+  uint32_t frameFill;
+  std::vector<uint16_t> stored;   // Driver ring buffer: complete frames, readable
+  uint32_t storedHead;            // Oldest readable conversion
+  uint32_t storedCount;
+};
+
+static HalAdcDigi hal_adc;
+
+// Conversions up to the current virtual time
+static void hal_adc_convert() {
+  if (!hal_adc.running) return;
+  uint64_t now = hal_time_us();
+  if (now < hal_adc.startUs) {   // Clock set back by a test: continue from here
+    hal_adc.startUs = now;
+    hal_adc.conversions = 0;
+  }
+  uint64_t due = (now - hal_adc.startUs) * hal_adc.sampleHz / 1000000;
+  uint8_t pin = HAL_ADC1_PINS[hal_adc.channel];
+  bool noisy = hal_get_analog_noise(pin) > 0;
+  uint32_t capacity = (uint32_t)hal_adc.stored.size();
+
+  // Whole runs up to the next frame boundary (20k conversions per simulated
+  // second - a noise-free level is sampled once per run)
+  while (hal_adc.conversions < due) {
+    uint32_t run = (uint32_t)min<uint64_t>(due - hal_adc.conversions, hal_adc.frameSamples - hal_adc.frameFill);
+    adc_digi_output_data_t out;
+    out.val = 0;
+    out.type1.channel = hal_adc.channel;
+    out.type1.data = hal_sample_analog(pin) & 0xFFF;
+    uint16_t* dst = hal_adc.frame.data() + hal_adc.frameFill;
+    if (noisy) {
+      dst[0] = out.val;
+      for (uint32_t i = 1; i < run; i++) {
+        out.type1.data = hal_sample_analog(pin) & 0xFFF;
+        dst[i] = out.val;
+      }
+    } else {
+      std::fill(dst, dst + run, out.val);
+    }
+    hal_adc.frameFill += run;
+    hal_adc.conversions += run;
+
+    if (hal_adc.frameFill == hal_adc.frameSamples) {
+      if (hal_adc.storedCount + hal_adc.frameSamples > capacity) {
+        hal_adc.overflow = true;   // Ring buffer full: the DMA interrupt drops the frame
+      } else {
+        uint32_t tail = (hal_adc.storedHead + hal_adc.storedCount) % capacity;
+        uint32_t first = min(hal_adc.frameSamples, capacity - tail);
+        memcpy(hal_adc.stored.data() + tail, hal_adc.frame.data(), first * sizeof(uint16_t));
+        memcpy(hal_adc.stored.data(), hal_adc.frame.data() + first, (hal_adc.frameSamples - first) * sizeof(uint16_t));
+        hal_adc.storedCount += hal_adc.frameSamples;
+      }
+      hal_adc.frameFill = 0;
+    }
+  }
+}
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t* init_config) {
+  if (!init_config || init_config->conv_num_each_intr == 0 ||
+      init_config->conv_num_each_intr % sizeof(adc_digi_output_data_t) != 0 ||
+      init_config->max_store_buf_size < init_config->conv_num_each_intr ||
+      init_config->adc2_chan_mask != 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (hal_adc.initialized) return ESP_ERR_INVALID_STATE;
+  hal_adc.initialized = true;
+  hal_adc.frameSamples = init_config->conv_num_each_intr / sizeof(adc_digi_output_data_t);
+  hal_adc.frame.assign(hal_adc.frameSamples, 0);
+  hal_adc.stored.assign(init_config->max_store_buf_size / sizeof(adc_digi_output_data_t), 0);
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_deinitialize(void) {
+  if (hal_adc.running) return ESP_ERR_INVALID_STATE;
+  hal_adc_reset();
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t* config) {
+  if (!hal_adc.initialized) return ESP_ERR_INVALID_STATE;
+  if (!config || config->pattern_num != 1 || !config->adc_pattern ||
+      config->adc_pattern[0].unit != 0 ||                      // ESP32 pattern: unit 0 = ADC1
+      config->adc_pattern[0].channel >= ADC1_CHANNEL_MAX ||
+      config->sample_freq_hz < SOC_ADC_SAMPLE_FREQ_THRES_LOW ||
+      config->sample_freq_hz > SOC_ADC_SAMPLE_FREQ_THRES_HIGH ||
+      config->conv_mode != ADC_CONV_SINGLE_UNIT_1 || config->format != ADC_DIGI_OUTPUT_FORMAT_TYPE1) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  hal_adc.configured = true;
+  hal_adc.sampleHz = config->sample_freq_hz;
+  hal_adc.channel = config->adc_pattern[0].channel;
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_start(void) {
+  if (!hal_adc.initialized || !hal_adc.configured) return ESP_ERR_INVALID_STATE;
+  hal_adc.running = true;
+  hal_adc.startUs = hal_time_us();
+  hal_adc.conversions = 0;
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_stop(void) {
+  if (!hal_adc.initialized) return ESP_ERR_INVALID_STATE;
+  hal_adc_convert();
+  hal_adc.running = false;
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_read_bytes(uint8_t* buf, uint32_t length_max, uint32_t* out_length, uint32_t timeout_ms) {
+  (void)timeout_ms;
+  if (!hal_adc.initialized) return ESP_ERR_INVALID_STATE;
+  hal_adc_convert();
+
+  uint32_t capacity = (uint32_t)hal_adc.stored.size();
+  uint32_t n = min(length_max / (uint32_t)sizeof(uint16_t), hal_adc.storedCount);
+  uint32_t first = min(n, capacity - hal_adc.storedHead);
+  memcpy(buf, hal_adc.stored.data() + hal_adc.storedHead, first * sizeof(uint16_t));
+  memcpy(buf + first * sizeof(uint16_t), hal_adc.stored.data(), (n - first) * sizeof(uint16_t));
+  hal_adc.storedHead = (hal_adc.storedHead + n) % capacity;
+  hal_adc.storedCount -= n;
+  n *= sizeof(uint16_t);
+  *out_length = n;
+
+  if (hal_adc.overflow) {
+    hal_adc.overflow = false;
+    return ESP_ERR_INVALID_STATE;
+  }
+  return n > 0 ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+void hal_adc_pin_changing(uint8_t pin) {
+  if (hal_adc.running && pin == HAL_ADC1_PINS[hal_adc.channel]) {
+    hal_adc_convert();
+  }
+}
+
+void hal_adc_reset() {
+  hal_adc = HalAdcDigi();
+}
+
+uint32_t hal_adc_conversions() {
+  hal_adc_convert();
+  return (uint32_t)hal_adc.conversions;
+}
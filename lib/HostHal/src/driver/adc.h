@@ -0,0 +1,111 @@
+#ifndef HOST_HAL_DRIVER_ADC_H
+#define HOST_HAL_DRIVER_ADC_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// =============================================================================
+// HOST HAL - ESP32 ADC continuous (DMA) mode (ESP-IDF 4.4 driver/adc.h subset)
+// =============================================================================
+// Same types, values and calls as ESP-IDF 4.4 on the ESP32 (ADC1 only,
+// output format type 1). While started, the driver converts the pattern's
+// channel at sample_freq_hz on the virtual clock; the value is the pin's
+// hal_set_analog() level (plus hal_set_analog_noise()) at the sample time.
+// Conversions become readable in frames of conv_num_each_intr bytes, like the
+// DMA interrupt delivers them. Frames that do not fit max_store_buf_size are
+// dropped and the next adc_digi_read_bytes() returns ESP_ERR_INVALID_STATE.
+// adc_digi_read_bytes() never waits on the host: without a complete frame it
+// returns ESP_ERR_TIMEOUT whatever the timeout.
+
+typedef enum {
+  ADC_UNIT_1 = 1,
+  ADC_UNIT_2 = 2,
+  ADC_UNIT_BOTH = 3,
+  ADC_UNIT_ALTER = 7,
+  ADC_UNIT_MAX,
+} adc_unit_t;
+
+typedef enum {
+  ADC1_CHANNEL_0 = 0,   // GPIO36
+  ADC1_CHANNEL_1,       // GPIO37
+  ADC1_CHANNEL_2,       // GPIO38
+  ADC1_CHANNEL_3,       // GPIO39
+  ADC1_CHANNEL_4,       // GPIO32
+  ADC1_CHANNEL_5,       // GPIO33
+  ADC1_CHANNEL_6,       // GPIO34
+  ADC1_CHANNEL_7,       // GPIO35
+  ADC1_CHANNEL_MAX,
+} adc1_channel_t;
+
+typedef enum {
+  ADC_ATTEN_DB_0 = 0,
+  ADC_ATTEN_DB_2_5 = 1,
+  ADC_ATTEN_DB_6 = 2,
+  ADC_ATTEN_DB_11 = 3,
+  ADC_ATTEN_MAX,
+} adc_atten_t;
+
+typedef enum {
+  ADC_CONV_SINGLE_UNIT_1 = 1,
+  ADC_CONV_SINGLE_UNIT_2 = 2,
+  ADC_CONV_BOTH_UNIT = 3,
+  ADC_CONV_ALTER_UNIT = 7,
+  ADC_CONV_UNIT_MAX,
+} adc_digi_convert_mode_t;
+
+typedef enum {
+  ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+  ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+} adc_digi_output_format_t;
+
+#define SOC_ADC_DIGI_MAX_BITWIDTH     12
+#define SOC_ADC_SAMPLE_FREQ_THRES_HIGH (2 * 1000 * 1000)
+#define SOC_ADC_SAMPLE_FREQ_THRES_LOW  (20 * 1000)
+
+typedef struct {
+  uint8_t atten;
+  uint8_t channel;
+  uint8_t unit;
+  uint8_t bit_width;
+} adc_digi_pattern_config_t;
+
+typedef struct {
+  union {
+    struct {
+      uint16_t data : 12;
+      uint16_t channel : 4;
+    } type1;
+    uint16_t val;
+  };
+} adc_digi_output_data_t;
+
+typedef struct {
+  bool conv_limit_en;
+  uint32_t conv_limit_num;
+  uint32_t pattern_num;
+  adc_digi_pattern_config_t* adc_pattern;
+  uint32_t sample_freq_hz;
+  adc_digi_convert_mode_t conv_mode;
+  adc_digi_output_format_t format;
+} adc_digi_configuration_t;
+
+typedef struct {
+  uint32_t max_store_buf_size;
+  uint32_t conv_num_each_intr;
+  uint32_t adc1_chan_mask;
+  uint32_t adc2_chan_mask;
+} adc_digi_init_config_t;
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t* init_config);
+esp_err_t adc_digi_deinitialize(void);
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t* config);
+esp_err_t adc_digi_start(void);
+esp_err_t adc_digi_stop(void);
+esp_err_t adc_digi_read_bytes(uint8_t* buf, uint32_t length_max, uint32_t* out_length, uint32_t timeout_ms);
+
+// Host only
+void hal_adc_pin_changing(uint8_t pin);   // Called by hal_set_analog() before the level changes
+void hal_adc_reset();                     // Driver deinitialized, buffered conversions dropped
+uint32_t hal_adc_conversions();           // Conversions since adc_digi_start()
+
+#endif // HOST_HAL_DRIVER_ADC_H
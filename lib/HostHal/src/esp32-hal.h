@@ -0,0 +1,12 @@
+#ifndef HOST_HAL_ESP32_HAL_H
+#define HOST_HAL_ESP32_HAL_H
+
+// =============================================================================
+// HOST HAL - ESP32 specific attributes
+// =============================================================================
+// Code placement attributes have no meaning on the host.
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#endif // HOST_HAL_ESP32_HAL_H
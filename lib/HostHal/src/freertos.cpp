@@ -0,0 +1,129 @@
+#include "Arduino.h"
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// =============================================================================
+// HOST HAL - FreeRTOS subset
+// =============================================================================
+
+BaseType_t xPortGetCoreID() { return 0; }
+
+// -----------------------------------------------------------------------------
+// Tasks
+// -----------------------------------------------------------------------------
+struct HalTask {
+  std::string name;
+  UBaseType_t priority;
+  BaseType_t coreId;
+  uint32_t stackDepth;
+};
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name,
+                                   uint32_t stackDepth, void* parameters,
+                                   UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t coreId) {
+  (void)function;
+  (void)parameters;
+  HalTask* task = new HalTask{name ? name : "", priority, coreId, stackDepth};
+  if (handle) *handle = task;
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) { delete task; }
+
+TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+
+void vTaskDelay(TickType_t ticks) { delay(ticks); }
+
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t period) {
+  *previousWake += period;
+  TickType_t now = xTaskGetTickCount();
+  if ((int32_t)(*previousWake - now) > 0) {
+    delay(*previousWake - now);
+  }
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  return task ? task->stackDepth : 0;
+}
+
+const char* hal_task_name(TaskHandle_t task) {
+  return task ? task->name.c_str() : nullptr;
+}
+
+// -----------------------------------------------------------------------------
+// Queues
+// -----------------------------------------------------------------------------
+struct HalQueue {
+  std::mutex lock;
+  std::deque<std::vector<uint8_t>> items;
+  UBaseType_t length;
+  UBaseType_t itemSize;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  HalQueue* queue = new HalQueue();
+  queue->length = length;
+  queue->itemSize = itemSize;
+  return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) { delete queue; }
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+  (void)ticksToWait;
+  std::lock_guard<std::mutex> guard(queue->lock);
+  if (queue->items.size() >= queue->length) return pdFALSE;
+  const uint8_t* bytes = (const uint8_t*)item;
+  queue->items.emplace_back(bytes, bytes + queue->itemSize);
+  return pdTRUE;
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void* item) {
+  std::lock_guard<std::mutex> guard(queue->lock);
+  const uint8_t* bytes = (const uint8_t*)item;
+  queue->items.clear();
+  queue->items.emplace_back(bytes, bytes + queue->itemSize);
+  return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* buffer, TickType_t ticksToWait) {
+  (void)ticksToWait;
+  std::lock_guard<std::mutex> guard(queue->lock);
+  if (queue->items.empty()) return pdFALSE;
+  memcpy(buffer, queue->items.front().data(), queue->itemSize);
+  queue->items.pop_front();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> guard(queue->lock);
+  return (UBaseType_t)queue->items.size();
+}
+
+// -----------------------------------------------------------------------------
+// Mutexes
+// -----------------------------------------------------------------------------
+struct HalMutex {
+  std::timed_mutex lock;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return new HalMutex(); }
+
+void vSemaphoreDelete(SemaphoreHandle_t mutex) { delete mutex; }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticksToWait) {
+  if (ticksToWait == portMAX_DELAY) {
+    mutex->lock.lock();
+    return pdTRUE;
+  }
+  return mutex->lock.try_lock_for(std::chrono::milliseconds(ticksToWait)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+  mutex->lock.unlock();
+  return pdTRUE;
+}
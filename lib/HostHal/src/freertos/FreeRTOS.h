@@ -0,0 +1,28 @@
+#ifndef HOST_HAL_FREERTOS_H
+#define HOST_HAL_FREERTOS_H
+
+// =============================================================================
+// HOST HAL - FreeRTOS subset
+// =============================================================================
+// One tick is one millisecond of the virtual clock (configTICK_RATE_HZ 1000,
+// as in the ESP32 build). Blocking calls never block on the host: the tests
+// drive the task loop bodies directly and advance the clock themselves.
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE  ((BaseType_t)0)
+#define pdTRUE   ((BaseType_t)1)
+#define pdFAIL   pdFALSE
+#define pdPASS   pdTRUE
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((TickType_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+BaseType_t xPortGetCoreID();
+
+#endif // HOST_HAL_FREERTOS_H
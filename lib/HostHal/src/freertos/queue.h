@@ -0,0 +1,17 @@
+#ifndef HOST_HAL_FREERTOS_QUEUE_H
+#define HOST_HAL_FREERTOS_QUEUE_H
+
+#include "FreeRTOS.h"
+
+// Thread safe copy queues. Receive and send never wait - with an empty
+// (or full) queue they return pdFALSE right away whatever the timeout.
+typedef struct HalQueue* QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait);
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void* item);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* buffer, TickType_t ticksToWait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+#endif // HOST_HAL_FREERTOS_QUEUE_H
@@ -0,0 +1,15 @@
+#ifndef HOST_HAL_FREERTOS_SEMPHR_H
+#define HOST_HAL_FREERTOS_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+// Mutexes map to std::timed_mutex so benchmark threads on the host get real
+// mutual exclusion. Timeouts are wall clock milliseconds here.
+typedef struct HalMutex* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+void vSemaphoreDelete(SemaphoreHandle_t mutex);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticksToWait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex);
+
+#endif // HOST_HAL_FREERTOS_SEMPHR_H
@@ -0,0 +1,25 @@
+#ifndef HOST_HAL_FREERTOS_TASK_H
+#define HOST_HAL_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+// Tasks are recorded but never started on the host - an endless task loop
+// would spin the virtual clock. Tests call the code the loop runs instead.
+typedef void (*TaskFunction_t)(void*);
+typedef struct HalTask* TaskHandle_t;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name,
+                                   uint32_t stackDepth, void* parameters,
+                                   UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t coreId);
+void vTaskDelete(TaskHandle_t task);
+
+TickType_t xTaskGetTickCount();
+void vTaskDelay(TickType_t ticks);                                 // Advances the virtual clock
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t period); // Advances the virtual clock
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+// Name of a created task (nullptr if the handle is unknown)
+const char* hal_task_name(TaskHandle_t task);
+
+#endif // HOST_HAL_FREERTOS_TASK_H
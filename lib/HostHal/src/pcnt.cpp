@@ -0,0 +1,237 @@
+#include "Arduino.h"
+#include "driver/pcnt.h"
+
+// =============================================================================
+// HOST HAL - ESP32 pulse counter
+// =============================================================================
+
+struct HalPcntChannel {
+  bool configured;
+  int pulsePin;
+  int ctrlPin;
+  pcnt_ctrl_mode_t lctrlMode;
+  pcnt_ctrl_mode_t hctrlMode;
+  pcnt_count_mode_t posMode;
+  pcnt_count_mode_t negMode;
+};
+
+struct HalPcntUnit {
+  HalPcntChannel channels[PCNT_CHANNEL_MAX];
+  int16_t count;
+  int16_t highLimit;
+  int16_t lowLimit;
+  int16_t threshold0;
+  int16_t threshold1;
+  bool running;
+  bool interruptEnabled;
+  uint32_t enabledEvents;
+  uint32_t status;
+  uint16_t filter;
+  bool filterEnabled;
+  pcnt_isr_handler_t handler;
+  void* handlerArg;
+  uint32_t interrupts;
+};
+
+static HalPcntUnit hal_pcnt_units[PCNT_UNIT_MAX];
+static bool hal_pcnt_service = false;
+
+static bool valid_unit(pcnt_unit_t unit) {
+  return unit >= PCNT_UNIT_0 && unit < PCNT_UNIT_MAX;
+}
+
+esp_err_t pcnt_unit_config(const pcnt_config_t* config) {
+  if (!config || !valid_unit(config->unit) || config->channel >= PCNT_CHANNEL_MAX ||
+      config->counter_h_lim <= 0 || config->counter_l_lim >= 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  HalPcntUnit& u = hal_pcnt_units[config->unit];
+  HalPcntChannel& c = u.channels[config->channel];
+  c.configured = true;
+  c.pulsePin = config->pulse_gpio_num;
+  c.ctrlPin = config->ctrl_gpio_num;
+  c.lctrlMode = config->lctrl_mode;
+  c.hctrlMode = config->hctrl_mode;
+  c.posMode = config->pos_mode;
+  c.negMode = config->neg_mode;
+  u.highLimit = config->counter_h_lim;
+  u.lowLimit = config->counter_l_lim;
+  u.count = 0;
+  u.running = true;   // Like the IDF: configuring a unit clears and starts it
+  return ESP_OK;
+}
+
+esp_err_t pcnt_get_counter_value(pcnt_unit_t unit, int16_t* count) {
+  if (!valid_unit(unit) || !count) return ESP_ERR_INVALID_ARG;
+  *count = hal_pcnt_units[unit].count;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_counter_pause(pcnt_unit_t unit) {
+  if (!valid_unit(unit)) return ESP_ERR_INVALID_ARG;
+  hal_pcnt_units[unit].running = false;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_counter_resume(pcnt_unit_t unit) {
+  if (!valid_unit(unit)) return ESP_ERR_INVALID_ARG;
+  hal_pcnt_units[unit].running = true;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_counter_clear(pcnt_unit_t unit) {
+  if (!valid_unit(unit)) return ESP_ERR_INVALID_ARG;
+  hal_pcnt_units[unit].count = 0;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_intr_enable(pcnt_unit_t unit) {
+  if (!valid_unit(unit)) return ESP_ERR_INVALID_ARG;
+  hal_pcnt_units[unit].interruptEnabled = true;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_intr_disable(pcnt_unit_t unit) {
+  if (!valid_unit(unit)) return ESP_ERR_INVALID_ARG;
+  hal_pcnt_units[unit].interruptEnabled = false;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_event_enable(pcnt_unit_t unit, pcnt_evt_type_t evt_type) {
+  if (!valid_unit(unit)) return ESP_ERR_INVALID_ARG;
+  hal_pcnt_units[unit].enabledEvents |= evt_type;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_event_disable(pcnt_unit_t unit, pcnt_evt_type_t evt_type) {
+  if (!valid_unit(unit)) return ESP_ERR_INVALID_ARG;
+  hal_pcnt_units[unit].enabledEvents &= ~(uint32_t)evt_type;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_set_event_value(pcnt_unit_t unit, pcnt_evt_type_t evt_type, int16_t value) {
+  if (!valid_unit(unit)) return ESP_ERR_INVALID_ARG;
+  HalPcntUnit& u = hal_pcnt_units[unit];
+  switch (evt_type) {
+    case PCNT_EVT_THRES_0: u.threshold0 = value; break;
+    case PCNT_EVT_THRES_1: u.threshold1 = value; break;
+    case PCNT_EVT_H_LIM: u.highLimit = value; break;
+    case PCNT_EVT_L_LIM: u.lowLimit = value; break;
+    default: return ESP_ERR_INVALID_ARG;
+  }
+  return ESP_OK;
+}
+
+esp_err_t pcnt_set_filter_value(pcnt_unit_t unit, uint16_t filter_val) {
+  if (!valid_unit(unit) || filter_val > 1023) return ESP_ERR_INVALID_ARG;
+  hal_pcnt_units[unit].filter = filter_val;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_get_filter_value(pcnt_unit_t unit, uint16_t* filter_val) {
+  if (!valid_unit(unit) || !filter_val) return ESP_ERR_INVALID_ARG;
+  *filter_val = hal_pcnt_units[unit].filter;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_filter_enable(pcnt_unit_t unit) {
+  if (!valid_unit(unit)) return ESP_ERR_INVALID_ARG;
+  hal_pcnt_units[unit].filterEnabled = true;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_filter_disable(pcnt_unit_t unit) {
+  if (!valid_unit(unit)) return ESP_ERR_INVALID_ARG;
+  hal_pcnt_units[unit].filterEnabled = false;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_get_event_status(pcnt_unit_t unit, uint32_t* status) {
+  if (!valid_unit(unit) || !status) return ESP_ERR_INVALID_ARG;
+  *status = hal_pcnt_units[unit].status;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_isr_service_install(int intr_alloc_flags) {
+  (void)intr_alloc_flags;
+  if (hal_pcnt_service) return ESP_ERR_INVALID_STATE;
+  hal_pcnt_service = true;
+  return ESP_OK;
+}
+
+void pcnt_isr_service_uninstall(void) {
+  hal_pcnt_service = false;
+  for (int i = 0; i < PCNT_UNIT_MAX; i++) hal_pcnt_units[i].handler = nullptr;
+}
+
+esp_err_t pcnt_isr_handler_add(pcnt_unit_t unit, pcnt_isr_handler_t isr_handler, void* args) {
+  if (!hal_pcnt_service) return ESP_ERR_INVALID_STATE;
+  if (!valid_unit(unit)) return ESP_ERR_INVALID_ARG;
+  hal_pcnt_units[unit].handler = isr_handler;   // Replaces an earlier handler, like the IDF
+  hal_pcnt_units[unit].handlerArg = args;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_isr_handler_remove(pcnt_unit_t unit) {
+  if (!hal_pcnt_service) return ESP_ERR_INVALID_STATE;
+  if (!valid_unit(unit)) return ESP_ERR_INVALID_ARG;
+  hal_pcnt_units[unit].handler = nullptr;
+  return ESP_OK;
+}
+
+// -----------------------------------------------------------------------------
+// Counting
+// -----------------------------------------------------------------------------
+
+static void raise_event(HalPcntUnit& u, uint32_t event) {
+  u.status = event;
+  if ((u.enabledEvents & event) && u.interruptEnabled && hal_pcnt_service && u.handler) {
+    u.interrupts++;
+    u.handler(u.handlerArg);
+  }
+}
+
+static void count_step(HalPcntUnit& u, int direction) {
+  u.count += direction;
+  if ((u.enabledEvents & PCNT_EVT_THRES_0) && u.count == u.threshold0) raise_event(u, PCNT_EVT_THRES_0);
+  if ((u.enabledEvents & PCNT_EVT_THRES_1) && u.count == u.threshold1) raise_event(u, PCNT_EVT_THRES_1);
+
+  // The limits reset the counter whether their event is enabled or not
+  if (u.count >= u.highLimit) {
+    u.count = 0;
+    raise_event(u, PCNT_EVT_H_LIM);
+  } else if (u.count <= u.lowLimit) {
+    u.count = 0;
+    raise_event(u, PCNT_EVT_L_LIM);
+  }
+}
+
+void hal_pcnt_pin_changed(uint8_t pin, int level) {
+  for (int i = 0; i < PCNT_UNIT_MAX; i++) {
+    HalPcntUnit& u = hal_pcnt_units[i];
+    if (!u.running) continue;
+
+    for (int ch = 0; ch < PCNT_CHANNEL_MAX; ch++) {
+      const HalPcntChannel& c = u.channels[ch];
+      if (!c.configured || c.pulsePin != (int)pin) continue;
+
+      pcnt_count_mode_t mode = level ? c.posMode : c.negMode;
+      int ctrl_level = c.ctrlPin >= 0 ? digitalRead((uint8_t)c.ctrlPin) : HIGH;
+      pcnt_ctrl_mode_t ctrl = ctrl_level ? c.hctrlMode : c.lctrlMode;
+      if (mode == PCNT_COUNT_DIS || ctrl == PCNT_MODE_DISABLE) continue;
+
+      int direction = (mode == PCNT_COUNT_INC) ? 1 : -1;
+      if (ctrl == PCNT_MODE_REVERSE) direction = -direction;
+      count_step(u, direction);
+    }
+  }
+}
+
+void hal_pcnt_reset() {
+  memset(hal_pcnt_units, 0, sizeof(hal_pcnt_units));
+  hal_pcnt_service = false;
+}
+
+uint32_t hal_pcnt_interrupts(pcnt_unit_t unit) {
+  return valid_unit(unit) ? hal_pcnt_units[unit].interrupts : 0;
+}
@@ -0,0 +1,458 @@
+#include "RideSimulator.h"
+#include <VescUart.h>
+#include <chrono>
+#include "ebike_controller.h"
+
+extern VescUart vescUart;
+
+// =============================================================================
+// PARAMETERS AND SCENARIOS
+// =============================================================================
+
+RideParams::RideParams()
+  : mass_kg(100.0f), crr(0.007f), cda_m2(0.55f), air_density(1.2f),
+    drivetrain_efficiency(0.95f), gear_min(0.8f), gear_max(3.8f),
+    torque_ripple(0.7f), brake_decel(2.5f),
+    wheel_diameter_m(WHEEL_DIAMETER_M), gear_ratio(MOTOR_GEAR_RATIO),
+    pole_pairs(MOTOR_POLES / 2.0f), kt_wheel(MOTOR_CONSTANT_KT),
+    gear_efficiency(0.9f), motor_resistance_ohm(0.3f), current_tau_ms(2.0f),
+    max_duty(0.95f),
+    ambient_c(25.0f), motor_rth_k_per_w(3.0f), motor_capacity_j_per_k(100.0f),
+    fet_loss_ohm(0.05f), fet_rth_k_per_w(8.0f), fet_capacity_j_per_k(30.0f),
+    vesc_current_max(10.0f), vesc_temp_start_c(85.0f), vesc_temp_end_c(100.0f),
+    battery_capacity_ah(7.0f), battery_resistance_ohm(0.18f),
+    battery_full_v(BATTERY_FULL_VOLTAGE), battery_empty_v(BATTERY_CRITICAL_VOLTAGE),
+    initial_soc(0.9f), bms_cutoff_v(37.7f) {}
+
+//                                 name        s     grade  torque cadence target brake
+static const RidePhase HILL_START_PHASES[] = {
+  {"stand",       1.0f,  6.0f,  0.0f,  0.0f,  0.0f, false},
+  {"climb",      20.0f,  6.0f, 35.0f, 60.0f,  0.0f, false},
+};
+
+static const RidePhase STOP_AND_GO_PHASES[] = {
+  {"go",         12.0f,  0.0f, 30.0f, 70.0f,  0.0f, false},
+  {"stop",        6.0f,  0.0f,  0.0f,  0.0f,  0.0f, true},
+  {"go",         12.0f,  0.0f, 30.0f, 70.0f,  0.0f, false},
+  {"stop",        6.0f,  0.0f,  0.0f,  0.0f,  0.0f, true},
+  {"go",         12.0f,  0.0f, 30.0f, 70.0f,  0.0f, false},
+  {"stop",        6.0f,  0.0f,  0.0f,  0.0f,  0.0f, true},
+  {"go",         12.0f,  0.0f, 30.0f, 70.0f,  0.0f, false},
+  {"stop",        6.0f,  0.0f,  0.0f,  0.0f,  0.0f, true},
+};
+
+static const RidePhase CRUISE_25_PHASES[] = {
+  {"accelerate", 20.0f,  0.0f, 30.0f, 75.0f, 25.0f, false},
+  {"cruise",     60.0f,  0.0f, 15.0f, 80.0f, 25.0f, false},
+};
+
+// Coasting with the weight on the stopped pedals: only PAS can end the assist
+static const RidePhase PEDAL_PAUSE_PHASES[] = {
+  {"go",          8.0f,  0.0f, 30.0f, 70.0f,  0.0f, false},
+  {"coast",       2.0f,  0.0f, 20.0f,  0.0f,  0.0f, false},
+  {"go",          4.0f,  0.0f, 30.0f, 70.0f,  0.0f, false},
+  {"coast",       2.0f,  0.0f, 20.0f,  0.0f,  0.0f, false},
+  {"go",          4.0f,  0.0f, 30.0f, 50.0f,  0.0f, false},
+  {"coast",       2.0f,  0.0f, 20.0f,  0.0f,  0.0f, false},
+};
+
+static const RidePhase LONG_CLIMB_PHASES[] = {
+  {"climb",     900.0f,  6.0f, 35.0f, 60.0f,  0.0f, false},
+};
+
+#define RIDE_PHASES(p) p, (int)(sizeof(p) / sizeof(p[0]))
+
+const RideScenario RIDE_HILL_START  = {"hill start",     RIDE_PHASES(HILL_START_PHASES)};
+const RideScenario RIDE_STOP_AND_GO = {"stop-and-go",    RIDE_PHASES(STOP_AND_GO_PHASES)};
+const RideScenario RIDE_CRUISE_25   = {"25 km/h cruise", RIDE_PHASES(CRUISE_25_PHASES)};
+const RideScenario RIDE_PEDAL_PAUSE = {"pedal pause",    RIDE_PHASES(PEDAL_PAUSE_PHASES)};
+const RideScenario RIDE_LONG_CLIMB  = {"long climb",     RIDE_PHASES(LONG_CLIMB_PHASES)};
+
+// PAS quadrature sequence for forward pedaling (A<<1 | B), see read_pas_sensors()
+static const uint8_t PAS_SEQUENCE[4] = {0, 1, 3, 2};
+static const int PAS_STEPS_PER_REV = PAS_PULSES_PER_REV * 4;
+
+// =============================================================================
+// RIDE SIMULATOR
+// =============================================================================
+
+RideSimulator::RideSimulator(const RideParams& ride_params)
+  : params(ride_params), vesc() {
+  resetRide();
+}
+
+void RideSimulator::resetRide() {
+  speed = 0.0f;
+  distance = 0.0f;
+  crankAngleRad = PI / 2.0;       // Pedal forward and level - strongest start
+  quadratureStep = PAS_STEPS_PER_REV / 4;
+  pedaling = false;
+  riderIntegral = 0.0f;
+  awaitingAssist = false;
+  awaitingCommand = false;
+  awaitingTarget = false;
+  targetsReached = 0;
+  commandStartUs = 0;
+  targetTimeSumMs = 0.0;
+  pedalStartUs = 0;
+  pedalStartStep = 0;
+  latencySumMs = 0.0;
+  crankTurning = false;
+  awaitingStop = false;
+  crankStopUs = 0;
+  stopLatencySumMs = 0.0;
+
+  motorCurrentA = 0.0f;
+  vesc.clearCommand();
+  soc = params.initial_soc;
+  batteryV = params.battery_empty_v + soc * (params.battery_full_v - params.battery_empty_v);
+  ampHours = 0.0f;
+  wattHours = 0.0f;
+  tachometer = 0.0;
+  motorTempC = params.ambient_c;
+  fetTempC = params.ambient_c;
+  bmsTripped = false;
+  updateTelemetry(0.0f, 0.0f);
+}
+
+void RideSimulator::resetFirmware() {
+  // Pins, interrupts and profiles as after power-up
+  ebike_setup();
+  vescUart.setSerialPort(&vesc);
+  debug_mode = false;
+
+  // PAS pins show the crank position and the decoder agrees
+  uint8_t state = PAS_SEQUENCE[quadratureStep & 3];
+  hal_set_digital(PAS_PIN_A, (state >> 1) & 1);
+  hal_set_digital(PAS_PIN_B, state & 1);
+  reset_pas_decoder();
+  current_cadence_rpm = 0.0;
+  current_cadence_rps = 0.0;
+
+  setTorqueSensor(0.0f);
+  crank_torque_nm = 0.0;
+  filtered_torque = 0.0;
+  current_mode = 0;
+  current_speed_kmh = 0.0;
+  current_motor_rpm = 0.0;
+  vesc_data_valid = false;
+  motor_enabled = false;
+  target_current_amps = 0.0;
+}
+
+RideKpis RideSimulator::run(const RideScenario& scenario) {
+  auto wall_start = std::chrono::steady_clock::now();
+
+  resetRide();
+  resetFirmware();
+
+  RideKpis kpis = {};
+  kpis.min_battery_voltage = batteryV;
+  kpis.min_current_limit_a = MAX_MOTOR_CURRENT;
+  uint32_t commands_start = vesc.commandsReceived;
+  uint32_t timeouts_start = vescUart.linkStats.timeouts;
+
+  nowUs = hal_time_us();
+  nextSensorUs = nowUs;
+  nextVescUs = nowUs;
+  const float dt = STEP_US / 1e6f;
+
+  for (int p = 0; p < scenario.num_phases; p++) {
+    const RidePhase& phase = scenario.phases[p];
+    long steps = (long)(phase.duration_s / dt + 0.5f);
+
+    // Current overshoot: peak vs. settled value (mean of the last half).
+    // The peak counts from the phase's own first rise - current carried
+    // over from the previous phase is not this phase's overshoot
+    float phase_peak = 0.0f;
+    float phase_low = motorCurrentA;
+    bool phase_rising = false;
+    double settled_sum = 0.0;
+    double settled_sum_sq = 0.0;
+    long settled_count = 0;
+
+    for (long i = 0; i < steps; i++) {
+      step(phase, dt, kpis);
+      vesc.service();
+
+      // sensorTask tick, vescTask wakes on the new command; otherwise vescTask
+      // wakes on its poll timeout
+      if (nowUs >= nextSensorUs) {
+        SharedMotorCommand command = run_sensor_cycle();
+        command.queued_time_us = micros();
+        run_vesc_cycle(&command);
+        nextSensorUs += 10000;
+        nextVescUs = nowUs + VESC_UART_POLL_MS * 1000;
+      } else if (nowUs >= nextVescUs) {
+        run_vesc_cycle(NULL);
+        nextVescUs = nowUs + VESC_UART_POLL_MS * 1000;
+      }
+
+      if (!phase_rising) {
+        phase_low = min(phase_low, motorCurrentA);
+        phase_rising = motorCurrentA > phase_low + 0.05f;
+      }
+      if (phase_rising && motorCurrentA > phase_peak) phase_peak = motorCurrentA;
+      if (i >= steps / 2) {
+        settled_sum += motorCurrentA;
+        settled_sum_sq += (double)motorCurrentA * motorCurrentA;
+        settled_count++;
+      }
+    }
+
+    float settled = settled_count > 0 ? (float)(settled_sum / settled_count) : 0.0f;
+    float overshoot = phase_peak - settled;
+    if (settled >= ASSIST_ON_CURRENT_A && overshoot > kpis.current_overshoot_a) {
+      kpis.current_overshoot_a = overshoot;
+      kpis.current_overshoot_pct = overshoot / settled * 100.0f;
+    }
+    if (settled >= ASSIST_ON_CURRENT_A) {
+      double variance = settled_sum_sq / settled_count - (double)settled * settled;
+      float ripple_pct = (float)(sqrt(variance > 0.0 ? variance : 0.0) / settled * 100.0);
+      if (ripple_pct > kpis.current_ripple_pct) kpis.current_ripple_pct = ripple_pct;
+    }
+    kpis.duration_s += phase.duration_s;
+  }
+
+  kpis.distance_km = distance / 1000.0f;
+  kpis.avg_speed_kmh = kpis.duration_s > 0 ? kpis.distance_km / (kpis.duration_s / 3600.0f) : 0.0f;
+  kpis.wh_per_km = kpis.distance_km > 0 ? kpis.battery_wh / kpis.distance_km : 0.0f;
+  kpis.motor_human_ratio = kpis.human_wh > 0 ? kpis.motor_wh / kpis.human_wh : 0.0f;
+  kpis.assist_delivery_pct = kpis.requested_wh > 0 ? kpis.motor_wh / kpis.requested_wh * 100.0f : 0.0f;
+  if (kpis.assisted_starts > 0) {
+    kpis.assist_latency_avg_ms = (float)(latencySumMs / kpis.assisted_starts);
+  }
+  if (targetsReached > 0) {
+    kpis.time_to_target_avg_ms = (float)(targetTimeSumMs / targetsReached);
+  }
+  if (kpis.crank_stops > 0) {
+    kpis.stop_latency_avg_ms = (float)(stopLatencySumMs / kpis.crank_stops);
+  }
+  kpis.commands_received = vesc.commandsReceived - commands_start;
+  kpis.uart_timeouts = vescUart.linkStats.timeouts - timeouts_start;
+
+  auto wall_end = std::chrono::steady_clock::now();
+  kpis.wall_time_ms = std::chrono::duration<double, std::milli>(wall_end - wall_start).count();
+  kpis.realtime_factor = kpis.wall_time_ms > 0 ? kpis.duration_s * 1000.0 / kpis.wall_time_ms : 0.0;
+  return kpis;
+}
+
+float RideSimulator::riderTorque(const RidePhase& phase, float dt) {
+  if (phase.brake || phase.rider_torque_nm <= 0.0f) {
+    riderIntegral = 0.0f;
+    return 0.0f;
+  }
+  if (phase.target_speed_kmh <= 0.0f) {
+    return phase.rider_torque_nm;
+  }
+
+  // Speed holding: PI on speed around the phase's base torque. Conditional
+  // integration: no integral build-up while the torque is at 0 or 60 Nm
+  // anyway, or the rider overshoots the target speed after every start. The
+  // P gain eases off the base torque within a few km/h of the target (with
+  // assist, far less rider torque holds the speed than reaches it)
+  float error = phase.target_speed_kmh - speedKmh();
+  float torque = phase.rider_torque_nm + 6.0f * error + riderIntegral;
+  bool saturated = (torque >= 60.0f && error > 0.0f) || (torque <= 0.0f && error < 0.0f);
+  if (!saturated) {
+    riderIntegral = constrain(riderIntegral + 1.0f * error * dt, -30.0f, 30.0f);
+  }
+  return constrain(torque, 0.0f, 60.0f);
+}
+
+void RideSimulator::step(const RidePhase& phase, float dt, RideKpis& kpis) {
+  const float g = 9.81f;
+  float radius = params.wheel_diameter_m / 2.0f;
+  float wheel_omega = speed / radius;
+
+  // Rider: ideal shifting to the preferred cadence, crank locked to the
+  // wheel through the freewheel while pedaling
+  float mean_torque = riderTorque(phase, dt);
+  bool was_pedaling = pedaling;
+  pedaling = mean_torque > 0.0f;
+
+  float crank_omega = 0.0f;
+  float crank_torque = 0.0f;
+  float gear = params.gear_min;
+  bool driving = pedaling && phase.cadence_rpm > 0.0f;
+  if (driving) {
+    float cadence_omega = phase.cadence_rpm * 2.0f * (float)PI / 60.0f;
+    gear = constrain(wheel_omega / cadence_omega, params.gear_min, params.gear_max);
+    crank_omega = wheel_omega / gear;
+    crank_torque = mean_torque * (1.0f - params.torque_ripple * cosf(2.0f * (float)crankAngleRad));
+  } else if (pedaling) {
+    crank_torque = mean_torque;     // Weight on the stopped pedals
+  }
+  setTorqueSensor(crank_torque);
+
+  // Assist latency: pedal start from (almost) standstill -> motor current
+  if (pedaling && !was_pedaling && speed < 0.5f) {
+    awaitingAssist = true;
+    awaitingCommand = true;
+    pedalStartUs = nowUs;
+    pedalStartStep = quadratureStep;
+    kpis.pedal_starts++;
+  } else if (!pedaling) {
+    awaitingAssist = false;
+    awaitingCommand = false;
+    awaitingTarget = false;
+  }
+  if (awaitingCommand && vesc.commandedCurrent() > 0.0f) {
+    int edges = (int)(quadratureStep - pedalStartStep);
+    if (edges > kpis.assist_start_edges_max) kpis.assist_start_edges_max = edges;
+    awaitingCommand = false;
+    awaitingTarget = true;
+    commandStartUs = nowUs;
+  }
+
+  // Stop latency: crank stops while the firmware commands assist -> the
+  // firmware commands 0 (the current decay after that is the VESC's)
+  bool turning = crank_omega > 0.0f;
+  if (crankTurning && !turning && vesc.commandedCurrent() > 0.0f) {
+    awaitingStop = true;
+    crankStopUs = nowUs;
+  } else if (turning) {
+    awaitingStop = false;
+  }
+  crankTurning = turning;
+
+  // Motor: VESC current loop, limited by the voltage left over the back-EMF
+  float motor_omega = wheel_omega * params.gear_ratio;
+  float ke = params.kt_wheel / params.gear_ratio;     // Motor shaft [V s/rad]
+  float commanded = max(vesc.commandedCurrent(), 0.0f);
+  float available = (params.max_duty * batteryV - ke * motor_omega) / params.motor_resistance_ohm;
+  float target = bmsTripped ? 0.0f : min(commanded, max(available, 0.0f));
+
+  // VESC thermal cutback: l_current_max scaled down linearly from start to
+  // end temperature, the hotter of winding and FETs
+  float hottest = max(motorTempC, fetTempC);
+  float thermal_scale = constrain((params.vesc_temp_end_c - hottest) /
+                                  (params.vesc_temp_end_c - params.vesc_temp_start_c), 0.0f, 1.0f);
+  float thermal_max = params.vesc_current_max * thermal_scale;
+  if (thermal_max < target) {
+    target = thermal_max;
+    kpis.vesc_cutback_s += dt;
+  }
+  motorCurrentA += (target - motorCurrentA) * min(dt * 1000.0f / params.current_tau_ms, 1.0f);
+  if (fabsf(motorCurrentA - target) < 1e-4f) motorCurrentA = target;  // No denormals while decaying
+
+  if (awaitingAssist && motorCurrentA >= ASSIST_ON_CURRENT_A) {
+    float latency_ms = (nowUs - pedalStartUs) / 1000.0f;
+    latencySumMs += latency_ms;
+    if (latency_ms > kpis.assist_latency_max_ms) kpis.assist_latency_max_ms = latency_ms;
+    kpis.assisted_starts++;
+    awaitingAssist = false;
+  }
+
+  // Time to target: the shaped command has caught up with the request
+  float requested = motor_enabled ? target_current_amps : 0.0f;
+  if (awaitingTarget && requested >= ASSIST_ON_CURRENT_A && fabsf(motorCurrentA - requested) <= 0.1f * requested) {
+    float time_ms = (nowUs - commandStartUs) / 1000.0f;
+    targetTimeSumMs += time_ms;
+    if (time_ms > kpis.time_to_target_max_ms) kpis.time_to_target_max_ms = time_ms;
+    targetsReached++;
+    awaitingTarget = false;
+  }
+
+  if (awaitingStop && vesc.commandedCurrent() <= 0.0f) {
+    float latency_ms = (nowUs - crankStopUs) / 1000.0f;
+    stopLatencySumMs += latency_ms;
+    if (latency_ms > kpis.stop_latency_max_ms) kpis.stop_latency_max_ms = latency_ms;
+    kpis.crank_stops++;
+    awaitingStop = false;
+  }
+
+  // Longitudinal dynamics
+  float slope = atanf(phase.grade_pct / 100.0f);
+  float f_rider = driving ? crank_torque * params.drivetrain_efficiency / (gear * radius) : 0.0f;
+  float f_motor = params.kt_wheel * motorCurrentA * params.gear_efficiency / radius;
+  float f_resist = params.mass_kg * g * (params.crr * cosf(slope) + sinf(slope)) +
+                   0.5f * params.air_density * params.cda_m2 * speed * speed;
+  float accel = (f_rider + f_motor - f_resist) / params.mass_kg;
+  if (phase.brake && speed > 0.0f) accel -= params.brake_decel;
+  speed += accel * dt;
+  if (speed < 0.0f) speed = 0.0f;   // Held by the brakes / feet, no rolling back
+  distance += speed * dt;
+
+  // Battery: electrical power drawn by the motor through the controller
+  float p_elec = motorCurrentA * motorCurrentA * params.motor_resistance_ohm + ke * motor_omega * motorCurrentA;
+  float ocv = params.battery_empty_v + soc * (params.battery_full_v - params.battery_empty_v);
+  float input_current = p_elec / (batteryV * 0.97f);
+  batteryV = ocv - input_current * params.battery_resistance_ohm;
+  if (!bmsTripped && batteryV < params.bms_cutoff_v) {
+    bmsTripped = true;
+    kpis.bms_trips++;
+  }
+  float ah = input_current * dt / 3600.0f;
+  soc -= ah / params.battery_capacity_ah;
+  ampHours += ah;
+  wattHours += batteryV * ah;
+  tachometer += motor_omega / (2.0 * PI) * params.pole_pairs * 6.0 * dt;
+
+  // Heat
+  float i_sq = motorCurrentA * motorCurrentA;
+  motorTempC += (i_sq * params.motor_resistance_ohm - (motorTempC - params.ambient_c) / params.motor_rth_k_per_w) *
+                dt / params.motor_capacity_j_per_k;
+  fetTempC += (i_sq * params.fet_loss_ohm - (fetTempC - params.ambient_c) / params.fet_rth_k_per_w) *
+              dt / params.fet_capacity_j_per_k;
+
+  // KPIs
+  kpis.human_wh += crank_torque * crank_omega * dt / 3600.0f;
+  kpis.motor_wh += f_motor * speed * dt / 3600.0f;
+  if (motor_enabled) kpis.requested_wh += assist_power_watts * dt / 3600.0f;
+  kpis.battery_wh += batteryV * ah;
+  if (motorCurrentA > kpis.peak_motor_current_a) kpis.peak_motor_current_a = motorCurrentA;
+  if (speedKmh() > kpis.max_speed_kmh) kpis.max_speed_kmh = speedKmh();
+  if (batteryV < kpis.min_battery_voltage) kpis.min_battery_voltage = batteryV;
+  if (motorTempC > kpis.max_motor_temp_c) kpis.max_motor_temp_c = motorTempC;
+  if (fetTempC > kpis.max_fet_temp_c) kpis.max_fet_temp_c = fetTempC;
+  if (motor_current_limit_amps < kpis.min_current_limit_a) kpis.min_current_limit_a = motor_current_limit_amps;
+
+  updateTelemetry(motor_omega, input_current);
+
+  // Crank position -> PAS edges at their exact times within the step
+  uint64_t end_us = nowUs + STEP_US;
+  moveCrank(crankAngleRad + crank_omega * dt, nowUs, end_us);
+  nowUs = end_us;
+  hal_set_time_us(nowUs);
+}
+
+void RideSimulator::moveCrank(double new_angle, uint64_t t0_us, uint64_t t1_us) {
+  const double step_angle = 2.0 * PI / PAS_STEPS_PER_REV;
+  double old_angle = crankAngleRad;
+  long new_step = (long)floor(new_angle / step_angle);
+
+  while (quadratureStep < new_step) {
+    quadratureStep++;
+    double fraction = (quadratureStep * step_angle - old_angle) / (new_angle - old_angle);
+    hal_set_time_us(t0_us + (uint64_t)(fraction * (double)(t1_us - t0_us)));
+
+    uint8_t state = PAS_SEQUENCE[quadratureStep & 3];
+    hal_set_digital(PAS_PIN_A, (state >> 1) & 1);   // Only the pin that changes
+    hal_set_digital(PAS_PIN_B, state & 1);          // fires the ISR
+  }
+  crankAngleRad = new_angle;
+}
+
+void RideSimulator::setTorqueSensor(float crank_torque) {
+  // Inverse of update_torque(): TORQUE_MAX_NM spans the larger side of the ADC
+  int max_deviation = max(TORQUE_STANDSTILL - TORQUE_MAX_BACKWARD, TORQUE_MAX_FORWARD - TORQUE_STANDSTILL);
+  int raw = TORQUE_STANDSTILL + (int)(crank_torque / TORQUE_MAX_NM * max_deviation + 0.5f);
+  hal_set_analog(TORQUE_SENSOR_PIN, (uint16_t)constrain(raw, 0, 4095));
+}
+
+void RideSimulator::updateTelemetry(float motor_omega, float input_current) {
+  VescEmulator::Telemetry& t = vesc.telemetry;
+  float ke = params.kt_wheel / params.gear_ratio;
+  t.motor_current = motorCurrentA;
+  t.input_current = input_current;
+  t.erpm = motor_omega * 60.0f / (2.0f * (float)PI) * params.pole_pairs;
+  t.input_voltage = batteryV;
+  t.duty = batteryV > 0 ? (ke * motor_omega + motorCurrentA * params.motor_resistance_ohm) / batteryV : 0.0f;
+  t.amp_hours = ampHours;
+  t.watt_hours = wattHours;
+  t.tachometer = (int32_t)tachometer;
+  t.tachometer_abs = (int32_t)tachometer;
+  t.temp_motor = motorTempC;
+  t.temp_mosfet = fetTempC;
+}
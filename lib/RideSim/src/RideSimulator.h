@@ -0,0 +1,211 @@
+#ifndef RIDE_SIM_RIDE_SIMULATOR_H
+#define RIDE_SIM_RIDE_SIMULATOR_H
+
+#include <Arduino.h>
+#include "VescEmulator.h"
+
+// =============================================================================
+// RIDE SIMULATOR - closed loop around the unmodified control pipeline
+// =============================================================================
+// Host only ([env:test]). Models the rider (torque per crank angle, ideal
+// shifting, speed holding), the bike (mass, grade, rolling resistance, aero
+// drag), the Q100C motor (Kt at the wheel, 14.2:1 gear, back-EMF limit), the
+// 13S2P battery (OCV + internal resistance), winding and FET temperatures
+// (lumped, I^2 R heated) and the VESC at the other end of the UART
+// (VescEmulator), including its thermal current cutback.
+//
+// The firmware sees only its hardware: PAS quadrature edges through the HAL
+// interrupt path, the torque sensor ADC, and UART bytes. It runs the same
+// cycles as on the ESP32: run_sensor_cycle() every 10ms, run_vesc_cycle()
+// right after with the new command and every VESC_UART_POLL_MS in between.
+//
+// Everything runs on the HAL virtual clock, so a ride is deterministic and
+// runs far faster than real time (a 60s ride takes a few milliseconds).
+
+struct RideParams {
+  // Bike + rider
+  float mass_kg;                  // Total mass
+  float crr;                      // Rolling resistance coefficient
+  float cda_m2;                   // Drag area
+  float air_density;              // [kg/m^3]
+  float drivetrain_efficiency;    // Crank -> wheel
+  float gear_min;                 // Lowest gear [wheel rev per crank rev]
+  float gear_max;                 // Highest gear
+  float torque_ripple;            // Crank torque = mean * (1 - ripple * cos(2 angle))
+  float brake_decel;              // [m/s^2] while a phase brakes
+
+  // Q100C hub motor
+  float wheel_diameter_m;
+  float gear_ratio;               // Motor rev per wheel rev
+  float pole_pairs;
+  float kt_wheel;                 // Wheel torque per phase amp [Nm/A]
+  float gear_efficiency;          // Planetary gear
+  float motor_resistance_ohm;     // Phase resistance
+  float current_tau_ms;           // VESC current loop time constant
+  float max_duty;
+
+  // Heat: winding and VESC FETs, each one lumped thermal mass
+  float ambient_c;
+  float motor_rth_k_per_w;        // Winding -> ambient
+  float motor_capacity_j_per_k;
+  float fet_loss_ohm;             // FET heat per motor amp^2
+  float fet_rth_k_per_w;
+  float fet_capacity_j_per_k;
+
+  // VESC limits
+  float vesc_current_max;         // l_current_max [A]
+  float vesc_temp_start_c;        // l_temp_fet_start / l_temp_motor_start: cutback from here
+  float vesc_temp_end_c;          // ... to 0 A here
+
+  // Battery (13S2P)
+  float battery_capacity_ah;
+  float battery_resistance_ohm;
+  float battery_full_v;           // OCV at 100% SoC
+  float battery_empty_v;          // OCV at 0% SoC
+  float initial_soc;              // 0..1
+  float bms_cutoff_v;             // BMS undervoltage trip: the pack switches off
+
+  RideParams();
+};
+
+// One segment of a scenario. With target_speed_kmh > 0 the rider modulates
+// torque around rider_torque_nm to hold that speed. Torque with cadence_rpm
+// 0 = standing on the stopped pedals (the sensor sees the torque, the crank
+// does not turn).
+struct RidePhase {
+  const char* name;
+  float duration_s;
+  float grade_pct;
+  float rider_torque_nm;          // Mean crank torque (0 = not pedaling)
+  float cadence_rpm;              // Rider's preferred cadence (ideal shifting)
+  float target_speed_kmh;
+  bool brake;
+};
+
+struct RideScenario {
+  const char* name;
+  const RidePhase* phases;
+  int num_phases;
+};
+
+// Built-in scenarios
+extern const RideScenario RIDE_HILL_START;      // Standing start on a 6% grade
+extern const RideScenario RIDE_STOP_AND_GO;     // 4x accelerate / brake to standstill
+extern const RideScenario RIDE_CRUISE_25;       // Accelerate, then hold 25 km/h
+extern const RideScenario RIDE_PEDAL_PAUSE;     // 3x coast with the feet on the stopped pedals
+extern const RideScenario RIDE_LONG_CLIMB;      // 15 minutes up a 6% grade
+
+struct RideKpis {
+  float duration_s;
+  float distance_km;
+  float avg_speed_kmh;
+  float max_speed_kmh;
+
+  int pedal_starts;               // Rider started pedaling from a stop
+  int assisted_starts;            // ... and the motor reached ASSIST_ON_CURRENT_A
+  float assist_latency_avg_ms;    // Pedal start -> motor current >= ASSIST_ON_CURRENT_A
+  float assist_latency_max_ms;
+  int assist_start_edges_max;     // PAS edges from pedal start until the first motor command > 0
+  float time_to_target_avg_ms;    // First motor command > 0 -> motor current within 10% of the request
+  float time_to_target_max_ms;    // (request = target_current_amps, before the command shaping)
+
+  int crank_stops;                // Crank stopped while the motor was commanded
+  float stop_latency_avg_ms;      // Crank stop -> motor command 0
+  float stop_latency_max_ms;
+
+  float peak_motor_current_a;
+  float current_overshoot_a;      // Worst phase: peak after its first rise - settled (mean of the last half)
+  float current_overshoot_pct;
+  float current_ripple_pct;       // Worst phase: std / mean of the settled current (pedal stroke surge)
+
+  float human_wh;                 // At the crank
+  float motor_wh;                 // Mechanical, at the wheel
+  float battery_wh;
+  float wh_per_km;                // Battery energy per distance
+  float motor_human_ratio;        // motor_wh / human_wh
+  float requested_wh;             // assist_power_watts while the motor is enabled
+  float assist_delivery_pct;      // motor_wh / requested_wh
+  float min_battery_voltage;
+  int bms_trips;                  // Loaded voltage below bms_cutoff_v (no motor for the rest of the ride)
+
+  float max_motor_temp_c;
+  float max_fet_temp_c;
+  float vesc_cutback_s;           // The VESC's thermal limit was below the command
+  float min_current_limit_a;      // Lowest motor_current_limit_amps (thermal derating)
+
+  uint32_t commands_received;     // SET_CURRENT frames seen by the VESC
+  uint32_t uart_timeouts;         // VescUart request timeouts during the ride
+  double wall_time_ms;            // Host time for the whole ride
+  double realtime_factor;         // Simulated time / host time
+};
+
+class RideSimulator {
+public:
+  static constexpr float ASSIST_ON_CURRENT_A = 0.5f;
+  static constexpr uint32_t STEP_US = 500;        // Physics step
+
+  explicit RideSimulator(const RideParams& params = RideParams());
+
+  // Resets the bike and the firmware ride state, then rides the scenario
+  RideKpis run(const RideScenario& scenario);
+
+  // State after the last step
+  float speedKmh() const { return speed * 3.6f; }
+  float motorCurrent() const { return motorCurrentA; }
+  float batteryVoltage() const { return batteryV; }
+  float motorTemp() const { return motorTempC; }
+  float fetTemp() const { return fetTempC; }
+  double crankAngle() const { return crankAngleRad; }
+
+  RideParams params;
+  VescEmulator vesc;
+
+private:
+  void resetRide();
+  void resetFirmware();
+  float riderTorque(const RidePhase& phase, float dt);
+  void step(const RidePhase& phase, float dt, RideKpis& kpis);
+  void moveCrank(double new_angle, uint64_t t0_us, uint64_t t1_us);
+  void setTorqueSensor(float crank_torque);
+  void updateTelemetry(float motor_omega, float input_current);
+
+  // Bike
+  float speed;                    // [m/s]
+  float distance;                 // [m]
+  double crankAngleRad;
+  long quadratureStep;            // Crank position in PAS steps (32 per rev)
+  bool pedaling;
+  float riderIntegral;            // Speed holding (rider PI controller)
+
+  // Assist latency measurement
+  bool awaitingAssist;
+  bool awaitingCommand;
+  bool awaitingTarget;
+  int targetsReached;
+  uint64_t commandStartUs;
+  double targetTimeSumMs;
+  uint64_t pedalStartUs;
+  long pedalStartStep;
+  double latencySumMs;
+  bool crankTurning;
+  bool awaitingStop;
+  uint64_t crankStopUs;
+  double stopLatencySumMs;
+
+  // Motor / battery
+  float motorCurrentA;
+  float batteryV;
+  float soc;
+  float ampHours;
+  float wattHours;
+  double tachometer;
+  float motorTempC;
+  float fetTempC;
+  bool bmsTripped;
+
+  uint64_t nowUs;
+  uint64_t nextSensorUs;
+  uint64_t nextVescUs;
+};
+
+#endif // RIDE_SIM_RIDE_SIMULATOR_H
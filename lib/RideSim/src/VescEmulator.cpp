@@ -0,0 +1,139 @@
+#include "VescEmulator.h"
+#include <VescUart.h>
+
+VescEmulator::VescEmulator(uint32_t baud, uint32_t turnaround_us)
+  : ScriptedStream(baud), telemetry(), timeoutMs(1000), commandsReceived(0),
+    requestsAnswered(0), badFrames(0), turnaroundUs(turnaround_us), txFreeUs(0),
+    lastCommandUs(0), commanded(0.0f) {
+  telemetry.temp_mosfet = 25.0f;
+  telemetry.temp_motor = 25.0f;
+}
+
+void VescEmulator::clearCommand() {
+  commanded = 0.0f;
+  for (auto it = frames.begin(); it != frames.end();) {
+    if (!it->payload.empty() && it->payload[0] == COMM_SET_CURRENT) {
+      it = frames.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+size_t VescEmulator::write(uint8_t value) {
+  // The byte is on the wire for one byte-time after the previous one
+  uint64_t now = hal_time_us();
+  txFreeUs = (txFreeUs > now ? txFreeUs : now) + byteTimeUs();
+  parseByte(value, txFreeUs);
+  return 1;
+}
+
+size_t VescEmulator::write(const uint8_t* buffer, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    write(buffer[i]);
+  }
+  return size;
+}
+
+void VescEmulator::parseByte(uint8_t value, uint64_t arrival_us) {
+  if (rxFrame.empty() && value != 2 && value != 3) {
+    return;  // Not a start byte - resync
+  }
+  rxFrame.push_back(value);
+
+  size_t header = rxFrame[0] == 2 ? 2 : 3;
+  if (rxFrame.size() < header) return;
+  size_t len = header == 2 ? rxFrame[1] : ((size_t)rxFrame[1] << 8) | rxFrame[2];
+  if (rxFrame.size() < header + len + 3) return;
+
+  const uint8_t* payload = rxFrame.data() + header;
+  uint16_t crc = ((uint16_t)rxFrame[header + len] << 8) | rxFrame[header + len + 1];
+  if (rxFrame.back() == 3 && crc == crc16((unsigned char*)payload, len)) {
+    frames.push_back(pendingFrame{arrival_us, std::vector<uint8_t>(payload, payload + len)});
+  } else {
+    badFrames++;
+  }
+  rxFrame.clear();
+}
+
+void VescEmulator::service() {
+  uint64_t now = hal_time_us();
+  while (!frames.empty() && frames.front().arrival_us <= now) {
+    handleFrame(frames.front());
+    frames.pop_front();
+  }
+
+  if (commanded != 0.0f && now - lastCommandUs > (uint64_t)timeoutMs * 1000) {
+    commanded = 0.0f;
+  }
+}
+
+void VescEmulator::handleFrame(const pendingFrame& frame) {
+  const uint8_t* payload = frame.payload.data();
+  int32_t len = (int32_t)frame.payload.size();
+  if (len < 1) return;
+
+  int32_t index = 1;
+  switch (payload[0]) {
+    case COMM_SET_CURRENT:
+      if (len < 5) return;
+      commanded = buffer_get_int32(payload, &index) / 1000.0f;
+      lastCommandUs = frame.arrival_us;
+      commandsReceived++;
+      break;
+
+    case COMM_GET_VALUES:
+    case COMM_GET_VALUES_SELECTIVE: {
+      uint32_t mask = 0xFFFFFFFF;
+      if (payload[0] == COMM_GET_VALUES_SELECTIVE) {
+        if (len < 5) return;
+        mask = buffer_get_uint32(payload, &index);
+      }
+
+      // Same field order for both; the full answer has every field
+      const Telemetry& t = telemetry;
+      uint8_t out[64];
+      int32_t n = 0;
+      out[n++] = payload[0];
+      if (payload[0] == COMM_GET_VALUES_SELECTIVE) buffer_append_uint32(out, mask, &n);
+      if (mask & SELECT_TEMP_MOSFET)        buffer_append_float16(out, t.temp_mosfet, 10.0, &n);
+      if (mask & SELECT_TEMP_MOTOR)         buffer_append_float16(out, t.temp_motor, 10.0, &n);
+      if (mask & SELECT_AVG_MOTOR_CURRENT)  buffer_append_float32(out, t.motor_current, 100.0, &n);
+      if (mask & SELECT_AVG_INPUT_CURRENT)  buffer_append_float32(out, t.input_current, 100.0, &n);
+      if (mask & SELECT_AVG_ID)             buffer_append_int32(out, 0, &n);
+      if (mask & SELECT_AVG_IQ)             buffer_append_float32(out, t.motor_current, 100.0, &n);
+      if (mask & SELECT_DUTY_CYCLE)         buffer_append_float16(out, t.duty, 1000.0, &n);
+      if (mask & SELECT_RPM)                buffer_append_float32(out, t.erpm, 1.0, &n);
+      if (mask & SELECT_INPUT_VOLTAGE)      buffer_append_float16(out, t.input_voltage, 10.0, &n);
+      if (mask & SELECT_AMP_HOURS)          buffer_append_float32(out, t.amp_hours, 10000.0, &n);
+      if (mask & SELECT_AMP_HOURS_CHARGED)  buffer_append_float32(out, 0.0, 10000.0, &n);
+      if (mask & SELECT_WATT_HOURS)         buffer_append_float32(out, t.watt_hours, 10000.0, &n);
+      if (mask & SELECT_WATT_HOURS_CHARGED) buffer_append_float32(out, 0.0, 10000.0, &n);
+      if (mask & SELECT_TACHOMETER)         buffer_append_int32(out, t.tachometer, &n);
+      if (mask & SELECT_TACHOMETER_ABS)     buffer_append_int32(out, t.tachometer_abs, &n);
+      if (mask & SELECT_FAULT)              out[n++] = FAULT_CODE_NONE;
+      if (mask & SELECT_PID_POS)            buffer_append_float32(out, 0.0, 1000000.0, &n);
+      if (mask & SELECT_CONTROLLER_ID)      out[n++] = 0;
+      answer(out, n, frame.arrival_us + turnaroundUs);
+      requestsAnswered++;
+      break;
+    }
+
+    default:
+      break;  // Not used by the firmware
+  }
+}
+
+void VescEmulator::answer(const uint8_t* payload, int32_t len, uint64_t at_us) {
+  uint8_t frame[72];
+  int32_t n = 0;
+  uint16_t crc = crc16((unsigned char*)payload, len);
+  frame[n++] = 2;
+  frame[n++] = (uint8_t)len;
+  memcpy(frame + n, payload, len);
+  n += len;
+  frame[n++] = (uint8_t)(crc >> 8);
+  frame[n++] = (uint8_t)(crc & 0xFF);
+  frame[n++] = 3;
+  scriptAt(at_us, frame, n);
+}
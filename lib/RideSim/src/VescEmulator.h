@@ -0,0 +1,74 @@
+#ifndef RIDE_SIM_VESC_EMULATOR_H
+#define RIDE_SIM_VESC_EMULATOR_H
+
+#include <Arduino.h>
+#include <ScriptedStream.h>
+#include <deque>
+
+// =============================================================================
+// VESC EMULATOR - the VESC end of the UART, on the HAL virtual clock
+// =============================================================================
+// Hand it to VescUart::setSerialPort(). Frames written by the firmware reach
+// the emulator one byte-time apart (115200 baud), like on the wire:
+//   - COMM_SET_CURRENT takes effect when its last byte has arrived
+//   - COMM_GET_VALUES / COMM_GET_VALUES_SELECTIVE are answered
+//     turnaroundUs after arrival with the current `telemetry`
+// The owner (RideSimulator) updates `telemetry` and calls service() as
+// virtual time advances.
+
+class VescEmulator : public ScriptedStream {
+public:
+  struct Telemetry {
+    float temp_mosfet;
+    float temp_motor;
+    float motor_current;
+    float input_current;
+    float duty;
+    float erpm;
+    float input_voltage;
+    float amp_hours;
+    float watt_hours;
+    int32_t tachometer;
+    int32_t tachometer_abs;
+  };
+
+  explicit VescEmulator(uint32_t baud = 115200, uint32_t turnaround_us = 300);
+
+  // Applies commands and sends answers that are due at the current virtual time
+  void service();
+
+  // Current set by the last SET_CURRENT (0 after timeoutMs without one)
+  float commandedCurrent() const { return commanded; }
+
+  // Motor off, SET_CURRENT frames still on the wire dropped (before the next ride)
+  void clearCommand();
+
+  size_t write(uint8_t value) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+
+  Telemetry telemetry;
+  uint32_t timeoutMs;          // VESC app timeout - current drops to 0
+  uint32_t commandsReceived;
+  uint32_t requestsAnswered;
+  uint32_t badFrames;
+
+private:
+  struct pendingFrame {
+    uint64_t arrival_us;
+    std::vector<uint8_t> payload;
+  };
+
+  void parseByte(uint8_t value, uint64_t arrival_us);
+  void handleFrame(const pendingFrame& frame);
+  void answer(const uint8_t* payload, int32_t len, uint64_t at_us);
+
+  uint32_t turnaroundUs;
+  uint64_t txFreeUs;           // Host -> VESC line busy until
+  uint64_t lastCommandUs;
+  float commanded;
+
+  std::vector<uint8_t> rxFrame;
+  std::deque<pendingFrame> frames;
+};
+
+#endif // RIDE_SIM_VESC_EMULATOR_H
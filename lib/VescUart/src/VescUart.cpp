@@ -2,6 +2,8 @@
 #include "VescUart.h"
 
 VescUart::VescUart(uint32_t timeout_ms) : _TIMEOUT(timeout_ms) {
+	memset(&linkStats, 0, sizeof(linkStats));
+	memset(pending, 0, sizeof(pending));
 	nunchuck.valueX         = 127;
 	nunchuck.valueY         = 127;
 	nunchuck.lowerButton  	= false;
@@ -18,164 +20,380 @@ void VescUart::setDebugPort(Stream* port)
 	debugPort = port;
 }
 
-int VescUart::receiveUartMessage(uint8_t * payloadReceived) {
-
-	// Messages <= 255 starts with "2", 2nd byte is length
-	// Messages > 255 starts with "3" 2nd and 3rd byte is length combined with 1st >>8 and then &0xFF
+int VescUart::update(void) {
 
 	// Makes no sense to run this function if no serialPort is defined.
 	if (serialPort == NULL)
-		return -1;
-
-	uint16_t counter = 0;
-	uint16_t endMessage = 256;
-	bool messageRead = false;
-	bool packetSizeExceeded = false;
-	uint8_t messageReceived[256];
-	uint16_t lenPayload = 0;
-	
-	uint32_t timeout = millis() + _TIMEOUT; // Defining the timestamp for timeout (100ms before timeout)
+		return 0;
+
+	uint32_t now = millis();
+	int frames = 0;
+	bool gotBytes = false;
+
+	// Only consume what is already in the RX buffer - never wait for more.
+	// The UART driver's RX ring is the only queue: header/footer bytes go through
+	// the state machine, payload bytes are read straight into rxPayload in one
+	// chunk and checksummed on the way (no second pass, no copy).
+	int waiting;
+	while ((waiting = serialPort->available()) > 0) {
+		rxLastByteMs = now;
+		gotBytes = true;
+
+		if (rxState == RX_PAYLOAD) {
+			size_t chunk = rxLength - rxIndex;
+			if (chunk > (size_t)waiting) {
+				chunk = waiting;
+			}
+			uint8_t * dest = rxPayload + rxIndex;
+			size_t received = serialPort->readBytes(dest, chunk);
+			if (received == 0) {
+				break;
+			}
+			for (size_t i = 0; i < received; i++) {
+				rxCrcCalc = crc16_update(rxCrcCalc, dest[i]);
+			}
+			rxIndex += received;
+			linkStats.bytesReceived += received;
+			if (rxIndex == rxLength) {
+				rxState = RX_CRC_HIGH;
+			}
+			continue;
+		}
+
+		int value = serialPort->read();
+		if (value < 0) {
+			break;
+		}
+		linkStats.bytesReceived++;
+
+		if (parseByte((uint8_t)value)) {
+			frames++;
+		}
+	}
+
+	// A frame that stopped arriving half way is dropped, so the parser resyncs on the next start byte.
+	// Checked after draining: when this call runs late (flash writes stall the task), the rest of
+	// a frame that arrived in time is already waiting and must not count as a gap.
+	if (!gotBytes && rxState != RX_WAIT_START && now - rxLastByteMs > RX_GAP_TIMEOUT_MS) {
+		linkStats.framingErrors++;
+		rxState = RX_WAIT_START;
+		if (debugPort != NULL) {
+			debugPort->println("Incomplete message dropped");
+		}
+	}
 
-	while ( millis() < timeout && messageRead == false && packetSizeExceeded == false) {
+	// Expire requests that got no answer
+	for (int i = 0; i < MAX_PENDING_REQUESTS; i++) {
+		if (pending[i].status == REQUEST_PENDING && now - pending[i].sentAtMs >= _TIMEOUT) {
+			pending[i].status = REQUEST_TIMEOUT;
+			linkStats.timeouts++;
+			if (debugPort != NULL) {
+				debugPort->println("Timeout");
+			}
+		}
+	}
 
-		while (serialPort->available()) {
+	return frames;
+}
 
-			messageReceived[counter++] = serialPort->read();
+bool VescUart::parseByte(uint8_t value) {
 
-			if (counter == 2) {
+	// Messages <= 255 starts with "2", 2nd byte is length
+	// Messages > 255 starts with "3" 2nd and 3rd byte is length combined with 1st >>8 and then &0xFF
 
-				switch (messageReceived[0])
-				{
-					case 2:
-						endMessage = messageReceived[1] + 5; //Payload size + 2 for sice + 3 for SRC and End.
-						lenPayload = messageReceived[1];
-					break;
+	switch (rxState) {
+		case RX_WAIT_START:
+			rxLength = 0;
+			if (value == 2) {
+				rxState = RX_LENGTH;
+			}
+			else if (value == 3) {
+				rxState = RX_LENGTH_HIGH;
+			}
+			else {
+				linkStats.bytesDiscarded++;
+			}
+			return false;
 
-					case 3:
-						// ToDo: Add Message Handling > 255 (starting with 3)
-						if( debugPort != NULL ){
-							debugPort->println("Message is larger than 256 bytes - not supported");
-						}
-					break;
+		case RX_LENGTH_HIGH:
+			rxLength = (uint16_t)value << 8;
+			rxState = RX_LENGTH;
+			return false;
 
-					default:
-						if( debugPort != NULL ){
-							debugPort->println("Unvalid start bit");
-						}
-					break;
+		case RX_LENGTH:
+			rxLength |= value;
+			if (rxLength == 0 || rxLength > VESCUART_RX_BUFFER_SIZE) {
+				linkStats.framingErrors++;
+				rxState = RX_WAIT_START;
+				if (debugPort != NULL) {
+					debugPort->println("Message does not fit into the receive buffer");
 				}
+				return false;
 			}
+			rxIndex = 0;
+			rxCrcCalc = 0;
+			rxState = RX_PAYLOAD;
+			return false;
 
-			if (counter >= sizeof(messageReceived)) {
-				packetSizeExceeded = true;
-				break;
+		case RX_PAYLOAD:
+			rxPayload[rxIndex++] = value;
+			rxCrcCalc = crc16_update(rxCrcCalc, value);
+			if (rxIndex == rxLength) {
+				rxState = RX_CRC_HIGH;
 			}
+			return false;
+
+		case RX_CRC_HIGH:
+			rxCrc = (uint16_t)value << 8;
+			rxState = RX_CRC_LOW;
+			return false;
 
-			if (counter == endMessage && messageReceived[endMessage - 1] == 3) {
-				messageReceived[endMessage] = 0;
+		case RX_CRC_LOW:
+			rxCrc |= value;
+			rxState = RX_END;
+			return false;
+
+		case RX_END:
+			rxState = RX_WAIT_START;
+			if (value != 3) {
+				linkStats.framingErrors++;
 				if (debugPort != NULL) {
-					debugPort->println("End of message reached!");
+					debugPort->println("Invalid end byte");
 				}
-				messageRead = true;
-				break; // Exit if end of message is reached, even if there is still more data in the buffer.
+				return false;
 			}
+			return handleFrame();
+	}
+
+	rxState = RX_WAIT_START;
+	return false;
+}
+
+bool VescUart::handleFrame(void) {
+
+	// CRC was accumulated while the payload arrived
+	if (rxCrcCalc != rxCrc) {
+		linkStats.crcErrors++;
+		if (debugPort != NULL) {
+			debugPort->print("CRC received: "); debugPort->println(rxCrc);
+			debugPort->print("CRC calc: "); debugPort->println(rxCrcCalc);
 		}
+		return false;
 	}
 
-	if(messageRead == false && debugPort != NULL ) {
-		debugPort->println("Timeout");
+	linkStats.framesReceived++;
+
+	if (debugPort != NULL) {
+		debugPort->print("Payload: ");
+		serialPrint(rxPayload, rxLength - 1);
 	}
-	
-	bool unpacked = false;
 
-	if (messageRead) {
-		unpacked = unpackPayload(messageReceived, endMessage, payloadReceived);
+	// Responses carry the packet id of their request
+	pendingRequest * request = findRequest(rxPayload[0]);
+	if (request == NULL || request->status != REQUEST_PENDING) {
+		linkStats.unmatchedFrames++;
+		return true;
 	}
 
-	if (unpacked) {
-		// Message was read
-		return lenPayload; 
+	if (!payloadComplete(rxPayload, rxLength)) {
+		linkStats.framingErrors++;	// Truncated answer - let the request time out
+		return true;
 	}
-	else {
-		// No Message Read
-		return 0;
+
+	bool decoded = processReadPacket(rxPayload);
+	if (!decoded && rawPacketHandler != NULL) {
+		rawPacketHandler(rxPayload, rxLength);
+		decoded = true;
 	}
+
+	if (decoded) {
+		request->status = REQUEST_DONE;
+		linkStats.lastLatencyUs = micros() - request->sentAtUs;
+		if (linkStats.lastLatencyUs > linkStats.maxLatencyUs) {
+			linkStats.maxLatencyUs = linkStats.lastLatencyUs;
+		}
+	}
+
+	return true;
 }
 
+VescUart::pendingRequest * VescUart::findRequest(uint8_t packetId) {
+	for (int i = 0; i < MAX_PENDING_REQUESTS; i++) {
+		if (pending[i].status != REQUEST_IDLE && pending[i].packetId == packetId) {
+			return &pending[i];
+		}
+	}
+	return NULL;
+}
 
+bool VescUart::payloadComplete(uint8_t * message, int len) {
+	// Every byte processReadPacket() reads for this packet id must be there
+	switch (message[0]) {
+		case COMM_FW_VERSION:
+			return len >= 3;	// Packet id, major, minor
 
-bool VescUart::unpackPayload(uint8_t * message, int lenMes, uint8_t * payload) {
+		case COMM_GET_VALUES:
+			return len >= 59;	// Packet id + fields up to the controller id
 
-	uint16_t crcMessage = 0;
-	uint16_t crcPayload = 0;
+		case COMM_GET_VALUES_SELECTIVE: {
+			if (len < 5) {
+				return false;
+			}
+			int32_t index = 1;
+			return len >= selectivePayloadSize(buffer_get_uint32(message, &index));
+		}
 
-	// Rebuild crc:
-	crcMessage = message[lenMes - 3] << 8;
-	crcMessage &= 0xFF00;
-	crcMessage += message[lenMes - 2];
+		default:
+			return true;
+	}
+}
 
-	if(debugPort!=NULL){
-		debugPort->print("SRC received: "); debugPort->println(crcMessage);
+int VescUart::selectivePayloadSize(uint32_t mask) {
+	// Field sizes in mask bit order, see processReadPacket()
+	static const uint8_t fieldSize[18] = {2, 2, 4, 4, 4, 4, 2, 4, 2, 4, 4, 4, 4, 4, 4, 1, 4, 1};
+
+	int size = 5;	// Packet id + mask
+	for (int bit = 0; bit < 18; bit++) {
+		if (mask & ((uint32_t)1 << bit)) {
+			size += fieldSize[bit];
+		}
 	}
+	return size;
+}
 
-	// Extract payload:
-	memcpy(payload, &message[2], message[1]);
+bool VescUart::sendRequest(uint8_t packetId, uint8_t canId, uint32_t mask) {
 
-	crcPayload = crc16(payload, message[1]);
+	if (serialPort == NULL)
+		return false;
 
-	if( debugPort != NULL ){
-		debugPort->print("SRC calc: "); debugPort->println(crcPayload);
+	pendingRequest * request = findRequest(packetId);
+	if (request != NULL && request->status == REQUEST_PENDING) {
+		return false;	// One request per packet id in flight, the answer would be ambiguous
 	}
-	
-	if (crcPayload == crcMessage) {
-		if( debugPort != NULL ) {
-			debugPort->print("Received: "); 
-			serialPrint(message, lenMes); debugPort->println();
 
-			debugPort->print("Payload: ");
-			serialPrint(payload, message[1] - 1); debugPort->println();
+	// Reuse an unpolled DONE/TIMEOUT slot of the same id, otherwise take a free one
+	for (int i = 0; request == NULL && i < MAX_PENDING_REQUESTS; i++) {
+		if (pending[i].status == REQUEST_IDLE) {
+			request = &pending[i];
 		}
-
-		return true;
-	}else{
+	}
+	if (request == NULL) {
 		return false;
 	}
+
+	int32_t index = 0;
+	uint8_t payload[7];
+	if (canId != 0) {
+		payload[index++] = { COMM_FORWARD_CAN };
+		payload[index++] = canId;
+	}
+	payload[index++] = packetId;
+	if (packetId == COMM_GET_VALUES_SELECTIVE) {
+		buffer_append_uint32(payload, mask, &index);
+	}
+
+	request->packetId = packetId;
+	request->status = REQUEST_PENDING;
+	request->sentAtMs = millis();
+	request->sentAtUs = micros();
+
+	packSendPayload(payload, index);
+	return true;
+}
+
+VescUart::RequestStatus VescUart::pollRequest(uint8_t packetId) {
+	pendingRequest * request = findRequest(packetId);
+	if (request == NULL) {
+		return REQUEST_IDLE;
+	}
+
+	RequestStatus status = (RequestStatus)request->status;
+	if (status != REQUEST_PENDING) {
+		request->status = REQUEST_IDLE;	// Result is reported once
+	}
+	return status;
+}
+
+bool VescUart::isPending(uint8_t packetId) {
+	pendingRequest * request = findRequest(packetId);
+	return request != NULL && request->status == REQUEST_PENDING;
+}
+
+bool VescUart::waitForResponse(uint8_t packetId) {
+	while (true) {
+		update();
+		RequestStatus status = pollRequest(packetId);
+		if (status != REQUEST_PENDING) {
+			return status == REQUEST_DONE;
+		}
+		delay(1);
+	}
+}
+
+bool VescUart::requestVescValues(uint8_t canId) {
+	if (debugPort!=NULL){
+		debugPort->println("Command: COMM_GET_VALUES "+String(canId));
+	}
+	return sendRequest(COMM_GET_VALUES, canId);
+}
+
+bool VescUart::requestVescValuesSelective(uint32_t mask, uint8_t canId) {
+	if (debugPort!=NULL){
+		debugPort->println("Command: COMM_GET_VALUES_SELECTIVE "+String(canId));
+	}
+	return sendRequest(COMM_GET_VALUES_SELECTIVE, canId, mask);
+}
+
+bool VescUart::requestPacket(uint8_t packetId, uint8_t canId) {
+	return sendRequest(packetId, canId);
+}
+
+void VescUart::setPacketHandler(packetHandler handler) {
+	rawPacketHandler = handler;
+}
+
+bool VescUart::requestFWversion(uint8_t canId) {
+	return sendRequest(COMM_FW_VERSION, canId);
 }
 
 
 int VescUart::packSendPayload(uint8_t * payload, int lenPay) {
 
 	uint16_t crcPayload = crc16(payload, lenPay);
-	int count = 0;
-	uint8_t messageSend[256];
-	
-	if (lenPay <= 256)
+	uint8_t header[3];
+	uint8_t footer[3];
+	int headerLen = 0;
+
+	if (lenPay <= 255)
 	{
-		messageSend[count++] = 2;
-		messageSend[count++] = lenPay;
+		header[headerLen++] = 2;
+		header[headerLen++] = lenPay;
 	}
 	else
 	{
-		messageSend[count++] = 3;
-		messageSend[count++] = (uint8_t)(lenPay >> 8);
-		messageSend[count++] = (uint8_t)(lenPay & 0xFF);
+		header[headerLen++] = 3;
+		header[headerLen++] = (uint8_t)(lenPay >> 8);
+		header[headerLen++] = (uint8_t)(lenPay & 0xFF);
 	}
 
-	memcpy(messageSend + count, payload, lenPay);
-	count += lenPay;
+	footer[0] = (uint8_t)(crcPayload >> 8);
+	footer[1] = (uint8_t)(crcPayload & 0xFF);
+	footer[2] = 3;
+
+	int count = headerLen + lenPay + 3;
 
-	messageSend[count++] = (uint8_t)(crcPayload >> 8);
-	messageSend[count++] = (uint8_t)(crcPayload & 0xFF);
-	messageSend[count++] = 3;
-	// messageSend[count] = NULL;
-	
 	if(debugPort!=NULL){
-		debugPort->print("Package to send: "); serialPrint(messageSend, count);
+		debugPort->print("Package to send: "); serialPrint(payload, lenPay - 1);
 	}
 
-	// Sending package
-	if( serialPort != NULL )
-		serialPort->write(messageSend, count);
+	// Sending package - written in three parts straight from the caller's payload,
+	// so only one task may send (the UART owner)
+	if( serialPort != NULL ) {
+		serialPort->write(header, headerLen);
+		serialPort->write(payload, lenPay);
+		serialPort->write(footer, 3);
+		linkStats.bytesSent += count;
+	}
 
 	// Returns number of send bytes
 	return count;
@@ -223,9 +441,31 @@ bool VescUart::processReadPacket(uint8_t * message) {
 
 		break;
 
-		/* case COMM_GET_VALUES_SELECTIVE:
+		case COMM_GET_VALUES_SELECTIVE: { // Same fields as COMM_GET_VALUES, only those set in the echoed mask
+
+			uint32_t mask = buffer_get_uint32(message, &index);
+
+			if (mask & SELECT_TEMP_MOSFET)			data.tempMosfet 		= buffer_get_float16(message, 10.0, &index);
+			if (mask & SELECT_TEMP_MOTOR)			data.tempMotor 			= buffer_get_float16(message, 10.0, &index);
+			if (mask & SELECT_AVG_MOTOR_CURRENT)	data.avgMotorCurrent 	= buffer_get_float32(message, 100.0, &index);
+			if (mask & SELECT_AVG_INPUT_CURRENT)	data.avgInputCurrent 	= buffer_get_float32(message, 100.0, &index);
+			if (mask & SELECT_AVG_ID)				index += 4;
+			if (mask & SELECT_AVG_IQ)				index += 4;
+			if (mask & SELECT_DUTY_CYCLE)			data.dutyCycleNow 		= buffer_get_float16(message, 1000.0, &index);
+			if (mask & SELECT_RPM)					data.rpm 				= buffer_get_float32(message, 1.0, &index);
+			if (mask & SELECT_INPUT_VOLTAGE)		data.inpVoltage 		= buffer_get_float16(message, 10.0, &index);
+			if (mask & SELECT_AMP_HOURS)			data.ampHours 			= buffer_get_float32(message, 10000.0, &index);
+			if (mask & SELECT_AMP_HOURS_CHARGED)	data.ampHoursCharged 	= buffer_get_float32(message, 10000.0, &index);
+			if (mask & SELECT_WATT_HOURS)			data.wattHours			= buffer_get_float32(message, 10000.0, &index);
+			if (mask & SELECT_WATT_HOURS_CHARGED)	data.wattHoursCharged	= buffer_get_float32(message, 10000.0, &index);
+			if (mask & SELECT_TACHOMETER)			data.tachometer 		= buffer_get_int32(message, &index);
+			if (mask & SELECT_TACHOMETER_ABS)		data.tachometerAbs 		= buffer_get_int32(message, &index);
+			if (mask & SELECT_FAULT)				data.error 				= (mc_fault_code)message[index++];
+			if (mask & SELECT_PID_POS)				data.pidPos				= buffer_get_float32(message, 1000000.0, &index);
+			if (mask & SELECT_CONTROLLER_ID)		data.id					= message[index++];
 
-			uint32_t mask = 0xFFFFFFFF; */
+			return true;
+		}
 
 		default:
 			return false;
@@ -238,25 +478,10 @@ bool VescUart::getFWversion(void){
 }
 
 bool VescUart::getFWversion(uint8_t canId){
-	
-	int32_t index = 0;
-	int payloadSize = (canId == 0 ? 1 : 3);
-	uint8_t payload[payloadSize];
-	
-	if (canId != 0) {
-		payload[index++] = { COMM_FORWARD_CAN };
-		payload[index++] = canId;
-	}
-	payload[index++] = { COMM_FW_VERSION };
-
-	packSendPayload(payload, payloadSize);
-
-	uint8_t message[256];
-	int messageLength = receiveUartMessage(message);
-	if (messageLength > 0) { 
-		return processReadPacket(message); 
+	if (!requestFWversion(canId)) {
+		return false;
 	}
-	return false;
+	return waitForResponse(COMM_FW_VERSION);
 }
 
 bool VescUart::getVescValues(void) {
@@ -264,29 +489,17 @@ bool VescUart::getVescValues(void) {
 }
 
 bool VescUart::getVescValues(uint8_t canId) {
-
-	if (debugPort!=NULL){
-		debugPort->println("Command: COMM_GET_VALUES "+String(canId));
-	}
-
-	int32_t index = 0;
-	int payloadSize = (canId == 0 ? 1 : 3);
-	uint8_t payload[payloadSize];
-	if (canId != 0) {
-		payload[index++] = { COMM_FORWARD_CAN };
-		payload[index++] = canId;
+	if (!requestVescValues(canId)) {
+		return false;
 	}
-	payload[index++] = { COMM_GET_VALUES };
-
-	packSendPayload(payload, payloadSize);
-
-	uint8_t message[256];
-	int messageLength = receiveUartMessage(message);
+	return waitForResponse(COMM_GET_VALUES);
+}
 
-	if (messageLength > 55) {
-		return processReadPacket(message); 
+bool VescUart::getVescValuesSelective(uint32_t mask, uint8_t canId) {
+	if (!requestVescValuesSelective(mask, canId)) {
+		return false;
 	}
-	return false;
+	return waitForResponse(COMM_GET_VALUES_SELECTIVE);
 }
 
 void VescUart::setNunchuckValues() {
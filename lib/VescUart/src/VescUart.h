@@ -6,6 +6,32 @@
 #include <buffer.h>
 #include <crc.h>
 
+/** Largest payload the receiver accepts (long frames start with 3 and carry a 16 bit
+  * length). Must hold COMM_GET_MCCONF/COMM_GET_APPCONF of the VESC firmware in use. */
+#ifndef VESCUART_RX_BUFFER_SIZE
+#define VESCUART_RX_BUFFER_SIZE 1024
+#endif
+
+/** Bits of the COMM_GET_VALUES_SELECTIVE mask (field order of the VESC firmware) */
+#define SELECT_TEMP_MOSFET			((uint32_t)1 << 0)
+#define SELECT_TEMP_MOTOR			((uint32_t)1 << 1)
+#define SELECT_AVG_MOTOR_CURRENT	((uint32_t)1 << 2)
+#define SELECT_AVG_INPUT_CURRENT	((uint32_t)1 << 3)
+#define SELECT_AVG_ID				((uint32_t)1 << 4)
+#define SELECT_AVG_IQ				((uint32_t)1 << 5)
+#define SELECT_DUTY_CYCLE			((uint32_t)1 << 6)
+#define SELECT_RPM					((uint32_t)1 << 7)
+#define SELECT_INPUT_VOLTAGE		((uint32_t)1 << 8)
+#define SELECT_AMP_HOURS			((uint32_t)1 << 9)
+#define SELECT_AMP_HOURS_CHARGED	((uint32_t)1 << 10)
+#define SELECT_WATT_HOURS			((uint32_t)1 << 11)
+#define SELECT_WATT_HOURS_CHARGED	((uint32_t)1 << 12)
+#define SELECT_TACHOMETER			((uint32_t)1 << 13)
+#define SELECT_TACHOMETER_ABS		((uint32_t)1 << 14)
+#define SELECT_FAULT				((uint32_t)1 << 15)
+#define SELECT_PID_POS				((uint32_t)1 << 16)
+#define SELECT_CONTROLLER_ID		((uint32_t)1 << 17)
+
 
 class VescUart
 {
@@ -42,10 +68,61 @@ class VescUart
         uint8_t minor;
     };
 
+	/** Struct to hold the UART link statistics of the non-blocking receiver */
+	struct linkStatistics {
+		uint32_t bytesReceived;		// All bytes read from the serial port
+		uint32_t bytesSent;			// All bytes handed to the serial port
+		uint32_t bytesDiscarded;	// Bytes skipped while searching for a start byte
+		uint32_t framesReceived;	// Frames with valid CRC and end byte
+		uint32_t crcErrors;			// Frames dropped because of a CRC mismatch
+		uint32_t framingErrors;		// Bad end byte, unsupported start byte or stalled frame
+		uint32_t timeouts;			// Requests that got no answer within _TIMEOUT
+		uint32_t unmatchedFrames;	// Valid frames nobody was waiting for
+		uint32_t lastLatencyUs;		// Request sent -> response decoded
+		uint32_t maxLatencyUs;
+	};
+
+	/** Slot of the pending request table (one per response packet id) */
+	struct pendingRequest {
+		uint8_t packetId;
+		uint8_t status;
+		uint32_t sentAtMs;
+		uint32_t sentAtUs;
+	};
+
+	/** States of the byte-driven frame parser */
+	enum rxParserState {
+		RX_WAIT_START,
+		RX_LENGTH_HIGH,
+		RX_LENGTH,
+		RX_PAYLOAD,
+		RX_CRC_HIGH,
+		RX_CRC_LOW,
+		RX_END
+	};
+
+	static const int MAX_PENDING_REQUESTS = 6;
+
+	/** A frame is sent back to back (64 bytes = 5.6ms at 115200 baud). Once no byte
+	  * arrived for this long the rest of it is lost and the parser resyncs. */
+	static const uint32_t RX_GAP_TIMEOUT_MS = 10;
+
 	//Timeout - specifies how long the function will wait for the vesc to respond
 	const uint32_t _TIMEOUT;
 
 	public:
+		/** Callback for answers without a built-in decoder (e.g. COMM_GET_MCCONF).
+		  * payload points into the receive buffer and is only valid during the call. */
+		typedef void (*packetHandler)(uint8_t * payload, uint16_t len);
+
+		/** Result of a request started with requestVescValues() / requestFWversion() */
+		enum RequestStatus {
+			REQUEST_IDLE,		// No request with this packet id
+			REQUEST_PENDING,	// Sent, waiting for the answer
+			REQUEST_DONE,		// Answer received and decoded
+			REQUEST_TIMEOUT		// No answer within _TIMEOUT
+		};
+
 		/**
 		 * @brief      Class constructor
 		 */
@@ -60,6 +137,9 @@ class VescUart
        /** Variable to hold firmware version */
         FWversionPackage fw_version; 
 
+		/** Variable to hold the statistics of the UART link */
+		linkStatistics linkStats;
+
         /**
          * @brief      Set the serial port for uart communication
          * @param      port  - Reference to Serial port (pointer) 
@@ -72,6 +152,77 @@ class VescUart
          */
         void setDebugPort(Stream* port);
 
+        /**
+         * @brief      Feeds all bytes waiting in the serial port through the frame
+         *             parser and expires requests older than _TIMEOUT. Never blocks -
+         *             call it regularly from the task that owns the UART.
+         *
+         * @return     Number of valid frames received during this call
+         */
+        int update(void);
+
+        /**
+         * @brief      Sends COMM_GET_VALUES without waiting for the answer.
+         *             Poll the result with pollRequest(COMM_GET_VALUES).
+         *
+         * @param      canId  - The CAN ID of the VESC (0 = local)
+         * @return     False if a GET_VALUES request is already pending
+         */
+        bool requestVescValues(uint8_t canId = 0);
+
+        /**
+         * @brief      Sends COMM_GET_VALUES_SELECTIVE without waiting for the answer.
+         *             Only the fields selected by mask are transferred and updated
+         *             in data. Poll the result with pollRequest(COMM_GET_VALUES_SELECTIVE).
+         *
+         * @param      mask   - SELECT_* bits of the wanted fields
+         * @param      canId  - The CAN ID of the VESC (0 = local)
+         * @return     False if a selective request is already pending
+         */
+        bool requestVescValuesSelective(uint32_t mask, uint8_t canId = 0);
+
+        /**
+         * @brief      Sends a request that consists of the packet id only (e.g.
+         *             COMM_GET_MCCONF) without waiting for the answer. Answers
+         *             without a built-in decoder go to the packet handler.
+         *
+         * @param      packetId  - COMM_PACKET_ID of the request
+         * @param      canId     - The CAN ID of the VESC (0 = local)
+         * @return     False if the same request is already pending
+         */
+        bool requestPacket(uint8_t packetId, uint8_t canId = 0);
+
+        /**
+         * @brief      Set the handler for answers without a built-in decoder
+         * @param      handler  - Called from update() with the payload (packet id first)
+         */
+        void setPacketHandler(packetHandler handler);
+
+        /**
+         * @brief      Sends COMM_FW_VERSION without waiting for the answer.
+         *             Poll the result with pollRequest(COMM_FW_VERSION).
+         *
+         * @param      canId  - The CAN ID of the VESC (0 = local)
+         * @return     False if a FW_VERSION request is already pending
+         */
+        bool requestFWversion(uint8_t canId = 0);
+
+        /**
+         * @brief      Returns the state of the request for packetId. REQUEST_DONE and
+         *             REQUEST_TIMEOUT are reported once, then the slot is freed.
+         *
+         * @param      packetId  - COMM_PACKET_ID of the request
+         * @return     Current RequestStatus
+         */
+        RequestStatus pollRequest(uint8_t packetId);
+
+        /**
+         * @brief      True while a request for packetId waits for its answer
+         *
+         * @param      packetId  - COMM_PACKET_ID of the request
+         */
+        bool isPending(uint8_t packetId);
+
         /**
          * @brief      Populate the firmware version variables
          *
@@ -102,6 +253,21 @@ class VescUart
          */
         bool getVescValues(uint8_t canId);
 
+        /**
+         * @brief      Sends COMM_GET_VALUES_SELECTIVE and stores the returned fields
+         * @param      mask   - SELECT_* bits of the wanted fields
+         * @param      canId  - The CAN ID of the VESC
+         *
+         * @return     True if successfull otherwise false
+         */
+        bool getVescValuesSelective(uint32_t mask, uint8_t canId = 0);
+
+        /**
+         * @brief      Number of payload bytes of a selective answer (packet id and mask included)
+         * @param      mask   - SELECT_* bits of the wanted fields
+         */
+        static int selectivePayloadSize(uint32_t mask);
+
         /**
          * @brief      Sends values for joystick and buttons to the nunchuck app
          */
@@ -182,6 +348,17 @@ class VescUart
          */
         void sendKeepalive(uint8_t canId);
 
+		/**
+		 * @brief      Packs the payload and sends it over Serial. Payloads above 255
+		 *             bytes are sent as long frame (start byte 3, 16 bit length).
+		 *             Header, payload and footer are written directly - no copy.
+		 *
+		 * @param      payload  - The payload as a unit8_t Array with length of int lenPayload
+		 * @param      lenPay   - Length of payload (max. 65535)
+		 * @return     The number of bytes send
+		 */
+		int packSendPayload(uint8_t * payload, int lenPay);
+
         /**
          * @brief      Help Function to print struct dataPackage over Serial for Debug
          */
@@ -196,32 +373,68 @@ class VescUart
 		  * Uses the class Stream instead of HarwareSerial */
 		Stream* debugPort = NULL;
 
+		/** Handler for answers without a built-in decoder */
+		packetHandler rawPacketHandler = NULL;
+
+		/** Frame parser state */
+		rxParserState rxState = RX_WAIT_START;
+		uint16_t rxLength = 0;
+		uint16_t rxIndex = 0;
+		uint16_t rxCrc = 0;			// CRC sent by the VESC
+		uint16_t rxCrcCalc = 0;		// CRC of the payload received so far
+		uint32_t rxLastByteMs = 0;
+		uint8_t rxPayload[VESCUART_RX_BUFFER_SIZE];
+
+		/** Requests waiting for an answer, matched by response packet id */
+		pendingRequest pending[MAX_PENDING_REQUESTS];
+
 		/**
-		 * @brief      Packs the payload and sends it over Serial
+		 * @brief      Advances the frame parser by one received byte
 		 *
-		 * @param      payload  - The payload as a unit8_t Array with length of int lenPayload
-		 * @param      lenPay   - Length of payload
-		 * @return     The number of bytes send
+		 * @param      value  - The received byte
+		 * @return     True if the byte completed a valid frame
 		 */
-		int packSendPayload(uint8_t * payload, int lenPay);
+		bool parseByte(uint8_t value);
 
 		/**
-		 * @brief      Receives the message over Serial
+		 * @brief      Verifies a completely received frame (CRC-16), decodes it in
+		 *             place from rxPayload and completes the matching pending request
 		 *
-		 * @param      payloadReceived  - The received payload as a unit8_t Array
-		 * @return     The number of bytes receeived within the payload
+		 * @return     True if the frame was valid
 		 */
-		int receiveUartMessage(uint8_t * payloadReceived);
+		bool handleFrame(void);
 
 		/**
-		 * @brief      Verifies the message (CRC-16) and extracts the payload
+		 * @brief      Sends a request and registers it in the pending table
 		 *
-		 * @param      message  - The received UART message
-		 * @param      lenMes   - The length of the message
-		 * @param      payload  - The final payload ready to extract data from
-		 * @return     True if the process was a success
+		 * @param      packetId  - COMM_PACKET_ID of the request (= id of the answer)
+		 * @param      canId     - The CAN ID of the VESC (0 = local)
+		 * @param      mask      - Field mask appended for selective requests (0 = none)
+		 * @return     False if the same request is still pending or no slot is free
+		 */
+		bool sendRequest(uint8_t packetId, uint8_t canId, uint32_t mask = 0);
+
+		/**
+		 * @brief      Checks that an answer is long enough to be decoded
+		 *
+		 * @param      message  - The payload (packet id first)
+		 * @param      len      - Length of the payload
+		 * @return     True if processReadPacket() can decode it safely
+		 */
+		bool payloadComplete(uint8_t * message, int len);
+
+		/**
+		 * @brief      Blocks until the request for packetId is answered or timed out
+		 *
+		 * @param      packetId  - COMM_PACKET_ID of the request
+		 * @return     True if the answer was received
+		 */
+		bool waitForResponse(uint8_t packetId);
+
+		/**
+		 * @brief      Returns the pending table slot used for packetId (or NULL)
 		 */
-		bool unpackPayload(uint8_t * message, int lenMes, uint8_t * payload);
+		pendingRequest * findRequest(uint8_t packetId);
 
 		/**
 		 * @brief      Extracts the data from the received payload
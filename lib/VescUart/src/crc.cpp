@@ -54,7 +54,7 @@ unsigned short crc16(unsigned char *buf, unsigned int len) {
 	unsigned int i;
 	unsigned short cksum = 0;
 	for (i = 0; i < len; i++) {
-		cksum = crc16_tab[(((cksum >> 8) ^ *buf++) & 0xFF)] ^ (cksum << 8);
+		cksum = crc16_update(cksum, *buf++);
 	}
 	return cksum;
 }
\ No newline at end of file
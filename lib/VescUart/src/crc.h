@@ -27,4 +27,14 @@
  */
 unsigned short crc16(unsigned char *buf, unsigned int len);
 
+/*
+ * Incremental form for byte-wise receivers:
+ * crc = 0; for each byte: crc = crc16_update(crc, byte);
+ */
+extern const unsigned short crc16_tab[];
+
+static inline unsigned short crc16_update(unsigned short crc, unsigned char value) {
+	return crc16_tab[((crc >> 8) ^ value) & 0xFF] ^ (unsigned short)(crc << 8);
+}
+
 #endif /* CRC_H_ */
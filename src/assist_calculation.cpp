@@ -1,54 +1,45 @@
 #include "ebike_controller.h"
+#include "deferred_log.h"
+#include "assist_table.h"
+#include "motor_map.h"
+#include "battery_model.h"
 
 // =============================================================================
 // SPEED-DEPENDENT ASSIST INTERPOLATION
 // =============================================================================
 
+// One compiled table per profile (ASSIST_PROFILES over SPEED_POINTS_KMH),
+// built by initializeAssistProfiles()
+static AssistTable assistTables[MAX_ASSIST_PROFILES];
+
+void build_assist_tables() {
+  for (int i = 0; i < MAX_ASSIST_PROFILES; i++) {
+    assistTables[i].build(SPEED_POINTS_KMH, ASSIST_PROFILES[i], NUM_SPEED_POINTS);
+  }
+}
+
+// Map cells of the last evaluation (sensorTask only)
+static AssistMapCursor mapCursor = {};
+
 void calculate_speed_dependent_assist() {
-  // Fallback: If no valid VESC data, use first value (0 km/h)
-  if (!vesc_data_valid) {
-    dynamic_assist_factor = ASSIST_PROFILES[current_mode][0];
+  // Profile with an assist map: factor from speed, cadence and the human
+  // power of this tick (calculate_assist_power() step 1)
+  const AssistProfileMap* map = ASSIST_MAPS[current_mode];
+  if (map != nullptr) {
+    float speed = vesc_data_valid ? current_speed_kmh : 0.0f;
+    dynamic_assist_factor = assist_map_factor(*map, mapCursor, speed, current_cadence_rpm, human_power_watts);
+    dynamic_assist_factor = constrain(dynamic_assist_factor, 0.0, 4.0);
     return;
   }
   
-  // Find the two support points for interpolation
-  int lower_index = 0;
-  int upper_index = NUM_SPEED_POINTS - 1;
-  
-  // Find correct interval
-  for (int i = 0; i < NUM_SPEED_POINTS - 1; i++) {
-    if (current_speed_kmh >= SPEED_POINTS_KMH[i] && 
-        current_speed_kmh <= SPEED_POINTS_KMH[i + 1]) {
-      lower_index = i;
-      upper_index = i + 1;
-      break;
-    }
-  }
-  
-  // Speed outside defined range?
-  if (current_speed_kmh <= SPEED_POINTS_KMH[0]) {
-    // Below minimum speed → first value
+  // Fallback: If no valid VESC data, use first value (0 km/h)
+  if (!vesc_data_valid) {
     dynamic_assist_factor = ASSIST_PROFILES[current_mode][0];
     return;
   }
   
-  if (current_speed_kmh >= SPEED_POINTS_KMH[NUM_SPEED_POINTS - 1]) {
-    // Above maximum speed → last value  
-    dynamic_assist_factor = ASSIST_PROFILES[current_mode][NUM_SPEED_POINTS - 1];
-    return;
-  }
-  
-  // Linear interpolation between the two support points
-  float speed_low = SPEED_POINTS_KMH[lower_index];
-  float speed_high = SPEED_POINTS_KMH[upper_index];
-  float assist_low = ASSIST_PROFILES[current_mode][lower_index];
-  float assist_high = ASSIST_PROFILES[current_mode][upper_index];
-  
-  // Interpolation factor (0.0 = lower point, 1.0 = upper point)
-  float interpolation_factor = (current_speed_kmh - speed_low) / (speed_high - speed_low);
-  
-  // Linear interpolation: y = y1 + t × (y2 - y1)
-  dynamic_assist_factor = assist_low + interpolation_factor * (assist_high - assist_low);
+  // Linear interpolation between the support points, held outside them
+  dynamic_assist_factor = assistTables[current_mode].factor(current_speed_kmh);
   
   // Safety limit
   dynamic_assist_factor = constrain(dynamic_assist_factor, 0.0, 4.0);
@@ -79,7 +70,7 @@ void calculate_assist_power() {
     human_power_watts = 500.0;
   }
   
-  // 2. CALCULATE SPEED-DEPENDENT ASSIST FACTOR
+  // 2. CALCULATE ASSIST FACTOR (speed curve or speed x cadence x power map)
   calculate_speed_dependent_assist();
   
   // 3. CALCULATE ASSIST POWER (NOW speed-dependent!)
@@ -98,31 +89,27 @@ void calculate_assist_power() {
   
   if (assist_power_watts > 0 && current_motor_rpm > 10.0) {
     // Use motor RPM for correct motor current calculation
-    // Approximate motor constant for Q100C motor (empirically determined)
     // This ensures constant mechanical power regardless of speed
-    float motor_rps = current_motor_rpm / 60.0;  // Convert RPM to RPS
-    float motor_omega = motor_rps * 2.0 * PI;     // Angular velocity [rad/s]
-    
-    // Motor constant for Q100C (defined in ebike_controller.h)
-    // Based on real performance curve data from Q100C motor:
-    // Max efficiency: 7.17 Nm @ 5.28 A → K_t = 1.36 Nm/A
-    // Max torque: 20.04 Nm @ 13.37 A → K_t = 1.50 Nm/A
-    // Average: K_t = 1.43 Nm/A (much more accurate than calculated estimate)
-    float motor_constant_kt = MOTOR_CONSTANT_KT;
+    // The Q100C curve is measured at the hub, so K_t goes with the hub
+    // (wheel) speed, not the speed of the motor inside the gear
+    float wheel_rpm = current_motor_rpm / MOTOR_GEAR_RATIO;
+    float hub_omega = wheel_rpm / 60.0 * 2.0 * PI;    // Angular velocity [rad/s]
     
-    target_current_amps = assist_power_watts / (motor_constant_kt * motor_omega);
+    // K_t is not constant (1.36 Nm/A at 5.28 A, 1.50 Nm/A at 13.37 A, see
+    // motor_map.h): solve K_t(I, rpm) × I = P_mech / ω for I
+    target_current_amps = motor_map_current(assist_power_watts / hub_omega, wheel_rpm);
     
   } else if (assist_power_watts > 0 && current_motor_rpm <= 10.0) {
     // Low speed: Use simplified calculation (avoid division by near-zero)
     // At very low speeds, use voltage-based calculation as fallback
-    target_current_amps = assist_power_watts / VOLTAGE_BATTERY;
+    target_current_amps = assist_power_watts / battery_supply_voltage();
     
   } else {
     target_current_amps = 0.0;
   }
   
-  // 6. LIMIT CURRENT
-  target_current_amps = constrain(target_current_amps, 0.0, MAX_MOTOR_CURRENT);
+  // 6. LIMIT CURRENT (MAX_MOTOR_CURRENT, lower while thermally derated)
+  target_current_amps = constrain(target_current_amps, 0.0, motor_current_limit_amps);
   
   // 7. MINIMUM CURRENT FOR MOTOR ACTIVATION
   if (target_current_amps > 0 && target_current_amps < MIN_MOTOR_CURRENT) {
@@ -133,9 +120,8 @@ void calculate_assist_power() {
   static unsigned long last_power_debug = 0;
   unsigned long now = millis();
   if (now - last_power_debug > 2000) { // Every 2 seconds
-    Serial.printf("POWER CALC - Torque:%.1fNm Cadence:%.1fRPM Human:%.0fW Factor:%.2f Assist:%.0fW MotorRPM:%.0f Current:%.2fA\n", 
-                  filtered_torque, current_cadence_rpm, human_power_watts, 
-                  dynamic_assist_factor, assist_power_watts, current_motor_rpm, target_current_amps);
+    logDeferred(LOG_POWER_CALC, filtered_torque, current_cadence_rpm, human_power_watts,
+                dynamic_assist_factor, assist_power_watts, current_motor_rpm, target_current_amps);
     last_power_debug = now;
   }
 }
@@ -0,0 +1,50 @@
+#include "assist_table.h"
+
+// =============================================================================
+// ASSIST FACTOR LOOKUP TABLE
+// =============================================================================
+
+AssistTable::AssistTable() {
+  // Constant 0 until built
+  const float speeds[2] = {0.0f, 1.0f};
+  const float factors[2] = {0.0f, 0.0f};
+  build(speeds, factors, 2);
+}
+
+bool AssistTable::build(const float* speeds_kmh, const float* factors, uint32_t count) {
+  if (count < 2 || count > ASSIST_TABLE_MAX_POINTS) {
+    return false;
+  }
+  for (uint32_t i = 1; i < count; i++) {
+    if (!(speeds_kmh[i] > speeds_kmh[i - 1])) {   // Also NaN
+      return false;
+    }
+  }
+
+  segments = count - 1;
+  for (uint32_t i = 0; i < segments; i++) {
+    x[i] = speeds_kmh[i];
+    y[i] = factors[i];
+    slope[i] = (factors[i + 1] - factors[i]) / (speeds_kmh[i + 1] - speeds_kmh[i]);
+  }
+  x_last = speeds_kmh[count - 1];
+  y_last = factors[count - 1];
+
+  float range = x_last - x[0];
+  cells_per_kmh = 1.0f / ASSIST_TABLE_STEP_KMH;
+  if (range * cells_per_kmh > ASSIST_TABLE_MAX_CELLS) {
+    cells_per_kmh = ASSIST_TABLE_MAX_CELLS / range;
+  }
+
+  // First segment reaching into each cell, with the cell index computed
+  // exactly as in factor(): a point's own cell starts in the segment before
+  // it, so the lookup only ever moves forward
+  uint32_t i = 0;
+  for (uint32_t cell = 0; cell <= ASSIST_TABLE_MAX_CELLS; cell++) {
+    while (i + 1 < segments && cellOf(x[i + 1]) < cell) {
+      i++;
+    }
+    cell_segment[cell] = (uint8_t)i;
+  }
+  return true;
+}
@@ -0,0 +1,110 @@
+#include "battery_model.h"
+#include "ebike_controller.h"
+#include "deferred_log.h"
+
+// =============================================================================
+// BATTERY RESISTANCE ESTIMATOR
+// =============================================================================
+
+BatteryResistanceEstimator::BatteryResistanceEstimator() {
+  reset();
+}
+
+void BatteryResistanceEstimator::reset() {
+  anchor_v = 0.0f;
+  anchor_a = 0.0f;
+  anchor_ms = 0;
+  has_anchor = false;
+  sum_dv_di = 0.0f;
+  sum_di_sq = 0.0f;
+  r_ohm = BATTERY_R_NOMINAL_OHM;
+  ocv_v = 0.0f;
+  step_count = 0;
+}
+
+void BatteryResistanceEstimator::update(float voltage, float input_current_a, unsigned long now_ms) {
+  if (voltage <= 0.0f) {
+    return;                                   // No VESC supply reading
+  }
+
+  if (!has_anchor || now_ms - anchor_ms > BATTERY_R_STEP_WINDOW_MS) {
+    has_anchor = true;                        // Too long ago: the OCV may have moved
+  } else {
+    float di = input_current_a - anchor_a;
+    if (fabsf(di) < BATTERY_R_MIN_STEP_A) {
+      ocv_v = voltage + r_ohm * input_current_a;
+      return;                                 // Keep waiting for a step
+    }
+    float dv = voltage - anchor_v;
+    sum_dv_di = BATTERY_R_FORGETTING * sum_dv_di - dv * di;
+    sum_di_sq = BATTERY_R_FORGETTING * sum_di_sq + di * di;
+    step_count++;
+
+    float fitted = (sum_dv_di + BATTERY_R_NOMINAL_OHM * BATTERY_R_PRIOR_A2) / (sum_di_sq + BATTERY_R_PRIOR_A2);
+    r_ohm = constrain(fitted, BATTERY_R_MIN_OHM, BATTERY_R_MAX_OHM);
+  }
+
+  anchor_v = voltage;
+  anchor_a = input_current_a;
+  anchor_ms = now_ms;
+  ocv_v = voltage + r_ohm * input_current_a;
+}
+
+// =============================================================================
+// BATTERY MODEL (vescTask) AND SAG-AWARE CURRENT LIMIT (sensorTask)
+// =============================================================================
+
+static BatteryResistanceEstimator estimator;
+static float input_per_motor_amp = 1.0f;   // Until measured: input = motor current (safe side)
+static uint32_t last_values_count = 0;
+static bool limit_enabled = true;
+
+void update_battery_model(float voltage, float input_current_a, unsigned long now_ms) {
+  estimator.update(voltage, input_current_a, now_ms);
+}
+
+const BatteryResistanceEstimator& battery_estimator() {
+  return estimator;
+}
+
+void limit_battery_current(const SharedVescData& vesc) {
+  if (vesc.values_count != last_values_count) {
+    if (vesc.actual_current >= BATTERY_RATIO_MIN_MOTOR_A) {
+      float ratio = constrain(vesc.input_current / vesc.actual_current, 0.05f, 1.2f);
+      input_per_motor_amp += BATTERY_RATIO_FILTER * (ratio - input_per_motor_amp);
+    }
+    last_values_count = vesc.values_count;
+  }
+  if (vesc.battery_ocv <= 0.0f || vesc.battery_resistance <= 0.0f) {
+    return;                                   // No estimate yet
+  }
+
+  float input_limit = max(vesc.battery_ocv - (float)BATTERY_CUTOFF_VOLTAGE, 0.0f) / vesc.battery_resistance;
+  float limit = input_limit / input_per_motor_amp;
+  bool limited = limit_enabled && limit < motor_current_limit_amps;
+  if (limited) {
+    motor_current_limit_amps = limit;
+  }
+
+  static unsigned long last_battery_debug = 0;
+  unsigned long now = millis();
+  if (now - last_battery_debug > 5000) { // Every 5 seconds
+    logDeferred(LOG_BATTERY_MODEL, vesc.battery_resistance, vesc.battery_ocv, vesc.battery_voltage,
+                input_limit, limit, limited ? " SAG-LIMIT" : "");
+    last_battery_debug = now;
+  }
+}
+
+void battery_model_reset() {
+  estimator.reset();
+  input_per_motor_amp = 1.0f;
+  last_values_count = sharedVescData.read().values_count;
+}
+
+void battery_limit_enable(bool enabled) {
+  limit_enabled = enabled;
+}
+
+float battery_supply_voltage() {
+  return vesc_data_valid && battery_voltage > 0.0f ? battery_voltage : VOLTAGE_BATTERY;
+}
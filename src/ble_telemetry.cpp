@@ -16,7 +16,8 @@
 
 #include "ble_telemetry.h"
 #include "ebike_controller.h"
-#include "wifi_telemetry.h"  // For addLogMessage function
+#include "log_messages.h"
+#include "task_perf.h"
 
 // External variables (defined in config.cpp)
 extern int current_mode;
@@ -42,6 +43,7 @@ BLECharacteristic* pCharBattery = NULL;
 BLECharacteristic* pCharCurrent = NULL;
 BLECharacteristic* pCharVescData = NULL;
 BLECharacteristic* pCharSystemStatus = NULL;
+BLECharacteristic* pCharTaskPerf = NULL;
 
 // BLE Characteristics - Control
 BLECharacteristic* pCharModeControl = NULL;
@@ -105,6 +107,10 @@ void EBikeCommandCallbacks::onWrite(BLECharacteristic* pCharacteristic) {
       // Send mode list
       sendBLEModeList();
       addLogMessage("BLE Mode list requested");
+    } else if (command == "RESET_PERF") {
+      // Clear the task run time / jitter histograms
+      taskPerfRequestReset();
+      addLogMessage("BLE Task perf histograms reset");
     } else if (command == "EMERGENCY_STOP") {
       // Emergency stop - set mode to no assist
       for (int i = 0; i < NUM_ACTIVE_PROFILES; i++) {
@@ -124,70 +130,78 @@ void EBikeCommandCallbacks::onWrite(BLECharacteristic* pCharacteristic) {
 void updateBLETelemetryData() {
   if (!bleDeviceConnected) return;
   
-  if (xSemaphoreTake(dataUpdateSemaphore, pdMS_TO_TICKS(10)) == pdTRUE) {
-    // Speed characteristic (4 bytes float)
-    float speed = sharedVescData.speed_kmh;
-    pCharSpeed->setValue((uint8_t*)&speed, 4);
-    pCharSpeed->notify();
-    
-    // Cadence characteristic (4 bytes float)
-    float cadence = sharedSensorData.cadence_rpm;
-    pCharCadence->setValue((uint8_t*)&cadence, 4);
-    pCharCadence->notify();
-    
-    // Torque characteristic (4 bytes float)
-    float torque = sharedSensorData.filtered_torque;
-    pCharTorque->setValue((uint8_t*)&torque, 4);
-    pCharTorque->notify();
-    
-    // Battery characteristic (1 byte uint8)
-    uint8_t battery = (uint8_t)sharedVescData.battery_percentage;
-    pCharBattery->setValue(&battery, 1);
-    pCharBattery->notify();
-    
-    // Current characteristic (4 bytes float)
-    float current = sharedVescData.actual_current;
-    pCharCurrent->setValue((uint8_t*)&current, 4);
-    pCharCurrent->notify();
-    
-    // System Status (JSON string)
-    JsonDocument statusDoc;
-    statusDoc["mode"] = sharedSensorData.current_mode;
-    statusDoc["mode_name"] = AVAILABLE_PROFILES[sharedSensorData.current_mode].name;
-    statusDoc["motor_enabled"] = sharedSensorData.motor_enabled;
-    statusDoc["timestamp"] = millis();
-    
-    String statusString;
-    serializeJson(statusDoc, statusString);
-    pCharSystemStatus->setValue(statusString.c_str());
-    pCharSystemStatus->notify();
-    
-    xSemaphoreGive(dataUpdateSemaphore);
-  }
+  // Lock-free snapshots - BLE notifications never stall the control loop
+  SharedSensorData sensor = sharedSensorData.read();
+  SharedVescData vesc = sharedVescData.read();
+  
+  // Speed characteristic (4 bytes float)
+  float speed = vesc.speed_kmh;
+  pCharSpeed->setValue((uint8_t*)&speed, 4);
+  pCharSpeed->notify();
+  
+  // Cadence characteristic (4 bytes float)
+  float cadence = sensor.cadence_rpm;
+  pCharCadence->setValue((uint8_t*)&cadence, 4);
+  pCharCadence->notify();
+  
+  // Torque characteristic (4 bytes float)
+  float torque = sensor.filtered_torque;
+  pCharTorque->setValue((uint8_t*)&torque, 4);
+  pCharTorque->notify();
+  
+  // Battery characteristic (1 byte uint8)
+  uint8_t battery = (uint8_t)vesc.battery_percentage;
+  pCharBattery->setValue(&battery, 1);
+  pCharBattery->notify();
+  
+  // Current characteristic (4 bytes float)
+  float current = vesc.actual_current;
+  pCharCurrent->setValue((uint8_t*)&current, 4);
+  pCharCurrent->notify();
+  
+  // System Status (JSON string)
+  JsonDocument statusDoc;
+  statusDoc["mode"] = sensor.current_mode;
+  statusDoc["mode_name"] = AVAILABLE_PROFILES[sensor.current_mode].name;
+  statusDoc["motor_enabled"] = sensor.motor_enabled;
+  statusDoc["timestamp"] = millis();
+  
+  String statusString;
+  serializeJson(statusDoc, statusString);
+  pCharSystemStatus->setValue(statusString.c_str());
+  pCharSystemStatus->notify();
 }
 
 // Update BLE VESC data
 void updateBLEVescData() {
   if (!bleDeviceConnected) return;
   
-  if (xSemaphoreTake(dataUpdateSemaphore, pdMS_TO_TICKS(10)) == pdTRUE) {
-    // VESC Data (JSON string für kompakte Übertragung)
-    JsonDocument vescDoc;
-    vescDoc["motor_rpm"] = sharedVescData.rpm;
-    vescDoc["duty_cycle"] = sharedVescData.duty_cycle;
-    vescDoc["temp_mosfet"] = sharedVescData.temp_mosfet;
-    vescDoc["temp_motor"] = sharedVescData.temp_motor;
-    vescDoc["battery_voltage"] = sharedVescData.battery_voltage;
-    vescDoc["amp_hours"] = sharedVescData.amp_hours;
-    vescDoc["watt_hours"] = sharedVescData.watt_hours;
-    
-    String vescString;
-    serializeJson(vescDoc, vescString);
-    pCharVescData->setValue(vescString.c_str());
-    pCharVescData->notify();
-    
-    xSemaphoreGive(dataUpdateSemaphore);
-  }
+  SharedVescData vesc = sharedVescData.read();
+  
+  // VESC Data (JSON string für kompakte Übertragung)
+  JsonDocument vescDoc;
+  vescDoc["motor_rpm"] = vesc.rpm;
+  vescDoc["duty_cycle"] = vesc.duty_cycle;
+  vescDoc["temp_mosfet"] = vesc.temp_mosfet;
+  vescDoc["temp_motor"] = vesc.temp_motor;
+  vescDoc["battery_voltage"] = vesc.battery_voltage;
+  vescDoc["amp_hours"] = vesc.amp_hours;
+  vescDoc["watt_hours"] = vesc.watt_hours;
+  
+  String vescString;
+  serializeJson(vescDoc, vescString);
+  pCharVescData->setValue(vescString.c_str());
+  pCharVescData->notify();
+}
+
+// Update task perf summary (compact JSON, see taskPerfToCompactJson)
+void updateBLETaskPerf() {
+  if (!bleDeviceConnected) return;
+  
+  char perfString[PERF_JSON_COMPACT_MAX];
+  taskPerfToCompactJson(perfString, sizeof(perfString));
+  pCharTaskPerf->setValue(perfString);
+  pCharTaskPerf->notify();
 }
 
 // Send available modes list
@@ -245,7 +259,7 @@ void bleTelemetryTask(void *pvParameters) {
   pCharFirmwareRev->setValue(BLE_FIRMWARE_VERSION);
   
   // ===== Telemetry Service =====
-  pTelemetryService = pBLEServer->createService(BLE_SERVICE_UUID_TELEMETRY);
+  pTelemetryService = pBLEServer->createService(BLEUUID(BLE_SERVICE_UUID_TELEMETRY), BLE_TELEMETRY_SERVICE_HANDLES);
   
   // Speed characteristic
   pCharSpeed = pTelemetryService->createCharacteristic(
@@ -296,6 +310,13 @@ void bleTelemetryTask(void *pvParameters) {
   );
   pCharSystemStatus->addDescriptor(new BLE2902());
   
+  // Task Perf characteristic (run time / jitter summary per task)
+  pCharTaskPerf = pTelemetryService->createCharacteristic(
+    BLE_CHAR_UUID_TASK_PERF,
+    BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY
+  );
+  pCharTaskPerf->addDescriptor(new BLE2902());
+  
   // ===== Control Service =====
   pControlService = pBLEServer->createService(BLE_SERVICE_UUID_CONTROL);
   
@@ -343,7 +364,11 @@ void bleTelemetryTask(void *pvParameters) {
   // Main task loop
   TickType_t xLastWakeTime = xTaskGetTickCount();
   
+  taskPerfRegister(TASK_PERF_BLE, "ble", BLE_UPDATE_RATE_MS * 1000UL, BLE_UPDATE_RATE_MS * 1000UL);
+  
   while (1) {
+    taskPerfBeginPeriodic(TASK_PERF_BLE);
+    
     // Handle connection state changes
     if (!bleDeviceConnected && bleOldDeviceConnected) {
       // Device disconnected
@@ -362,8 +387,11 @@ void bleTelemetryTask(void *pvParameters) {
     if (bleDeviceConnected) {
       updateBLETelemetryData();
       updateBLEVescData();
+      updateBLETaskPerf();
     }
     
+    taskPerfEnd(TASK_PERF_BLE);
+    
     // Wait for next update cycle
     vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(BLE_UPDATE_RATE_MS));
   }
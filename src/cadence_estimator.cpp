@@ -0,0 +1,166 @@
+#include "cadence_estimator.h"
+#include <math.h>
+
+static const uint32_t HISTORY = CADENCE_EDGES_PER_REV + 1;
+
+CadenceEstimator::CadenceEstimator() {
+  reset();
+}
+
+void CadenceEstimator::reset() {
+  for (uint32_t i = 0; i < CADENCE_EDGES_PER_REV; i++) {
+    share[i] = 1.0f / CADENCE_EDGES_PER_REV;
+  }
+  calibration_updates = 0;
+  breakSequence();
+}
+
+void CadenceEstimator::breakSequence() {
+  head = 0;
+  count = 0;
+  last_step_edges = 1;
+  cadence_rpm = 0.0f;
+}
+
+uint32_t CadenceEstimator::slot(int32_t edge_index) {
+  int32_t s = edge_index % (int32_t)CADENCE_EDGES_PER_REV;
+  return (uint32_t)(s < 0 ? s + CADENCE_EDGES_PER_REV : s);
+}
+
+float CadenceEstimator::sharesBetween(int32_t from_index, int32_t to_index) const {
+  float sum = 0.0f;
+  for (int32_t i = from_index + 1; i <= to_index; i++) {
+    sum += share[slot(i)];
+  }
+  return sum;
+}
+
+const CadenceEstimator::Step& CadenceEstimator::stepBack(uint32_t steps) const {
+  return history[(head + HISTORY - 1 - steps) % HISTORY];
+}
+
+int32_t CadenceEstimator::findStepBack(int32_t edge_index) const {
+  for (uint32_t steps = 1; steps < count; steps++) {
+    int32_t index = stepBack(steps).edge_index;
+    if (index == edge_index) {
+      return (int32_t)steps;
+    }
+    if (index < edge_index) {
+      break;  // Indices only go down from here
+    }
+  }
+  return -1;
+}
+
+uint32_t CadenceEstimator::lastEdgeUs() const {
+  return count > 0 ? stepBack(0).time_us : 0;
+}
+
+uint32_t CadenceEstimator::expectedIntervalUs() const {
+  if (cadence_rpm <= 0.0f || count == 0) {
+    return 0;
+  }
+  int32_t last_index = stepBack(0).edge_index;
+  return (uint32_t)(sharesBetween(last_index, last_index + (int32_t)last_step_edges) * 60000000.0f / cadence_rpm);
+}
+
+float CadenceEstimator::edgeShare(int32_t edge_index) const {
+  return share[slot(edge_index)];
+}
+
+// Same cadence in both halves of the last revolution (within
+// CADENCE_STEADY_TOLERANCE), using the learned shares of each half
+bool CadenceEstimator::isSteady() const {
+  const Step& latest = stepBack(0);
+  int32_t middle_back = findStepBack(latest.edge_index - CADENCE_EDGES_PER_REV / 2);
+  int32_t revolution_back = findStepBack(latest.edge_index - CADENCE_EDGES_PER_REV);
+  if (middle_back < 0 || revolution_back < 0) {
+    return false;
+  }
+
+  const Step& middle = stepBack((uint32_t)middle_back);
+  float recent_share = sharesBetween(middle.edge_index, latest.edge_index);
+  float recent_rate = recent_share / (float)(latest.time_us - middle.time_us);
+  float older_rate = (1.0f - recent_share) / (float)(middle.time_us - stepBack((uint32_t)revolution_back).time_us);
+  return fabsf(recent_rate / older_rate - 1.0f) < CADENCE_STEADY_TOLERANCE;
+}
+
+// The latest step's share of the revolution that ended with it. A step over
+// several edges scales their shares together (the split between them is not
+// observable).
+void CadenceEstimator::learnShares() {
+  const Step& latest = stepBack(0);
+  const Step& previous = stepBack(1);
+  const Step& revolution_start = stepBack((uint32_t)findStepBack(latest.edge_index - CADENCE_EDGES_PER_REV));
+
+  float revolution_us = (float)(latest.time_us - revolution_start.time_us);
+  float measured = (float)(latest.time_us - previous.time_us) / revolution_us;
+  float nominal = (float)last_step_edges / CADENCE_EDGES_PER_REV;
+
+  if (measured <= 0.25f * nominal || measured >= 4.0f * nominal) {
+    return;
+  }
+
+  float learned = sharesBetween(previous.edge_index, latest.edge_index);
+  float scale = 1.0f + CADENCE_CALIBRATION_GAIN * (measured / learned - 1.0f);
+  for (int32_t i = previous.edge_index + 1; i <= latest.edge_index; i++) {
+    share[slot(i)] *= scale;
+  }
+
+  float sum = 0.0f;
+  for (uint32_t i = 0; i < CADENCE_EDGES_PER_REV; i++) sum += share[i];
+  for (uint32_t i = 0; i < CADENCE_EDGES_PER_REV; i++) share[i] /= sum;
+  calibration_updates++;
+}
+
+bool CadenceEstimator::addForwardEdge(int32_t edge_index, uint32_t time_us) {
+  if (count > 0) {
+    int32_t step_edges = edge_index - stepBack(0).edge_index;
+    if (step_edges == 0) {
+      return false;  // Same edge again after a bounce - keep the first timestamp
+    }
+    if (step_edges < 0 || step_edges > CADENCE_MAX_STEP_EDGES) {
+      breakSequence();
+    } else {
+      last_step_edges = (uint32_t)step_edges;
+    }
+  }
+
+  history[head].time_us = time_us;
+  history[head].edge_index = edge_index;
+  head = (head + 1) % HISTORY;
+  if (count < HISTORY) count++;
+
+  if (count < 2) {
+    return false;  // No interval yet
+  }
+
+  // Calibration only at steady cadence - while the rider speeds up, the last
+  // step is shorter than its share of the (slower) revolution
+  if (isSteady()) {
+    learnShares();
+  }
+
+  // Window: back to one revolution, or less if that is longer than
+  // CADENCE_WINDOW_US (at least one step)
+  float revolutions = 0.0f;
+  uint32_t span_us = 0;
+  int32_t window_start = edge_index;
+  for (uint32_t steps = 1; steps < count; steps++) {
+    const Step& start = stepBack(steps);
+    uint32_t candidate_us = time_us - start.time_us;
+    if (steps > 1 && (candidate_us > CADENCE_WINDOW_US ||
+                      edge_index - start.edge_index > CADENCE_EDGES_PER_REV)) {
+      break;
+    }
+    revolutions += sharesBetween(start.edge_index, window_start);
+    window_start = start.edge_index;
+    span_us = candidate_us;
+  }
+
+  if (span_us == 0) {
+    return false;
+  }
+  cadence_rpm = revolutions * 60000000.0f / (float)span_us;
+  return true;
+}
@@ -24,20 +24,42 @@ bool enable_ble_telemetry = true;      // Set to true to enable BLE Interface
 // Speed interpolation points [km/h]
 float SPEED_POINTS_KMH[NUM_SPEED_POINTS] = {0, 5, 10, 15, 20, 30};
 
+// Assist maps: factor over speed x cadence x human power (assist_map.h) for
+// profiles that should react to the rider, checked at compile time.
+// Touring, less support below 60 rpm (spin, don't grind), more under hard
+// effort: [speed][cadence][human power]
+static constexpr AssistProfileMap TOURING_ADAPTIVE_MAP = {
+  {0, 5, 10, 15, 20, 30},           // km/h
+  {40, 60, 80, 100},                // rpm
+  {50, 150, 300},                   // W human power
+  {
+    {{1.86, 2.32, 2.67}, {2.32, 2.90, 3.33}, {2.55, 3.19, 3.67}, {2.55, 3.19, 3.67}},   // 0 km/h
+    {{1.38, 1.72, 1.98}, {1.72, 2.15, 2.47}, {1.89, 2.37, 2.72}, {1.89, 2.37, 2.72}},   // 5 km/h
+    {{1.12, 1.40, 1.61}, {1.40, 1.75, 2.01}, {1.54, 1.93, 2.21}, {1.54, 1.93, 2.21}},   // 10 km/h
+    {{0.90, 1.12, 1.29}, {1.12, 1.40, 1.61}, {1.23, 1.54, 1.77}, {1.23, 1.54, 1.77}},   // 15 km/h
+    {{0.77, 0.96, 1.10}, {0.96, 1.20, 1.38}, {1.06, 1.32, 1.52}, {1.06, 1.32, 1.52}},   // 20 km/h
+    {{0.51, 0.64, 0.74}, {0.64, 0.80, 0.92}, {0.70, 0.88, 1.01}, {0.70, 0.88, 1.01}}    // 30 km/h
+  }
+};
+ASSIST_MAP_CHECK(TOURING_ADAPTIVE_MAP);
+
 // Available assist profiles - comment out profiles you don't want to use
+// (a profile with a map uses it instead of the speed curve, nullptr = speed curve only)
 // The system will automatically use only the enabled profiles
 AssistProfile AVAILABLE_PROFILES[] = {
   {
     "Linear", 
     "linear profile", 
     true,
-    {1, 1, 1, 1, 1, 1}
+    {1, 1, 1, 1, 1, 1},
+    nullptr
   }
   // {
   //   "Touring Eco", 
   //   "Like Touring but ~40% reduced for better range and efficiency", 
   //   true,
-  //   {1.8, 1.2, 1.0, 0.8, 0.7, 0.5}
+  //   {1.8, 1.2, 1.0, 0.8, 0.7, 0.5},
+  //   nullptr
   // }
 
 
@@ -46,35 +68,48 @@ AssistProfile AVAILABLE_PROFILES[] = {
   //   "No Assist", 
   //   "No motor assistance", 
   //   false,
-  //   {0.0, 0.0, 0.0, 0.0, 0.0, 0.0}
+  //   {0.0, 0.0, 0.0, 0.0, 0.0, 0.0},
+  //   nullptr
   // },
   
   /*{
     "Touring", 
     "Fast start-up, gentle slope to 30km/h - good for touring with luggage", 
     false,
-    {2.9, 2.15, 1.75, 1.4, 1.2, 0.8}
+    {2.9, 2.15, 1.75, 1.4, 1.2, 0.8},
+    nullptr
+  },*/
+  
+  /*{
+    "Touring Adaptive", 
+    "Touring curve, more support at higher cadence and effort", 
+    false,
+    {2.9, 2.15, 1.75, 1.4, 1.2, 0.8},
+    &TOURING_ADAPTIVE_MAP
   },*/
   
   /*{
     "Mountain Bike", 
     "High power at start for steep terrain, low support at mid speeds", 
     false,
-    {2.0, 1.6, 0.5, 0.8, 1.2, 1.0}
+    {2.0, 1.6, 0.5, 0.8, 1.2, 1.0},
+    nullptr
   },*/
   
   /*{
     "Urban", 
     "Optimized for start-stop traffic, full power for traffic light starts", 
     false,
-    {2.9, 1.5, 0.75, 1.0, 1.2, 0.9}
+    {2.9, 1.5, 0.75, 1.0, 1.2, 0.9},
+    nullptr
   },*/
   
   /*{
     "Speed", 
     "Fast to top speed, progressive increase to maximum speed of 30km/h", 
     false,
-    {1.0, 1.5, 2.5, 2.6, 2.7, 3.0}
+    {1.0, 1.5, 2.5, 2.6, 2.7, 3.0},
+    nullptr
   },*/
   
   
@@ -82,14 +117,16 @@ AssistProfile AVAILABLE_PROFILES[] = {
     "Urban + Light", 
     "Same as Urban but with automatic light activation", 
     true,
-    {2.9, 1.5, 0.75, 1.0, 1.2, 0.9}
+    {2.9, 1.5, 0.75, 1.0, 1.2, 0.9},
+    nullptr
   },*/
   
   /*{
     "No Assist + Light", 
     "No motor assistance but with automatic light", 
     true,
-    {0.0, 0.0, 0.0, 0.0, 0.0, 0.0}
+    {0.0, 0.0, 0.0, 0.0, 0.0, 0.0},
+    nullptr
   }*/
 };
 
@@ -97,14 +134,16 @@ AssistProfile AVAILABLE_PROFILES[] = {
 const int NUM_ACTIVE_PROFILES = sizeof(AVAILABLE_PROFILES) / sizeof(AVAILABLE_PROFILES[0]);
 
 // Legacy arrays for compatibility with existing code (dynamically sized)
-float ASSIST_PROFILES[10][NUM_SPEED_POINTS];  // Max 10 profiles (should be enough)
-bool LIGHT_MODES[10];
+float ASSIST_PROFILES[MAX_ASSIST_PROFILES][NUM_SPEED_POINTS];  // Max 10 profiles (should be enough)
+bool LIGHT_MODES[MAX_ASSIST_PROFILES];
+const AssistProfileMap* ASSIST_MAPS[MAX_ASSIST_PROFILES];
 
 // Function to initialize legacy arrays from active profiles
 void initializeAssistProfiles() {
   // Clear all profiles first (use a reasonable maximum)
-  for (int i = 0; i < 10; i++) {
+  for (int i = 0; i < MAX_ASSIST_PROFILES; i++) {
     LIGHT_MODES[i] = false;
+    ASSIST_MAPS[i] = nullptr;
     for (int j = 0; j < NUM_SPEED_POINTS; j++) {
       ASSIST_PROFILES[i][j] = 0.0;
     }
@@ -113,10 +152,13 @@ void initializeAssistProfiles() {
   // Copy active profiles to legacy arrays
   for (int i = 0; i < NUM_ACTIVE_PROFILES; i++) {
     LIGHT_MODES[i] = AVAILABLE_PROFILES[i].hasLight;
+    ASSIST_MAPS[i] = AVAILABLE_PROFILES[i].map;
     for (int j = 0; j < NUM_SPEED_POINTS; j++) {
       ASSIST_PROFILES[i][j] = AVAILABLE_PROFILES[i].profile[j];
     }
   }
+  
+  build_assist_tables();
 }
 
 // PAS sensor state variables
@@ -128,8 +170,8 @@ unsigned long pulse_intervals[4] = {0, 0, 0, 0};
 int pulse_index = 0;
 
 // Interrupt-based PAS sensor variables
-volatile bool pas_interrupt_flag = false;
-volatile unsigned long last_interrupt_time = 0;
+unsigned long pas_edges_decoded = 0;
+unsigned long pas_invalid_transitions = 0;
 volatile int quadrature_pulses_per_rev = 32;  // 8 original pulses × 4 quadrature transitions
 volatile unsigned long last_revolution_time = 0;
 
@@ -139,6 +181,7 @@ float current_cadence_rps = 0.0;
 int raw_torque_value = 0;
 float crank_torque_nm = 0.0;
 float filtered_torque = 0.0;
+float crank_torque_peak_nm = 0.0;
 
 // Speed and assist
 float current_speed_kmh = 0.0;
@@ -151,10 +194,13 @@ float human_power_watts = 0.0;
 float assist_power_watts = 0.0;
 float target_current_amps = 0.0;
 float actual_current_amps = 0.0;
+float motor_current_limit_amps = MAX_MOTOR_CURRENT;
 
 // System status
 int current_mode = 0;
 bool motor_enabled = false;
+bool motor_cut = true;
+float commanded_current_amps = 0.0;
 bool lightOn = false;
 unsigned long last_pedal_activity = 0;
 unsigned long last_loop_time = 0;
@@ -174,6 +220,18 @@ int vescCounter = 0;
 int vescDelayBetween = 9999;
 int vescDelayBetweenList = 9999;
 
+// =============================================================================
+// SHARED DATA AND VESC UART
+// =============================================================================
+
+// Seqlock snapshots are zero-initialized on construction
+SeqlockSnapshot<SharedSensorData> sharedSensorData;
+SeqlockSnapshot<SharedVescData> sharedVescData;
+SeqlockSnapshot<MotorCommandLatency> motorCommandLatency;
+
+/** VESC UART communication object (used by vescTask only) */
+VescUart vescUart;
+
 // =============================================================================
 // DEBUG MODE VARIABLES
 // =============================================================================
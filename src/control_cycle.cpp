@@ -0,0 +1,178 @@
+#include "ebike_controller.h"
+#include "deferred_log.h"
+#include "current_shaper.h"
+#include "current_tracking.h"
+#include "thermal_derating.h"
+#include "battery_model.h"
+#include <VescUart.h>
+
+// External VESC UART instance (created in config.cpp)
+extern VescUart vescUart;
+
+// =============================================================================
+// CONTROL CYCLES - one iteration of sensorTask / vescTask
+// =============================================================================
+// The task loops in main.cpp only add the FreeRTOS plumbing (mailbox, delays)
+// around these. Keeping the cycles here lets the host build drive exactly
+// the same pipeline (ride simulator, [env:test]).
+
+// CORE 0: one 10ms sensor tick. Returns the motor command for vescTask.
+SharedMotorCommand run_sensor_cycle() {
+  // -------------------------------------------------------------------------
+  // HIGH-FREQUENCY SENSOR PROCESSING (Core 0)
+  // -------------------------------------------------------------------------
+  
+  // Start of the pedal-to-command latency measurement
+  uint32_t tick_start_us = micros();
+  
+  // 0. Update debug simulation if enabled (must be called first)
+  if (debug_mode) {
+    update_debug_simulation();
+  }
+  
+  // Debug output every 2 seconds (deferred - formatted by logDrainTask)
+  static unsigned long last_status = 0;
+  if (millis() - last_status > 2000) {
+    logDeferred(LOG_SENSOR_ALIVE, current_cadence_rpm, filtered_torque, raw_torque_value,
+                current_mode, motor_enabled ? "ON" : "OFF");
+    last_status = millis();
+  }
+  
+  // 1. Read PAS sensors (interrupt-based, very fast)
+  read_pas_sensors();
+  
+  // Special PAS debug output when pedaling is detected
+  static float last_cadence = 0.0;
+  static unsigned long last_pas_debug = 0;
+  
+  // Output PAS info when cadence changes significantly or periodically
+  if (abs(current_cadence_rpm - last_cadence) > 2.0 || 
+      (current_cadence_rpm > 0 && millis() - last_pas_debug > 1000)) {
+    if (current_cadence_rpm > 0) {
+      logDeferred(LOG_PAS_PEDALING, current_cadence_rpm,
+                  pedal_direction == 1 ? "FORWARD" : (pedal_direction == -1 ? "REVERSE" : "STOPPED"),
+                  pos);
+      last_pas_debug = millis();
+      last_cadence = current_cadence_rpm;
+    }
+  } else if (current_cadence_rpm == 0 && last_cadence > 0) {
+    logDeferred(LOG_PAS_STOPPED);
+    last_cadence = 0.0;
+  }
+  
+  // 2. Update cadence calculation
+  update_cadence();
+  
+  // 3. Read and filter torque sensor, average it over the last pedal stroke
+  update_torque();
+  update_crank_torque();
+  
+  // 4. Mode management (reverse pedaling detection)
+  update_mode_selection();
+  
+  // 5. Get current speed from VESC data (lock-free snapshot, never waits)
+  SharedVescData vesc_snapshot = sharedVescData.read();
+  
+  // 6. Current limit (thermal derating, battery sag), then the assist power
+  // with current speed
+  current_speed_kmh = vesc_snapshot.speed_kmh;
+  vesc_data_valid = vesc_snapshot.data_valid;
+  update_thermal_derating(vesc_snapshot);
+  limit_battery_current(vesc_snapshot);
+  calculate_assist_power();
+  
+  // 7. Closed-loop correction from the delivered current and power
+  target_current_amps = track_motor_current(vesc_snapshot);
+  
+  // 8. Motor status and safety checks
+  update_motor_status();
+  
+  // 9. Shape the motor command: filtered, rate and jerk limited ramps,
+  // safety cuts immediately
+  commanded_current_amps = shape_motor_current(motor_enabled ? target_current_amps : 0.0, motor_cut);
+  
+  // 10. Publish shared sensor data (seqlock - the writer never blocks)
+  SharedSensorData sensor_snapshot;
+  sensor_snapshot.cadence_rpm = current_cadence_rpm;
+  sensor_snapshot.cadence_rps = current_cadence_rps;
+  sensor_snapshot.torque_nm = crank_torque_nm;
+  sensor_snapshot.filtered_torque = filtered_torque;
+  sensor_snapshot.torque_peak_nm = crank_torque_peak_nm;
+  sensor_snapshot.current_mode = current_mode;
+  sensor_snapshot.motor_enabled = motor_enabled;
+  sensor_snapshot.last_update = millis();
+  sharedSensorData.publish(sensor_snapshot);
+  
+  // 11. Motor command for vescTask (queued_time_us is set by the caller)
+  SharedMotorCommand command;
+  command.target_current = commanded_current_amps;
+  command.timestamp = millis();
+  command.sample_time_us = tick_start_us;
+  command.test_mode = false;
+  command.test_end_time = 0;
+  command.queued_time_us = tick_start_us;
+  return command;
+}
+
+// CORE 1: one vescTask wake-up (new command from the mailbox, or the
+// VESC_UART_POLL_MS timeout with command == NULL). Never blocks on the VESC.
+void run_vesc_cycle(const SharedMotorCommand* command) {
+  static unsigned long last_status = 0;
+  static unsigned long last_housekeeping = 0;
+  
+  // -------------------------------------------------------------------------
+  // VESC COMMUNICATION (Core 1) - event-driven, never blocks on the VESC
+  // -------------------------------------------------------------------------
+  
+  // 1. Motor command from sensorTask
+  if (command != NULL) {
+    send_motor_command(*command);
+  }
+  
+  // 2. Drain UART RX, handle GET_VALUES answers/timeouts, send next request
+  update_vesc_data();
+  
+  unsigned long now = millis();
+  if (now - last_housekeeping < VESC_HOUSEKEEPING_MS) {
+    return;
+  }
+  last_housekeeping = now;
+  
+  // Debug output every 3 seconds (deferred - formatted by logDrainTask)
+  if (now - last_status > 3000) {
+    MotorCommandLatency latency = motorCommandLatency.read();
+    logDeferred(LOG_VESC_ALIVE, current_speed_kmh, vesc_data_valid ? "YES" : "NO", loopCounter,
+                battery_voltage, battery_percentage);
+    logDeferred(LOG_VESC_LATENCY,
+                (unsigned long)latency.pedal_to_wire_us, latency.pedal_to_wire_avg_us,
+                (unsigned long)latency.pedal_to_wire_max_us, (unsigned long)latency.queue_to_wire_max_us,
+                (unsigned long)latency.commands_sent);
+    logDeferred(LOG_VESC_UART,
+                (unsigned long)vescUart.linkStats.bytesSent, (unsigned long)vescUart.linkStats.bytesReceived,
+                (unsigned long)vescUart.linkStats.framesReceived, (unsigned long)vescUart.linkStats.crcErrors,
+                (unsigned long)vescUart.linkStats.framingErrors, (unsigned long)vescUart.linkStats.timeouts,
+                (unsigned long)vescUart.linkStats.lastLatencyUs, (unsigned long)vescUart.linkStats.maxLatencyUs);
+    last_status = now;
+  }
+  
+  // 3. Publish shared VESC data (vescTask is the only writer of this snapshot).
+  // last_update stays at the last GET_VALUES answer (handle_vesc_values()):
+  // update_motor_status() cuts the motor when it gets older than 1s.
+  SharedVescData vesc_snapshot = sharedVescData.read();
+  vesc_snapshot.speed_kmh = current_speed_kmh;
+  vesc_snapshot.data_valid = vesc_data_valid;
+  vesc_snapshot.actual_current = actual_current_amps;
+  vesc_snapshot.battery_voltage = battery_voltage;
+  vesc_snapshot.battery_percentage = battery_percentage;
+  sharedVescData.publish(vesc_snapshot);
+  
+  // 4. Debug output (low frequency to avoid spam)
+  static unsigned long last_debug = 0;
+  if (now - last_debug > 500) {  // Every 500ms
+    print_debug_info();
+    last_debug = now;
+  }
+  
+  // Update loop counter for compatibility
+  loopCounter++;
+}
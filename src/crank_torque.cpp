@@ -0,0 +1,75 @@
+#include "crank_torque.h"
+
+static_assert(CRANK_TORQUE_WINDOW_EDGES <= CADENCE_EDGES_PER_REV, "Averaging window longer than the bin ring");
+static_assert(CRANK_TORQUE_STROKE_EDGES <= CADENCE_EDGES_PER_REV, "Peak window longer than the bin ring");
+
+CrankTorqueAverager::CrankTorqueAverager() {
+  reset();
+}
+
+void CrankTorqueAverager::reset() {
+  head = 0;
+  count = 0;
+  open_sum = 0.0f;
+  open_samples = 0;
+  open_max = 0.0f;
+  avg_nm = 0.0f;
+  peak_nm = 0.0f;
+}
+
+void CrankTorqueAverager::pushBin(float mean_nm, float max_nm) {
+  bin_mean[head] = mean_nm;
+  bin_max[head] = max_nm;
+  head = (head + 1) % CADENCE_EDGES_PER_REV;
+  if (count < CADENCE_EDGES_PER_REV) {
+    count++;
+  }
+}
+
+bool CrankTorqueAverager::addSample(float torque_nm, uint32_t forward_edges) {
+  open_sum += torque_nm;
+  open_samples++;
+  if (open_samples == 1 || torque_nm > open_max) {
+    open_max = torque_nm;
+  }
+
+  if (forward_edges == 0) {
+    // Still inside the first edge since a reset: nothing better than the
+    // samples themselves
+    if (count == 0) {
+      avg_nm = open_sum / open_samples;
+      peak_nm = open_max;
+    }
+    return false;
+  }
+
+  // Close the bin, once per edge passed in this tick (more than a full ring
+  // would only overwrite itself)
+  float mean_nm = open_sum / open_samples;
+  if (forward_edges > CADENCE_EDGES_PER_REV) {
+    forward_edges = CADENCE_EDGES_PER_REV;
+  }
+  for (uint32_t i = 0; i < forward_edges; i++) {
+    pushBin(mean_nm, open_max);
+  }
+  open_sum = 0.0f;
+  open_samples = 0;
+
+  // Window sums over at most 16-32 bins, once per edge
+  uint32_t window = count < CRANK_TORQUE_WINDOW_EDGES ? count : CRANK_TORQUE_WINDOW_EDGES;
+  float sum = 0.0f;
+  for (uint32_t i = 1; i <= window; i++) {
+    sum += bin_mean[(head + CADENCE_EDGES_PER_REV - i) % CADENCE_EDGES_PER_REV];
+  }
+  avg_nm = sum / window;
+
+  uint32_t stroke = count < CRANK_TORQUE_STROKE_EDGES ? count : CRANK_TORQUE_STROKE_EDGES;
+  peak_nm = bin_max[(head + CADENCE_EDGES_PER_REV - 1) % CADENCE_EDGES_PER_REV];
+  for (uint32_t i = 2; i <= stroke; i++) {
+    float m = bin_max[(head + CADENCE_EDGES_PER_REV - i) % CADENCE_EDGES_PER_REV];
+    if (m > peak_nm) {
+      peak_nm = m;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,85 @@
+#include "current_shaper.h"
+#include "ebike_controller.h"
+
+// =============================================================================
+// CURRENT SHAPER
+// =============================================================================
+
+CurrentShaper::CurrentShaper() {
+  configure(current_shaper_default_config());
+  reset();
+}
+
+void CurrentShaper::configure(const CurrentShaperConfig& config) {
+  cfg = config;
+}
+
+void CurrentShaper::reset() {
+  filtered = 0.0f;
+  out = 0.0f;
+  rate_a_per_s = 0.0f;
+}
+
+float CurrentShaper::update(float target, bool cut) {
+  if (cut) {
+    reset();
+    return out;
+  }
+
+  // Releasing the motor is left to the fall rate - the filter would never
+  // quite reach 0
+  filtered = cfg.filter > 0.0f && target > 0.0f ? filtered + (1.0f - cfg.filter) * (target - filtered) : target;
+
+  float error = filtered - out;
+  float wanted = error / CURRENT_SHAPER_DT_S;        // Rate that gets there this tick
+  if (cfg.rise_a_per_s > 0.0f && wanted > cfg.rise_a_per_s) wanted = cfg.rise_a_per_s;
+  if (cfg.fall_a_per_s > 0.0f && wanted < -cfg.fall_a_per_s) wanted = -cfg.fall_a_per_s;
+
+  if (cfg.jerk_a_per_s2 > 0.0f) {
+    // Slow enough to brake to rate 0 at the target: v^2 = 2 * jerk * distance
+    float stop_rate = sqrtf(2.0f * cfg.jerk_a_per_s2 * fabsf(error));
+    wanted = constrain(wanted, -stop_rate, stop_rate);
+    float step = cfg.jerk_a_per_s2 * CURRENT_SHAPER_DT_S;
+    rate_a_per_s += constrain(wanted - rate_a_per_s, -step, step);
+  } else {
+    rate_a_per_s = wanted;
+  }
+
+  out += rate_a_per_s * CURRENT_SHAPER_DT_S;
+  if ((error >= 0.0f && out >= filtered) || (error <= 0.0f && out <= filtered)) {
+    out = filtered;                                   // Arrived - never past the target
+    rate_a_per_s = 0.0f;
+  }
+  if (out < 0.0f) {
+    out = 0.0f;
+    rate_a_per_s = 0.0f;
+  }
+  return out;
+}
+
+CurrentShaperConfig current_shaper_default_config() {
+  CurrentShaperConfig config;
+  config.filter = CURRENT_FILTER;
+  config.rise_a_per_s = CURRENT_RAMP_RATE;
+  config.fall_a_per_s = CURRENT_FALL_RATE;
+  config.jerk_a_per_s2 = CURRENT_JERK_LIMIT;
+  return config;
+}
+
+// =============================================================================
+// MOTOR COMMAND SHAPING (sensorTask)
+// =============================================================================
+
+static CurrentShaper shaper;
+
+float shape_motor_current(float target, bool cut) {
+  return shaper.update(target, cut);
+}
+
+void current_shaper_reset() {
+  shaper.reset();
+}
+
+void current_shaper_configure(const CurrentShaperConfig& config) {
+  shaper.configure(config);
+}
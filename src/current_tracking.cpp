@@ -0,0 +1,106 @@
+#include "current_tracking.h"
+#include "ebike_controller.h"
+#include "deferred_log.h"
+
+// =============================================================================
+// CURRENT TRACKER
+// =============================================================================
+
+CurrentTracker::CurrentTracker() {
+  reset();
+}
+
+void CurrentTracker::reset() {
+  integral = 0.0f;
+  proportional = 0.0f;
+  kt_scale = 1.0f;
+  delivered_w = 0.0f;
+  current_error_a = 0.0f;
+  last_target_a = 0.0f;
+  vesc_limited = false;
+  integral_held = false;
+}
+
+float CurrentTracker::update(const CurrentTrackingInput& in) {
+  // Between samples (10 ms ticks, 20 ms VESC polls) the P term of the last
+  // one holds, so the corrected target does not jump at the sample rate
+  if (in.new_sample) {
+    proportional = 0.0f;                      // Until this sample is comparable
+
+    // Electrical power in minus copper and gear losses
+    float p_elec = VESC_EFFICIENCY * in.input_voltage * in.input_current_a;
+    float p_copper = in.motor_current_a * in.motor_current_a * MOTOR_PHASE_RESISTANCE;
+    delivered_w = max(p_elec - p_copper, 0.0f) * MOTOR_GEAR_EFFICIENCY;
+
+    current_error_a = in.commanded_a - in.motor_current_a;
+    vesc_limited = in.commanded_a >= MIN_MOTOR_CURRENT &&
+                   in.motor_current_a < TRACKING_LIMITED_RATIO * in.commanded_a;
+
+    bool settled = last_target_a > 0.0f &&
+                   fabsf(in.commanded_a - last_target_a) <= TRACKING_SETTLED_RATIO * last_target_a;
+    if (in.active && settled && in.speed_kmh >= TRACKING_MIN_SPEED_KMH &&
+        in.requested_w >= TRACKING_MIN_POWER_W) {
+      float error = constrain((in.requested_w - delivered_w) / in.requested_w, -1.0f, 1.0f);
+      proportional = TRACKING_KP * error;
+
+      // Anti-windup: no more scale while more current would not help
+      integral_held = error > 0.0f && (vesc_limited || last_target_a >= in.limit_a);
+      if (!integral_held) {
+        integral += TRACKING_KI * error * TRACKING_SAMPLE_S;
+        integral = constrain(integral, TRACKING_SCALE_MIN - 1.0f, TRACKING_SCALE_MAX - 1.0f);
+      }
+    }
+  }
+
+  kt_scale = constrain(1.0f + integral + proportional, TRACKING_SCALE_MIN, TRACKING_SCALE_MAX);
+
+  float target = 0.0f;
+  if (in.target_a > 0.0f) {
+    target = constrain(in.target_a * kt_scale, MIN_MOTOR_CURRENT, in.limit_a);
+  }
+  last_target_a = target;
+  return target;
+}
+
+// =============================================================================
+// MOTOR CURRENT TRACKING (sensorTask)
+// =============================================================================
+
+static CurrentTracker tracker;
+static uint32_t last_values_count = 0;
+
+float track_motor_current(const SharedVescData& vesc) {
+  CurrentTrackingInput in;
+  in.target_a = target_current_amps;
+  in.limit_a = motor_current_limit_amps;
+  in.requested_w = assist_power_watts;
+  in.commanded_a = commanded_current_amps;
+  in.speed_kmh = vesc.speed_kmh;
+  in.active = motor_enabled && vesc.data_valid;
+  in.new_sample = vesc.values_count != last_values_count;
+  in.motor_current_a = vesc.actual_current;
+  in.input_current_a = vesc.input_current;
+  in.input_voltage = vesc.battery_voltage;
+  last_values_count = vesc.values_count;
+
+  float target = tracker.update(in);
+
+  static unsigned long last_tracking_debug = 0;
+  unsigned long now = millis();
+  if (now - last_tracking_debug > 2000) { // Every 2 seconds
+    logDeferred(LOG_CURRENT_TRACKING, assist_power_watts, tracker.deliveredWatts(),
+                commanded_current_amps, vesc.actual_current, tracker.scale(),
+                tracker.limited() ? " VESC-LIMIT" : "");
+    last_tracking_debug = now;
+  }
+  return target;
+}
+
+void current_tracking_reset() {
+  tracker.reset();
+  last_values_count = 0;
+}
+
+const CurrentTracker& current_tracker() {
+  return tracker;
+}
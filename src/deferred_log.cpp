@@ -0,0 +1,290 @@
+#include "deferred_log.h"
+#include "log_messages.h"
+#include <stdio.h>
+#include <string.h>
+
+// =============================================================================
+// DEFERRED LOG FORMATS (index = DeferredLogId)
+// =============================================================================
+
+const DeferredLogFormat DEFERRED_LOG_FORMATS[NUM_DEFERRED_LOG_IDS] = {
+  // LOG_SENSOR_ALIVE
+  {"[SENSOR] Task alive - Cadence: %.1f RPM, Torque: %.1f Nm (Raw: %d), Mode: %d, Motor: %s", false},
+  // LOG_PAS_PEDALING
+  {"[PAS] Pedaling detected! Cadence: %.1f RPM, Direction: %s, Position: %d", false},
+  // LOG_PAS_STOPPED
+  {"[PAS] Pedaling stopped", false},
+  // LOG_PAS_POSITION_OVERFLOW
+  {"Position overflow protection: %d -> %d", false},
+  // LOG_MODE_CHANGED
+  {"MODE CHANGED: %d (Reverse steps: %d)", true},
+  // LOG_POWER_CALC
+  {"POWER CALC - Torque:%.1fNm Cadence:%.1fRPM Human:%.0fW Factor:%.2f Assist:%.0fW MotorRPM:%.0f Current:%.2fA", false},
+  // LOG_MOTOR_DEBUG
+  {"MOTOR DEBUG - PAS:%s Torque:%s(%.1f) Cadence:%s(%.1f) Mode:%s(%d) Dir:%s VescFresh:%s", false},
+  // LOG_MOTOR_EXCESSIVE_CADENCE
+  {"WARNING: Motor stopped - excessive cadence (%.1f RPM)", true},
+  // LOG_MOTOR_SPEED_EMERGENCY
+  {"EMERGENCY: Speed limit exceeded (%.1f km/h) - motor stopped!", true},
+  // LOG_VESC_ALIVE
+  {"[VESC] Task alive - Speed: %.1f km/h, Data valid: %s, Loop count: %d, Battery: %.1fV (%.0f%%)", false},
+  // LOG_VESC_LATENCY
+  {"[VESC] Command latency - Pedal->UART: %luus (avg %.0fus, max %luus), Queue->UART max: %luus, Sent: %lu", false},
+  // LOG_VESC_UART
+  {"[VESC] UART - TX: %lu B, RX: %lu B, Frames: %lu, CRC errors: %lu, Framing errors: %lu, Timeouts: %lu, Reply latency: %luus (max %luus)", false},
+  // LOG_VESC_CONNECTION_LOST
+  {"WARNING: VESC connection lost!", true},
+  // LOG_VESC_SAFE_MODE
+  {"SAFETY: Motor disabled - VESC connection failed", true},
+  // LOG_BATTERY_CRITICAL
+  {"CRITICAL: Battery critically low! Voltage: %.1fV (%.1f%%) - Fast blinking!", true},
+  // LOG_BATTERY_LOW
+  {"WARNING: Low battery! Voltage: %.1fV (%.1f%%)", true},
+  // LOG_BATTERY_RECOVERED_LOW
+  {"INFO: Battery recovered from critical to low. Voltage: %.1fV (%.1f%%)", true},
+  // LOG_BATTERY_OK
+  {"INFO: Battery level OK again. Voltage: %.1fV (%.1f%%)", false},
+  // LOG_DEBUG_MODE
+  {"DEBUG MODE | %s%s| Phase:%d", false},
+  // LOG_DEBUG_SENSORS
+  {"States: %d-%d | Dir:%s | Pos:%d | Cadence:%.1frpm%s | Speed:%.1fkm/h%s | Torque:%.1fNm(raw:%d)%s", false},
+  // LOG_DEBUG_OUTPUTS
+  {"Human:%.0fW Assist:%.0fW | Motor:%s(%.1fA) | Mode:%d(x%.2f) | Light:%s | Batt:%.1fV(%.0f%%)%s | Delay:%d", false},
+  // LOG_TORQUE_ZERO_CALIBRATED
+  {"INFO: Torque zero calibrated: %.1f ADC (%+.1f)", true},
+  // LOG_TORQUE_ZERO_SAVED
+  {"[TORQUE] Zero %.1f ADC stored in NVS (write %lu since boot)", false},
+  // LOG_CURRENT_TRACKING
+  {"TRACKING - Requested:%.0fW Delivered:%.0fW Current:%.2fA/%.2fA Scale:%.2f%s", false},
+  // LOG_THERMAL_DERATING
+  {"THERMAL - Motor:%.1fC (VESC %.1fC) FET:%.1fC (VESC %.1fC) Limit:%.2fA Time to limit:%.0fs%s", false},
+  // LOG_BATTERY_MODEL
+  {"BATTERY - R:%.3fOhm OCV:%.1fV Loaded:%.1fV Max input:%.1fA Max motor:%.2fA%s", false},
+};
+
+DeferredLogRing deferredLogRing;
+
+TaskHandle_t logDrainTaskHandle = NULL;
+
+// =============================================================================
+// LOCK-FREE RING (bounded MPSC, per-slot sequence numbers)
+// =============================================================================
+// Slot i is free for position p when sequence == p, and holds the entry for
+// position p when sequence == p + 1. The consumer hands it back for the next
+// lap by storing p + DEFERRED_LOG_CAPACITY.
+
+DeferredLogRing::DeferredLogRing() : head(0), tail(0), reported_drops(0),
+                                     written(0), dropped(0), drained(0) {
+  static_assert((DEFERRED_LOG_CAPACITY & (DEFERRED_LOG_CAPACITY - 1)) == 0,
+                "DEFERRED_LOG_CAPACITY must be a power of two");
+  for (uint32_t i = 0; i < DEFERRED_LOG_CAPACITY; i++) {
+    slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+bool DeferredLogRing::push(uint8_t id, uint32_t timestamp_us, const DeferredLogArg* args, uint8_t num_args) {
+  uint32_t pos = head.load(std::memory_order_relaxed);
+  Slot* slot;
+
+  for (;;) {
+    slot = &slots[pos & (DEFERRED_LOG_CAPACITY - 1)];
+    uint32_t seq = slot->sequence.load(std::memory_order_acquire);
+    int32_t diff = (int32_t)(seq - pos);
+
+    if (diff == 0) {
+      // Slot is free - reserve it (another producer may win, then retry)
+      if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // Consumer has not freed this slot yet: ring full, never wait
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      pos = head.load(std::memory_order_relaxed);
+    }
+  }
+
+  if (num_args > DEFERRED_LOG_MAX_ARGS) {
+    num_args = DEFERRED_LOG_MAX_ARGS;
+  }
+  slot->entry.timestamp_us = timestamp_us;
+  slot->entry.id = id;
+  slot->entry.num_args = num_args;
+  memcpy(slot->entry.args, args, num_args * sizeof(DeferredLogArg));
+
+  slot->sequence.store(pos + 1, std::memory_order_release);
+  written.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool DeferredLogRing::pop(DeferredLogEntry& entry) {
+  Slot* slot = &slots[tail & (DEFERRED_LOG_CAPACITY - 1)];
+  if (slot->sequence.load(std::memory_order_acquire) != tail + 1) {
+    return false;  // Empty, or the producer is still filling this slot
+  }
+
+  entry = slot->entry;
+  slot->sequence.store(tail + DEFERRED_LOG_CAPACITY, std::memory_order_release);
+  tail++;
+  drained.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+DeferredLogStats DeferredLogRing::stats() const {
+  DeferredLogStats s;
+  s.written = written.load(std::memory_order_relaxed);
+  s.dropped = dropped.load(std::memory_order_relaxed);
+  s.drained = drained.load(std::memory_order_relaxed);
+  return s;
+}
+
+uint32_t DeferredLogRing::takeNewDrops() {
+  uint32_t total = dropped.load(std::memory_order_relaxed);
+  uint32_t new_drops = total - reported_drops;
+  reported_drops = total;
+  return new_drops;
+}
+
+// =============================================================================
+// FORMATTING (drain task)
+// =============================================================================
+
+// Append one conversion ("%-8.2f" etc.) using the matching union member
+static size_t appendConversion(char* out, size_t room, const char* spec, size_t spec_len,
+                               const DeferredLogArg& arg) {
+  char fmt[16];
+  if (spec_len >= sizeof(fmt)) {
+    return 0;
+  }
+  memcpy(fmt, spec, spec_len);
+  fmt[spec_len] = '\0';
+
+  char conversion = fmt[spec_len - 1];
+  bool is_long = memchr(fmt, 'l', spec_len) != NULL;
+  int n = 0;
+
+  switch (conversion) {
+    case 'd':
+    case 'i':
+      n = is_long ? snprintf(out, room, fmt, (long)arg.i) : snprintf(out, room, fmt, (int)arg.i);
+      break;
+    case 'u':
+    case 'x':
+    case 'X':
+      n = is_long ? snprintf(out, room, fmt, (unsigned long)arg.u) : snprintf(out, room, fmt, (unsigned int)arg.u);
+      break;
+    case 'f':
+    case 'e':
+    case 'g':
+      n = snprintf(out, room, fmt, (double)arg.f);
+      break;
+    case 'c':
+      n = snprintf(out, room, fmt, (int)arg.i);
+      break;
+    case 's':
+      n = snprintf(out, room, fmt, arg.s != NULL ? arg.s : "(null)");
+      break;
+    default:
+      return 0;
+  }
+
+  if (n < 0) {
+    return 0;
+  }
+  return (size_t)n < room ? (size_t)n : room - 1;
+}
+
+size_t formatDeferredLogEntry(const DeferredLogEntry& entry, char* buffer, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  if (entry.id >= NUM_DEFERRED_LOG_IDS) {
+    snprintf(buffer, size, "[LOG] Unknown format ID %u", (unsigned int)entry.id);
+    return strlen(buffer);
+  }
+
+  const char* p = DEFERRED_LOG_FORMATS[entry.id].format;
+  size_t len = 0;
+  uint8_t arg_index = 0;
+
+  while (*p != '\0' && len < size - 1) {
+    if (*p != '%') {
+      buffer[len++] = *p++;
+      continue;
+    }
+    if (p[1] == '%') {
+      buffer[len++] = '%';
+      p += 2;
+      continue;
+    }
+
+    // Conversion spec: flags, width, precision, length, conversion character
+    const char* spec = p++;
+    while (*p != '\0' && strchr("-+ #0123456789.l", *p) != NULL) {
+      p++;
+    }
+    if (*p == '\0') {
+      break;
+    }
+    p++;
+
+    if (arg_index < entry.num_args) {
+      len += appendConversion(buffer + len, size - len, spec, (size_t)(p - spec), entry.args[arg_index]);
+    }
+    arg_index++;
+  }
+
+  buffer[len] = '\0';
+  return len;
+}
+
+size_t drainDeferredLog(DeferredLogRing& ring, Print& out, size_t max_entries) {
+  char line[DEFERRED_LOG_LINE_MAX];
+  DeferredLogEntry entry;
+  size_t count = 0;
+
+  while (count < max_entries && ring.pop(entry)) {
+    formatDeferredLogEntry(entry, line, sizeof(line));
+    out.println(line);
+    if (entry.id < NUM_DEFERRED_LOG_IDS && DEFERRED_LOG_FORMATS[entry.id].web_log) {
+      addLogMessage(line);
+    }
+    count++;
+  }
+
+  uint32_t new_drops = ring.takeNewDrops();
+  if (new_drops > 0) {
+    out.printf("[LOG] %lu log entries dropped (ring full)\n", (unsigned long)new_drops);
+  }
+
+  return count;
+}
+
+// =============================================================================
+// DRAIN TASK (Core 1, lowest priority - only runs when nothing else needs the CPU)
+// =============================================================================
+
+void logDrainTask(void *pvParameters) {
+  (void)pvParameters;   // Created with NULL, drains the global ring
+  for (;;) {
+    drainDeferredLog(deferredLogRing, Serial, DEFERRED_LOG_CAPACITY);
+    vTaskDelay(pdMS_TO_TICKS(DEFERRED_LOG_DRAIN_MS));
+  }
+}
+
+void setupDeferredLog() {
+  BaseType_t result = xTaskCreatePinnedToCore(
+    logDrainTask,         // Task function
+    "LogDrainTask",       // Task name
+    4096,                 // Stack size (snprintf with floats)
+    NULL,                 // Parameter
+    1,                    // Priority (LOWEST - below VESC, same as WiFi/BLE)
+    &logDrainTaskHandle,  // Task handle
+    1                     // Core 1
+  );
+
+  if (result != pdPASS || logDrainTaskHandle == NULL) {
+    Serial.println("ERROR: Failed to create log drain task - hot path log lines are discarded");
+  }
+}
@@ -1,4 +1,12 @@
 #include "ebike_controller.h"
+#include "pas_counter.h"
+#include "torque_adc.h"
+#include "torque_zero.h"
+#include "torque_calibration.h"
+#include "current_shaper.h"
+#include "current_tracking.h"
+#include "thermal_derating.h"
+#include "battery_model.h"
 
 // =============================================================================
 // INITIALIZATION
@@ -20,9 +28,25 @@ void ebike_setup() {
   pinMode(PAS_PIN_A, INPUT_PULLUP);
   pinMode(PAS_PIN_B, INPUT_PULLUP);
   
-  // Enable hardware interrupts for PAS sensors
-  attachInterrupt(digitalPinToInterrupt(PAS_PIN_A), pas_interrupt_handler, CHANGE);
-  attachInterrupt(digitalPinToInterrupt(PAS_PIN_B), pas_interrupt_handler, CHANGE);
+  // PAS counting: pulse counter unit, GPIO interrupts if it cannot be set up
+  if (!select_pas_counter(pasCounter)) {
+    Serial.println("PAS: PCNT unavailable - counting with GPIO interrupts");
+    select_pas_counter(&pasGpioCounter);
+  }
+  
+  // Torque sensor: continuous DMA sampling, single reads if it cannot be set up
+  if (!torque_adc_begin()) {
+    Serial.println("Torque: ADC DMA unavailable - single reads per cycle");
+  }
+  torque_zero_begin();
+  torque_calibration_begin();
+  
+  // Motor command starts at 0 (the shaper configuration is kept), nothing
+  // learned about the motor and battery yet
+  current_shaper_reset();
+  current_tracking_reset();
+  thermal_derating_reset();
+  battery_model_reset();
   
   // Set initial values
   last_loop_time = millis();
@@ -0,0 +1,24 @@
+#include "log_messages.h"
+
+// Log messages storage (thread-safe with mutex)
+SemaphoreHandle_t logMutex = NULL;
+String logMessages[MAX_LOG_MESSAGES];
+int logMessageCount = 0;
+int logMessageIndex = 0;
+
+// Add log message (thread-safe)
+void addLogMessage(const String& message) {
+  if (logMutex != NULL && xSemaphoreTake(logMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+    // Circular buffer für Log-Nachrichten
+    logMessages[logMessageIndex] = String(millis()) + ": " + message;
+    logMessageIndex = (logMessageIndex + 1) % MAX_LOG_MESSAGES;
+    if (logMessageCount < MAX_LOG_MESSAGES) {
+      logMessageCount++;
+    }
+    xSemaphoreGive(logMutex);
+  }
+}
+
+void addLogMessage(const char* message) {
+  addLogMessage(String(message));
+}
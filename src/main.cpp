@@ -18,8 +18,10 @@
   - Light control
   - Multi-Core Architecture with FreeRTOS
     - Core 0: Sensor Processing (PAS, Torque, Calculations) - HIGH PRIORITY
-    - Core 1: VESC Communication (UART) - LOWER PRIORITY
-    - Semaphore-based data synchronization
+    - Core 1: VESC Communication (UART) - woken by every new target current,
+      non-blocking frame parser for telemetry
+    - Lock-free seqlock snapshots for shared sensor/VESC data
+    - Deferred binary logging: the control tasks never call Serial.printf
   
   Hardware:
   - ESP32 DevKit v1 (3.3V Logic, Dual Core)
@@ -36,6 +38,12 @@
 #include <VescUart.h>
 #include "ebike_controller.h"
 
+// Hot-path log lines are formatted and printed by logDrainTask
+#include "deferred_log.h"
+
+// Run time / wake-up jitter histograms (/api/perf)
+#include "task_perf.h"
+
 // WiFi Web Interface Integration
 #include "wifi_telemetry.h"
 
@@ -47,6 +55,7 @@
   #include "freertos/FreeRTOS.h"
   #include "freertos/task.h"
   #include "freertos/semphr.h"
+  #include "freertos/queue.h"
 #endif
 
 // =============================================================================
@@ -57,21 +66,12 @@
 TaskHandle_t sensorTaskHandle = NULL;
 TaskHandle_t vescTaskHandle = NULL;
 
-// Semaphores for thread-safe data sharing
-SemaphoreHandle_t dataUpdateSemaphore = NULL;
-SemaphoreHandle_t motorCommandSemaphore = NULL;
+// Motor command mailbox (sensorTask -> vescTask)
+QueueHandle_t motorCommandQueue = NULL;
 
-// Shared data structure instances (defined in header, instantiated here)
-SharedSensorData sharedSensorData;
-SharedVescData sharedVescData;
-SharedMotorCommand sharedMotorCommand;
-
-// =============================================================================
-// VESC UART COMMUNICATION (Hardware Serial for ESP32)
-// =============================================================================
-
-/** VESC UART communication object */
-VescUart vescUart;
+// Shared snapshots and the VescUart object live in config.cpp so the modules
+// also link without main.cpp (host build, [env:test])
+extern VescUart vescUart;
 
 // =============================================================================
 // FREERTOS TASK FUNCTIONS
@@ -90,101 +90,31 @@ void sensorTask(void *pvParameters) {
   
   Serial.println("Sensor Task started on Core 0");
   
-  // Add periodic status output for debugging
-  unsigned long last_status = 0;
+  taskPerfRegister(TASK_PERF_SENSOR, "sensor", 10000, 10000);
   
   for (;;) {
-    // -------------------------------------------------------------------------
-    // HIGH-FREQUENCY SENSOR PROCESSING (Core 0)
-    // -------------------------------------------------------------------------
-    
-    // 0. Update debug simulation if enabled (must be called first)
-    if (debug_mode) {
-      update_debug_simulation();
-    }
-    
-    // Debug output every 2 seconds
-    if (millis() - last_status > 2000) {
-      Serial.printf("[SENSOR] Task alive - Cadence: %.1f RPM, Torque: %.1f Nm (Raw: %d), Mode: %d, Motor: %s\n", 
-                   current_cadence_rpm, filtered_torque, raw_torque_value, current_mode, motor_enabled ? "ON" : "OFF");
-      last_status = millis();
-    }
-    
-    // 1. Read PAS sensors (interrupt-based, very fast)
-    read_pas_sensors();
-    
-    // Special PAS debug output when pedaling is detected
-    static float last_cadence = 0.0;
-    static unsigned long last_pas_debug = 0;
-    
-    // Output PAS info when cadence changes significantly or periodically
-    if (abs(current_cadence_rpm - last_cadence) > 2.0 || 
-        (current_cadence_rpm > 0 && millis() - last_pas_debug > 1000)) {
-      if (current_cadence_rpm > 0) {
-        Serial.printf("[PAS] Pedaling detected! Cadence: %.1f RPM, Direction: %s, Position: %d\n",
-                     current_cadence_rpm, 
-                     pedal_direction == 1 ? "FORWARD" : (pedal_direction == -1 ? "REVERSE" : "STOPPED"),
-                     pos);
-        last_pas_debug = millis();
-        last_cadence = current_cadence_rpm;
-      }
-    } else if (current_cadence_rpm == 0 && last_cadence > 0) {
-      Serial.println("[PAS] Pedaling stopped");
-      last_cadence = 0.0;
-    }
-    
-    // 2. Update cadence calculation
-    update_cadence();
-    
-    // 3. Read and filter torque sensor
-    update_torque();
-    
-    // 4. Mode management (reverse pedaling detection)
-    update_mode_selection();
+    taskPerfBeginPeriodic(TASK_PERF_SENSOR);
     
-    // 5. Get current speed from VESC data (thread-safe)
-    float current_speed = 0.0;
-    bool speed_valid = false;
-    if (xSemaphoreTake(dataUpdateSemaphore, pdMS_TO_TICKS(5)) == pdTRUE) {
-      current_speed = sharedVescData.speed_kmh;
-      speed_valid = sharedVescData.data_valid;
-      xSemaphoreGive(dataUpdateSemaphore);
-    }
-    
-    // 6. Calculate assist power with current speed
-    current_speed_kmh = current_speed;
-    vesc_data_valid = speed_valid;
-    calculate_assist_power();
+    // Steps 0-8 (PAS, torque, mode, assist, safety, publish) - control_cycle.cpp
+    SharedMotorCommand command = run_sensor_cycle();
     
-    // 7. Motor status and safety checks
-    update_motor_status();
+    // 10. Hand the motor command to vescTask (overwrites the mailbox,
+    //     never blocks - vescTask wakes up immediately on Core 1)
+    command.queued_time_us = micros();
+    xQueueOverwrite(motorCommandQueue, &command);
     
-    // 8. Update shared sensor data (thread-safe)
-    if (xSemaphoreTake(dataUpdateSemaphore, pdMS_TO_TICKS(10)) == pdTRUE) {
-      sharedSensorData.cadence_rpm = current_cadence_rpm;
-      sharedSensorData.cadence_rps = current_cadence_rps;
-      sharedSensorData.torque_nm = crank_torque_nm;
-      sharedSensorData.filtered_torque = filtered_torque;
-      sharedSensorData.current_mode = current_mode;
-      sharedSensorData.motor_enabled = motor_enabled;
-      sharedSensorData.last_update = millis();
-      xSemaphoreGive(dataUpdateSemaphore);
-    }
-    
-    // 10. Send motor command (thread-safe)
-    if (xSemaphoreTake(motorCommandSemaphore, pdMS_TO_TICKS(5)) == pdTRUE) {
-      sharedMotorCommand.target_current = target_current_amps;
-      sharedMotorCommand.command_ready = true;
-      sharedMotorCommand.timestamp = millis();
-      xSemaphoreGive(motorCommandSemaphore);
-    }
+    taskPerfEnd(TASK_PERF_SENSOR);
     
     // Precise timing (100Hz)
     vTaskDelayUntil(&xLastWakeTime, xFrequency);
   }
 }
 
-// CORE 1: VESC Communication Task (LOWER PRIORITY)
+// CORE 1: VESC Communication Task (HIGHEST PRIORITY on Core 1)
+// Single owner of the VESC UART. Sleeps on the command mailbox, so a new
+// target current goes out as soon as sensorTask hands it over, and wakes at
+// least every VESC_UART_POLL_MS to feed received bytes through the
+// non-blocking VescUart frame parser. Nothing in this loop waits for the VESC.
 void vescTask(void *pvParameters) {
   // Delay to ensure Serial is ready
   vTaskDelay(pdMS_TO_TICKS(200));
@@ -192,69 +122,27 @@ void vescTask(void *pvParameters) {
   Serial.println("=== VESC TASK STARTING ===");
   Serial.printf("VESC Task running on Core: %d\n", xPortGetCoreID());
   
-  TickType_t xLastWakeTime = xTaskGetTickCount();
-  const TickType_t xFrequency = pdMS_TO_TICKS(50); // 20Hz update rate (less critical)
+  const TickType_t xPollInterval = pdMS_TO_TICKS(VESC_UART_POLL_MS);
   
   Serial.println("VESC Task started on Core 1");
   
-  // Add periodic status output for debugging
-  unsigned long last_status = 0;
+  // Event-driven: deadline = the next poll, measured from the mailbox write
+  taskPerfRegister(TASK_PERF_VESC, "vesc", 0, VESC_UART_POLL_MS * 1000UL);
   
   for (;;) {
-    // -------------------------------------------------------------------------
-    // VESC COMMUNICATION (Core 1) - Can block without affecting sensors
-    // -------------------------------------------------------------------------
-    
-    // Debug output every 3 seconds
-    if (millis() - last_status > 3000) {
-      Serial.printf("[VESC] Task alive - Speed: %.1f km/h, Data valid: %s, Loop count: %d, Battery: %.1fV (%.0f%%)\n", 
-                   current_speed_kmh, vesc_data_valid ? "YES" : "NO", loopCounter, battery_voltage, battery_percentage);
-      last_status = millis();
-    }
+    // 1. Motor command from sensorTask (wakes immediately, else poll timeout)
+    SharedMotorCommand command;
+    uint32_t wait_start_us = micros();
+    bool has_command = xQueueReceive(motorCommandQueue, &command, xPollInterval) == pdTRUE;
     
-    // 1. Query VESC data (speed, telemetry) - BLOCKING operation
-    update_vesc_data();  // This can take 50ms without affecting Core 0!
+    // Released by the mailbox write, or by the end of the poll timeout
+    taskPerfBegin(TASK_PERF_VESC, has_command ? command.queued_time_us
+                                              : wait_start_us + VESC_UART_POLL_MS * 1000UL);
     
-    // 2. Update shared VESC data (thread-safe)
-    if (xSemaphoreTake(dataUpdateSemaphore, pdMS_TO_TICKS(20)) == pdTRUE) {
-      sharedVescData.speed_kmh = current_speed_kmh;
-      sharedVescData.data_valid = vesc_data_valid;
-      sharedVescData.actual_current = actual_current_amps;
-      sharedVescData.battery_voltage = battery_voltage;
-      sharedVescData.battery_percentage = battery_percentage;
-      sharedVescData.last_update = millis();
-      xSemaphoreGive(dataUpdateSemaphore);
-    }
+    // 2.-4. Send it, drain UART RX, housekeeping - control_cycle.cpp
+    run_vesc_cycle(has_command ? &command : NULL);
     
-    // 3. Send motor command if ready (thread-safe)
-    if (xSemaphoreTake(motorCommandSemaphore, pdMS_TO_TICKS(10)) == pdTRUE) {
-      if (sharedMotorCommand.command_ready) {
-        float command_current = sharedMotorCommand.target_current;
-        
-        // Send command to VESC (BLOCKING operation)
-        if (motor_enabled) {
-          vescUart.setCurrent(command_current);
-        } else {
-          vescUart.setCurrent(0.0);
-        }
-        
-        sharedMotorCommand.command_ready = false;
-      }
-      xSemaphoreGive(motorCommandSemaphore);
-    }
-    
-    // 4. Debug output (low frequency to avoid spam)
-    static unsigned long last_debug = 0;
-    if (millis() - last_debug > 500) {  // Every 500ms
-      print_debug_info();
-      last_debug = millis();
-    }
-    
-    // Update loop counter for compatibility
-    loopCounter++;
-    
-    // Lower frequency for VESC communication (20Hz)
-    vTaskDelayUntil(&xLastWakeTime, xFrequency);
+    taskPerfEnd(TASK_PERF_VESC);
   }
 }
 
@@ -268,7 +156,7 @@ void setup() {
   Serial.println("Starting Multi-Core E-Bike Controller (ESP32 DevKit v1)...");
   Serial.println("Architecture: FreeRTOS Dual-Core");
   Serial.println("  - Core 0: Sensor Processing (HIGH PRIORITY, 100Hz)");
-  Serial.println("  - Core 1: VESC Communication (LOWER PRIORITY, 20Hz)");
+  Serial.println("  - Core 1: VESC Communication (event-driven commands, non-blocking telemetry)");
   
   // Initialize VESC Hardware Serial connection on ESP32
   // ESP32 has multiple hardware UARTs - using UART2
@@ -282,24 +170,19 @@ void setup() {
   ebike_setup();
   Serial.println("ebike_setup() completed successfully");
   
-  // Create FreeRTOS semaphores for thread-safe data sharing
-  Serial.println("Creating semaphores...");
-  dataUpdateSemaphore = xSemaphoreCreateMutex();
-  motorCommandSemaphore = xSemaphoreCreateMutex();
+  // Create the motor command mailbox (sensor/VESC data use lock-free
+  // seqlock snapshots and need no semaphore)
+  Serial.println("Creating motor command queue...");
+  motorCommandQueue = xQueueCreate(1, sizeof(SharedMotorCommand));
   
-  if (dataUpdateSemaphore == NULL || motorCommandSemaphore == NULL) {
-    Serial.println("ERROR: Failed to create semaphores!");
+  if (motorCommandQueue == NULL) {
+    Serial.println("ERROR: Failed to create motor command queue!");
     while (1) {
       delay(1000);
     }
   }
   
-  // Initialize shared data
-  memset(&sharedSensorData, 0, sizeof(sharedSensorData));
-  memset(&sharedVescData, 0, sizeof(sharedVescData));
-  memset(&sharedMotorCommand, 0, sizeof(sharedMotorCommand));
-  
-  Serial.println("Semaphores created successfully");
+  Serial.println("Motor command queue created successfully");
   
   // Create FreeRTOS tasks on specific cores
   Serial.println("Creating FreeRTOS tasks...");
@@ -315,13 +198,15 @@ void setup() {
     0                     // Core 0
   );
   
-  // CORE 1: VESC communication (LOWER PRIORITY)
+  // CORE 1: VESC communication (HIGHEST PRIORITY on Core 1 - preempts WiFi
+  // and BLE as soon as a new motor command arrives; it never blocks on the
+  // VESC, so the short bursts don't starve them)
   BaseType_t vescTaskResult = xTaskCreatePinnedToCore(
     vescTask,             // Task function
     "VescTask",           // Task name
     4096,                 // Stack size
     NULL,                 // Parameter
-    1,                    // Priority (LOWER)
+    3,                    // Priority (HIGHEST on Core 1)
     &vescTaskHandle,      // Task handle
     1                     // Core 1
   );
@@ -337,6 +222,10 @@ void setup() {
     }
   }
   
+  // CORE 1: Log drain task (LOWEST PRIORITY - formats the deferred log lines
+  // of sensorTask/vescTask and writes them to Serial)
+  setupDeferredLog();
+  
   // *** WiFi Web Interface Integration ***
   if (enable_wifi_telemetry) {
     Serial.println("Setting up WiFi Web Interface...");
@@ -1,7 +1,7 @@
 #include "ebike_controller.h"
 
-// WiFi Logging Integration
-#include "wifi_telemetry.h"
+// Logging from sensorTask (formatted by logDrainTask, also forwarded to the web log)
+#include "deferred_log.h"
 
 // =============================================================================
 // MODE SWITCHING
@@ -25,13 +25,8 @@ void update_mode_selection() {
       current_mode = new_mode;
       mode_switched_this_session = true;  // Mark as switched
       
-      Serial.print("MODE CHANGED: ");
-      Serial.print(current_mode);
-      Serial.print(" (Reverse steps: ");
-      Serial.print(-pos);
-      Serial.println(")");
-      
-      addLogMessage("Mode switched to: " + String(current_mode) + " (Reverse steps: " + String(-pos) + ")");
+      // sensorTask: deferred, logDrainTask prints it and adds it to the web log
+      logDeferred(LOG_MODE_CHANGED, current_mode, -pos);
     }
   } else {
     // Position reset (=0) - reset session flag for next cycle
@@ -50,18 +45,14 @@ void update_mode_selection() {
 // Mode change function for external interfaces (WiFi, BLE)
 void changeAssistMode(int new_mode) {
   if (new_mode >= 0 && new_mode < NUM_ACTIVE_PROFILES) {
-    // Update shared sensor data (thread-safe)
-    if (xSemaphoreTake(dataUpdateSemaphore, pdMS_TO_TICKS(100)) == pdTRUE) {
-      sharedSensorData.current_mode = new_mode;
-      current_mode = new_mode;  // Also update global variable for compatibility
-      
-      // Set light according to new mode
-      lightOn = AVAILABLE_PROFILES[new_mode].hasLight;
-      digitalWrite(LIGHT_PIN, lightOn ? HIGH : LOW);
-      
-      xSemaphoreGive(dataUpdateSemaphore);
-      
-      Serial.printf("External mode change to: %d (%s)\n", new_mode, AVAILABLE_PROFILES[new_mode].name);
-    }
+    // Only sensorTask publishes sharedSensorData (single-writer seqlock).
+    // Set the mode here; the next 10ms sensor tick publishes it.
+    current_mode = new_mode;
+    
+    // Set light according to new mode
+    lightOn = AVAILABLE_PROFILES[new_mode].hasLight;
+    digitalWrite(LIGHT_PIN, lightOn ? HIGH : LOW);
+    
+    Serial.printf("External mode change to: %d (%s)\n", new_mode, AVAILABLE_PROFILES[new_mode].name);
   }
 }
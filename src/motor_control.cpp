@@ -1,8 +1,9 @@
 #include "ebike_controller.h"
+#include "torque_zero.h"
 #include <VescUart.h>
 
-// WiFi Logging Integration
-#include "wifi_telemetry.h"
+// Hot-path logging (formatted by logDrainTask, also forwarded to the web log)
+#include "deferred_log.h"
 
 // ESP32 FreeRTOS Includes für Semaphore-Funktionen
 #ifdef ESP32
@@ -35,36 +36,46 @@ void update_motor_status() {
   bool forward_pedaling = pedal_direction > 0; // Only forward pedaling
   
   // Additional safety: Check VESC data freshness in multi-core environment
-  bool vesc_data_fresh = true;
-  if (xSemaphoreTake(dataUpdateSemaphore, pdMS_TO_TICKS(1)) == pdTRUE) {
-    vesc_data_fresh = (now - sharedVescData.last_update) < 1000; // VESC data less than 1s old
-    xSemaphoreGive(dataUpdateSemaphore);
-  }
+  // (lock-free snapshot read - never waits on the VESC/web/BLE tasks)
+  bool vesc_data_fresh = (now - sharedVescData.read().last_update) < 1000; // VESC data less than 1s old
   
   // DEBUG: Log all conditions periodically
   static unsigned long last_motor_debug = 0;
   if (now - last_motor_debug > 1000) { // Every 1 second
-    Serial.printf("MOTOR DEBUG - PAS:%s Torque:%s(%.1f) Cadence:%s(%.1f) Mode:%s(%d) Dir:%s VescFresh:%s\n", 
-                  pas_active ? "OK" : "NO", 
-                  torque_present ? "OK" : "NO", filtered_torque,
-                  cadence_valid ? "OK" : "NO", current_cadence_rpm,
-                  mode_allows_assist ? "OK" : "NO", current_mode,
-                  forward_pedaling ? "FWD" : "STOP",
-                  vesc_data_fresh ? "YES" : "NO");
+    logDeferred(LOG_MOTOR_DEBUG,
+                pas_active ? "OK" : "NO",
+                torque_present ? "OK" : "NO", filtered_torque,
+                cadence_valid ? "OK" : "NO", current_cadence_rpm,
+                mode_allows_assist ? "OK" : "NO", current_mode,
+                forward_pedaling ? "FWD" : "STOP",
+                vesc_data_fresh ? "YES" : "NO");
     last_motor_debug = now;
   }
   
   motor_enabled = pas_active && torque_present && cadence_valid && 
                  mode_allows_assist && forward_pedaling && vesc_data_fresh;
   
-  // Additional safety checks
+  // Rider stopped or reversed the crank, no usable VESC data: the command
+  // drops to 0 at once (see also the checks below). Only a fading torque
+  // ramps the assist down.
+  motor_cut = !(pas_active && cadence_valid && mode_allows_assist && forward_pedaling && vesc_data_fresh);
+  
+  // Additional safety checks (logged once when the condition starts, not every tick)
+  static bool excessive_cadence_logged = false;
   if (current_cadence_rpm > 250.0) {  // Over 250 RPM = unrealistic
     motor_enabled = false;
-    Serial.println("MOTOR: Disabled due to excessive cadence");
-    addLogMessage("WARNING: Motor stopped - excessive cadence (" + String(current_cadence_rpm) + " RPM)");
+    motor_cut = true;
+    if (!excessive_cadence_logged) {
+      logDeferred(LOG_MOTOR_EXCESSIVE_CADENCE, current_cadence_rpm);
+      excessive_cadence_logged = true;
+    }
+  } else {
+    excessive_cadence_logged = false;
   }
   
-  if (abs(raw_torque_value - TORQUE_STANDSTILL) < TORQUE_THRESHOLD) {  // No torque detected
+  // No torque detected: deviation from the learned zero (update_torque()
+  // measures from there too, not from the factory TORQUE_STANDSTILL)
+  if (fabsf(raw_torque_value - torque_zero_counts()) < TORQUE_THRESHOLD) {
     motor_enabled = false;
     // if (now - last_motor_debug < 100) { // Only log occasionally
     // Serial.printf("MOTOR: Disabled - torque below threshold (Raw: %d, Standstill: %d, Threshold: %d)\n", 
@@ -74,51 +85,61 @@ void update_motor_status() {
   }
 
   // Emergency stop on excessive speed
+  static bool overspeed_logged = false;
   if (current_speed_kmh > 45.0) {
     motor_enabled = false;
+    motor_cut = true;
     target_current_amps = 0.0;
-    Serial.println("EMERGENCY: Speed limit exceeded - motor disabled!");
-    addLogMessage("EMERGENCY: Speed limit exceeded (" + String(current_speed_kmh) + " km/h) - motor stopped!");
+    if (!overspeed_logged) {
+      logDeferred(LOG_MOTOR_SPEED_EMERGENCY, current_speed_kmh);
+      overspeed_logged = true;
+    }
+  } else {
+    overspeed_logged = false;
   }
 
 }
 
 // =============================================================================
-// VESC MOTOR COMMAND - Thread-Safe
+// VESC MOTOR COMMAND - vescTask only (single owner of the UART)
 // =============================================================================
 
-void send_motor_command() {
-  // This function is now called from the VESC task (Core 1)
-  // It reads the motor command from shared data and sends it to VESC
+void send_motor_command(const SharedMotorCommand& command) {
+  // Called by vescTask as soon as sensorTask hands over a new command. The
+  // GET_VALUES answer is parsed asynchronously, so SET_CURRENT goes out even
+  // while a telemetry request is still in flight.
   
   static float last_sent_current = -1.0;
-  static unsigned long last_vesc_debug = 0;
-  float current_to_send = 0.0;
-  
-  if (motor_enabled) {
-    current_to_send = target_current_amps;
-  } else {
-    current_to_send = 0.0;
-  }
+  static unsigned long last_send_time = 0;
+  static MotorCommandLatency latency = {};
   
-  // DEBUG: Always log VESC commands for debugging
+  // Skip unchanged currents, but keep the VESC timeout alive
   unsigned long now = millis();
-  if (now - last_vesc_debug > 500) { // Every 500ms
-    Serial.printf("VESC SEND - Motor:%s Target:%.2fA Current:%.2fA Human:%.0fW Assist:%.0fW Factor:%.2f\n", 
-                  motor_enabled ? "ON" : "OFF", 
-                  target_current_amps, current_to_send,
-                  human_power_watts, assist_power_watts, dynamic_assist_factor);
-    last_vesc_debug = now;
+  bool changed = fabs(command.target_current - last_sent_current) > MOTOR_COMMAND_DEADBAND_A;
+  if (!changed && now - last_send_time < MOTOR_COMMAND_KEEPALIVE_MS) {
+    return;
   }
   
-  // Only send command if current changed significantly (reduces UART traffic)
-  if (abs(current_to_send - last_sent_current) > 0.1 || current_to_send == 0.0) {
-    vescUart.setCurrent(current_to_send);
-    last_sent_current = current_to_send;
-    
-    // Debug output for any command change
-    Serial.printf("VESC CMD SENT: %.2fA (Motor:%s, Mode:%d, Cadence:%.1f, Torque:%.1f)\n", 
-                 current_to_send, motor_enabled ? "ON" : "OFF", 
-                 current_mode, current_cadence_rpm, filtered_torque);
+  vescUart.setCurrent(command.target_current);
+  uint32_t sent_us = micros();
+  
+  last_sent_current = command.target_current;
+  last_send_time = now;
+  
+  // Record the latency actually achieved
+  latency.pedal_to_wire_us = sent_us - command.sample_time_us;
+  latency.queue_to_wire_us = sent_us - command.queued_time_us;
+  if (latency.pedal_to_wire_us > latency.pedal_to_wire_max_us) {
+    latency.pedal_to_wire_max_us = latency.pedal_to_wire_us;
+  }
+  if (latency.queue_to_wire_us > latency.queue_to_wire_max_us) {
+    latency.queue_to_wire_max_us = latency.queue_to_wire_us;
+  }
+  if (latency.commands_sent == 0) {
+    latency.pedal_to_wire_avg_us = latency.pedal_to_wire_us;
+  } else {
+    latency.pedal_to_wire_avg_us = latency.pedal_to_wire_avg_us * 0.95 + latency.pedal_to_wire_us * 0.05;
   }
+  latency.commands_sent++;
+  motorCommandLatency.publish(latency);
 }
@@ -0,0 +1,91 @@
+#include "motor_map.h"
+#include "motor_map_table.h"
+#include "ebike_controller.h"
+
+// =============================================================================
+// MOTOR MAP LOOKUP
+// =============================================================================
+
+#define MOTOR_MAP_MAX_CURRENT  ((MOTOR_MAP_CURRENT_POINTS - 1) * MOTOR_MAP_CURRENT_STEP)
+
+// Grid cell and position in it (0..1, held at the axis ends)
+struct MapCell {
+  int i;           // Current row
+  int j;           // Speed column
+  float fi;
+  float fj;
+};
+
+static void locate_axis(float value, float step, int points, int& cell, float& fraction) {
+  float position = value / step;
+  if (!(position > 0.0f)) {            // Also NaN
+    cell = 0;
+    fraction = 0.0f;
+  } else if (position >= points - 1) {
+    cell = points - 2;
+    fraction = 1.0f;
+  } else {
+    cell = (int)position;
+    fraction = position - cell;
+  }
+}
+
+static MapCell locate(float current_a, float wheel_rpm) {
+  MapCell cell;
+  locate_axis(current_a, MOTOR_MAP_CURRENT_STEP, MOTOR_MAP_CURRENT_POINTS, cell.i, cell.fi);
+  locate_axis(wheel_rpm, MOTOR_MAP_RPM_STEP, MOTOR_MAP_RPM_POINTS, cell.j, cell.fj);
+  return cell;
+}
+
+// Row i interpolated over the speed
+static float row_value(const float (*table)[MOTOR_MAP_RPM_POINTS], int i, const MapCell& cell) {
+  return table[i][cell.j] + cell.fj * (table[i][cell.j + 1] - table[i][cell.j]);
+}
+
+static float bilinear(const float (*table)[MOTOR_MAP_RPM_POINTS], const MapCell& cell) {
+  float low = row_value(table, cell.i, cell);
+  float high = row_value(table, cell.i + 1, cell);
+  return low + cell.fi * (high - low);
+}
+
+float motor_map_kt(float current_a, float wheel_rpm) {
+  return bilinear(MOTOR_MAP_KT, locate(current_a, wheel_rpm));
+}
+
+float motor_map_efficiency(float current_a, float wheel_rpm) {
+  return bilinear(MOTOR_MAP_EFFICIENCY, locate(current_a, wheel_rpm));
+}
+
+float motor_map_torque(float current_a, float wheel_rpm) {
+  return motor_map_kt(current_a, wheel_rpm) * current_a;
+}
+
+float motor_map_current(float torque_nm, float wheel_rpm, int* iterations) {
+  if (iterations != nullptr) {
+    *iterations = 0;
+  }
+  if (!(torque_nm > 0.0f)) {
+    return 0.0f;
+  }
+
+  float current = min(torque_nm / (float)MOTOR_CONSTANT_KT, MOTOR_MAP_MAX_CURRENT);
+  for (int n = 0; n < MOTOR_MAP_MAX_ITERATIONS; n++) {
+    // T(I) = Kt(I) * I with Kt linear in I inside the cell:
+    // dT/dI = Kt + I * dKt/dI
+    MapCell cell = locate(current, wheel_rpm);
+    float kt_low = row_value(MOTOR_MAP_KT, cell.i, cell);
+    float kt_high = row_value(MOTOR_MAP_KT, cell.i + 1, cell);
+    float kt = kt_low + cell.fi * (kt_high - kt_low);
+    float slope = kt + current * (kt_high - kt_low) / MOTOR_MAP_CURRENT_STEP;
+
+    float step = (torque_nm - kt * current) / max(slope, MOTOR_MAP_MIN_SLOPE);
+    current = constrain(current + step, 0.0f, MOTOR_MAP_MAX_CURRENT);
+    if (iterations != nullptr) {
+      (*iterations)++;
+    }
+    if (fabsf(step) < MOTOR_MAP_TOLERANCE_A) {
+      break;
+    }
+  }
+  return current;
+}
@@ -0,0 +1,90 @@
+#include "ebike_controller.h"
+#include "pas_counter.h"
+
+// =============================================================================
+// GPIO PAS COUNTER - CHANGE interrupts on both pins, decoded in sensorTask
+// =============================================================================
+
+PasEdgeRing pasEdgeRing;
+PasGpioCounter pasGpioCounter;
+
+void IRAM_ATTR pas_interrupt_handler() {
+  // Interrupt Service Routine - must be very fast!
+  // IRAM_ATTR ensures this function runs from RAM for maximum speed
+  // Both pins share this handler: record when it ran and both levels, the
+  // decoding happens in sensorTask (PasGpioCounter::nextStep)
+  PasEdge edge;
+  edge.time_us = micros();
+  edge.levels = (digitalRead(PAS_PIN_A) << 1) | digitalRead(PAS_PIN_B);
+  pasEdgeRing.push(edge);
+}
+
+// Quadrature lookup table for direction:
+// [old_state][new_state] = direction (1=forward, -1=backward, 0=invalid)
+// State = A*2 + B
+static const int quadrature_table[4][4] = {
+  // new: 00  01  10  11
+  {  0,  1, -1,  0}, // old: 00
+  { -1,  0,  0,  1}, // old: 01
+  {  1,  0,  0, -1}, // old: 10
+  {  0, -1,  1,  0}  // old: 11
+};
+
+PasGpioCounter::PasGpioCounter() : decoded_position(0), lost_steps(0), ring_drops_seen(0) {
+}
+
+bool PasGpioCounter::begin() {
+  attachInterrupt(digitalPinToInterrupt(PAS_PIN_A), pas_interrupt_handler, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(PAS_PIN_B), pas_interrupt_handler, CHANGE);
+  return true;
+}
+
+void PasGpioCounter::end() {
+  detachInterrupt(digitalPinToInterrupt(PAS_PIN_A));
+  detachInterrupt(digitalPinToInterrupt(PAS_PIN_B));
+}
+
+void PasGpioCounter::reset() {
+  pasEdgeRing.clear();
+  ring_drops_seen = pasEdgeRing.dropped();
+  a = digitalRead(PAS_PIN_A);
+  b = digitalRead(PAS_PIN_B);
+  decoded_position = 0;
+}
+
+bool PasGpioCounter::nextStep(PasStep& step) {
+  PasEdge edge;
+  while (pasEdgeRing.pop(edge)) {
+    int old_state = (a << 1) | b;
+    int new_state = edge.levels & 3;
+    if (new_state == old_state) {
+      continue;  // Bounce that settled before the handler read the pins
+    }
+
+    a = (new_state >> 1) & 1;
+    b = new_state & 1;
+
+    int direction_change = quadrature_table[old_state][new_state];
+    if (direction_change == 0) {
+      pas_invalid_transitions++;  // Both pins changed: one edge was lost, direction unknown
+      lost_steps++;
+      continue;
+    }
+
+    decoded_position += direction_change;
+    step.time_us = edge.time_us;
+    step.position = decoded_position;
+    return true;
+  }
+
+  // Ring overflowed: the recorded levels no longer follow each other, the
+  // pins are the truth. Later edges decode against them again.
+  uint32_t drops = pasEdgeRing.dropped();
+  if (drops != ring_drops_seen) {
+    lost_steps += drops - ring_drops_seen;
+    ring_drops_seen = drops;
+    a = digitalRead(PAS_PIN_A);
+    b = digitalRead(PAS_PIN_B);
+  }
+  return false;
+}
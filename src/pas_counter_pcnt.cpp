@@ -0,0 +1,125 @@
+#include "ebike_controller.h"
+#include "pas_counter.h"
+#include "driver/pcnt.h"
+
+// =============================================================================
+// PCNT PAS COUNTER - hardware quadrature decoding, one interrupt per magnet
+// =============================================================================
+// Both channels of one unit form a 4x quadrature decoder (forward =
+// 00 -> 01 -> 11 -> 10, A << 1 | B):
+//   channel 0: edges on A, direction from B
+//   channel 1: edges on B, direction from A
+// The counter runs between -PAS_PCNT_STEP_EDGES and +PAS_PCNT_STEP_EDGES and
+// resets to 0 in hardware when it reaches either limit; the limit event
+// interrupt adds the limit to limit_position and captures the step.
+//
+// position() = limit_position + counter. A read that lands between the
+// hardware reset and the interrupt (a few us) returns the position of the
+// previous capture - read_pas_sensors() only trusts a read at the capture
+// position if it just decoded that capture.
+
+PasPcntCounter pasPcntCounter;
+
+static const pcnt_unit_t PAS_PCNT = (pcnt_unit_t)PAS_PCNT_UNIT;
+
+static void IRAM_ATTR pas_pcnt_interrupt_handler(void* arg) {
+  uint32_t status = 0;
+  pcnt_get_event_status(PAS_PCNT, &status);
+  static_cast<PasPcntCounter*>(arg)->onLimit(micros(), status);
+}
+
+PasPcntCounter::PasPcntCounter() : limit_position(0) {
+}
+
+void IRAM_ATTR PasPcntCounter::onLimit(uint32_t time_us, uint32_t status) {
+  int32_t position = limit_position.load(std::memory_order_relaxed);
+  if (status & PCNT_EVT_H_LIM) {
+    position += PAS_PCNT_STEP_EDGES;
+  } else if (status & PCNT_EVT_L_LIM) {
+    position -= PAS_PCNT_STEP_EDGES;
+  } else {
+    return;
+  }
+  limit_position.store(position, std::memory_order_release);
+
+  PasStep step;
+  step.time_us = time_us;
+  step.position = position;
+  step_ring.push(step);
+}
+
+bool PasPcntCounter::begin() {
+  pcnt_config_t channel_a = {};
+  channel_a.pulse_gpio_num = PAS_PIN_A;
+  channel_a.ctrl_gpio_num = PAS_PIN_B;
+  channel_a.lctrl_mode = PCNT_MODE_REVERSE;  // A falls while B low (10 -> 00): forward
+  channel_a.hctrl_mode = PCNT_MODE_KEEP;     // A rises while B high (01 -> 11): forward
+  channel_a.pos_mode = PCNT_COUNT_INC;
+  channel_a.neg_mode = PCNT_COUNT_DEC;
+  channel_a.counter_h_lim = PAS_PCNT_STEP_EDGES;
+  channel_a.counter_l_lim = -PAS_PCNT_STEP_EDGES;
+  channel_a.unit = PAS_PCNT;
+  channel_a.channel = PCNT_CHANNEL_0;
+
+  pcnt_config_t channel_b = channel_a;
+  channel_b.pulse_gpio_num = PAS_PIN_B;
+  channel_b.ctrl_gpio_num = PAS_PIN_A;
+  channel_b.pos_mode = PCNT_COUNT_DEC;       // B rises while A low (00 -> 01): forward
+  channel_b.neg_mode = PCNT_COUNT_INC;       // B falls while A high (11 -> 10): forward
+  channel_b.channel = PCNT_CHANNEL_1;
+
+  esp_err_t err = pcnt_unit_config(&channel_a);
+  if (err == ESP_OK) err = pcnt_unit_config(&channel_b);
+  if (err == ESP_OK) err = pcnt_set_filter_value(PAS_PCNT, PAS_PCNT_FILTER_CYCLES);
+  if (err == ESP_OK) err = pcnt_filter_enable(PAS_PCNT);
+  if (err == ESP_OK) err = pcnt_event_enable(PAS_PCNT, PCNT_EVT_H_LIM);
+  if (err == ESP_OK) err = pcnt_event_enable(PAS_PCNT, PCNT_EVT_L_LIM);
+  if (err == ESP_OK) err = pcnt_counter_pause(PAS_PCNT);
+  if (err == ESP_OK) err = pcnt_counter_clear(PAS_PCNT);
+  if (err == ESP_OK) {
+    err = pcnt_isr_service_install(0);
+    if (err == ESP_ERR_INVALID_STATE) err = ESP_OK;  // Already installed by an earlier begin()
+  }
+  if (err == ESP_OK) err = pcnt_isr_handler_add(PAS_PCNT, pas_pcnt_interrupt_handler, this);
+  if (err == ESP_OK) err = pcnt_intr_enable(PAS_PCNT);
+
+  if (err != ESP_OK) {
+    Serial.printf("PAS: PCNT setup failed (error %d)\n", (int)err);
+    return false;
+  }
+
+  limit_position.store(0, std::memory_order_relaxed);
+  step_ring.clear();
+  pcnt_counter_resume(PAS_PCNT);
+  return true;
+}
+
+void PasPcntCounter::end() {
+  pcnt_intr_disable(PAS_PCNT);
+  pcnt_isr_handler_remove(PAS_PCNT);
+  pcnt_counter_pause(PAS_PCNT);
+}
+
+void PasPcntCounter::reset() {
+  // Paused, no limit interrupt can change limit_position meanwhile
+  pcnt_counter_pause(PAS_PCNT);
+  pcnt_counter_clear(PAS_PCNT);
+  limit_position.store(0, std::memory_order_relaxed);
+  step_ring.clear();
+  pcnt_counter_resume(PAS_PCNT);
+}
+
+bool PasPcntCounter::nextStep(PasStep& step) {
+  return step_ring.pop(step);
+}
+
+int32_t PasPcntCounter::position() {
+  int32_t before, after;
+  int16_t count = 0;
+  do {
+    before = limit_position.load(std::memory_order_acquire);
+    pcnt_get_counter_value(PAS_PCNT, &count);
+    after = limit_position.load(std::memory_order_acquire);
+  } while (before != after);  // Limit interrupt in between
+  return before + count;
+}
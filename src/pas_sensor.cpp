@@ -1,4 +1,7 @@
 #include "ebike_controller.h"
+#include "deferred_log.h"
+#include "cadence_estimator.h"
+#include "pas_counter.h"
 #include <limits.h>
 
 // ESP32 FreeRTOS Includes
@@ -9,24 +12,28 @@
 #endif
 
 // =============================================================================
-// INTERRUPT HANDLER FOR PAS SENSORS - Multi-Core Optimized
+// PAS COUNTER SELECTION
 // =============================================================================
 
-void IRAM_ATTR pas_interrupt_handler() {
-  // Interrupt Service Routine - must be very fast!
-  // IRAM_ATTR ensures this function runs from RAM for maximum speed
-  static unsigned long last_time = 0;
-  unsigned long now = micros();  // micros() is safer in ISR than millis()
-  
-  // Debounce: Minimum 1500 microseconds (1.5ms) between interrupts
-  // Reduced from 2ms for better high-cadence response
-  if (now - last_time < 1500) {
-    return;
+PasCounter* pasCounter = &pasPcntCounter;
+
+// Cadence from the captured steps (sensorTask only)
+static CadenceEstimator cadenceEstimator;
+static uint32_t pas_poll_us = 0;     // micros() when read_pas_sensors() last polled the counter
+static uint32_t last_motion_us = 0;  // Last step, or poll that saw the position move past it
+static_assert(CADENCE_EDGES_PER_REV == PAS_PULSES_PER_REV * 4, "Cadence estimator expects 4 edges per PAS pulse");
+static_assert(PAS_PCNT_STEP_EDGES <= CADENCE_MAX_STEP_EDGES, "PCNT captures must be steps the cadence estimator follows");
+
+bool select_pas_counter(PasCounter* counter) {
+  if (!counter->begin()) {
+    return false;
   }
-  
-  last_time = now;
-  last_interrupt_time = now;  // Store for main loop
-  pas_interrupt_flag = true;  // Set flag for main loop
+  if (pasCounter != counter) {
+    pasCounter->end();
+    pasCounter = counter;
+  }
+  reset_pas_decoder();
+  return true;
 }
 
 // =============================================================================
@@ -54,28 +61,36 @@ void update_cadence() {
   
   // NORMAL MODE: Original sensor processing
   unsigned long now = millis();
-  
+
+  // Predictive stop: no edge for PAS_STOP_INTERVALS times the expected edge
+  // interval at the current cadence (~100ms at 60 RPM instead of waiting
+  // for PEDAL_TIMEOUT_MS). Until then an overdue edge caps the cadence.
+  // The PCNT counter captures one step per magnet; the position polled in
+  // between tells whether the crank still moved.
+  uint32_t expected_us = cadenceEstimator.expectedIntervalUs() / cadenceEstimator.lastStepEdges();
+  if (expected_us > 0) {
+    uint32_t since_motion_us = pas_poll_us - last_motion_us;
+    if (since_motion_us > PAS_STOP_INTERVALS * expected_us) {
+      current_cadence_rpm = 0.0;
+      current_cadence_rps = 0.0;
+      pedal_direction = 0;  // Standstill - assist off, a restart needs two forward edges
+      cadenceEstimator.breakSequence();
+    } else if (since_motion_us > expected_us) {
+      float bound_rpm = cadenceEstimator.cadenceRpm() * (float)expected_us / (float)since_motion_us;
+      if (bound_rpm < current_cadence_rpm) {
+        current_cadence_rpm = bound_rpm;
+        current_cadence_rps = current_cadence_rpm / 60.0;
+      }
+    }
+  }
+
   // Timeout check: If too long without pedals, set cadence to 0
   if (now - last_pulse_time > CADENCE_WINDOW_MS) {
     current_cadence_rpm = 0.0;
     current_cadence_rps = 0.0;
     pedal_direction = 0;  // Standstill
     pos = 0;  // Reset position on standstill
-    
-    // Reset interrupt timing as well
-    pas_interrupt_flag = false;
-    last_interrupt_time = 0;
-    return;
-  }
-  
-  // Additional smoothing: Gradual decay if no recent activity
-  if (now - last_pulse_time > CADENCE_WINDOW_MS / 2) {
-    // Gradually reduce cadence if no recent pulses
-    current_cadence_rpm *= 0.95;  // 5% decay per call
-    if (current_cadence_rpm < 1.0) {
-      current_cadence_rpm = 0.0;
-    }
-    current_cadence_rps = current_cadence_rpm / 60.0;
+    cadenceEstimator.breakSequence();
   }
 }
 
@@ -83,112 +98,151 @@ void update_cadence() {
 // PAS HALL SENSOR EVALUATION - Multi-Core Safe
 // =============================================================================
 
+// Decoder state (sensorTask only)
+static int32_t step_position = 0;   // Position of the last captured step
+static int32_t seen_position = 0;   // Position already counted into pos
+static uint32_t last_step_us = 0;
+static bool last_step_valid = false;
+static uint32_t lost_steps_seen = 0;
+
+static void set_cadence_from_estimator() {
+  float raw_cadence_rpm = cadenceEstimator.cadenceRpm();
+
+  // Plausibility check (3-200 RPM)
+  if (raw_cadence_rpm >= 3.0 && raw_cadence_rpm <= 200.0) {
+    current_cadence_rpm = raw_cadence_rpm;
+    current_cadence_rps = current_cadence_rpm / 60.0;
+  }
+}
+
+// Apply one captured step. step_ms is the step time on the millis() clock.
+static void decode_pas_step(const PasStep& step, unsigned long step_ms) {
+  int32_t moved = step.position - step_position;
+  step_position = step.position;
+  if (moved == 0) {
+    return;
+  }
+  int direction = moved > 0 ? 1 : -1;
+
+  uint32_t step_interval_us = step.time_us - last_step_us;
+  bool bounce = last_step_valid && direction != pedal_direction && pedal_direction != 0 &&
+                step_interval_us < PAS_BOUNCE_US;
+  last_step_us = step.time_us;
+  last_step_valid = true;
+  last_motion_us = step.time_us;
+  if (bounce) {
+    return;  // Keep direction and cadence of the real movement (pos still counts it)
+  }
+  pedal_direction = direction;  // 1=forward, -1=backward
+
+  // Cadence from the us step timestamps (sliding window, per-edge calibration).
+  // The position identifies the edge on the crank.
+  if (pedal_direction > 0) {  // Only during forward movement
+    if (cadenceEstimator.addForwardEdge(step.position, step.time_us)) {
+      set_cadence_from_estimator();
+    }
+  } else {
+    cadenceEstimator.breakSequence();
+  }
+
+  // Legacy pulse interval for compatibility (ring buffer)
+  if (last_pulse_time > 0) {
+    unsigned long interval = step_ms - last_pulse_time;
+    pulse_intervals[pulse_index] = interval;
+    pulse_index = (pulse_index + 1) % 4;  // Ring buffer with 4 entries
+  }
+
+  last_pulse_time = step_ms;
+  last_pedal_activity = step_ms;
+}
+
+// Position moved past the last captured step (PCNT counter between two
+// magnets): direction and activity at poll resolution. From standstill the
+// polled position also starts the cadence, so assist does not wait for two
+// magnets.
+static void decode_pas_motion(int32_t position, uint32_t now_us, unsigned long now_ms) {
+  int direction = position > step_position ? 1 : -1;
+  last_motion_us = now_us;
+  last_pulse_time = now_ms;
+  last_pedal_activity = now_ms;
+
+  if (direction != pedal_direction) {
+    pedal_direction = direction;
+    cadenceEstimator.breakSequence();
+  }
+  if (direction > 0 && cadenceEstimator.cadenceRpm() <= 0.0f) {
+    if (cadenceEstimator.addForwardEdge(position, now_us)) {
+      set_cadence_from_estimator();
+    }
+  }
+}
+
+void reset_pas_decoder() {
+  pasCounter->reset();
+  lost_steps_seen = pasCounter->lostSteps();
+  step_position = 0;
+  seen_position = 0;
+  pos = 0;
+  pedal_direction = 0;
+  last_pulse_time = 0;
+  last_step_valid = false;
+  cadenceEstimator.reset();
+}
+
 void read_pas_sensors() {
   // DEBUG MODE: Skip real sensor reading
   if (debug_mode && debug_simulate_pas) {
     return; // All simulation is handled in update_cadence()
   }
-  
-  // NORMAL MODE: Original sensor processing
-  // Check for interrupt flag first - this is set by hardware interrupt
-  if (!pas_interrupt_flag) {
-    return;  // No new interrupt - nothing to do
+
+  // NORMAL MODE: Decode every step the counter captured since the last tick.
+  // The step timestamps are micros(); last_pulse_time and last_pedal_activity
+  // stay on the millis() clock, so convert via the age of the step (both
+  // clocks wrap differently).
+  uint32_t now_us = micros();
+  unsigned long now_ms = millis();
+  pas_poll_us = now_us;
+
+  PasStep step;
+  bool stepped = false;
+  while (pasCounter->nextStep(step)) {
+    int32_t age_us = (int32_t)(now_us - step.time_us);
+    if (age_us < 0) {
+      age_us = 0;  // Captured after now_us was taken
+    }
+    decode_pas_step(step, now_ms - (unsigned long)age_us / 1000);
+    stepped = true;
   }
-  
-  // Critical section: disable interrupts briefly to read sensor state
-  // Verwende Arduino-kompatible Interrupt-Kontrolle
-  noInterrupts();
-  pas_interrupt_flag = false;  // Reset flag
-  unsigned long interrupt_time = last_interrupt_time;
-  interrupts();
-  
-  // Read current sensor states (digital pins)
-  int newA = digitalRead(PAS_PIN_A);
-  int newB = digitalRead(PAS_PIN_B);
-  
-  // Check if something really changed
-  if (newA == a && newB == b) {
-    return;  // False alarm, no change
+
+  // Steps lost (ring overflow, missed edge): the next step does not follow
+  // the last one, and the edge index may no longer match the crank
+  uint32_t lost = pasCounter->lostSteps();
+  if (lost != lost_steps_seen) {
+    lost_steps_seen = lost;
+    cadenceEstimator.reset();
   }
-  
-  unsigned long now = millis();
-  
-  // Quadrature decoding for direction and position
-  int old_state = (a << 1) | b;       // Old state: A*2 + B
-  int new_state = (newA << 1) | newB; // New state: A*2 + B
-  
-  // Quadrature lookup table for direction:
-  // [old_state][new_state] = direction (1=forward, -1=backward, 0=invalid)
-  static const int quadrature_table[4][4] = {
-    // new: 00  01  11  10
-    {  0,  1, -1,  0}, // old: 00
-    { -1,  0,  0,  1}, // old: 01  
-    {  1,  0,  0, -1}, // old: 11
-    {  0, -1,  1,  0}  // old: 10
-  };
-  
-  int direction_change = quadrature_table[old_state][new_state];
-  
-  if (direction_change != 0) {
-    // Valid state transition
-    pos += direction_change;
-    pedal_direction = direction_change;  // 1=forward, -1=backward
-    
-    // ENHANCED CONTINUOUS CADENCE CALCULATION at every step
-    if (pedal_direction > 0 && last_pulse_time > 0) {  // Only during forward movement
-      unsigned long step_interval = now - last_pulse_time;
-        
-      // Wider plausible range for better responsiveness
-      if (step_interval > 5 && step_interval < 3000) {  // 5ms - 3s
-        // Calculate RPM based on current step speed
-        // One step = 1/32 revolution (quadrature encoding: 8 pulses * 4 edges = 32)
-        unsigned long revolution_time = step_interval * quadrature_pulses_per_rev;
-        
-        // Calculate raw cadence
-        float raw_cadence_rpm = 60000.0 / revolution_time;
-        
-        // Enhanced plausibility check (3-200 RPM for better range)
-        if (raw_cadence_rpm >= 3.0 && raw_cadence_rpm <= 200.0) {
-          // More responsive smoothing for multi-core environment
-          float alpha = 0.4;  // Higher alpha = more responsive
-          
-          if (current_cadence_rpm > 0.0) {
-            // Adaptive smoothing: more responsive when cadence is changing rapidly
-            float cadence_change_rate = abs(raw_cadence_rpm - current_cadence_rpm) / current_cadence_rpm;
-            if (cadence_change_rate > 0.2) {  // >20% change
-              alpha = 0.6;  // More responsive during rapid changes
-            }
-            
-            current_cadence_rpm = current_cadence_rpm * (1.0 - alpha) + raw_cadence_rpm * alpha;
-          } else {
-            current_cadence_rpm = raw_cadence_rpm;  // Take first value immediately
-          }
-          current_cadence_rps = current_cadence_rpm / 60.0;
-        }
-      }
-    }
-    
-    // Legacy pulse interval for compatibility (ring buffer)
-    if (last_pulse_time > 0) {
-      unsigned long interval = now - last_pulse_time;
-      pulse_intervals[pulse_index] = interval;
-      pulse_index = (pulse_index + 1) % 4;  // Ring buffer with 4 entries
+
+  // Position: every edge counts for the mode switch. A read at the last
+  // capture without a new step may be the PCNT limit race (see
+  // pas_counter_pcnt.cpp) - wait for the next poll.
+  int32_t position = pasCounter->position();
+  if (position != seen_position && (stepped || position != step_position)) {
+    int32_t moved = position - seen_position;
+    seen_position = position;
+    pos += moved;
+    pas_edges_decoded += (unsigned long)(moved > 0 ? moved : -moved);
+
+    if (position != step_position) {
+      decode_pas_motion(position, now_us, now_ms);
     }
-    
-    last_pulse_time = now;
-    last_pedal_activity = now;
   }
-  
-  // Store states for next iteration
-  a = newA;
-  b = newB;
-  
+
   // Overflow protection with better handling
   if (pos >= INT_MAX - 1000 || pos <= INT_MIN + 1000) {
     int old_pos = pos;
     pos = pos % 10000;  // Keep relative position but reset to manageable range
     vescCounter += (pos - old_pos);  // Maintain vescCounter continuity
-    
-    Serial.printf("Position overflow protection: %d -> %d\n", old_pos, pos);
+
+    logDeferred(LOG_PAS_POSITION_OVERFLOW, old_pos, pos);
   }
 }
@@ -0,0 +1,274 @@
+#include "task_perf.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+TaskPerf taskPerf[NUM_TASK_PERF];
+
+// =============================================================================
+// LOG-BUCKETED HISTOGRAM
+// =============================================================================
+// Values below 2 * PERF_SUB_BUCKETS get their own bucket. Above, bucket
+// (shift + 1) * PERF_SUB_BUCKETS + sub holds [(SUB + sub) << shift,
+// (SUB + sub + 1) << shift) - the top bits of the value select the bucket.
+
+static const uint32_t PERF_SUB_BITS = 2;  // log2(PERF_SUB_BUCKETS)
+
+PerfHistogram::PerfHistogram() {
+  static_assert((1 << PERF_SUB_BITS) == PERF_SUB_BUCKETS, "PERF_SUB_BITS does not match PERF_SUB_BUCKETS");
+  reset();
+}
+
+uint32_t PerfHistogram::bucketIndex(uint32_t value_us) {
+  if (value_us < PERF_SUB_BUCKETS) {
+    return value_us;
+  }
+  uint32_t msb = 31 - __builtin_clz(value_us);
+  uint32_t shift = msb - PERF_SUB_BITS;
+  uint32_t sub = (value_us >> shift) & (PERF_SUB_BUCKETS - 1);
+  uint32_t index = (shift + 1) * PERF_SUB_BUCKETS + sub;
+  return index < PERF_NUM_BUCKETS ? index : PERF_NUM_BUCKETS - 1;
+}
+
+uint32_t PerfHistogram::bucketLower(uint32_t index) {
+  if (index < PERF_SUB_BUCKETS) {
+    return index;
+  }
+  uint32_t shift = index / PERF_SUB_BUCKETS - 1;
+  return (PERF_SUB_BUCKETS + index % PERF_SUB_BUCKETS) << shift;
+}
+
+uint32_t PerfHistogram::bucketUpper(uint32_t index) {
+  if (index >= PERF_NUM_BUCKETS - 1) {
+    return UINT32_MAX;
+  }
+  return bucketLower(index + 1) - 1;
+}
+
+void PerfHistogram::record(uint32_t value_us) {
+  std::atomic<uint32_t>& bucket = buckets[bucketIndex(value_us)];
+  bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  total.store(total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (value_us > maximum.load(std::memory_order_relaxed)) {
+    maximum.store(value_us, std::memory_order_relaxed);
+  }
+}
+
+void PerfHistogram::reset() {
+  for (uint32_t i = 0; i < PERF_NUM_BUCKETS; i++) {
+    buckets[i].store(0, std::memory_order_relaxed);
+  }
+  total.store(0, std::memory_order_relaxed);
+  maximum.store(0, std::memory_order_relaxed);
+}
+
+uint32_t PerfHistogram::count() const {
+  return total.load(std::memory_order_relaxed);
+}
+
+uint32_t PerfHistogram::maxValue() const {
+  return maximum.load(std::memory_order_relaxed);
+}
+
+uint32_t PerfHistogram::bucketCount(uint32_t index) const {
+  return index < PERF_NUM_BUCKETS ? buckets[index].load(std::memory_order_relaxed) : 0;
+}
+
+float PerfHistogram::mean() const {
+  double sum = 0.0;
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < PERF_NUM_BUCKETS; i++) {
+    uint32_t c = bucketCount(i);
+    if (c == 0) continue;
+    uint32_t upper = (i == PERF_NUM_BUCKETS - 1) ? maxValue() : bucketUpper(i);
+    sum += c * 0.5 * ((double)bucketLower(i) + upper);
+    n += c;
+  }
+  return n > 0 ? (float)(sum / n) : 0.0f;
+}
+
+uint32_t PerfHistogram::percentile(float p) const {
+  uint32_t n = count();
+  if (n == 0) {
+    return 0;
+  }
+  uint32_t rank = (uint32_t)ceilf(p * n);
+  if (rank < 1) rank = 1;
+
+  uint32_t seen = 0;
+  for (uint32_t i = 0; i < PERF_NUM_BUCKETS; i++) {
+    seen += bucketCount(i);
+    if (seen >= rank) {
+      uint32_t upper = bucketUpper(i);
+      return upper < maxValue() ? upper : maxValue();   // Never report more than was seen
+    }
+  }
+  return maxValue();
+}
+
+// =============================================================================
+// PER-TASK RECORDING
+// =============================================================================
+
+void taskPerfRegister(TaskPerfId id, const char* name, uint32_t period_us, uint32_t deadline_us) {
+  TaskPerf& perf = taskPerf[id];
+  perf.period_us = period_us;
+  perf.deadline_us = deadline_us;
+  perf.run_time_us.reset();
+  perf.wake_jitter_us.reset();
+  perf.iterations.store(0, std::memory_order_relaxed);
+  perf.deadline_misses.store(0, std::memory_order_relaxed);
+  perf.reset_requested.store(false, std::memory_order_relaxed);
+  perf.grid_valid = false;
+  perf.name = name;
+}
+
+void taskPerfBegin(TaskPerfId id, uint32_t release_us) {
+  TaskPerf& perf = taskPerf[id];
+  uint32_t now = micros();
+
+  if (perf.reset_requested.exchange(false, std::memory_order_relaxed)) {
+    perf.run_time_us.reset();
+    perf.wake_jitter_us.reset();
+    perf.iterations.store(0, std::memory_order_relaxed);
+    perf.deadline_misses.store(0, std::memory_order_relaxed);
+  }
+
+  // Woken before the release time (tick phase, poll timeout rounding) = on time
+  int32_t late_us = (int32_t)(now - release_us);
+  if (late_us < 0) {
+    late_us = 0;
+    release_us = now;
+  }
+  perf.wake_jitter_us.record((uint32_t)late_us);
+
+  perf.release_us = release_us;
+  perf.start_cycles = ESP.getCycleCount();
+}
+
+void taskPerfBeginPeriodic(TaskPerfId id) {
+  TaskPerf& perf = taskPerf[id];
+  uint32_t now = micros();
+
+  if (!perf.grid_valid) {
+    perf.grid_release_us = now;
+    perf.grid_valid = true;
+  } else {
+    // vTaskDelayUntil keeps the grid even after an overrun
+    perf.grid_release_us += perf.period_us;
+    if ((int32_t)(now - perf.grid_release_us) < 0) {
+      perf.grid_release_us = now;  // Tick came earlier than our estimate: re-anchor
+    }
+  }
+
+  taskPerfBegin(id, perf.grid_release_us);
+}
+
+void taskPerfEnd(TaskPerfId id) {
+  TaskPerf& perf = taskPerf[id];
+  uint32_t cycles = ESP.getCycleCount() - perf.start_cycles;
+  uint32_t end_us = micros();
+
+  perf.run_time_us.record(cycles / getCpuFrequencyMhz());
+  perf.iterations.store(perf.iterations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (perf.deadline_us > 0 && end_us - perf.release_us > perf.deadline_us) {
+    perf.deadline_misses.store(perf.deadline_misses.load(std::memory_order_relaxed) + 1,
+                               std::memory_order_relaxed);
+  }
+}
+
+void taskPerfRequestReset() {
+  for (int i = 0; i < NUM_TASK_PERF; i++) {
+    taskPerf[i].reset_requested.store(true, std::memory_order_relaxed);
+  }
+}
+
+// =============================================================================
+// JSON OUTPUT (web and BLE task - reads only)
+// =============================================================================
+
+// snprintf appender that keeps counting when the buffer is full
+struct PerfJsonWriter {
+  char* buffer;
+  size_t size;
+  size_t length;
+
+  void add(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    va_list args;
+    va_start(args, format);
+    size_t room = length < size ? size - length : 0;
+    int n = vsnprintf(room > 0 ? buffer + length : NULL, room, format, args);
+    va_end(args);
+    if (n > 0) length += (size_t)n;
+  }
+};
+
+static void writeHistogramJson(PerfJsonWriter& out, const char* key, const PerfHistogram& h) {
+  out.add("\"%s\":{\"n\":%lu,\"mean\":%.1f,\"p50\":%lu,\"p90\":%lu,\"p99\":%lu,\"max\":%lu,\"buckets\":[",
+          key, (unsigned long)h.count(), h.mean(), (unsigned long)h.percentile(0.50f),
+          (unsigned long)h.percentile(0.90f), (unsigned long)h.percentile(0.99f), (unsigned long)h.maxValue());
+
+  // Sparse: [lowest value in the bucket, count] for non-empty buckets only
+  bool first = true;
+  for (uint32_t i = 0; i < PERF_NUM_BUCKETS; i++) {
+    uint32_t c = h.bucketCount(i);
+    if (c == 0) continue;
+    out.add("%s[%lu,%lu]", first ? "" : ",", (unsigned long)PerfHistogram::bucketLower(i), (unsigned long)c);
+    first = false;
+  }
+  out.add("]}");
+}
+
+size_t taskPerfToJson(char* buffer, size_t size) {
+  PerfJsonWriter out = {buffer, size, 0};
+  out.add("{\"uptime_ms\":%lu,\"cpu_mhz\":%lu,\"tasks\":[", (unsigned long)millis(),
+          (unsigned long)getCpuFrequencyMhz());
+
+  bool first = true;
+  for (int i = 0; i < NUM_TASK_PERF; i++) {
+    const TaskPerf& perf = taskPerf[i];
+    if (perf.name == NULL) continue;
+
+    out.add("%s{\"name\":\"%s\",\"period_us\":%lu,\"deadline_us\":%lu,\"iterations\":%lu,\"deadline_misses\":%lu,",
+            first ? "" : ",", perf.name, (unsigned long)perf.period_us, (unsigned long)perf.deadline_us,
+            (unsigned long)perf.iterations.load(std::memory_order_relaxed),
+            (unsigned long)perf.deadline_misses.load(std::memory_order_relaxed));
+    writeHistogramJson(out, "run_us", perf.run_time_us);
+    out.add(",");
+    writeHistogramJson(out, "jitter_us", perf.wake_jitter_us);
+    out.add("}");
+    first = false;
+  }
+  out.add("]}");
+
+  if (size > 0 && out.length >= size) {
+    buffer[size - 1] = '\0';
+  }
+  return out.length;
+}
+
+// One array per task: [name, iterations, deadline misses, run p50, run p99,
+// run max, jitter p99, jitter max] - fits a 512 byte BLE attribute
+size_t taskPerfToCompactJson(char* buffer, size_t size) {
+  PerfJsonWriter out = {buffer, size, 0};
+  out.add("{\"t\":[");
+
+  bool first = true;
+  for (int i = 0; i < NUM_TASK_PERF; i++) {
+    const TaskPerf& perf = taskPerf[i];
+    if (perf.name == NULL) continue;
+
+    out.add("%s[\"%s\",%lu,%lu,%lu,%lu,%lu,%lu,%lu]", first ? "" : ",", perf.name,
+            (unsigned long)perf.iterations.load(std::memory_order_relaxed),
+            (unsigned long)perf.deadline_misses.load(std::memory_order_relaxed),
+            (unsigned long)perf.run_time_us.percentile(0.50f), (unsigned long)perf.run_time_us.percentile(0.99f),
+            (unsigned long)perf.run_time_us.maxValue(),
+            (unsigned long)perf.wake_jitter_us.percentile(0.99f), (unsigned long)perf.wake_jitter_us.maxValue());
+    first = false;
+  }
+  out.add("]}");
+
+  if (size > 0 && out.length >= size) {
+    buffer[size - 1] = '\0';
+  }
+  return out.length;
+}
@@ -0,0 +1,127 @@
+#include "thermal_derating.h"
+#include "ebike_controller.h"
+#include "deferred_log.h"
+
+// =============================================================================
+// THERMAL NODE
+// =============================================================================
+
+ThermalNode::ThermalNode(const ThermalNodeConfig& config)
+  : cfg(config) {
+  reset(THERMAL_AMBIENT_C);
+}
+
+void ThermalNode::reset(float ambient_c) {
+  temp_c = ambient_c;
+  has_reading = false;
+}
+
+void ThermalNode::predict(float current_a, float ambient_c, float dt_s) {
+  float heat_w = cfg.loss_ohm * current_a * current_a;
+  float cooling_w = (temp_c - ambient_c) / cfg.rth_k_per_w;
+  temp_c += (heat_w - cooling_w) * dt_s / cfg.capacity_j_per_k;
+}
+
+void ThermalNode::correct(float measured_c, float dt_s) {
+  if (measured_c < THERMAL_SENSOR_MIN_C || measured_c > THERMAL_SENSOR_MAX_C) {
+    return;
+  }
+  if (!has_reading) {
+    temp_c = measured_c;
+    has_reading = true;
+    return;
+  }
+  temp_c += (measured_c - temp_c) * min(dt_s / THERMAL_CORRECTION_S, 1.0f);
+}
+
+float ThermalNode::timeToLimit(float current_a, float ambient_c) const {
+  if (temp_c >= cfg.limit_c) {
+    return 0.0f;
+  }
+  float steady_c = ambient_c + cfg.loss_ohm * current_a * current_a * cfg.rth_k_per_w;
+  if (steady_c <= cfg.limit_c) {
+    return THERMAL_NO_LIMIT_S;
+  }
+  float tau_s = cfg.rth_k_per_w * cfg.capacity_j_per_k;
+  return min(tau_s * logf((steady_c - temp_c) / (steady_c - cfg.limit_c)), THERMAL_NO_LIMIT_S);
+}
+
+float ThermalNode::allowedCurrent(float ambient_c, float horizon_s) const {
+  // T(horizon) = T_ss - (T_ss - T) * e^(-horizon / tau) = T_limit, solved for T_ss
+  float decay = expf(-horizon_s / (cfg.rth_k_per_w * cfg.capacity_j_per_k));
+  float steady_c = (cfg.limit_c - temp_c * decay) / (1.0f - decay);
+  float heat_w = (steady_c - ambient_c) / cfg.rth_k_per_w;
+  return heat_w > 0.0f ? sqrtf(heat_w / cfg.loss_ohm) : 0.0f;
+}
+
+ThermalNodeConfig thermal_motor_config() {
+  ThermalNodeConfig config;
+  config.limit_c = THERMAL_MOTOR_LIMIT_C;
+  config.loss_ohm = MOTOR_PHASE_RESISTANCE;
+  config.rth_k_per_w = THERMAL_MOTOR_RTH_K_PER_W;
+  config.capacity_j_per_k = THERMAL_MOTOR_CAPACITY_J_PER_K;
+  return config;
+}
+
+ThermalNodeConfig thermal_fet_config() {
+  ThermalNodeConfig config;
+  config.limit_c = THERMAL_FET_LIMIT_C;
+  config.loss_ohm = THERMAL_FET_LOSS_OHM;
+  config.rth_k_per_w = THERMAL_FET_RTH_K_PER_W;
+  config.capacity_j_per_k = THERMAL_FET_CAPACITY_J_PER_K;
+  return config;
+}
+
+// =============================================================================
+// MOTOR CURRENT DERATING (sensorTask)
+// =============================================================================
+
+static ThermalNode motor_node(thermal_motor_config());
+static ThermalNode fet_node(thermal_fet_config());
+static bool derating_enabled = true;
+static uint32_t last_temps_count = 0;
+
+void update_thermal_derating(const SharedVescData& vesc) {
+  // Heat from the command sent last tick (what the VESC is driving now)
+  motor_node.predict(commanded_current_amps, THERMAL_AMBIENT_C, THERMAL_DT_S);
+  fet_node.predict(commanded_current_amps, THERMAL_AMBIENT_C, THERMAL_DT_S);
+  if (vesc.temps_count != last_temps_count) {
+    motor_node.correct(vesc.temp_motor, VESC_SLOW_POLL_MS / 1000.0f);
+    fet_node.correct(vesc.temp_mosfet, VESC_SLOW_POLL_MS / 1000.0f);
+    last_temps_count = vesc.temps_count;
+  }
+
+  float allowed = min(motor_node.allowedCurrent(THERMAL_AMBIENT_C, THERMAL_HORIZON_S),
+                      fet_node.allowedCurrent(THERMAL_AMBIENT_C, THERMAL_HORIZON_S));
+  motor_current_limit_amps = derating_enabled ? min(allowed, (float)MAX_MOTOR_CURRENT) : MAX_MOTOR_CURRENT;
+
+  static unsigned long last_thermal_debug = 0;
+  unsigned long now = millis();
+  if (now - last_thermal_debug > 5000) { // Every 5 seconds
+    float time_to_limit = min(motor_node.timeToLimit(commanded_current_amps, THERMAL_AMBIENT_C),
+                              fet_node.timeToLimit(commanded_current_amps, THERMAL_AMBIENT_C));
+    logDeferred(LOG_THERMAL_DERATING, motor_node.temperature(), vesc.temp_motor,
+                fet_node.temperature(), vesc.temp_mosfet, motor_current_limit_amps, time_to_limit,
+                motor_current_limit_amps < MAX_MOTOR_CURRENT ? " DERATED" : "");
+    last_thermal_debug = now;
+  }
+}
+
+void thermal_derating_reset() {
+  motor_node.reset(THERMAL_AMBIENT_C);
+  fet_node.reset(THERMAL_AMBIENT_C);
+  motor_current_limit_amps = MAX_MOTOR_CURRENT;
+  last_temps_count = sharedVescData.read().temps_count;   // Readings from before are not ours
+}
+
+void thermal_derating_enable(bool enabled) {
+  derating_enabled = enabled;
+}
+
+const ThermalNode& thermal_motor_node() {
+  return motor_node;
+}
+
+const ThermalNode& thermal_fet_node() {
+  return fet_node;
+}
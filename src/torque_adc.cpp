@@ -0,0 +1,160 @@
+#include "torque_adc.h"
+#include "ebike_controller.h"
+#include "driver/adc.h"
+
+// =============================================================================
+// CIC DECIMATOR
+// =============================================================================
+// Integrators run at the conversion rate, combs at the output rate. With
+// unsigned wrap-around the result is exact even when the integrators
+// overflow, as long as decimation^order * 4095 fits 32 bits.
+
+CicDecimator::CicDecimator(uint32_t decimation) : decimation(decimation) {
+  scale = 1.0f;
+  for (int i = 0; i < TORQUE_ADC_CIC_ORDER; i++) {
+    scale /= (float)decimation;
+  }
+  reset();
+}
+
+void CicDecimator::reset() {
+  for (int i = 0; i < TORQUE_ADC_CIC_ORDER; i++) {
+    integrator[i] = 0;
+    comb_delay[i] = 0;
+  }
+  phase = 0;
+  outputs = 0;
+  latest = 0.0f;
+}
+
+bool CicDecimator::push(uint16_t sample) {
+  uint32_t x = sample;
+  for (int i = 0; i < TORQUE_ADC_CIC_ORDER; i++) {
+    integrator[i] += x;
+    x = integrator[i];
+  }
+  if (++phase < decimation) {
+    return false;
+  }
+  phase = 0;
+
+  for (int i = 0; i < TORQUE_ADC_CIC_ORDER; i++) {
+    uint32_t y = x - comb_delay[i];
+    comb_delay[i] = x;
+    x = y;
+  }
+  latest = (float)x * scale;
+  outputs++;
+  return true;
+}
+
+// =============================================================================
+// DMA SAMPLING
+// =============================================================================
+
+static_assert(TORQUE_ADC_DECIMATION * TORQUE_ADC_DECIMATION * 4095.0 < 4294967296.0,
+              "CIC gain does not fit 32 bits");
+static_assert(TORQUE_ADC_FRAME_BYTES % sizeof(adc_digi_output_data_t) == 0, "DMA frame must hold whole conversions");
+static_assert(TORQUE_ADC_READ_BYTES % sizeof(adc_digi_output_data_t) == 0, "Read chunk must hold whole conversions");
+
+static CicDecimator torqueDecimator(TORQUE_ADC_DECIMATION);
+static TorqueAdcStats stats = {};
+static bool adc_running = false;
+
+bool torque_adc_begin() {
+  if (adc_running) {
+    return true;
+  }
+
+  adc_digi_init_config_t init = {};
+  init.max_store_buf_size = TORQUE_ADC_BUFFER_BYTES;
+  init.conv_num_each_intr = TORQUE_ADC_FRAME_BYTES;
+  init.adc1_chan_mask = 1u << TORQUE_ADC_CHANNEL;
+  init.adc2_chan_mask = 0;
+
+  adc_digi_pattern_config_t pattern = {};
+  pattern.atten = ADC_ATTEN_DB_11;             // 0-3.3V like analogRead()
+  pattern.channel = TORQUE_ADC_CHANNEL;
+  pattern.unit = 0;                             // ADC1
+  pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+  adc_digi_configuration_t config = {};
+  config.conv_limit_en = true;                  // Required on the ESP32
+  config.conv_limit_num = 250;
+  config.pattern_num = 1;
+  config.adc_pattern = &pattern;
+  config.sample_freq_hz = TORQUE_ADC_SAMPLE_HZ;
+  config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+
+  esp_err_t err = adc_digi_initialize(&init);
+  if (err == ESP_OK) {
+    err = adc_digi_controller_configure(&config);
+    if (err == ESP_OK) err = adc_digi_start();
+    if (err != ESP_OK) adc_digi_deinitialize();
+  }
+  if (err != ESP_OK) {
+    Serial.printf("Torque: ADC DMA setup failed (error %d)\n", (int)err);
+    return false;
+  }
+
+  torqueDecimator.reset();
+  adc_running = true;
+  return true;
+}
+
+void torque_adc_end() {
+  if (!adc_running) {
+    return;
+  }
+  adc_digi_stop();
+  adc_digi_deinitialize();
+  adc_running = false;
+}
+
+bool torque_adc_active() {
+  return adc_running;
+}
+
+bool torque_adc_read(float& counts) {
+  if (!adc_running) {
+    return false;
+  }
+
+  // Everything the DMA delivered since the last tick (~400 bytes), bounded
+  // by the driver buffer so a flood cannot hold sensorTask
+  adc_digi_output_data_t chunk[TORQUE_ADC_READ_BYTES / sizeof(adc_digi_output_data_t)];
+  for (uint32_t reads = 0; reads < TORQUE_ADC_BUFFER_BYTES / TORQUE_ADC_READ_BYTES + 1; reads++) {
+    uint32_t length = 0;
+    esp_err_t err = adc_digi_read_bytes((uint8_t*)chunk, sizeof(chunk), &length, 0);
+    if (err == ESP_ERR_INVALID_STATE) {
+      stats.overruns++;   // Frames were lost, the ones returned are still valid
+    } else if (err != ESP_OK) {
+      break;              // ESP_ERR_TIMEOUT: buffer drained
+    }
+
+    uint32_t n = length / sizeof(adc_digi_output_data_t);
+    stats.conversions += n;
+    for (uint32_t i = 0; i < n; i++) {
+      if (chunk[i].type1.channel != TORQUE_ADC_CHANNEL) {
+        stats.foreign++;
+        stats.conversions--;
+      } else if (torqueDecimator.push(chunk[i].type1.data)) {
+        stats.outputs++;
+      }
+    }
+    if (length < sizeof(chunk)) {
+      break;
+    }
+  }
+
+  if (!torqueDecimator.ready()) {
+    return false;
+  }
+  counts = torqueDecimator.output();
+  return true;
+}
+
+const TorqueAdcStats& torque_adc_stats() {
+  return stats;
+}
@@ -0,0 +1,141 @@
+#include "torque_calibration.h"
+#include "ebike_controller.h"
+#include <Preferences.h>
+#include <atomic>
+
+// =============================================================================
+// CALIBRATION CURVE (one direction)
+// =============================================================================
+
+TorqueCalCurve::TorqueCalCurve() {
+  TorqueCalTable table = torque_cal_default_table();
+  build(table.forward, table.forward_points);
+}
+
+static bool points_valid(const TorqueCalPoint* points, uint32_t count) {
+  if (count < 2 || count > TORQUE_CAL_MAX_POINTS) return false;
+  if (points[0].counts != 0.0f || points[0].nm != 0.0f) return false;
+  for (uint32_t i = 1; i < count; i++) {
+    // Written so that NaN fails every comparison
+    if (!(points[i].counts - points[i - 1].counts >= TORQUE_CAL_GRID_STEP)) return false;
+    if (!(points[i].counts <= 4095.0f)) return false;
+    if (!(points[i].nm >= points[i - 1].nm && points[i].nm <= 1000.0f)) return false;
+  }
+  return true;
+}
+
+bool TorqueCalCurve::build(const TorqueCalPoint* points, uint32_t count) {
+  if (!points_valid(points, count)) {
+    return false;
+  }
+
+  segments = count - 1;
+  for (uint32_t i = 0; i < segments; i++) {
+    x[i] = points[i].counts;
+    y[i] = points[i].nm;
+    slope[i] = (points[i + 1].nm - points[i].nm) / (points[i + 1].counts - points[i].counts);
+  }
+
+  // Segment holding the start of each grid cell
+  uint32_t i = 0;
+  for (uint32_t cell = 0; cell < TORQUE_CAL_GRID_CELLS; cell++) {
+    float start = (float)(cell << TORQUE_CAL_GRID_SHIFT);
+    while (i + 1 < segments && x[i + 1] <= start) {
+      i++;
+    }
+    cell_segment[cell] = (uint8_t)i;
+  }
+  return true;
+}
+
+bool torque_cal_table_valid(const TorqueCalTable& table) {
+  return table.version == TORQUE_CAL_VERSION &&
+         points_valid(table.forward, table.forward_points) &&
+         points_valid(table.backward, table.backward_points);
+}
+
+TorqueCalTable torque_cal_default_table() {
+  // Original linear scale: TORQUE_MAX_NM at the larger of the two possible
+  // deviations, in both directions
+  float full_scale = max(TORQUE_STANDSTILL - TORQUE_MAX_BACKWARD, TORQUE_MAX_FORWARD - TORQUE_STANDSTILL);
+  TorqueCalTable table = {};
+  table.version = TORQUE_CAL_VERSION;
+  table.forward_points = 2;
+  table.forward[1].counts = full_scale;
+  table.forward[1].nm = TORQUE_MAX_NM;
+  table.backward_points = 2;
+  table.backward[1] = table.forward[1];
+  return table;
+}
+
+// =============================================================================
+// CALIBRATION SERVICE
+// =============================================================================
+// sensorTask owns the compiled curves. torque_calibration_set() (WiFi task)
+// publishes the new table and bumps cal_requested; the next
+// torque_calibration_nm() call compiles it - a few microseconds, and the
+// curves never change under a running lookup.
+
+static const char* NVS_NAMESPACE = "torque_cal";
+
+static TorqueCalCurve forwardCurve;
+static TorqueCalCurve backwardCurve;
+static SeqlockSnapshot<TorqueCalTable> activeTable;     // Writer: sensorTask (begin: setup)
+static SeqlockSnapshot<TorqueCalTable> requestedTable;  // Writer: torque_calibration_set()
+static std::atomic<uint32_t> cal_requested(0);
+static uint32_t cal_applied = 0;
+
+static void apply_table(const TorqueCalTable& table) {
+  forwardCurve.build(table.forward, table.forward_points);
+  backwardCurve.build(table.backward, table.backward_points);
+  activeTable.publish(table);
+}
+
+void torque_calibration_begin() {
+  TorqueCalTable table = torque_cal_default_table();
+
+  Preferences nvs;
+  if (nvs.begin(NVS_NAMESPACE, true)) {
+    TorqueCalTable stored;
+    size_t bytes = nvs.getBytes("table", &stored, sizeof(stored));
+    if (bytes == sizeof(stored) && torque_cal_table_valid(stored)) {
+      table = stored;
+    } else if (bytes > 0) {
+      Serial.println("Torque: stored calibration invalid - using the linear default");
+    }
+    nvs.end();
+  }
+
+  cal_applied = cal_requested.load(std::memory_order_acquire);
+  apply_table(table);
+}
+
+float torque_calibration_nm(float deviation) {
+  uint32_t requested = cal_requested.load(std::memory_order_acquire);
+  if (requested != cal_applied) {
+    cal_applied = requested;
+    apply_table(requestedTable.read());
+  }
+  return deviation >= 0.0f ? forwardCurve.torqueNm(deviation) : backwardCurve.torqueNm(-deviation);
+}
+
+bool torque_calibration_set(const TorqueCalTable& table, bool persist) {
+  if (!torque_cal_table_valid(table)) {
+    return false;
+  }
+  if (persist) {
+    Preferences nvs;
+    if (!nvs.begin(NVS_NAMESPACE, false) || nvs.putBytes("table", &table, sizeof(table)) != sizeof(table)) {
+      return false;
+    }
+    nvs.end();
+  }
+  requestedTable.publish(table);
+  cal_requested.fetch_add(1, std::memory_order_release);
+  return true;
+}
+
+TorqueCalTable torque_calibration_table() {
+  TorqueCalTable table = activeTable.read();
+  return table.version == TORQUE_CAL_VERSION ? table : torque_cal_default_table();  // Before begin()
+}
@@ -1,4 +1,8 @@
 #include "ebike_controller.h"
+#include "torque_adc.h"
+#include "crank_torque.h"
+#include "torque_zero.h"
+#include "torque_calibration.h"
 
 // =============================================================================
 // TORQUE SENSOR EVALUATION (Absolute torque from 2.48V center point)
@@ -28,36 +32,74 @@ void update_torque() {
   }
   
   // NORMAL MODE: Original sensor processing
-  // Read ADC value (0-4095 for 12-bit ADC on ESP32)
+  // ADC value (0-4095 for 12-bit ADC on ESP32), decimated from the DMA
+  // stream (see torque_adc.h) or, without DMA, a single read
   // ESP32 ADC measures 0-3.3V with 12-bit resolution
   // Torque sensor with 3kΩ pull-down resistor for voltage divider
-  raw_torque_value = analogRead(TORQUE_SENSOR_PIN);
+  float adc_counts;
+  if (torque_adc_active()) {
+    if (!torque_adc_read(adc_counts)) {
+      return;  // Decimator settling after start: keep the previous torque
+    }
+  } else {
+    adc_counts = analogRead(TORQUE_SENSOR_PIN);
+  }
+  raw_torque_value = lroundf(adc_counts);
   
   // Calculate deviation from center point 
   // For ESP32 with 3.3V reference and 12V sensor via step-up converter + 3kΩ resistor:
-  // Center should be around 2880 ADC (2.3V) as defined in TORQUE_STANDSTILL
-  int deviation_from_center = raw_torque_value - TORQUE_STANDSTILL;
+  // Center should be around 2880 ADC (2.3V) as defined in TORQUE_STANDSTILL,
+  // the auto-zero follows its drift (see torque_zero.h)
+  torque_zero_update(adc_counts);
+  float deviation_from_center = adc_counts - torque_zero_counts();
   
   // Use ABSOLUTE VALUE - force intensity regardless of pedal position
-  int absolute_deviation = abs(deviation_from_center);
+  float absolute_deviation = fabsf(deviation_from_center);
   
   // Check if deviation is above threshold
   if (absolute_deviation < TORQUE_THRESHOLD) {
     crank_torque_nm = 0.0;  // Below threshold = no meaningful torque
   } else {
-    // Calculate maximum possible deviation from center
-    // For ESP32: max(2880-0, 4095-2880) = max(2880, 1215) = 2880 ADC
-    int max_deviation = max(TORQUE_STANDSTILL - TORQUE_MAX_BACKWARD, 
-                           TORQUE_MAX_FORWARD - TORQUE_STANDSTILL);
-    
-    // Scale absolute deviation to 0-TORQUE_MAX_NM range
-    crank_torque_nm = (float)absolute_deviation / max_deviation * TORQUE_MAX_NM;
+    // Calibration table for the deflection direction (see torque_calibration.h;
+    // default: linear, TORQUE_MAX_NM at max(2880-0, 4095-2880) = 2880 ADC)
+    crank_torque_nm = torque_calibration_nm(deviation_from_center);
   }
   
   // Clamp to reasonable range (only positive values)
   if (crank_torque_nm > TORQUE_MAX_NM) crank_torque_nm = TORQUE_MAX_NM;
   if (crank_torque_nm < 0.0) crank_torque_nm = 0.0;
   
-  // Direct assignment without filtering
+  // Filtering happens in the ADC decimator
   filtered_torque = crank_torque_nm;
 }
+
+// =============================================================================
+// CRANK-SYNCHRONOUS TORQUE (average over crank angle, see crank_torque.h)
+// =============================================================================
+
+static CrankTorqueAverager crankTorque;
+static int crank_torque_pos = 0;   // pos at the last tick
+
+void update_crank_torque() {
+  int moved = pos - crank_torque_pos;
+  crank_torque_pos = pos;
+
+  // Simulated sensors have no crank position: keep the direct value
+  if (debug_mode && (debug_simulate_torque || debug_simulate_pas)) {
+    crank_torque_peak_nm = filtered_torque;
+    return;
+  }
+
+  // Standing on the pedals or pedaling backwards: no crank rotation to
+  // average over, the instantaneous torque stays (no human power without
+  // cadence anyway)
+  if (pedal_direction <= 0 || current_cadence_rpm <= 0.0) {
+    crankTorque.reset();
+    crank_torque_peak_nm = crank_torque_nm;
+    return;
+  }
+
+  crankTorque.addSample(crank_torque_nm, moved > 0 ? (uint32_t)moved : 0);
+  filtered_torque = crankTorque.average();
+  crank_torque_peak_nm = crankTorque.peak();
+}
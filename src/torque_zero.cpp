@@ -0,0 +1,208 @@
+#include "torque_zero.h"
+#include "ebike_controller.h"
+#include "deferred_log.h"
+#include <Preferences.h>
+
+// =============================================================================
+// ZERO TRACKER
+// =============================================================================
+
+TorqueZeroTracker::TorqueZeroTracker() {
+  begin(TORQUE_STANDSTILL);
+}
+
+void TorqueZeroTracker::begin(float zero) {
+  zero_counts = zero;
+  boot_done = false;
+  restartWindow();
+}
+
+void TorqueZeroTracker::restartWindow() {
+  window_start_ms = 0;
+  window_samples = 0;
+  window_sum = 0.0f;
+  window_min = 0.0f;
+  window_max = 0.0f;
+}
+
+TorqueZeroTracker::Result TorqueZeroTracker::update(float counts, bool crank_idle, uint32_t now_ms) {
+  if (!crank_idle) {
+    restartWindow();
+    return NO_CHANGE;
+  }
+
+  // Signal moving (foot on the pedal, pushing the bike): start over from here
+  if (window_samples > 0 &&
+      (counts - window_min > TORQUE_ZERO_QUIET_COUNTS || window_max - counts > TORQUE_ZERO_QUIET_COUNTS)) {
+    restartWindow();
+  }
+  if (window_samples == 0) {
+    window_start_ms = now_ms;
+    window_min = counts;
+    window_max = counts;
+  }
+  window_samples++;
+  window_sum += counts;
+  if (counts < window_min) window_min = counts;
+  if (counts > window_max) window_max = counts;
+
+  uint32_t window_ms = boot_done ? TORQUE_ZERO_TRACK_WINDOW_MS : TORQUE_ZERO_BOOT_MS;
+  if (now_ms - window_start_ms < window_ms) {
+    return NO_CHANGE;
+  }
+  float mean = window_sum / window_samples;
+  restartWindow();
+
+  float error = mean - zero_counts;
+  Result result;
+  if (!boot_done) {
+    if (fabsf(error) > TORQUE_ZERO_BOOT_COUNTS) {
+      return NO_CHANGE;  // Resting foot - wait for free pedals
+    }
+    zero_counts = mean;
+    boot_done = true;
+    result = BOOT_CALIBRATED;
+  } else {
+    if (fabsf(error) > TORQUE_ZERO_TRACK_COUNTS) {
+      return NO_CHANGE;
+    }
+    float gain = (window_ms / 1000.0f) / TORQUE_ZERO_TRACK_TAU_S;
+    zero_counts += error * (gain < 1.0f ? gain : 1.0f);
+    result = TRACKED;
+  }
+
+  zero_counts = constrain(zero_counts, TORQUE_STANDSTILL - TORQUE_ZERO_MAX_SHIFT,
+                          TORQUE_STANDSTILL + TORQUE_ZERO_MAX_SHIFT);
+  return result;
+}
+
+// =============================================================================
+// AUTO-ZERO SERVICE (sensorTask)
+// =============================================================================
+
+static const char* NVS_NAMESPACE = "torque_zero";
+
+static Preferences nvs;
+static TorqueZeroTracker tracker;
+static TorqueZeroStatus status;
+static SeqlockSnapshot<TorqueZeroStatus> sharedStatus;
+static bool zero_active = false;
+static bool nvs_open = false;
+static bool zero_stored = false;         // NVS holds a zero
+static float history_zero = 0.0f;        // Zero of the newest history entry
+static unsigned long last_save_ms = 0;
+
+static void add_history(float zero, TorqueZeroSource source) {
+  if (status.history_count == TORQUE_ZERO_HISTORY) {
+    memmove(&status.history[0], &status.history[1], (TORQUE_ZERO_HISTORY - 1) * sizeof(TorqueZeroEntry));
+    status.history_count--;
+  }
+  TorqueZeroEntry& entry = status.history[status.history_count++];
+  entry.boot = status.boot;
+  entry.uptime_s = millis() / 1000;
+  entry.zero_counts = zero;
+  entry.source = source;
+  history_zero = zero;
+}
+
+static bool zero_plausible(float zero) {
+  return zero == zero && fabsf(zero - TORQUE_STANDSTILL) <= TORQUE_ZERO_MAX_SHIFT;   // zero == zero: not NaN
+}
+
+static void save_zero(unsigned long now) {
+  if (!nvs_open) {
+    return;
+  }
+  nvs.putFloat("zero", status.zero_counts);
+  nvs.putBytes("history", status.history, status.history_count * sizeof(TorqueZeroEntry));
+  status.saved_counts = status.zero_counts;
+  status.saves++;
+  last_save_ms = now;
+  zero_stored = true;
+  logDeferred(LOG_TORQUE_ZERO_SAVED, status.zero_counts, (unsigned long)status.saves);
+}
+
+void torque_zero_begin() {
+  if (zero_active) {
+    return;
+  }
+  memset(&status, 0, sizeof(status));
+  status.zero_counts = TORQUE_STANDSTILL;
+
+  nvs_open = nvs.begin(NVS_NAMESPACE, false);
+  zero_stored = false;
+  if (nvs_open) {
+    status.boot = nvs.getUInt("boots", 0) + 1;
+    nvs.putUInt("boots", status.boot);
+
+    size_t bytes = nvs.getBytes("history", status.history, sizeof(status.history));
+    status.history_count = bytes / sizeof(TorqueZeroEntry);
+
+    float stored = nvs.getFloat("zero", NAN);
+    if (zero_plausible(stored)) {
+      status.zero_counts = stored;
+      status.saved_counts = stored;
+      zero_stored = true;
+      add_history(stored, TORQUE_ZERO_FROM_NVS);
+    }
+  } else {
+    Serial.println("Torque: NVS unavailable - zero offset is not stored");
+  }
+
+  tracker.begin(status.zero_counts);
+  history_zero = status.zero_counts;
+  last_save_ms = millis();
+  zero_active = true;
+  sharedStatus.publish(status);
+}
+
+void torque_zero_end() {
+  if (!zero_active) {
+    return;
+  }
+  nvs.end();
+  nvs_open = false;
+  zero_active = false;
+}
+
+void torque_zero_update(float counts) {
+  if (!zero_active) {
+    return;
+  }
+  unsigned long now = millis();
+  bool crank_idle = current_cadence_rpm <= 0.0 && pedal_direction == 0 &&
+                    now - last_pedal_activity > TORQUE_ZERO_IDLE_MS;
+
+  TorqueZeroTracker::Result result = tracker.update(counts, crank_idle, now);
+  if (result == TorqueZeroTracker::NO_CHANGE) {
+    return;
+  }
+
+  float old_zero = status.zero_counts;
+  status.zero_counts = tracker.zero();
+  if (result == TorqueZeroTracker::BOOT_CALIBRATED) {
+    status.calibrated = 1;
+    add_history(status.zero_counts, TORQUE_ZERO_FROM_BOOT);
+    logDeferred(LOG_TORQUE_ZERO_CALIBRATED, status.zero_counts, status.zero_counts - old_zero);
+  } else if (fabsf(status.zero_counts - history_zero) >= TORQUE_ZERO_HISTORY_COUNTS) {
+    add_history(status.zero_counts, TORQUE_ZERO_FROM_TRACKING);
+  }
+
+  // Still idle here (the tracker only changes the zero on quiet windows).
+  // The boot calibration is written right away, tracking at most every
+  // TORQUE_ZERO_SAVE_INTERVAL_MS.
+  bool moved = !zero_stored || fabsf(status.zero_counts - status.saved_counts) >= TORQUE_ZERO_SAVE_COUNTS;
+  bool due = result == TorqueZeroTracker::BOOT_CALIBRATED || now - last_save_ms >= TORQUE_ZERO_SAVE_INTERVAL_MS;
+  if (moved && due) {
+    save_zero(now);
+  }
+  sharedStatus.publish(status);
+}
+
+float torque_zero_counts() {
+  return zero_active ? status.zero_counts : (float)TORQUE_STANDSTILL;
+}
+
+TorqueZeroStatus torque_zero_status() {
+  return sharedStatus.read();
+}
@@ -1,8 +1,9 @@
 #include "ebike_controller.h"
+#include "battery_model.h"
 #include <VescUart.h>
 
-// WiFi Logging Integration
-#include "wifi_telemetry.h"
+// Logging from vescTask (formatted by logDrainTask, also forwarded to the web log)
+#include "deferred_log.h"
 
 // ESP32 FreeRTOS Includes für Task-Funktionen
 #ifdef ESP32
@@ -14,125 +15,165 @@
 extern VescUart vescUart;
 
 // =============================================================================
-// VESC DATA QUERY (Speed) - Optimized for Multi-Core
+// VESC DATA QUERY (Speed) - Non-blocking, dual-rate
 // =============================================================================
+// vescTask calls this every few milliseconds. VescUart::update() only parses
+// the bytes that already arrived; the answer is picked up by a later call, so
+// motor commands are never held back by a telemetry request.
+//
+// COMM_GET_VALUES_SELECTIVE only transfers the fields in the mask:
+//   fast (50Hz): rpm, motor + input current, input voltage  -> 24 byte answer
+//   slow (1Hz):  fast fields + temperatures, duty, Ah, Wh, tachometer
+// instead of the 64 byte full GET_VALUES answer. Only one selective request
+// is in flight at a time, so the slow poll simply replaces one fast poll.
+
+static const uint32_t VESC_FAST_VALUES = SELECT_RPM | SELECT_AVG_MOTOR_CURRENT | SELECT_AVG_INPUT_CURRENT |
+                                         SELECT_INPUT_VOLTAGE;
+static const uint32_t VESC_SLOW_VALUES = VESC_FAST_VALUES | SELECT_TEMP_MOSFET | SELECT_TEMP_MOTOR |
+                                         SELECT_DUTY_CYCLE | SELECT_AMP_HOURS | SELECT_WATT_HOURS |
+                                         SELECT_TACHOMETER;
+
+static void handle_vesc_values(unsigned long now, bool slow);
+static void handle_vesc_timeout(unsigned long now);
+
+// Current outage: first timed-out request (0 = connected), safe mode logged.
+// Cleared by the next answer, so every outage is detected and logged.
+static unsigned long connection_lost_time = 0;
+static bool safe_mode_logged = false;
 
 void update_vesc_data() {
   unsigned long now = millis();
   
-  // Query VESC data at lower frequency since it runs on separate core
-  // and doesn't interfere with sensor processing anymore
-  static unsigned long last_vesc_query = 0;
-  if (now - last_vesc_query < 100) {  // 100ms = 10Hz query rate
-    return;
-  }
+  // Feed received bytes through the frame parser, expire old requests
+  vescUart.update();
   
-  last_vesc_query = now;
-  
-  // VESC query with timeout - CAN BLOCK without affecting Core 0!
-  unsigned long vesc_start_time = millis();
-  bool vesc_success = false;
-  
-  // Try to query VESC data with reasonable timeout 
-  // Since we're on Core 1, blocking here doesn't affect PAS sensors
-  while (millis() - vesc_start_time < 100) {  // Max 100ms timeout
-    if (vescUart.getVescValues()) {
-      vesc_success = true;
+  static bool slow_in_flight = false;   // The request in flight has the slow mask
+  switch (vescUart.pollRequest(COMM_GET_VALUES_SELECTIVE)) {
+    case VescUart::REQUEST_DONE:
+      handle_vesc_values(now, slow_in_flight);
+      break;
+    case VescUart::REQUEST_TIMEOUT:
+      handle_vesc_timeout(now);
+      break;
+    default:
       break;
-    }
-    vTaskDelay(pdMS_TO_TICKS(10));  // Use FreeRTOS delay instead of Arduino delay
   }
   
-  if (vesc_success) {
-    // Successful data query
-    vesc_data_valid = true;
-    last_vesc_data_time = now;
-    
-    // Calculate speed from eRPM (ELEGANT SOLUTION!)
-    float erpm = vescUart.data.rpm;
-    float pole_pairs = MOTOR_POLES / 2.0;           // 16 poles = 8 pole pairs
-    
-    // eRPM → motor revolutions → wheel revolutions → speed
-    float motor_rpm = erpm / pole_pairs;
-    current_motor_rpm = motor_rpm;
-    float wheel_rpm = motor_rpm / MOTOR_GEAR_RATIO;
-    float wheel_circumference_m = PI * WHEEL_DIAMETER_M;
-    
-    // km/h = (revolutions/min) × (circumference in m) × (60 min/h) × (1 km/1000m)
-    current_speed_kmh = wheel_rpm * wheel_circumference_m * 0.06; // 60/1000
-    
-    // Plausibility check (E-bikes don't go over 50 km/h)
-    if (current_speed_kmh < 0 || current_speed_kmh > 50.0) {
-      current_speed_kmh = 0.0;
-      vesc_data_valid = false;
-    }
-    
-    // Also read actual current for monitoring
-    actual_current_amps = vescUart.data.avgMotorCurrent;
-    
-    // Extended VESC data for web interface
-    float erpm_raw = vescUart.data.rpm;
-    float duty_cycle_raw = vescUart.data.dutyCycleNow;
-    float temp_mosfet_raw = vescUart.data.tempMosfet;
-    float temp_motor_raw = vescUart.data.tempMotor;
-    float amp_hours_raw = vescUart.data.ampHours;
-    float watt_hours_raw = vescUart.data.wattHours;
-    
-    // Update shared VESC data (thread-safe)
-    if (xSemaphoreTake(dataUpdateSemaphore, pdMS_TO_TICKS(5)) == pdTRUE) {
-      sharedVescData.speed_kmh = current_speed_kmh;
-      sharedVescData.data_valid = vesc_data_valid;
-      sharedVescData.actual_current = actual_current_amps;
-      sharedVescData.battery_voltage = battery_voltage;
-      sharedVescData.battery_percentage = battery_percentage;
-      
-      // Extended data
-      sharedVescData.rpm = erpm_raw;
-      sharedVescData.duty_cycle = duty_cycle_raw * 100.0; // Convert to percentage
-      sharedVescData.temp_mosfet = temp_mosfet_raw;
-      sharedVescData.temp_motor = temp_motor_raw;
-      sharedVescData.amp_hours = amp_hours_raw;
-      sharedVescData.watt_hours = watt_hours_raw;
-      sharedVescData.last_update = now;
-      
-      xSemaphoreGive(dataUpdateSemaphore);
-    }
-    
-    // Read battery voltage and calculate percentage
-    battery_voltage = vescUart.data.inpVoltage;
-    
-    // Calculate battery percentage (linear approximation)
-    // For 48V system: Full=54.6V (13S * 4.2V), Empty=40.8V (13S * 3.1V)
-    if (battery_voltage > BATTERY_FULL_VOLTAGE) {
-      battery_percentage = 100.0;
-    } else if (battery_voltage < BATTERY_CRITICAL_VOLTAGE) {
-      battery_percentage = 0.0;
+  // Next query - at most one selective request in flight
+  static unsigned long last_fast_query = 0;
+  static unsigned long last_slow_query = 0;
+  if (!vescUart.isPending(COMM_GET_VALUES_SELECTIVE) && now - last_fast_query >= VESC_FAST_POLL_MS) {
+    last_fast_query = now;
+    if (now - last_slow_query >= VESC_SLOW_POLL_MS) {
+      last_slow_query = now;
+      slow_in_flight = vescUart.requestVescValuesSelective(VESC_SLOW_VALUES);
     } else {
-      battery_percentage = ((battery_voltage - BATTERY_CRITICAL_VOLTAGE) / 
-                           (BATTERY_FULL_VOLTAGE - BATTERY_CRITICAL_VOLTAGE)) * 100.0;
+      vescUart.requestVescValuesSelective(VESC_FAST_VALUES);
+      slow_in_flight = false;
     }
-    
-    // Update battery status
-    update_battery_status();
-    
-  } else {
-    // VESC communication failed or timeout
-    vesc_data_valid = false;
+  }
+}
+
+static void handle_vesc_values(unsigned long now, bool slow) {
+  // Successful data query - the outage (if any) is over
+  vesc_data_valid = true;
+  last_vesc_data_time = now;
+  connection_lost_time = 0;
+  safe_mode_logged = false;
+  
+  // Calculate speed from eRPM (ELEGANT SOLUTION!)
+  float erpm = vescUart.data.rpm;
+  float pole_pairs = MOTOR_POLES / 2.0;           // 16 poles = 8 pole pairs
+  
+  // eRPM → motor revolutions → wheel revolutions → speed
+  float motor_rpm = erpm / pole_pairs;
+  current_motor_rpm = motor_rpm;
+  float wheel_rpm = motor_rpm / MOTOR_GEAR_RATIO;
+  float wheel_circumference_m = PI * WHEEL_DIAMETER_M;
+  
+  // km/h = (revolutions/min) × (circumference in m) × (60 min/h) × (1 km/1000m)
+  current_speed_kmh = wheel_rpm * wheel_circumference_m * 0.06; // 60/1000
+  
+  // Plausibility check (E-bikes don't go over 50 km/h)
+  if (current_speed_kmh < 0 || current_speed_kmh > 50.0) {
     current_speed_kmh = 0.0;
-    
-    // Connection lost handling
-    static unsigned long connection_lost_time = 0;
-    if (connection_lost_time == 0) {
-      connection_lost_time = now;
-      Serial.println("WARNING: VESC connection lost!");
-      addLogMessage("WARNING: VESC connection lost!");
-    }
-    
-    // After 5 seconds without connection, go to safe mode
-    if (now - connection_lost_time > 5000) {
-      motor_enabled = false;
-      addLogMessage("SAFETY: Motor disabled - VESC connection failed");
-      // Serial.println("SAFETY: Motor disabled due to VESC connection loss");
+    vesc_data_valid = false;
+  }
+  
+  // Actual current and battery voltage (monitoring, closed-loop tracking),
+  // internal resistance from the current steps
+  actual_current_amps = vescUart.data.avgMotorCurrent;
+  battery_voltage = vescUart.data.inpVoltage;
+  update_battery_model(battery_voltage, vescUart.data.avgInputCurrent, now);
+  float battery_ocv = battery_estimator().openCircuitVoltage();
+  
+  // Extended VESC data for web interface
+  float erpm_raw = vescUart.data.rpm;
+  float duty_cycle_raw = vescUart.data.dutyCycleNow;
+  float temp_mosfet_raw = vescUart.data.tempMosfet;
+  float temp_motor_raw = vescUart.data.tempMotor;
+  float amp_hours_raw = vescUart.data.ampHours;
+  float watt_hours_raw = vescUart.data.wattHours;
+  
+  // Publish shared VESC data (lock-free, this task is the only writer)
+  SharedVescData vesc_snapshot = sharedVescData.read();
+  vesc_snapshot.speed_kmh = current_speed_kmh;
+  vesc_snapshot.data_valid = vesc_data_valid;
+  vesc_snapshot.actual_current = actual_current_amps;
+  vesc_snapshot.input_current = vescUart.data.avgInputCurrent;
+  vesc_snapshot.battery_voltage = battery_voltage;
+  vesc_snapshot.battery_percentage = battery_percentage;
+  vesc_snapshot.battery_resistance = battery_estimator().resistance();
+  vesc_snapshot.battery_ocv = battery_ocv;
+  vesc_snapshot.values_count++;
+  if (slow) {
+    vesc_snapshot.temps_count++;
+  }
+  
+  // Extended data
+  vesc_snapshot.rpm = erpm_raw;
+  vesc_snapshot.duty_cycle = duty_cycle_raw * 100.0; // Convert to percentage
+  vesc_snapshot.temp_mosfet = temp_mosfet_raw;
+  vesc_snapshot.temp_motor = temp_motor_raw;
+  vesc_snapshot.amp_hours = amp_hours_raw;
+  vesc_snapshot.watt_hours = watt_hours_raw;
+  vesc_snapshot.last_update = now;
+  
+  sharedVescData.publish(vesc_snapshot);
+  
+  // Calculate battery percentage (linear approximation) from the open-circuit
+  // voltage - the sag under load is not charge used
+  // For 48V system: Full=54.6V (13S * 4.2V), Empty=40.8V (13S * 3.1V)
+  if (battery_ocv > BATTERY_FULL_VOLTAGE) {
+    battery_percentage = 100.0;
+  } else if (battery_ocv < BATTERY_CRITICAL_VOLTAGE) {
+    battery_percentage = 0.0;
+  } else {
+    battery_percentage = ((battery_ocv - BATTERY_CRITICAL_VOLTAGE) / 
+                         (BATTERY_FULL_VOLTAGE - BATTERY_CRITICAL_VOLTAGE)) * 100.0;
+  }
+  
+  // Update battery status
+  update_battery_status();
+}
+
+static void handle_vesc_timeout(unsigned long now) {
+  // VESC communication failed or timeout
+  vesc_data_valid = false;
+  current_speed_kmh = 0.0;
+  
+  // Connection lost handling
+  if (connection_lost_time == 0) {
+    connection_lost_time = now;
+    logDeferred(LOG_VESC_CONNECTION_LOST);
+  }
+  
+  // After 5 seconds without connection, go to safe mode
+  if (now - connection_lost_time > 5000) {
+    motor_enabled = false;
+    if (!safe_mode_logged) {  // Once, not on every timed-out request
+      logDeferred(LOG_VESC_SAFE_MODE);
+      safe_mode_logged = true;
     }
   }
 }
@@ -147,32 +188,25 @@ void update_battery_status() {
     if (!battery_critical) {
       battery_critical = true;
       battery_low = true;  // Critical implies low
-      Serial.printf("CRITICAL: Battery critically low! Voltage: %.1fV (%.1f%%) - Fast blinking!\n", 
-                   battery_voltage, battery_percentage);
-      addLogMessage("CRITICAL: Battery critically low! " + String(battery_percentage, 0) + "% (" + String(battery_voltage, 1) + "V)");
+      logDeferred(LOG_BATTERY_CRITICAL, battery_voltage, battery_percentage);
     }
   } else if (battery_percentage <= BATTERY_LOW_THRESHOLD) {
     // Check if battery is low (≤20%)
     if (!battery_low) {
       battery_low = true;
       battery_critical = false;
-      Serial.printf("WARNING: Low battery! Voltage: %.1fV (%.1f%%)\n", 
-                   battery_voltage, battery_percentage);
-      addLogMessage("WARNING: Battery low! " + String(battery_percentage, 0) + "% (" + String(battery_voltage, 1) + "V)");
+      logDeferred(LOG_BATTERY_LOW, battery_voltage, battery_percentage);
     } else if (battery_critical) {
       // Battery recovered from critical to low
       battery_critical = false;
-      Serial.printf("INFO: Battery recovered from critical to low. Voltage: %.1fV (%.1f%%)\n", 
-                   battery_voltage, battery_percentage);
-      addLogMessage("INFO: Battery recovered from critical to low. " + String(battery_percentage, 0) + "% (" + String(battery_voltage, 1) + "V)");
+      logDeferred(LOG_BATTERY_RECOVERED_LOW, battery_voltage, battery_percentage);
     }
   } else {
     // Battery is OK
     if (battery_low || battery_critical) {
       battery_low = false;
       battery_critical = false;
-      Serial.printf("INFO: Battery level OK again. Voltage: %.1fV (%.1f%%)\n", 
-                   battery_voltage, battery_percentage);
+      logDeferred(LOG_BATTERY_OK, battery_voltage, battery_percentage);
     }
   }
   
@@ -15,6 +15,9 @@
 
 #include "wifi_telemetry.h"
 #include "ebike_controller.h"
+#include "task_perf.h"
+#include "torque_zero.h"
+#include "torque_calibration.h"
 
 // External variables (defined in config.cpp)
 extern int current_mode;
@@ -26,29 +29,6 @@ TaskHandle_t wifiTaskHandle = NULL;
 WebServer webServer(WEB_SERVER_PORT);
 bool wifiConnected = false;
 
-// Log messages storage (thread-safe with mutex)
-SemaphoreHandle_t logMutex = NULL;
-String logMessages[MAX_LOG_MESSAGES];
-int logMessageCount = 0;
-int logMessageIndex = 0;
-
-// Add log message (thread-safe)
-void addLogMessage(const String& message) {
-  if (logMutex != NULL && xSemaphoreTake(logMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-    // Circular buffer für Log-Nachrichten
-    logMessages[logMessageIndex] = String(millis()) + ": " + message;
-    logMessageIndex = (logMessageIndex + 1) % MAX_LOG_MESSAGES;
-    if (logMessageCount < MAX_LOG_MESSAGES) {
-      logMessageCount++;
-    }
-    xSemaphoreGive(logMutex);
-  }
-}
-
-void addLogMessage(const char* message) {
-  addLogMessage(String(message));
-}
-
 // Web Interface HTML
 const char* webInterface = R"HTML(
 <!DOCTYPE html>
@@ -280,41 +260,146 @@ const char* webInterface = R"HTML(
 
 // API Handler für Telemetrie-Daten
 void handleTelemetryAPI() {
-  if (xSemaphoreTake(dataUpdateSemaphore, pdMS_TO_TICKS(10)) == pdTRUE) {
+  // Lock-free snapshots - the web handler never stalls the control loop
+  SharedSensorData sensor = sharedSensorData.read();
+  SharedVescData vesc = sharedVescData.read();
+  
+  JsonDocument doc;
+  
+  // Main telemetry data
+  doc["speed"] = vesc.speed_kmh;
+  doc["cadence"] = sensor.cadence_rpm;
+  doc["torque"] = sensor.filtered_torque;
+  doc["torque_peak"] = sensor.torque_peak_nm;
+  doc["battery"] = vesc.battery_percentage;
+  doc["current"] = vesc.actual_current;
+  doc["mode"] = sensor.current_mode;
+  doc["motor_enabled"] = sensor.motor_enabled;
+  doc["timestamp"] = millis();
+  
+  // Extended VESC data
+  doc["motor_rpm"] = vesc.rpm;
+  doc["duty_cycle"] = vesc.duty_cycle;
+  doc["temp_mosfet"] = vesc.temp_mosfet;
+  doc["temp_motor"] = vesc.temp_motor;
+  doc["battery_voltage"] = vesc.battery_voltage;
+  doc["amp_hours"] = vesc.amp_hours;
+  doc["watt_hours"] = vesc.watt_hours;
+  
+  // Motor command path latency (pedal sample -> SET_CURRENT on the UART)
+  MotorCommandLatency latency = motorCommandLatency.read();
+  doc["cmd_latency_us"] = latency.pedal_to_wire_us;
+  doc["cmd_latency_avg_us"] = latency.pedal_to_wire_avg_us;
+  doc["cmd_latency_max_us"] = latency.pedal_to_wire_max_us;
+  
+  // Add mode name from available profiles
+  if (sensor.current_mode >= 0 && sensor.current_mode < NUM_ACTIVE_PROFILES) {
+    doc["mode_name"] = AVAILABLE_PROFILES[sensor.current_mode].name;
+  }
+  
+  String response;
+  serializeJson(doc, response);
+  webServer.send(200, "application/json", response);
+}
+
+// API Handler für Task-Laufzeiten (run time / jitter histograms, ?reset=1 clears them)
+void handlePerfAPI() {
+  static char response[PERF_JSON_MAX];  // Only the WiFi task serves requests
+  
+  if (webServer.hasArg("reset")) {
+    taskPerfRequestReset();
+  }
+  
+  size_t length = taskPerfToJson(response, sizeof(response));
+  if (length >= sizeof(response)) {
+    // Too many occupied buckets - fall back to the summary without buckets
+    taskPerfToCompactJson(response, sizeof(response));
+  }
+  webServer.send(200, "application/json", response);
+}
+
+// API Handler für den Torque-Nullpunkt (auto-zero, newest history entry last)
+void handleTorqueZeroAPI() {
+  static const char* SOURCES[] = {"nvs", "boot", "tracking"};
+  TorqueZeroStatus zero = torque_zero_status();  // Lock-free snapshot
+  
+  JsonDocument doc;
+  doc["zero"] = zero.zero_counts;
+  doc["factory"] = TORQUE_STANDSTILL;
+  doc["saved"] = zero.saved_counts;
+  doc["calibrated"] = zero.calibrated != 0;
+  doc["boot"] = zero.boot;
+  doc["saves"] = zero.saves;
+  JsonArray history = doc["history"].to<JsonArray>();
+  for (uint32_t i = 0; i < zero.history_count && i < TORQUE_ZERO_HISTORY; i++) {
+    JsonObject entry = history.add<JsonObject>();
+    entry["boot"] = zero.history[i].boot;
+    entry["uptime_s"] = zero.history[i].uptime_s;
+    entry["zero"] = zero.history[i].zero_counts;
+    entry["source"] = zero.history[i].source <= TORQUE_ZERO_FROM_TRACKING ? SOURCES[zero.history[i].source] : "?";
+  }
+  
+  String response;
+  serializeJson(doc, response);
+  webServer.send(200, "application/json", response);
+}
+
+static void calPointsToJson(JsonArray array, const TorqueCalPoint* points, uint32_t count) {
+  for (uint32_t i = 0; i < count && i < TORQUE_CAL_MAX_POINTS; i++) {
+    JsonArray point = array.add<JsonArray>();
+    point.add(points[i].counts);
+    point.add(points[i].nm);
+  }
+}
+
+static bool calPointsFromJson(JsonArrayConst array, TorqueCalPoint* points, uint32_t& count) {
+  if (array.isNull() || array.size() > TORQUE_CAL_MAX_POINTS) {
+    return false;
+  }
+  count = 0;
+  for (JsonArrayConst point : array) {
+    if (point.size() != 2 || !point[0].is<float>() || !point[1].is<float>()) {
+      return false;
+    }
+    points[count].counts = point[0].as<float>();
+    points[count].nm = point[1].as<float>();
+    count++;
+  }
+  return true;
+}
+
+// API Handler für die Torque-Kalibrierung
+// GET: {"forward":[[counts,nm],...],"backward":[...]} (deviation from the zero)
+// POST: same format (tools/torque_cal_fit.py), stored in NVS; answers with
+// the new table, sensorTask applies it on its next tick
+void handleTorqueCalAPI() {
+  TorqueCalTable table = torque_calibration_table();
+  if (webServer.method() == HTTP_POST) {
     JsonDocument doc;
-    
-    // Main telemetry data
-    doc["speed"] = sharedVescData.speed_kmh;
-    doc["cadence"] = sharedSensorData.cadence_rpm;
-    doc["torque"] = sharedSensorData.filtered_torque;
-    doc["battery"] = sharedVescData.battery_percentage;
-    doc["current"] = sharedVescData.actual_current;
-    doc["mode"] = sharedSensorData.current_mode;
-    doc["motor_enabled"] = sharedSensorData.motor_enabled;
-    doc["timestamp"] = millis();
-    
-    // Extended VESC data
-    doc["motor_rpm"] = sharedVescData.rpm;
-    doc["duty_cycle"] = sharedVescData.duty_cycle;
-    doc["temp_mosfet"] = sharedVescData.temp_mosfet;
-    doc["temp_motor"] = sharedVescData.temp_motor;
-    doc["battery_voltage"] = sharedVescData.battery_voltage;
-    doc["amp_hours"] = sharedVescData.amp_hours;
-    doc["watt_hours"] = sharedVescData.watt_hours;
-    
-    // Add mode name from available profiles
-    if (sharedSensorData.current_mode >= 0 && sharedSensorData.current_mode < NUM_ACTIVE_PROFILES) {
-      doc["mode_name"] = AVAILABLE_PROFILES[sharedSensorData.current_mode].name;
+    if (deserializeJson(doc, webServer.arg("plain")) != DeserializationError::Ok) {
+      webServer.send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+      return;
     }
     
-    String response;
-    serializeJson(doc, response);
-    webServer.send(200, "application/json", response);
-    
-    xSemaphoreGive(dataUpdateSemaphore);
-  } else {
-    webServer.send(503, "application/json", "{\"error\":\"Data unavailable\"}");
+    table = {};
+    table.version = TORQUE_CAL_VERSION;
+    if (!calPointsFromJson(doc["forward"].as<JsonArrayConst>(), table.forward, table.forward_points) ||
+        !calPointsFromJson(doc["backward"].as<JsonArrayConst>(), table.backward, table.backward_points) ||
+        !torque_calibration_set(table, true)) {
+      webServer.send(400, "application/json", "{\"error\":\"Invalid calibration table\"}");
+      return;
+    }
+    addLogMessage("Torque calibration updated: " + String(table.forward_points) + " forward / " +
+                  String(table.backward_points) + " backward points");
   }
+  
+  JsonDocument doc;
+  calPointsToJson(doc["forward"].to<JsonArray>(), table.forward, table.forward_points);
+  calPointsToJson(doc["backward"].to<JsonArray>(), table.backward, table.backward_points);
+  
+  String response;
+  serializeJson(doc, response);
+  webServer.send(200, "application/json", response);
 }
 
 // API Handler für Log-Nachrichten
@@ -458,6 +543,10 @@ void wifiTelemetryTask(void *pvParameters) {
     // API Routes
     webServer.on("/api/telemetry", HTTP_GET, handleTelemetryAPI);
     webServer.on("/api/logs", HTTP_GET, handleLogsAPI);
+    webServer.on("/api/perf", HTTP_GET, handlePerfAPI);
+    webServer.on("/api/torque_zero", HTTP_GET, handleTorqueZeroAPI);
+    webServer.on("/api/torque_cal", HTTP_GET, handleTorqueCalAPI);
+    webServer.on("/api/torque_cal", HTTP_POST, handleTorqueCalAPI);
     webServer.on("/api/modes", HTTP_GET, handleModesAPI);
     webServer.on("/api/changemode", HTTP_POST, handleChangeModeAPI);
     
@@ -474,7 +563,11 @@ void wifiTelemetryTask(void *pvParameters) {
   TickType_t xLastWakeTime = xTaskGetTickCount();
   const TickType_t xFrequency = pdMS_TO_TICKS(TELEMETRY_UPDATE_RATE_MS);
   
+  taskPerfRegister(TASK_PERF_WIFI, "wifi", TELEMETRY_UPDATE_RATE_MS * 1000UL, TELEMETRY_UPDATE_RATE_MS * 1000UL);
+  
   for (;;) {
+    taskPerfBeginPeriodic(TASK_PERF_WIFI);
+    
     // Web Server verarbeiten
     if (wifiConnected) {
       webServer.handleClient();
@@ -504,6 +597,8 @@ void wifiTelemetryTask(void *pvParameters) {
       }
     }
     
+    taskPerfEnd(TASK_PERF_WIFI);
+    
     // Warten bis nächster Zyklus
     vTaskDelayUntil(&xLastWakeTime, xFrequency);
   }
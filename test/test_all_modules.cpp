@@ -1,193 +1,60 @@
 #include <unity.h>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <RideSimulator.h>
+#include <ScriptedStream.h>
+#include <VescUart.h>
+#include "cadence_estimator.h"
+#include "crank_torque.h"
+#include "deferred_log.h"
+#include "log_messages.h"
+#include "pas_counter.h"
+#include "driver/adc.h"
+#include "driver/pcnt.h"
+#include "seqlock.h"
+#include "task_perf.h"
+#include "torque_adc.h"
+#include "torque_zero.h"
+#include "torque_calibration.h"
+#include "assist_table.h"
+#include "current_shaper.h"
+#include "current_tracking.h"
+#include "thermal_derating.h"
+#include "battery_model.h"
+#include "motor_map.h"
+#include <Preferences.h>
 #include "test_mocks.h"
 
+// The firmware's VESC link (config.cpp)
+extern VescUart vescUart;
+
 // =============================================================================
-// GLOBAL MOCK VARIABLES (shared across all test modules)
+// TEST SETUP AND TEARDOWN
 // =============================================================================
+// The modules under test are the real ones from src/ (config.cpp holds the
+// globals). Only the assist profiles are replaced: config.cpp ships a single
+// "Linear" profile, the tests use three with distinct curves.
 
-// Torque sensor variables
-int raw_torque_value = 2880;
-float crank_torque_nm = 0.0;
-float filtered_torque = 20.0;
-bool debug_mode = false;
-bool debug_simulate_torque = false;
-
-// Assist calculation variables
-float SPEED_POINTS_KMH[NUM_SPEED_POINTS] = {0, 5, 10, 15, 20, 30};
-float ASSIST_PROFILES[3][NUM_SPEED_POINTS] = {
+static const float TEST_ASSIST_PROFILES[3][NUM_SPEED_POINTS] = {
     {2.0, 1.8, 1.5, 1.2, 1.0, 0.8}, // Sport mode
-    {1.5, 1.3, 1.1, 0.9, 0.7, 0.5}, // Eco mode  
+    {1.5, 1.3, 1.1, 0.9, 0.7, 0.5}, // Eco mode
     {1.0, 1.0, 1.0, 1.0, 1.0, 1.0}  // Linear mode
 };
-float current_speed_kmh = 0.0;
-float current_motor_rpm = 0.0;
-int current_mode = 0;
-bool vesc_data_valid = true;
-float dynamic_assist_factor = 1.0;
-float current_cadence_rps = 1.5;
-float human_power_watts = 0.0;
-float assist_power_watts = 0.0;
-float target_current_amps = 0.0;
-
-// Motor control variables
-bool motor_enabled = false;
-float current_cadence_rpm = 0.0;
-int pedal_direction = 1;
-unsigned long last_pedal_activity = 0;
-
-// Battery monitoring variables
-float battery_voltage = 48.0;
-float battery_percentage = 100.0;
-bool battery_low = false;
-bool battery_critical = false;
-bool battery_led_state = false;
-unsigned long last_battery_led_toggle = 0;
-
-// VESC communication variables
-float actual_current_amps = 0.0;
-
-// Mock millis function
-static unsigned long mock_millis_value = 1000;
-unsigned long millis() { return mock_millis_value; }
-
-// Mock Arduino functions
-int analogRead(int pin) { (void)pin; return raw_torque_value; }
-void digitalWrite(int pin, int state) { (void)pin; (void)state; }
-
-// =============================================================================
-// MOCK FUNCTION IMPLEMENTATIONS
-// =============================================================================
-
-void update_torque() {
-    if (debug_mode && debug_simulate_torque) return;
-    
-    raw_torque_value = analogRead(36);
-    int deviation_from_center = raw_torque_value - TORQUE_STANDSTILL;
-    int absolute_deviation = abs(deviation_from_center);
-    
-    if (absolute_deviation < TORQUE_THRESHOLD) {
-        crank_torque_nm = 0.0;
-    } else {
-        int max_deviation = max(TORQUE_STANDSTILL - TORQUE_MAX_BACKWARD, 
-                               TORQUE_MAX_FORWARD - TORQUE_STANDSTILL);
-        crank_torque_nm = (float)absolute_deviation / max_deviation * TORQUE_MAX_NM;
-    }
-    
-    if (crank_torque_nm > TORQUE_MAX_NM) crank_torque_nm = TORQUE_MAX_NM;
-    if (crank_torque_nm < 0.0) crank_torque_nm = 0.0;
-    filtered_torque = crank_torque_nm;
-}
-
-void calculate_speed_dependent_assist() {
-    if (!vesc_data_valid) {
-        dynamic_assist_factor = ASSIST_PROFILES[current_mode][0];
-        return;
-    }
-    
-    int lower_index = 0, upper_index = NUM_SPEED_POINTS - 1;
-    
-    for (int i = 0; i < NUM_SPEED_POINTS - 1; i++) {
-        if (current_speed_kmh >= SPEED_POINTS_KMH[i] && 
-            current_speed_kmh <= SPEED_POINTS_KMH[i + 1]) {
-            lower_index = i;
-            upper_index = i + 1;
-            break;
-        }
-    }
-    
-    if (current_speed_kmh <= SPEED_POINTS_KMH[0]) {
-        dynamic_assist_factor = ASSIST_PROFILES[current_mode][0];
-        return;
-    }
-    
-    if (current_speed_kmh >= SPEED_POINTS_KMH[NUM_SPEED_POINTS - 1]) {
-        dynamic_assist_factor = ASSIST_PROFILES[current_mode][NUM_SPEED_POINTS - 1];
-        return;
-    }
-    
-    float speed_low = SPEED_POINTS_KMH[lower_index];
-    float speed_high = SPEED_POINTS_KMH[upper_index];
-    float assist_low = ASSIST_PROFILES[current_mode][lower_index];
-    float assist_high = ASSIST_PROFILES[current_mode][upper_index];
-    
-    float interpolation_factor = (current_speed_kmh - speed_low) / (speed_high - speed_low);
-    dynamic_assist_factor = assist_low + interpolation_factor * (assist_high - assist_low);
-    dynamic_assist_factor = constrain(dynamic_assist_factor, 0.0f, 4.0f);
-}
-
-void calculate_assist_power() {
-    human_power_watts = filtered_torque * current_cadence_rps * 2.0 * PI;
-    if (human_power_watts > 500.0) human_power_watts = 500.0;
-    
-    calculate_speed_dependent_assist();
-    assist_power_watts = dynamic_assist_factor * human_power_watts;
-    
-    if (assist_power_watts > MAX_MOTOR_POWER) assist_power_watts = MAX_MOTOR_POWER;
-    
-    if (assist_power_watts > 0 && VOLTAGE_BATTERY > 0) {
-        target_current_amps = assist_power_watts / VOLTAGE_BATTERY;
-    } else {
-        target_current_amps = 0.0;
-    }
-    
-    target_current_amps = constrain(target_current_amps, 0.0f, (float)MAX_MOTOR_CURRENT);
-    if (target_current_amps > 0 && target_current_amps < MIN_MOTOR_CURRENT) {
-        target_current_amps = MIN_MOTOR_CURRENT;
-    }
-}
-
-void update_motor_status() {
-    unsigned long now = millis();
-    bool pas_active = (now - last_pedal_activity) < PEDAL_TIMEOUT_MS;
-    bool torque_present = abs(filtered_torque) > 0.2;
-    bool cadence_valid = current_cadence_rpm > 2.0;
-    bool mode_allows_assist = (current_mode >= 0 && current_mode < 3);
-    bool forward_pedaling = pedal_direction > 0;
-    
-    motor_enabled = pas_active && torque_present && cadence_valid && 
-                   mode_allows_assist && forward_pedaling && vesc_data_valid;
-    
-    if (current_cadence_rpm > 250.0) motor_enabled = false;
-    if (abs(raw_torque_value - TORQUE_STANDSTILL) < TORQUE_THRESHOLD) motor_enabled = false;
-    if (current_speed_kmh > 45.0) {
-        motor_enabled = false;
-        target_current_amps = 0.0;
-    }
-}
-
-void update_battery_status() {
-    battery_low = battery_percentage < BATTERY_LOW_THRESHOLD;
-    battery_critical = battery_percentage < BATTERY_CRITICAL_THRESHOLD;
-    
-    if (battery_voltage < BATTERY_CRITICAL_VOLTAGE) {
-        battery_critical = true;
-    }
-}
-
-void update_battery_led() {
-    unsigned long now = millis();
-    
-    if (!battery_low) {
-        digitalWrite(BATTERY_LED_PIN, LOW);
-        return;
-    }
-    
-    unsigned long blink_interval = battery_critical ? 
-        BATTERY_LED_FAST_BLINK_INTERVAL : BATTERY_LED_BLINK_INTERVAL;
-    
-    if (now - last_battery_led_toggle >= blink_interval) {
-        battery_led_state = !battery_led_state;
-        digitalWrite(BATTERY_LED_PIN, battery_led_state ? HIGH : LOW);
-        last_battery_led_toggle = now;
-    }
-}
-
-// =============================================================================
-// TEST SETUP AND TEARDOWN
-// =============================================================================
 
 void setUp(void) {
     // Reset all variables to known state
+    hal_reset_pins();
+    hal_set_millis(2000);
+
+    initializeAssistProfiles();
+    memcpy(ASSIST_PROFILES, TEST_ASSIST_PROFILES, sizeof(TEST_ASSIST_PROFILES));
+    build_assist_tables();
+
+    hal_set_analog(TORQUE_SENSOR_PIN, TORQUE_STANDSTILL);
     raw_torque_value = TORQUE_STANDSTILL;
     crank_torque_nm = 0.0;
     filtered_torque = 20.0;
@@ -195,6 +62,7 @@ void setUp(void) {
     debug_simulate_torque = false;
     
     current_speed_kmh = 0.0;
+    current_motor_rpm = 0.0;
     current_mode = 0;
     vesc_data_valid = true;
     dynamic_assist_factor = 1.0;
@@ -206,8 +74,7 @@ void setUp(void) {
     motor_enabled = false;
     current_cadence_rpm = 70.0;
     pedal_direction = 1;
-    mock_millis_value = 2000;
-    last_pedal_activity = mock_millis_value - 100;
+    last_pedal_activity = millis() - 100;
     
     battery_voltage = 48.0;
     battery_percentage = 100.0;
@@ -217,10 +84,23 @@ void setUp(void) {
     last_battery_led_toggle = 0;
     
     actual_current_amps = 0.0;
+
+    // update_motor_status() only enables the motor with VESC data < 1 s old
+    SharedVescData vesc = {};
+    vesc.data_valid = true;
+    vesc.last_update = millis();
+    sharedVescData.publish(vesc);
 }
 
 void tearDown(void) {
-    // Clean up after each test
+    // Clean up after each test: PAS tests may have switched to the GPIO counter,
+    // the ride simulator starts DMA torque sampling and the auto-zero (the
+    // unit tests use analogRead and TORQUE_STANDSTILL, with the linear
+    // default calibration)
+    select_pas_counter(&pasPcntCounter);
+    torque_adc_end();
+    torque_zero_end();
+    torque_calibration_set(torque_cal_default_table(), false);
 }
 
 // =============================================================================
@@ -228,28 +108,28 @@ void tearDown(void) {
 // =============================================================================
 
 void test_torque_sensor_neutral_position(void) {
-    raw_torque_value = TORQUE_STANDSTILL;
+    hal_set_analog(TORQUE_SENSOR_PIN, TORQUE_STANDSTILL);
     update_torque();
     TEST_ASSERT_EQUAL_FLOAT(0.0, crank_torque_nm);
     TEST_ASSERT_EQUAL_FLOAT(0.0, filtered_torque);
 }
 
 void test_torque_sensor_below_threshold(void) {
-    raw_torque_value = TORQUE_STANDSTILL + (TORQUE_THRESHOLD - 1);
+    hal_set_analog(TORQUE_SENSOR_PIN, TORQUE_STANDSTILL + (TORQUE_THRESHOLD - 1));
     update_torque();
     TEST_ASSERT_EQUAL_FLOAT(0.0, crank_torque_nm);
     TEST_ASSERT_EQUAL_FLOAT(0.0, filtered_torque);
 }
 
 void test_torque_sensor_above_threshold(void) {
-    raw_torque_value = TORQUE_STANDSTILL + TORQUE_THRESHOLD + 100;
+    hal_set_analog(TORQUE_SENSOR_PIN, TORQUE_STANDSTILL + TORQUE_THRESHOLD + 100);
     update_torque();
     TEST_ASSERT_TRUE(crank_torque_nm > 0.0);
     TEST_ASSERT_EQUAL_FLOAT(crank_torque_nm, filtered_torque);
 }
 
 void test_torque_sensor_maximum_forward(void) {
-    raw_torque_value = TORQUE_MAX_FORWARD;
+    hal_set_analog(TORQUE_SENSOR_PIN, TORQUE_MAX_FORWARD);
     update_torque();
     
     float expected_torque = (float)(TORQUE_MAX_FORWARD - TORQUE_STANDSTILL) / 
@@ -262,17 +142,727 @@ void test_torque_sensor_maximum_forward(void) {
 }
 
 void test_torque_sensor_symmetry(void) {
-    raw_torque_value = TORQUE_STANDSTILL + 500;
+    hal_set_analog(TORQUE_SENSOR_PIN, TORQUE_STANDSTILL + 500);
     update_torque();
     float torque_forward = crank_torque_nm;
     
-    raw_torque_value = TORQUE_STANDSTILL - 500;
+    hal_set_analog(TORQUE_SENSOR_PIN, TORQUE_STANDSTILL - 500);
     update_torque();
     float torque_backward = crank_torque_nm;
     
     TEST_ASSERT_FLOAT_WITHIN(0.1, torque_forward, torque_backward);
 }
 
+void test_cic_decimator_step_response(void) {
+    CicDecimator cic(TORQUE_ADC_DECIMATION);
+
+    // Start-up transient is discarded, a constant input comes out exactly
+    for (int i = 0; i < TORQUE_ADC_CIC_ORDER * TORQUE_ADC_DECIMATION; i++) {
+        cic.push(2000);
+    }
+    TEST_ASSERT_FALSE(cic.ready());
+    int outputs = 0;
+    for (int i = 0; i < TORQUE_ADC_DECIMATION; i++) {
+        if (cic.push(2000)) outputs++;
+    }
+    TEST_ASSERT_EQUAL(1, outputs);
+    TEST_ASSERT_TRUE(cic.ready());
+    TEST_ASSERT_EQUAL_FLOAT(2000.0f, cic.output());
+
+    // Step: half way after one output (triangular response), settled after two
+    for (int i = 0; i < TORQUE_ADC_DECIMATION; i++) cic.push(3000);
+    TEST_ASSERT_FLOAT_WITHIN(5.0f, 2500.0f, cic.output());
+    for (int i = 0; i < TORQUE_ADC_DECIMATION; i++) cic.push(3000);
+    TEST_ASSERT_EQUAL_FLOAT(3000.0f, cic.output());
+
+    // Integrators wrap around after ~350 outputs at full scale: still exact
+    for (int i = 0; i < 1000 * TORQUE_ADC_DECIMATION; i++) cic.push(4095);
+    TEST_ASSERT_EQUAL_FLOAT(4095.0f, cic.output());
+}
+
+// Torque noise (standard deviation [Nm]) over 100 sensor ticks
+static float torque_noise_nm(float& mean) {
+    double sum = 0.0, sum_sq = 0.0;
+    const int ticks = 100;
+    for (int i = 0; i < ticks; i++) {
+        hal_advance_time_us(10000);
+        update_torque();
+        sum += crank_torque_nm;
+        sum_sq += crank_torque_nm * crank_torque_nm;
+    }
+    mean = (float)(sum / ticks);
+    return (float)sqrt(sum_sq / ticks - (sum / ticks) * (sum / ticks));
+}
+
+void test_torque_adc_dma_decimates_noise(void) {
+    // 100 counts forward, the ADC scatters every conversion by +-40 counts
+    const float expected_nm = 100.0f / TORQUE_STANDSTILL * TORQUE_MAX_NM;
+    hal_set_analog(TORQUE_SENSOR_PIN, TORQUE_STANDSTILL + 100);
+    hal_set_analog_noise(TORQUE_SENSOR_PIN, 40);
+
+    float raw_mean;
+    float raw_noise = torque_noise_nm(raw_mean);
+
+    TEST_ASSERT_TRUE(torque_adc_begin());
+    TEST_ASSERT_TRUE(torque_adc_active());
+    TorqueAdcStats before = torque_adc_stats();
+
+    // Settling: the torque holds its previous value, nothing waits
+    filtered_torque = 20.0;
+    hal_advance_time_us(10000);
+    update_torque();
+    TEST_ASSERT_EQUAL_FLOAT(20.0, filtered_torque);
+    for (int i = 0; i < 5; i++) {
+        hal_advance_time_us(10000);
+        update_torque();
+    }
+
+    float dma_mean;
+    float dma_noise = torque_noise_nm(dma_mean);
+    printf("  INFO: torque noise: single read %.2f Nm, DMA+CIC %.2f Nm (mean %.2f / %.2f Nm)\n",
+           raw_noise, dma_noise, raw_mean, dma_mean);
+    TEST_ASSERT_FLOAT_WITHIN(0.3f, expected_nm, dma_mean);
+    TEST_ASSERT_TRUE(dma_noise < raw_noise / 8.0f);
+
+    // 20 kHz, all of channel 0, no frames lost at the 10ms tick
+    const TorqueAdcStats& after = torque_adc_stats();
+    TEST_ASSERT_UINT_WITHIN(2 * TORQUE_ADC_DECIMATION, 106 * TORQUE_ADC_DECIMATION,
+                              after.conversions - before.conversions);
+    TEST_ASSERT_EQUAL(0, after.overruns - before.overruns);
+    TEST_ASSERT_EQUAL(0, after.foreign - before.foreign);
+
+    // sensorTask stalls 100ms: the buffer overflows, the read reports it once
+    // and keeps decimating what is left
+    hal_advance_time_us(100000);
+    update_torque();
+    TEST_ASSERT_EQUAL(1, torque_adc_stats().overruns - before.overruns);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, expected_nm, crank_torque_nm);
+
+    torque_adc_end();
+    TEST_ASSERT_FALSE(torque_adc_active());
+    TEST_ASSERT_EQUAL(0, hal_adc_conversions());
+}
+
+// update_torque() every 10ms with the crank idle for the auto-zero
+static void run_idle_torque_ticks(int ticks) {
+    for (int i = 0; i < ticks; i++) {
+        hal_advance_time_us(10000);
+        update_torque();
+    }
+}
+
+void test_torque_zero_boot_calibration_and_tracking(void) {
+    hal_nvs_erase();
+    current_cadence_rpm = 0.0;
+    current_cadence_rps = 0.0;
+    pedal_direction = 0;
+    last_pedal_activity = millis() - 5000;
+
+    // Fresh board, zero drifted by 20 counts: phantom torque with the factory zero
+    hal_set_analog(TORQUE_SENSOR_PIN, TORQUE_STANDSTILL + 20);
+    torque_zero_begin();
+    TorqueZeroStatus zero = torque_zero_status();
+    TEST_ASSERT_EQUAL(1, zero.boot);
+    TEST_ASSERT_FALSE(zero.calibrated);
+    TEST_ASSERT_EQUAL(0, zero.history_count);
+    run_idle_torque_ticks(50);
+    TEST_ASSERT_TRUE(crank_torque_nm > 1.0);
+
+    // Boot calibration after one quiet window, written to NVS right away
+    run_idle_torque_ticks(60);
+    zero = torque_zero_status();
+    TEST_ASSERT_TRUE(zero.calibrated);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, TORQUE_STANDSTILL + 20.0f, zero.zero_counts);
+    TEST_ASSERT_EQUAL_FLOAT(0.0, crank_torque_nm);
+    TEST_ASSERT_EQUAL(1, zero.saves);
+    TEST_ASSERT_EQUAL(1, zero.history_count);
+    TEST_ASSERT_EQUAL(TORQUE_ZERO_FROM_BOOT, zero.history[0].source);
+    uint32_t writes = hal_nvs_writes();
+
+    // A foot resting on the stopped pedal is quiet too, but not followed
+    hal_set_analog(TORQUE_SENSOR_PIN, TORQUE_STANDSTILL + 120);
+    run_idle_torque_ticks(3000);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, TORQUE_STANDSTILL + 20.0f, torque_zero_counts());
+    TEST_ASSERT_TRUE(crank_torque_nm > 5.0);
+
+    // Pedaling: no tracking
+    hal_set_analog(TORQUE_SENSOR_PIN, TORQUE_STANDSTILL + 26);
+    current_cadence_rpm = 60.0;
+    pedal_direction = 1;
+    run_idle_torque_ticks(3000);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, TORQUE_STANDSTILL + 20.0f, torque_zero_counts());
+
+    // Slow drift while parked: followed with TORQUE_ZERO_TRACK_TAU_S, the
+    // history records every count, NVS waits for the save interval
+    current_cadence_rpm = 0.0;
+    pedal_direction = 0;
+    last_pedal_activity = millis() - 5000;
+    run_idle_torque_ticks(12000);
+    zero = torque_zero_status();
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, TORQUE_STANDSTILL + 26.0f - 6.0f * expf(-120.0f / TORQUE_ZERO_TRACK_TAU_S),
+                             zero.zero_counts);
+    TEST_ASSERT_TRUE(zero.history_count >= 5);
+    TEST_ASSERT_EQUAL(TORQUE_ZERO_FROM_TRACKING, zero.history[zero.history_count - 1].source);
+    TEST_ASSERT_EQUAL(writes, hal_nvs_writes());
+    run_idle_torque_ticks(TORQUE_ZERO_SAVE_INTERVAL_MS / 10);
+    zero = torque_zero_status();
+    TEST_ASSERT_EQUAL(2, zero.saves);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, TORQUE_STANDSTILL + 26.0f, zero.saved_counts);
+    TEST_ASSERT_EQUAL(writes + 2, hal_nvs_writes());   // Zero + history
+
+    // Reboot: zero and history from NVS
+    float learned = torque_zero_counts();
+    uint32_t history_count = zero.history_count;
+    torque_zero_end();
+    torque_zero_begin();
+    zero = torque_zero_status();
+    TEST_ASSERT_EQUAL(2, zero.boot);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, learned, zero.zero_counts);
+    TEST_ASSERT_EQUAL(min(history_count + 1, (uint32_t)TORQUE_ZERO_HISTORY), zero.history_count);
+    TEST_ASSERT_EQUAL(TORQUE_ZERO_FROM_NVS, zero.history[zero.history_count - 1].source);
+    torque_zero_end();
+
+    // Fresh board booted with a foot on the pedal: waits for free pedals
+    hal_nvs_erase();
+    hal_set_analog(TORQUE_SENSOR_PIN, TORQUE_STANDSTILL + 200);
+    torque_zero_begin();
+    run_idle_torque_ticks(300);
+    TEST_ASSERT_FALSE(torque_zero_status().calibrated);
+    TEST_ASSERT_EQUAL_FLOAT((float)TORQUE_STANDSTILL, torque_zero_counts());
+    hal_set_analog(TORQUE_SENSOR_PIN, TORQUE_STANDSTILL - 10);
+    run_idle_torque_ticks(110);
+    TEST_ASSERT_TRUE(torque_zero_status().calibrated);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, TORQUE_STANDSTILL - 10.0f, torque_zero_counts());
+}
+
+// Straight search over the points, as a reference for the O(1) lookup
+static float naive_cal_nm(const TorqueCalPoint* points, uint32_t count, float deviation) {
+    uint32_t i = 0;
+    while (i + 2 < count && deviation >= points[i + 1].counts) {
+        i++;
+    }
+    float slope = (points[i + 1].nm - points[i].nm) / (points[i + 1].counts - points[i].counts);
+    return points[i].nm + slope * (deviation - points[i].counts);
+}
+
+void test_torque_calibration_table(void) {
+    hal_nvs_erase();
+    torque_calibration_begin();
+
+    // Default table: the original linear scale
+    float full_scale = TORQUE_STANDSTILL - TORQUE_MAX_BACKWARD;
+    for (int dev = 0; dev <= 4095; dev += 5) {
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, dev / full_scale * TORQUE_MAX_NM, torque_calibration_nm((float)dev));
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, dev / full_scale * TORQUE_MAX_NM, torque_calibration_nm((float)-dev));
+    }
+
+    // Measured curve (progressive strain gauge, stiffer backwards), points
+    // at odd spacings and one exactly on a grid cell border
+    TorqueCalTable table = {};
+    table.version = TORQUE_CAL_VERSION;
+    const TorqueCalPoint forward[] = {{0, 0}, {40, 2.5f}, {96, 7}, {128, 10}, {161, 14}, {300, 30},
+                                      {520, 55}, {900, 98}, {1400, 150}, {2100, 215}, {2900, 270}, {3900, 300}};
+    const TorqueCalPoint backward[] = {{0, 0}, {250, 18}, {1000, 60}, {2880, 140}};
+    table.forward_points = sizeof(forward) / sizeof(forward[0]);
+    table.backward_points = sizeof(backward) / sizeof(backward[0]);
+    memcpy(table.forward, forward, sizeof(forward));
+    memcpy(table.backward, backward, sizeof(backward));
+    TEST_ASSERT_TRUE(torque_calibration_set(table, true));
+
+    // Every deviation (and one in between) matches the straight search,
+    // beyond the last point the last segment is extended
+    for (int dev = 0; dev <= 4095; dev++) {
+        for (float x = (float)dev; x < dev + 1.0f; x += 0.5f) {
+            TEST_ASSERT_FLOAT_WITHIN(0.001f, naive_cal_nm(forward, table.forward_points, x), torque_calibration_nm(x));
+            TEST_ASSERT_FLOAT_WITHIN(0.001f, naive_cal_nm(backward, table.backward_points, x), torque_calibration_nm(-x));
+        }
+    }
+    TEST_ASSERT_EQUAL_FLOAT(14.0f, torque_calibration_nm(161.0f));
+    TEST_ASSERT_EQUAL(12, torque_calibration_table().forward_points);
+
+    // update_torque() uses it: 96 counts forward = 7 Nm
+    hal_set_analog(TORQUE_SENSOR_PIN, TORQUE_STANDSTILL + 96);
+    update_torque();
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 7.0f, crank_torque_nm);
+
+    // Broken tables are rejected and change nothing
+    TorqueCalTable bad = table;
+    bad.forward[3].counts = bad.forward[2].counts + 10;       // Closer than a grid cell
+    TEST_ASSERT_FALSE(torque_calibration_set(bad, true));
+    bad = table;
+    bad.backward[2].nm = 10;                                  // Decreasing
+    TEST_ASSERT_FALSE(torque_calibration_set(bad, true));
+    bad = table;
+    bad.forward[0].nm = 1;                                    // Not through (0, 0)
+    TEST_ASSERT_FALSE(torque_calibration_set(bad, true));
+    bad = table;
+    bad.forward_points = 1;
+    TEST_ASSERT_FALSE(torque_calibration_set(bad, true));
+    bad = table;
+    bad.backward[3].nm = NAN;
+    TEST_ASSERT_FALSE(torque_calibration_set(bad, true));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 7.0f, torque_calibration_nm(96.0f));
+
+    // Reboot: the table comes back from NVS
+    torque_calibration_set(torque_cal_default_table(), false);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 10.0f, torque_calibration_nm(96.0f));
+    torque_calibration_begin();
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 7.0f, torque_calibration_nm(96.0f));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 18.0f, torque_calibration_nm(-250.0f));
+    hal_nvs_erase();
+}
+
+// =============================================================================
+// PAS SENSOR (EDGE RING DECODER) TESTS
+// =============================================================================
+// Edges are injected through the pins, so the selected PAS counter sees them
+// exactly as on the ESP32 (GPIO interrupts or the pulse counter emulation of
+// lib/HostHal). Forward pedaling = 00, 01, 11, 10.
+
+static const uint8_t PAS_FORWARD_SEQUENCE[4] = {0, 1, 3, 2};
+static int pasTestStep = 0;
+
+static void attach_pas_test_counter(PasCounter* counter) {
+    hal_set_digital(PAS_PIN_A, 0);
+    hal_set_digital(PAS_PIN_B, 0);
+    TEST_ASSERT_TRUE(select_pas_counter(counter));
+    pasTestStep = 0;
+    current_cadence_rpm = 0.0;
+}
+
+// One quadrature step (direction +1/-1) at the current virtual time
+static void pas_test_edge(int direction) {
+    pasTestStep += direction;
+    uint8_t state = PAS_FORWARD_SEQUENCE[pasTestStep & 3];
+    hal_set_digital(PAS_PIN_A, (state >> 1) & 1);
+    hal_set_digital(PAS_PIN_B, state & 1);
+}
+
+void test_pas_edge_ring_decodes_every_edge(void) {
+    attach_pas_test_counter(&pasGpioCounter);
+    unsigned long edges_before = pas_edges_decoded;
+    unsigned long invalid_before = pas_invalid_transitions;
+
+    // 200 RPM = 32 edges in 300ms, one edge every 9375us. sensorTask only
+    // polls every 50ms here, so each read_pas_sensors() sees ~5 edges.
+    const uint32_t edge_interval_us = 9375;
+    uint64_t t = hal_time_us();
+    uint64_t next_poll = t + 50000;
+    uint64_t last_edge = t;
+    for (int i = 0; i < 96; i++) {
+        t += edge_interval_us;
+        while (next_poll < t) {
+            hal_set_time_us(next_poll);
+            read_pas_sensors();
+            next_poll += 50000;
+        }
+        hal_set_time_us(t);
+        pas_test_edge(1);
+        last_edge = t;
+    }
+    hal_set_time_us(next_poll);
+    read_pas_sensors();
+
+    TEST_ASSERT_EQUAL(96, pos);
+    TEST_ASSERT_EQUAL(1, pedal_direction);
+    TEST_ASSERT_EQUAL(96, (int)(pas_edges_decoded - edges_before));
+    TEST_ASSERT_EQUAL(0, (int)(pas_invalid_transitions - invalid_before));
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 200.0, current_cadence_rpm);
+
+    // Edge time, not poll time (millis() clock)
+    TEST_ASSERT_UINT_WITHIN(1, (unsigned long)(last_edge / 1000), last_pulse_time);
+    TEST_ASSERT_EQUAL(last_pulse_time, last_pedal_activity);
+
+    // Three steps back are all counted for the mode switch
+    for (int i = 0; i < 3; i++) {
+        t += 20000;
+        hal_set_time_us(t);
+        pas_test_edge(-1);
+    }
+    read_pas_sensors();
+    TEST_ASSERT_EQUAL(93, pos);
+    TEST_ASSERT_EQUAL(-1, pedal_direction);
+}
+
+void test_pas_edge_ring_bounce_and_overflow(void) {
+    attach_pas_test_counter(&pasGpioCounter);
+    uint64_t t = hal_time_us();
+    for (int i = 0; i < 4; i++) {
+        t += 20000;
+        hal_set_time_us(t);
+        pas_test_edge(1);
+    }
+
+    // Contact bounce: forward, back and forward again within 300us
+    t += 20000;
+    hal_set_time_us(t);
+    pas_test_edge(1);
+    hal_set_time_us(t + 150);
+    pas_test_edge(-1);
+    hal_set_time_us(t + 300);
+    pas_test_edge(1);
+    read_pas_sensors();
+    TEST_ASSERT_EQUAL(5, pos);
+    TEST_ASSERT_EQUAL(1, pedal_direction);
+
+    // More edges than the ring holds between two polls: the surplus is
+    // dropped and counted, the decoder re-reads the pins and carries on
+    uint32_t dropped_before = pasEdgeRing.dropped();
+    for (int i = 0; i < PAS_EDGE_RING_CAPACITY + 10; i++) {
+        t += 10000;
+        hal_set_time_us(t);
+        pas_test_edge(1);
+    }
+    read_pas_sensors();
+    TEST_ASSERT_EQUAL(10, (int)(pasEdgeRing.dropped() - dropped_before));
+    TEST_ASSERT_EQUAL(5 + PAS_EDGE_RING_CAPACITY, pos);
+
+    for (int i = 0; i < 4; i++) {
+        t += 10000;
+        hal_set_time_us(t);
+        pas_test_edge(1);
+    }
+    read_pas_sensors();
+    TEST_ASSERT_EQUAL(5 + PAS_EDGE_RING_CAPACITY + 4, pos);
+    TEST_ASSERT_EQUAL(1, pedal_direction);
+}
+
+// sensorTask ticks (10ms) with PAS edges every edge_interval_us in between.
+// Returns the time of the last edge.
+static uint64_t pas_test_pedal(uint64_t& t, int edges, uint32_t edge_interval_us) {
+    uint64_t next_tick = t - t % 10000 + 10000;
+    uint64_t last_edge = t;
+    for (int i = 0; i < edges; i++) {
+        uint64_t edge_time = t + edge_interval_us;
+        while (next_tick <= edge_time) {
+            hal_set_time_us(next_tick);
+            read_pas_sensors();
+            update_cadence();
+            next_tick += 10000;
+        }
+        hal_set_time_us(edge_time);
+        pas_test_edge(1);
+        t = last_edge = edge_time;
+    }
+    return last_edge;
+}
+
+void test_pas_predictive_stop_and_start(void) {
+    attach_pas_test_counter(&pasGpioCounter);
+    uint64_t t = hal_time_us();
+
+    // 60 RPM = one edge every 31250us, then the crank stops
+    uint64_t last_edge = pas_test_pedal(t, 64, 31250);
+    read_pas_sensors();
+    update_cadence();
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 60.0, current_cadence_rpm);
+
+    // Overdue edge: cadence capped before the stop is declared
+    uint64_t stop_us = 0;
+    bool capped = false;
+    for (uint64_t tick = last_edge - last_edge % 10000 + 10000; tick < last_edge + 1000000; tick += 10000) {
+        hal_set_time_us(tick);
+        read_pas_sensors();
+        update_cadence();
+        if (current_cadence_rpm > 0.0 && current_cadence_rpm < 59.0) capped = true;
+        if (pedal_direction == 0) {
+            stop_us = tick - last_edge;
+            break;
+        }
+    }
+    TEST_ASSERT_TRUE(capped);
+    TEST_ASSERT_TRUE(stop_us > (uint64_t)(PAS_STOP_INTERVALS * 31250));
+    TEST_ASSERT_TRUE(stop_us <= (uint64_t)(PAS_STOP_INTERVALS * 31250) + 10000);   // Next tick
+    TEST_ASSERT_EQUAL_FLOAT(0.0, current_cadence_rpm);
+
+    // Restart: the first edge alone is no pedaling (bump, bounce), the
+    // second forward edge gives cadence and assist
+    t = hal_time_us() + 2000000;
+    raw_torque_value = TORQUE_STANDSTILL + TORQUE_THRESHOLD + 100;
+    filtered_torque = 15.0;
+    pas_test_pedal(t, 1, 0);
+    read_pas_sensors();
+    update_cadence();
+    TEST_ASSERT_EQUAL_FLOAT(0.0, current_cadence_rpm);
+
+    pas_test_pedal(t, 1, 250000);   // Slow first step: 7.5 RPM
+    read_pas_sensors();
+    update_cadence();
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 7.5, current_cadence_rpm);
+    TEST_ASSERT_EQUAL(1, pedal_direction);
+
+    SharedVescData vesc = {};
+    vesc.data_valid = true;
+    vesc.last_update = millis();
+    sharedVescData.publish(vesc);
+    update_motor_status();
+    TEST_ASSERT_TRUE(motor_enabled);
+}
+
+// Uneven crank: magnet placement error plus hall sensor B off by 15%
+static double uneven_edge_weight(int k) {
+    return 1.0 + 0.25 * sin(2.0 * PI * k / CADENCE_EDGES_PER_REV) + ((k & 1) ? 0.15 : -0.15);
+}
+
+void test_cadence_estimator_calibrates_uneven_edges(void) {
+    CadenceEstimator estimator;
+    double weight_sum = 0.0;
+    for (int k = 0; k < CADENCE_EDGES_PER_REV; k++) weight_sum += uneven_edge_weight(k);
+
+    // 90 RPM: one revolution = 666667us, split by the uneven edge weights
+    const double revolution_us = 60e6 / 90.0;
+    double t = 1000.0;
+    int32_t index = 0;
+    float first_rev_error = 0.0f, last_rev_error = 0.0f, single_step_error = 0.0f;
+    const int revolutions = 100;
+
+    for (int rev = 0; rev < revolutions; rev++) {
+        for (int k = 0; k < CADENCE_EDGES_PER_REV; k++) {
+            double step_us = revolution_us * uneven_edge_weight(k) / weight_sum;
+            t += step_us;
+            index++;
+            if (!estimator.addForwardEdge(index, (uint32_t)t)) continue;
+
+            float error = fabsf(estimator.cadenceRpm() - 90.0f);
+            float step_rpm = (float)(60e6 / (step_us * CADENCE_EDGES_PER_REV));  // One step x 32
+            if (rev == 1 && error > first_rev_error) first_rev_error = error;
+            if (rev == revolutions - 1 && error > last_rev_error) last_rev_error = error;
+            if (fabsf(step_rpm - 90.0f) > single_step_error) single_step_error = fabsf(step_rpm - 90.0f);
+        }
+    }
+
+    char info[160];
+    snprintf(info, sizeof(info),
+             "Cadence at 90 RPM, uneven edges: single step +-%.1f RPM, window uncalibrated +-%.2f, calibrated +-%.3f",
+             single_step_error, first_rev_error, last_rev_error);
+    TEST_MESSAGE(info);
+
+    TEST_ASSERT_TRUE(single_step_error > 20.0f);
+    TEST_ASSERT_TRUE(first_rev_error > 1.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.3, 90.0, 90.0f + last_rev_error);
+
+    // Each edge learned its share of the revolution (edge k ends step k)
+    for (int k = 0; k < CADENCE_EDGES_PER_REV; k++) {
+        float expected = (float)(uneven_edge_weight(k) / weight_sum);
+        TEST_ASSERT_FLOAT_WITHIN(0.02f * expected, expected, estimator.edgeShare(k + 1));
+    }
+}
+
+void test_cadence_estimator_follows_cadence_step(void) {
+    CadenceEstimator estimator;
+    uint32_t t = 1000;
+    int32_t index = 0;
+
+    // 60 RPM, then 90 RPM from one edge to the next
+    for (int i = 0; i < 64; i++) {
+        t += 31250;
+        estimator.addForwardEdge(++index, t);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.1, 60.0, estimator.cadenceRpm());
+
+    uint32_t change_us = t;
+    uint32_t settled_us = 0;
+    for (int i = 0; i < 64 && settled_us == 0; i++) {
+        t += 20833;
+        estimator.addForwardEdge(++index, t);
+        if (fabsf(estimator.cadenceRpm() - 90.0f) < 1.0f) settled_us = t - change_us;
+    }
+    TEST_ASSERT_TRUE(settled_us > 0);
+    TEST_ASSERT_TRUE(settled_us <= CADENCE_WINDOW_US);
+
+    // Bounce (same edge again) is ignored, a gap starts over, backward breaks the sequence
+    float before = estimator.cadenceRpm();
+    TEST_ASSERT_FALSE(estimator.addForwardEdge(index, t + 200));
+    TEST_ASSERT_EQUAL_FLOAT(before, estimator.cadenceRpm());
+    estimator.breakSequence();
+    TEST_ASSERT_FALSE(estimator.addForwardEdge(++index, t + 20833));
+    TEST_ASSERT_TRUE(estimator.addForwardEdge(++index, t + 2 * 20833));
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 90.0, estimator.cadenceRpm());  // Single step: shares learned around the step change
+}
+
+void test_pas_pcnt_counts_quadrature(void) {
+    attach_pas_test_counter(&pasPcntCounter);
+    uint16_t filter = 0;
+    pcnt_get_filter_value((pcnt_unit_t)PAS_PCNT_UNIT, &filter);
+    TEST_ASSERT_EQUAL(PAS_PCNT_FILTER_CYCLES, filter);
+    unsigned long edges_before = pas_edges_decoded;
+    uint32_t interrupts_before = hal_pcnt_interrupts((pcnt_unit_t)PAS_PCNT_UNIT);
+
+    // 200 RPM with 50ms polls, as in test_pas_edge_ring_decodes_every_edge:
+    // the counter sees every edge, the CPU one interrupt per magnet
+    uint64_t t = hal_time_us();
+    uint64_t next_poll = t + 50000;
+    for (int i = 0; i < 96; i++) {
+        t += 9375;
+        while (next_poll < t) {
+            hal_set_time_us(next_poll);
+            read_pas_sensors();
+            next_poll += 50000;
+        }
+        hal_set_time_us(t);
+        pas_test_edge(1);
+    }
+    hal_set_time_us(next_poll);
+    read_pas_sensors();
+
+    TEST_ASSERT_EQUAL(96, pos);
+    TEST_ASSERT_EQUAL(1, pedal_direction);
+    TEST_ASSERT_EQUAL(96, (int)(pas_edges_decoded - edges_before));
+    TEST_ASSERT_EQUAL(96 / PAS_PCNT_STEP_EDGES, (int)(hal_pcnt_interrupts((pcnt_unit_t)PAS_PCNT_UNIT) - interrupts_before));
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 200.0, current_cadence_rpm);
+
+    // Between two magnets: position and direction from the counter value
+    for (int i = 0; i < 3; i++) {
+        t += 20000;
+        hal_set_time_us(t);
+        pas_test_edge(-1);
+    }
+    read_pas_sensors();
+    TEST_ASSERT_EQUAL(93, pos);
+    TEST_ASSERT_EQUAL(-1, pedal_direction);
+
+    // Rocking around a magnet boundary: one capture per crossing, pos exact
+    for (int i = 0; i < 6; i++) {
+        t += 20000;
+        hal_set_time_us(t);
+        pas_test_edge((i & 1) ? 1 : -1);
+        read_pas_sensors();
+    }
+    TEST_ASSERT_EQUAL(93, pos);
+    TEST_ASSERT_EQUAL(0, (int)pasPcntCounter.lostSteps());
+}
+
+void test_pas_pcnt_stop_and_start(void) {
+    attach_pas_test_counter(&pasPcntCounter);
+    uint64_t t = hal_time_us();
+
+    // 60 RPM (31250us per edge, 125ms per magnet), then the crank stops
+    uint64_t last_edge = pas_test_pedal(t, 64, 31250);
+    read_pas_sensors();
+    update_cadence();
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 60.0, current_cadence_rpm);
+
+    // Stop declared from the polled position, not after 3 magnets
+    uint64_t stop_us = 0;
+    for (uint64_t tick = last_edge - last_edge % 10000 + 10000; tick < last_edge + 1000000; tick += 10000) {
+        hal_set_time_us(tick);
+        read_pas_sensors();
+        update_cadence();
+        if (pedal_direction == 0) {
+            stop_us = tick - last_edge;
+            break;
+        }
+    }
+    TEST_ASSERT_TRUE(stop_us > (uint64_t)(PAS_STOP_INTERVALS * 31250));
+    TEST_ASSERT_TRUE(stop_us <= (uint64_t)(PAS_STOP_INTERVALS * 31250) + 20000);   // Poll + next tick
+    TEST_ASSERT_EQUAL_FLOAT(0.0, current_cadence_rpm);
+
+    // Restart: the second edge gives cadence although no magnet was captured
+    t = hal_time_us() + 2000000;
+    uint32_t captures_before = hal_pcnt_interrupts((pcnt_unit_t)PAS_PCNT_UNIT);
+    pas_test_pedal(t, 1, 0);
+    read_pas_sensors();
+    update_cadence();
+    TEST_ASSERT_EQUAL_FLOAT(0.0, current_cadence_rpm);
+    TEST_ASSERT_EQUAL(1, pedal_direction);
+
+    pas_test_pedal(t, 1, 250000);   // 7.5 RPM, +-one poll
+    read_pas_sensors();
+    update_cadence();
+    TEST_ASSERT_EQUAL(captures_before, hal_pcnt_interrupts((pcnt_unit_t)PAS_PCNT_UNIT));
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 7.5, current_cadence_rpm);
+}
+
+void test_cadence_estimator_magnet_steps(void) {
+    // PCNT captures: one step per magnet, 4 edges each. The uneven crank of
+    // test_cadence_estimator_calibrates_uneven_edges, seen every 4th edge.
+    CadenceEstimator estimator;
+    double weight_sum = 0.0;
+    for (int k = 0; k < CADENCE_EDGES_PER_REV; k++) weight_sum += uneven_edge_weight(k);
+
+    const double revolution_us = 60e6 / 90.0;
+    double t = 1000.0;
+    int32_t index = 0;
+    float last_rev_error = 0.0f;
+    for (int rev = 0; rev < 100; rev++) {
+        for (int k = 0; k < CADENCE_EDGES_PER_REV; k += PAS_PCNT_STEP_EDGES) {
+            double weight = 0.0;
+            for (int e = 0; e < PAS_PCNT_STEP_EDGES; e++) weight += uneven_edge_weight(k + e);
+            t += revolution_us * weight / weight_sum;
+            index += PAS_PCNT_STEP_EDGES;
+            if (!estimator.addForwardEdge(index, (uint32_t)t)) continue;
+            float error = fabsf(estimator.cadenceRpm() - 90.0f);
+            if (rev == 99 && error > last_rev_error) last_rev_error = error;
+        }
+    }
+    TEST_ASSERT_TRUE(estimator.calibrationUpdates() > 0);
+    TEST_ASSERT_FLOAT_WITHIN(0.3, 90.0, 90.0f + last_rev_error);
+    TEST_ASSERT_EQUAL(PAS_PCNT_STEP_EDGES, (int)estimator.lastStepEdges());
+
+    // Each magnet learned the share of its 4 edges
+    for (int k = 0; k < CADENCE_EDGES_PER_REV; k += PAS_PCNT_STEP_EDGES) {
+        float expected = 0.0f, learned = 0.0f;
+        for (int e = 0; e < PAS_PCNT_STEP_EDGES; e++) {
+            expected += (float)(uneven_edge_weight(k + e) / weight_sum);
+            learned += estimator.edgeShare(k + e + 1);
+        }
+        TEST_ASSERT_FLOAT_WITHIN(0.02f * expected, expected, learned);
+    }
+
+    // A step longer than one magnet (missed capture) starts a new sequence
+    TEST_ASSERT_FALSE(estimator.addForwardEdge(index + 2 * PAS_PCNT_STEP_EDGES, (uint32_t)t + 200000));
+}
+
+// Crank torque of the ride simulator's rider: two strokes per revolution
+static float stroke_torque_nm(float mean_nm, double crank_rev) {
+    return mean_nm * (1.0f - 0.7f * (float)cos(2.0 * 2.0 * PI * crank_rev));
+}
+
+void test_crank_torque_average_removes_stroke_pulse(void) {
+    const float cadences_rpm[] = {40.0f, 60.0f, 95.0f};
+    for (float cadence_rpm : cadences_rpm) {
+        CrankTorqueAverager averager;
+        long edges_seen = 0;
+        float avg_min = 1e9f, avg_max = 0.0f, peak_min = 1e9f;
+
+        // 10ms sensor ticks for 3 revolutions, the first one fills the window
+        for (int tick = 1; tick <= (int)(3 * 60.0f / cadence_rpm * 100.0f); tick++) {
+            double rev = cadence_rpm / 60.0 * tick * 0.01;
+            long edges = (long)(rev * CADENCE_EDGES_PER_REV);
+            bool closed = averager.addSample(stroke_torque_nm(20.0f, rev), (uint32_t)(edges - edges_seen));
+            TEST_ASSERT_EQUAL(edges != edges_seen, closed);
+            edges_seen = edges;
+            if (rev >= 1.0) {
+                avg_min = min(avg_min, averager.average());
+                avg_max = max(avg_max, averager.average());
+                peak_min = min(peak_min, averager.peak());
+            }
+        }
+        printf("  INFO: %.0f RPM: crank average %.1f..%.1f Nm (instantaneous 6..34), stroke peak >= %.1f Nm\n",
+               cadence_rpm, avg_min, avg_max, peak_min);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, 20.0f, avg_min);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, 20.0f, avg_max);
+        TEST_ASSERT_FLOAT_WITHIN(2.0f, 33.0f, peak_min);
+    }
+
+    // From standstill: the samples before the first edge, then the bins so far
+    CrankTorqueAverager averager;
+    TEST_ASSERT_FALSE(averager.addSample(10.0f, 0));
+    TEST_ASSERT_FALSE(averager.addSample(20.0f, 0));
+    TEST_ASSERT_EQUAL_FLOAT(15.0f, averager.average());
+    TEST_ASSERT_EQUAL_FLOAT(20.0f, averager.peak());
+    TEST_ASSERT_TRUE(averager.addSample(30.0f, 2));
+    TEST_ASSERT_EQUAL_FLOAT(20.0f, averager.average());
+    TEST_ASSERT_EQUAL(2, averager.edgesInWindow());
+    TEST_ASSERT_TRUE(averager.addSample(40.0f, 1));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, (20.0f + 20.0f + 40.0f) / 3.0f, averager.average());
+    TEST_ASSERT_EQUAL_FLOAT(40.0f, averager.peak());
+
+    averager.reset();
+    TEST_ASSERT_EQUAL(0, averager.edgesInWindow());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, averager.average());
+}
+
 // =============================================================================
 // ASSIST CALCULATION TESTS
 // =============================================================================
@@ -316,6 +906,248 @@ void test_assist_calculation_edge_cases(void) {
     TEST_ASSERT_EQUAL_FLOAT(2.0, dynamic_assist_factor);
 }
 
+// calculate_speed_dependent_assist() before the lookup tables: interval
+// search and slope on every call
+static float legacy_speed_dependent_assist(const float* speeds, const float* factors, int count, float speed) {
+    int lower_index = 0;
+    int upper_index = count - 1;
+    for (int i = 0; i < count - 1; i++) {
+        if (speed >= speeds[i] && speed <= speeds[i + 1]) {
+            lower_index = i;
+            upper_index = i + 1;
+            break;
+        }
+    }
+    if (speed <= speeds[0]) return factors[0];
+    if (speed >= speeds[count - 1]) return factors[count - 1];
+    float t = (speed - speeds[lower_index]) / (speeds[upper_index] - speeds[lower_index]);
+    return constrain(factors[lower_index] + t * (factors[upper_index] - factors[lower_index]), 0.0, 4.0);
+}
+
+// Finer profile than NUM_SPEED_POINTS: 32 points, uneven spacing, one
+// point off the 0.1 km/h grid and two only one cell apart
+static void fine_assist_profile(float* speeds, float* factors) {
+    for (int i = 0; i < ASSIST_TABLE_MAX_POINTS; i++) {
+        speeds[i] = i * 0.9f + (i % 3) * 0.05f;
+        factors[i] = 2.0f + 1.5f * sinf(i * 0.7f);
+    }
+    speeds[1] = 0.1f;
+    speeds[2] = 0.2f;
+}
+
+void test_assist_table_matches_interpolation(void) {
+    // Every 0.001 km/h from -5 to 60 km/h, all test profiles
+    for (int mode = 0; mode < 3; mode++) {
+        current_mode = mode;
+        for (int i = -5000; i <= 60000; i++) {
+            current_speed_kmh = i * 0.001f;
+            calculate_speed_dependent_assist();
+            float expected = legacy_speed_dependent_assist(SPEED_POINTS_KMH, ASSIST_PROFILES[mode], NUM_SPEED_POINTS,
+                                                           current_speed_kmh);
+            TEST_ASSERT_FLOAT_WITHIN(1e-5f, expected, dynamic_assist_factor);
+        }
+    }
+
+    // Fine profile, including both sides of every point
+    float speeds[ASSIST_TABLE_MAX_POINTS], factors[ASSIST_TABLE_MAX_POINTS];
+    fine_assist_profile(speeds, factors);
+    AssistTable table;
+    TEST_ASSERT_TRUE(table.build(speeds, factors, ASSIST_TABLE_MAX_POINTS));
+    for (int i = -1000; i <= 40000; i++) {
+        float speed = i * 0.001f;
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, legacy_speed_dependent_assist(speeds, factors, ASSIST_TABLE_MAX_POINTS, speed),
+                                 table.factor(speed));
+    }
+    for (int i = 0; i < ASSIST_TABLE_MAX_POINTS; i++) {
+        float below = nextafterf(speeds[i], -1.0f);
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, factors[i], table.factor(speeds[i]));
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, legacy_speed_dependent_assist(speeds, factors, ASSIST_TABLE_MAX_POINTS, below),
+                                 table.factor(below));
+    }
+    TEST_ASSERT_EQUAL_FLOAT(factors[0], table.factor(NAN));
+
+    // More than 60 km/h of points: coarser grid, same result
+    float wide_speeds[3] = {0.0f, 40.0f, 100.0f};
+    float wide_factors[3] = {1.0f, 3.0f, 0.5f};
+    TEST_ASSERT_TRUE(table.build(wide_speeds, wide_factors, 3));
+    for (int i = 0; i <= 110000; i += 7) {
+        float speed = i * 0.001f;
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, legacy_speed_dependent_assist(wide_speeds, wide_factors, 3, speed),
+                                 table.factor(speed));
+    }
+
+    // Broken profiles are rejected and leave the table unchanged
+    wide_speeds[2] = 40.0f;
+    TEST_ASSERT_FALSE(table.build(wide_speeds, wide_factors, 3));
+    TEST_ASSERT_FALSE(table.build(wide_speeds, wide_factors, 1));
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, table.factor(100.0f));
+}
+
+// Host CPU time per lookup, lookup table vs the interval search it replaced,
+// for the shipped 6-point grid and a 32-point profile
+#define ASSIST_BENCH_LOOKUPS  2000000
+
+static double bench_assist_ns(const AssistTable& table, const float* speeds, const float* factors, int count,
+                              bool legacy) {
+    volatile float sink = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ASSIST_BENCH_LOOKUPS; i++) {
+        float speed = ((uint32_t)i * 7919u % 32000u) * 0.001f;   // Scattered over 0..32 km/h
+        sink = sink + (legacy ? legacy_speed_dependent_assist(speeds, factors, count, speed) : table.factor(speed));
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+           ASSIST_BENCH_LOOKUPS;
+}
+
+void test_assist_table_benchmark(void) {
+    AssistTable table;
+    TEST_ASSERT_TRUE(table.build(SPEED_POINTS_KMH, ASSIST_PROFILES[0], NUM_SPEED_POINTS));
+    double table6_ns = bench_assist_ns(table, SPEED_POINTS_KMH, ASSIST_PROFILES[0], NUM_SPEED_POINTS, false);
+    double legacy6_ns = bench_assist_ns(table, SPEED_POINTS_KMH, ASSIST_PROFILES[0], NUM_SPEED_POINTS, true);
+
+    float speeds[ASSIST_TABLE_MAX_POINTS], factors[ASSIST_TABLE_MAX_POINTS];
+    fine_assist_profile(speeds, factors);
+    TEST_ASSERT_TRUE(table.build(speeds, factors, ASSIST_TABLE_MAX_POINTS));
+    double table32_ns = bench_assist_ns(table, speeds, factors, ASSIST_TABLE_MAX_POINTS, false);
+    double legacy32_ns = bench_assist_ns(table, speeds, factors, ASSIST_TABLE_MAX_POINTS, true);
+
+    char line[200];
+    snprintf(line, sizeof(line),
+             "Assist factor: table %.1f / %.1f ns, interval search %.1f / %.1f ns (%d / %d points, host CPU)",
+             table6_ns, table32_ns, legacy6_ns, legacy32_ns, NUM_SPEED_POINTS, ASSIST_TABLE_MAX_POINTS);
+    TEST_MESSAGE(line);
+    // For reading only: two ~10 ns wall-clock runs do not compare reliably
+    // under host load
+}
+
+// Map of f = 0.5 + 0.04 * speed + 0.01 * cadence + 0.002 * power at
+// uneven grid points: trilinear interpolation reproduces it exactly inside
+static constexpr float linear_assist(float speed, float cadence, float power) {
+    return 0.5f + 0.04f * speed + 0.01f * cadence + 0.002f * power;
+}
+
+#define LINEAR_ASSIST_ROW(s, c) {linear_assist(s, c, 0), linear_assist(s, c, 100), linear_assist(s, c, 400)}
+#define LINEAR_ASSIST_PLANE(s) {LINEAR_ASSIST_ROW(s, 30), LINEAR_ASSIST_ROW(s, 70), LINEAR_ASSIST_ROW(s, 120)}
+
+static constexpr AssistMap<4, 3, 3> LINEAR_ASSIST_MAP = {
+    {0, 8, 12, 25}, {30, 70, 120}, {0, 100, 400},
+    {LINEAR_ASSIST_PLANE(0), LINEAR_ASSIST_PLANE(8), LINEAR_ASSIST_PLANE(12), LINEAR_ASSIST_PLANE(25)}
+};
+ASSIST_MAP_CHECK(LINEAR_ASSIST_MAP);
+
+// Speed x cadence only
+static constexpr AssistMap<2, 2, 1> SPEED_CADENCE_MAP = {{0, 20}, {40, 80}, {100}, {{{1.0}, {2.0}}, {{0.5}, {1.0}}}};
+ASSIST_MAP_CHECK(SPEED_CADENCE_MAP);
+
+// Rejected at compile time
+static constexpr AssistMap<2, 1, 1> SPEED_NOT_INCREASING = {{10, 10}, {0}, {0}, {{{1.0}}, {{1.0}}}};
+static constexpr AssistMap<2, 1, 2> FACTOR_TOO_HIGH = {{0, 10}, {0}, {0, 100}, {{{1.0, 4.5}}, {{1.0, 1.0}}}};
+static_assert(!assist_map_valid(SPEED_NOT_INCREASING), "speed axis check");
+static_assert(!assist_map_valid(FACTOR_TOO_HIGH), "factor range check");
+
+void test_assist_map_interpolation(void) {
+    // Inside the grid: exact, wherever the cursor was before (slow sweep
+    // and random jumps), outside: held at the nearest grid value
+    AssistMapCursor sweep = {};
+    AssistMapCursor jump = {};
+    uint32_t seed = 12345;
+    for (int i = 0; i < 20000; i++) {
+        float speed = -2.0f + i * 0.0015f;
+        float cadence = 20.0f + (i % 1100) * 0.1f;
+        float power = i * 0.025f;
+        float expected = linear_assist(constrain(speed, 0.0f, 25.0f), constrain(cadence, 30.0f, 120.0f),
+                                       constrain(power, 0.0f, 400.0f));
+        TEST_ASSERT_FLOAT_WITHIN(1e-4f, expected, assist_map_factor(LINEAR_ASSIST_MAP, sweep, speed, cadence, power));
+
+        seed = seed * 1103515245u + 12345u;
+        float s = (seed >> 8) % 2500 * 0.01f;
+        float c = 30.0f + (seed >> 4) % 900 * 0.1f;
+        float p = (seed >> 12) % 400;
+        TEST_ASSERT_FLOAT_WITHIN(1e-4f, linear_assist(s, c, p), assist_map_factor(LINEAR_ASSIST_MAP, jump, s, c, p));
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, linear_assist(0, 30, 0), assist_map_factor(LINEAR_ASSIST_MAP, jump, NAN, NAN, NAN));
+
+    // 2-D map: the single-point power axis is ignored
+    AssistMapCursor cursor = {};
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.5f, assist_map_factor(SPEED_CADENCE_MAP, cursor, 0.0f, 60.0f, 0.0f));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.125f, assist_map_factor(SPEED_CADENCE_MAP, cursor, 10.0f, 60.0f, 500.0f));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, assist_map_factor(SPEED_CADENCE_MAP, cursor, 30.0f, 100.0f, 50.0f));
+}
+
+void test_assist_map_profile(void) {
+    static constexpr AssistProfileMap CADENCE_MAP = {
+        {0, 5, 10, 15, 20, 30}, {40, 60, 80, 100}, {50, 150, 300},
+        {{{1.0, 1.0, 1.0}, {1.0, 1.0, 1.0}, {2.0, 2.0, 2.0}, {2.0, 2.0, 2.0}},
+         {{1.0, 1.0, 1.0}, {1.0, 1.0, 1.0}, {2.0, 2.0, 2.0}, {2.0, 2.0, 2.0}},
+         {{1.0, 1.0, 1.0}, {1.0, 1.0, 1.0}, {2.0, 2.0, 2.0}, {2.0, 2.0, 2.0}},
+         {{1.0, 1.0, 1.0}, {1.0, 1.0, 1.0}, {2.0, 2.0, 2.0}, {2.0, 2.0, 2.0}},
+         {{1.0, 1.0, 1.0}, {1.0, 1.0, 1.0}, {2.0, 2.0, 2.0}, {2.0, 2.0, 2.0}},
+         {{0.5, 0.5, 0.5}, {0.5, 0.5, 0.5}, {1.0, 1.0, 1.0}, {1.0, 1.0, 1.0}}}
+    };
+    ASSIST_MAPS[2] = &CADENCE_MAP;
+    current_mode = 2;
+    current_speed_kmh = 10.0;
+    filtered_torque = 10.0;
+
+    // Same torque, the factor follows the cadence
+    current_cadence_rpm = 50.0;
+    current_cadence_rps = current_cadence_rpm / 60.0;
+    calculate_assist_power();
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.0, dynamic_assist_factor);
+    TEST_ASSERT_FLOAT_WITHIN(0.5, human_power_watts, assist_power_watts);
+
+    current_cadence_rpm = 70.0;
+    current_cadence_rps = current_cadence_rpm / 60.0;
+    calculate_assist_power();
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.5, dynamic_assist_factor);
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 1.5 * human_power_watts, assist_power_watts);
+
+    // ... and the speed; without VESC data the 0 km/h plane
+    current_speed_kmh = 25.0;
+    calculate_assist_power();
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.125, dynamic_assist_factor);
+    vesc_data_valid = false;
+    calculate_assist_power();
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.5, dynamic_assist_factor);
+
+    // Speed-only profiles are unchanged
+    ASSIST_MAPS[2] = nullptr;
+    vesc_data_valid = true;
+    calculate_assist_power();
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.0, dynamic_assist_factor);
+}
+
+// Host CPU time per map evaluation at the 10ms tick: slowly changing inputs
+// (cached cells) and random inputs (cell search every call)
+#define ASSIST_MAP_BENCH_CALLS  1000000
+
+void test_assist_map_benchmark(void) {
+    AssistMapCursor cursor = {};
+    volatile float sink = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ASSIST_MAP_BENCH_CALLS; i++) {
+        float t = (i % 100000) * 0.00001f;
+        sink = sink + assist_map_factor(LINEAR_ASSIST_MAP, cursor, 25.0f * t, 30.0f + 90.0f * t, 400.0f * t);
+    }
+    double ride_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                     ASSIST_MAP_BENCH_CALLS;
+
+    uint32_t seed = 1;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ASSIST_MAP_BENCH_CALLS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        sink = sink + assist_map_factor(LINEAR_ASSIST_MAP, cursor, (seed >> 8) % 26, 30 + (seed >> 4) % 90,
+                                        (seed >> 12) % 400);
+    }
+    double random_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                       ASSIST_MAP_BENCH_CALLS;
+
+    char line[200];
+    snprintf(line, sizeof(line), "Assist map 4x3x3: %.1f ns riding, %.1f ns random inputs (host CPU)",
+             ride_ns, random_ns);
+    TEST_MESSAGE(line);   // Host timing for reading only: load and -O level dependent
+}
+
 void test_power_calculation(void) {
     filtered_torque = 20.0;
     current_cadence_rps = 1.5;
@@ -329,6 +1161,22 @@ void test_power_calculation(void) {
     TEST_ASSERT_FLOAT_WITHIN(0.1, 7.29, target_current_amps); // 350W / 48V
 }
 
+void test_power_calculation_uses_motor_rpm(void) {
+    // Above 10 motor RPM the current comes from Kt(I, rpm) × I = P / ω, not
+    // P / U, with ω at the hub (Kt is measured there)
+    filtered_torque = 20.0;
+    current_cadence_rps = 1.5;
+    current_speed_kmh = 0.0;
+    current_motor_rpm = 4500.0;
+    
+    calculate_assist_power();
+    
+    float wheel_rpm = 4500.0 / MOTOR_GEAR_RATIO;
+    float omega = wheel_rpm / 60.0 * 2.0 * PI;
+    TEST_ASSERT_FLOAT_WITHIN(1.0, 350.0, assist_power_watts);
+    TEST_ASSERT_FLOAT_WITHIN(0.02, 350.0 / omega, motor_map_torque(target_current_amps, wheel_rpm));
+}
+
 void test_power_limits(void) {
     filtered_torque = 100.0;
     current_cadence_rps = 2.0;
@@ -341,13 +1189,58 @@ void test_power_limits(void) {
     TEST_ASSERT_TRUE(target_current_amps <= 8.0);
 }
 
+void test_motor_map_matches_curve(void) {
+    // Q100C load test points (torque [Nm], wheel rpm, current [A], efficiency)
+    const float points[][4] = {
+        {7.17f, 216.4f, 5.28f, 0.807f},
+        {8.04f, 213.3f, 5.86f, 0.801f},
+        {11.33f, 203.5f, 7.89f, 0.799f},
+        {18.05f, 185.6f, 12.13f, 0.753f},
+        {20.04f, 180.3f, 13.37f, 0.742f},
+    };
+    for (const auto& p : points) {
+        TEST_ASSERT_FLOAT_WITHIN(0.02f, p[0] / p[2], motor_map_kt(p[2], p[1]));
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, p[3], motor_map_efficiency(p[2], p[1]));
+    }
+
+    // Kt rises with current (drag share), no torque and no efficiency at 0
+    TEST_ASSERT_TRUE(motor_map_kt(2.0f, 150.0f) < motor_map_kt(8.0f, 150.0f));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, motor_map_torque(0.0f, 150.0f));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, motor_map_efficiency(4.0f, 0.0f));
+}
+
+void test_motor_map_inversion(void) {
+    // Round trip over the operating range: current for a torque, torque
+    // for that current
+    int max_iterations = 0;
+    long total_iterations = 0;
+    int count = 0;
+    for (float rpm = 20.0f; rpm <= 300.0f; rpm += 20.0f) {
+        for (float torque = 0.5f; torque <= 20.0f; torque += 0.5f) {
+            int iterations = 0;
+            float current = motor_map_current(torque, rpm, &iterations);
+            TEST_ASSERT_FLOAT_WITHIN(0.02f, torque, motor_map_torque(current, rpm));
+            max_iterations = max(max_iterations, iterations);
+            total_iterations += iterations;
+            count++;
+        }
+    }
+    printf("  INFO: Motor map inversion: %.1f Newton iterations avg, %d max (%d points)\n",
+           (float)total_iterations / count, max_iterations, count);
+    TEST_ASSERT_TRUE(max_iterations <= MOTOR_MAP_MAX_ITERATIONS);
+
+    // Drag first: a small torque needs the drag current on top
+    TEST_ASSERT_TRUE(motor_map_current(1.0f, 150.0f) > 1.0f / MOTOR_CONSTANT_KT + 0.5f);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, motor_map_current(0.0f, 150.0f));
+}
+
 // =============================================================================
 // MOTOR CONTROL TESTS
 // =============================================================================
 
 void test_motor_activation_normal_conditions(void) {
-    mock_millis_value = 2000;
-    last_pedal_activity = mock_millis_value - 100;
+    hal_set_millis(2000);
+    last_pedal_activity = millis() - 100;
     filtered_torque = 15.0;
     current_cadence_rpm = 60.0;
     current_mode = 0;
@@ -360,9 +1253,138 @@ void test_motor_activation_normal_conditions(void) {
     TEST_ASSERT_TRUE(motor_enabled);
 }
 
+// The raw torque gate measures from the learned zero: a zero drifted up must
+// not look like pedal load, one drifted down must not hide light pedaling
+void test_motor_activation_uses_learned_zero(void) {
+    const int drifts[] = {20, -20};
+    for (int drift : drifts) {
+        hal_nvs_erase();
+        current_cadence_rpm = 0.0;
+        pedal_direction = 0;
+        last_pedal_activity = millis() - 5000;
+        hal_set_analog(TORQUE_SENSOR_PIN, TORQUE_STANDSTILL + drift);
+        torque_zero_begin();
+        run_idle_torque_ticks(110);
+        TEST_ASSERT_TRUE(torque_zero_status().calibrated);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, TORQUE_STANDSTILL + drift, torque_zero_counts());
+
+        SharedVescData vesc = {};
+        vesc.data_valid = true;
+        vesc.last_update = millis();
+        sharedVescData.publish(vesc);
+        last_pedal_activity = millis() - 100;
+        filtered_torque = 15.0;
+        current_cadence_rpm = 60.0;
+        current_mode = 0;
+        pedal_direction = 1;
+        current_speed_kmh = 15.0;
+
+        // No pedal load: at the learned zero (20 counts off the factory zero)
+        raw_torque_value = TORQUE_STANDSTILL + drift;
+        update_motor_status();
+        TEST_ASSERT_FALSE(motor_enabled);
+
+        // Light pedaling: just above the threshold from the learned zero
+        raw_torque_value = TORQUE_STANDSTILL + drift + TORQUE_THRESHOLD + 2;
+        update_motor_status();
+        TEST_ASSERT_TRUE(motor_enabled);
+        torque_zero_end();
+    }
+}
+
+// VESC silent: the housekeeping publish must not refresh last_update, so
+// 1 s after the last answer the motor is cut - command 0 in that tick
+void test_motor_cut_on_stale_vesc_data(void) {
+    static ScriptedStream silent_vesc;          // Takes the requests, never answers
+    silent_vesc.clear();
+    vescUart.setSerialPort(&silent_vesc);
+    unsigned long last_answer = sharedVescData.read().last_update;   // setUp
+    current_shaper_reset();
+
+    filtered_torque = 15.0;
+    current_cadence_rpm = 60.0;
+    current_mode = 0;
+    pedal_direction = 1;
+    current_speed_kmh = 15.0;
+    raw_torque_value = TORQUE_STANDSTILL + TORQUE_THRESHOLD + 100;
+
+    bool assisted = false, cut = false;
+    for (int tick = 0; tick < 150 && !cut; tick++) {
+        hal_advance_time_us(10000);
+        run_vesc_cycle(NULL);
+        last_pedal_activity = millis();
+        update_motor_status();
+        float command = shape_motor_current(motor_enabled ? 5.0 : 0.0, motor_cut);
+        if (motor_cut) {
+            cut = true;
+            TEST_ASSERT_EQUAL_FLOAT(0.0f, command);
+            TEST_ASSERT_FALSE(motor_enabled);
+            TEST_ASSERT_TRUE(millis() - last_answer >= 1000);
+        } else {
+            assisted |= command > 0.0f;
+        }
+    }
+    TEST_ASSERT_TRUE(assisted);
+    TEST_ASSERT_TRUE(cut);
+    TEST_ASSERT_EQUAL(last_answer, sharedVescData.read().last_update);
+}
+
+// SET_CURRENT frames written to the VESC since the last call
+static int sent_current_frames(ScriptedStream& uart) {
+    int frames = 0;
+    for (size_t i = 0; i + 10 <= uart.written.size(); i += 10) {
+        if (uart.written[i + 2] == COMM_SET_CURRENT) frames++;
+    }
+    uart.written.clear();
+    return frames;
+}
+
+void test_motor_command_dedup_keepalive(void) {
+    static ScriptedStream vesc_port;
+    vesc_port.clear();
+    vescUart.setSerialPort(&vesc_port);
+    SharedMotorCommand command = {};
+
+    // First command after a pause goes out, the same current 10 ms later does not
+    hal_advance_time_us(100000);
+    command.target_current = 3.0f;
+    send_motor_command(command);
+    TEST_ASSERT_EQUAL(1, sent_current_frames(vesc_port));
+    hal_advance_time_us(10000);
+    send_motor_command(command);
+    TEST_ASSERT_EQUAL(0, sent_current_frames(vesc_port));
+
+    // Changes within the deadband are skipped, larger ones go out at once
+    hal_advance_time_us(10000);
+    command.target_current = 3.0f + MOTOR_COMMAND_DEADBAND_A / 2;
+    send_motor_command(command);
+    TEST_ASSERT_EQUAL(0, sent_current_frames(vesc_port));
+    hal_advance_time_us(10000);
+    command.target_current = 4.0f;
+    send_motor_command(command);
+    TEST_ASSERT_EQUAL(1, sent_current_frames(vesc_port));
+
+    // An unchanged current is re-sent every MOTOR_COMMAND_KEEPALIVE_MS (10 ms ticks)
+    int frames = 0;
+    for (int tick = 1; tick <= 20; tick++) {
+        hal_advance_time_us(10000);
+        send_motor_command(command);
+        int sent = sent_current_frames(vesc_port);
+        frames += sent;
+        TEST_ASSERT_EQUAL(tick % (MOTOR_COMMAND_KEEPALIVE_MS / 10) == 0 ? 1 : 0, sent);
+    }
+    TEST_ASSERT_EQUAL(20 / (MOTOR_COMMAND_KEEPALIVE_MS / 10), frames);
+
+    // Back to 0 A goes out in the same tick
+    hal_advance_time_us(10000);
+    command.target_current = 0.0f;
+    send_motor_command(command);
+    TEST_ASSERT_EQUAL(1, sent_current_frames(vesc_port));
+}
+
 void test_motor_deactivation_pas_timeout(void) {
-    mock_millis_value = 5000;
-    last_pedal_activity = mock_millis_value - (PEDAL_TIMEOUT_MS + 100);
+    hal_set_millis(5000);
+    last_pedal_activity = millis() - (PEDAL_TIMEOUT_MS + 100);
     filtered_torque = 15.0;
     current_cadence_rpm = 60.0;
     current_mode = 0;
@@ -375,8 +1397,8 @@ void test_motor_deactivation_pas_timeout(void) {
 }
 
 void test_motor_deactivation_reverse_pedaling(void) {
-    mock_millis_value = 2000;
-    last_pedal_activity = mock_millis_value - 100;
+    hal_set_millis(2000);
+    last_pedal_activity = millis() - 100;
     filtered_torque = 15.0;
     current_cadence_rpm = 60.0;
     current_mode = 0;
@@ -389,8 +1411,8 @@ void test_motor_deactivation_reverse_pedaling(void) {
 }
 
 void test_emergency_speed_cutoff(void) {
-    mock_millis_value = 2000;
-    last_pedal_activity = mock_millis_value - 100;
+    hal_set_millis(2000);
+    last_pedal_activity = millis() - 100;
     filtered_torque = 15.0;
     current_cadence_rpm = 60.0;
     current_mode = 0;
@@ -402,12 +1424,224 @@ void test_emergency_speed_cutoff(void) {
     
     TEST_ASSERT_FALSE(motor_enabled);
     TEST_ASSERT_EQUAL_FLOAT(0.0, target_current_amps);
+    TEST_ASSERT_TRUE(motor_cut);
+}
+
+void test_current_shaper_s_curve(void) {
+    CurrentShaperConfig config = {0.0f, 20.0f, 40.0f, 400.0f};
+    CurrentShaper shaper;
+    shaper.configure(config);
+
+    // 0 -> 8 A step: rate and jerk bounded, arrives without overshoot
+    float previous_rate = 0.0f;
+    int ticks = 0;
+    while (shaper.output() < 8.0f && ticks < 200) {
+        shaper.update(8.0f, false);
+        TEST_ASSERT_TRUE(shaper.rate() <= config.rise_a_per_s + 0.001f);
+        if (shaper.output() < 8.0f) {
+            TEST_ASSERT_TRUE(fabsf(shaper.rate() - previous_rate) <= config.jerk_a_per_s2 * CURRENT_SHAPER_DT_S + 0.001f);
+        }
+        TEST_ASSERT_TRUE(shaper.output() <= 8.0f);
+        previous_rate = shaper.rate();
+        ticks++;
+    }
+    TEST_ASSERT_EQUAL_FLOAT(8.0f, shaper.output());
+    TEST_ASSERT_UINT_WITHIN(10, 45, ticks);          // 0.4 s at 20 A/s + 2 x 50 ms jerk phases
+
+    // Easing off: down at the fall rate, all the way to 0
+    for (ticks = 0; shaper.output() > 0.0f && ticks < 200; ticks++) {
+        shaper.update(0.0f, false);
+        TEST_ASSERT_TRUE(shaper.rate() >= -config.fall_a_per_s - 0.001f);
+        TEST_ASSERT_TRUE(shaper.output() >= 0.0f);
+    }
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, shaper.output());
+    TEST_ASSERT_UINT_WITHIN(10, 30, ticks);
+
+    // Safety cut: 0 in the same tick, whatever the limits
+    for (int i = 0; i < 100; i++) shaper.update(8.0f, false);
+    TEST_ASSERT_EQUAL_FLOAT(8.0f, shaper.output());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, shaper.update(8.0f, true));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, shaper.rate());
+
+    // Filter only: first-order approach, never past the target
+    CurrentShaperConfig filter_only = {0.5f, 0.0f, 0.0f, 0.0f};
+    shaper.configure(filter_only);
+    shaper.reset();
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 4.0f, shaper.update(8.0f, false));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 6.0f, shaper.update(8.0f, false));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, shaper.update(0.0f, false));
+
+    // All limits off: the command is the target
+    CurrentShaperConfig off = {0.0f, 0.0f, 0.0f, 0.0f};
+    shaper.configure(off);
+    TEST_ASSERT_EQUAL_FLOAT(12.5f, shaper.update(12.5f, false));
+}
+
+void test_current_tracker_learns_kt_error(void) {
+    // Motor delivering 70% of the power the open-loop current stands for
+    const float delivery = 0.7f;
+    CurrentTracker tracker;
+    CurrentTrackingInput in = {};
+    in.target_a = 3.0f;
+    in.limit_a = MAX_MOTOR_CURRENT;
+    in.requested_w = 150.0f;
+    in.speed_kmh = 20.0f;
+    in.active = true;
+    in.new_sample = true;
+    in.input_voltage = 50.0f;
+
+    float target = 0.0f;
+    for (int i = 0; i < 1000; i++) {
+        // VESC follows the command, power proportional to the current
+        in.commanded_a = target;
+        in.motor_current_a = target;
+        float delivered_w = in.requested_w * delivery * target / in.target_a;
+        in.input_current_a = (delivered_w / MOTOR_GEAR_EFFICIENCY + target * target * MOTOR_PHASE_RESISTANCE) /
+                             (VESC_EFFICIENCY * in.input_voltage);
+        target = tracker.update(in);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.02f, 1.0f / delivery, tracker.scale());
+    TEST_ASSERT_FLOAT_WITHIN(2.0f, 150.0f, tracker.deliveredWatts());
+    TEST_ASSERT_FALSE(tracker.limited());
+
+    // Learned scale is kept while the motor is off and applied to the next request
+    in.active = false;
+    in.target_a = 0.0f;
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, tracker.update(in));
+    in.target_a = 2.0f;
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 2.0f / delivery, tracker.update(in));
+
+    // VESC stuck at 2 A (back-EMF): no windup while more current cannot help
+    tracker.reset();
+    in.active = true;
+    in.target_a = 3.0f;
+    target = in.target_a;
+    for (int i = 0; i < 1000; i++) {
+        in.commanded_a = target;
+        in.motor_current_a = 2.0f;
+        in.input_current_a = in.requested_w * 0.5f / (VESC_EFFICIENCY * in.input_voltage);
+        target = tracker.update(in);
+    }
+    TEST_ASSERT_TRUE(tracker.limited());
+    TEST_ASSERT_TRUE(tracker.saturated());
+    TEST_ASSERT_TRUE(tracker.scale() < 1.0f + TRACKING_KP + 0.01f);
+
+    // Never more than MAX_MOTOR_CURRENT
+    in.target_a = MAX_MOTOR_CURRENT;
+    TEST_ASSERT_TRUE(tracker.update(in) <= MAX_MOTOR_CURRENT);
+
+    // The P term holds between samples: a tick without a new VESC answer
+    // leaves the scale (and so the corrected target) where the sample put it
+    tracker.reset();
+    in.target_a = 3.0f;
+    target = in.target_a;
+    for (int i = 0; i < 50; i++) {
+        in.new_sample = (i % 2) == 0;              // VESC_FAST_POLL_MS = 2 ticks
+        in.commanded_a = target;
+        in.motor_current_a = target;
+        in.input_current_a = (in.requested_w * delivery * target / in.target_a / MOTOR_GEAR_EFFICIENCY +
+                              target * target * MOTOR_PHASE_RESISTANCE) / (VESC_EFFICIENCY * in.input_voltage);
+        float scale_before = tracker.scale();
+        target = tracker.update(in);
+        if (!in.new_sample) {
+            TEST_ASSERT_EQUAL_FLOAT(scale_before, tracker.scale());
+        }
+    }
+    TEST_ASSERT_TRUE(tracker.scale() > 1.0f);
+
+    // A sample that cannot be compared (motor off) drops the P term
+    float learned = tracker.scale();
+    in.new_sample = true;
+    in.active = false;
+    tracker.update(in);
+    TEST_ASSERT_TRUE(tracker.scale() < learned);
+}
+
+void test_thermal_node_forecast(void) {
+    ThermalNode node(thermal_motor_config());
+    node.reset(THERMAL_AMBIENT_C);
+
+    // Forecast at a constant 8 A matches stepping the model to the limit
+    float forecast_s = node.timeToLimit(8.0f, THERMAL_AMBIENT_C);
+    ThermalNode stepped = node;
+    float elapsed_s = 0.0f;
+    while (stepped.temperature() < THERMAL_MOTOR_LIMIT_C && elapsed_s < THERMAL_NO_LIMIT_S) {
+        stepped.predict(8.0f, THERMAL_AMBIENT_C, THERMAL_DT_S);
+        elapsed_s += THERMAL_DT_S;
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, elapsed_s, forecast_s);
+    TEST_ASSERT_EQUAL_FLOAT(THERMAL_NO_LIMIT_S, node.timeToLimit(2.0f, THERMAL_AMBIENT_C));
+
+    // Riding at the allowed current: full current while cold, then a smooth
+    // fall to what the winding holds at the limit, never above it
+    float sustained = sqrtf((THERMAL_MOTOR_LIMIT_C - THERMAL_AMBIENT_C) /
+                            (THERMAL_MOTOR_RTH_K_PER_W * MOTOR_PHASE_RESISTANCE));
+    float allowed = node.allowedCurrent(THERMAL_AMBIENT_C, THERMAL_HORIZON_S);
+    TEST_ASSERT_TRUE(allowed > MAX_MOTOR_CURRENT);
+    float max_step = 0.0f;
+    for (int i = 0; i < 360000; i++) {                 // 1 hour
+        float current = min(allowed, (float)MAX_MOTOR_CURRENT);
+        node.predict(current, THERMAL_AMBIENT_C, THERMAL_DT_S);
+        float next = node.allowedCurrent(THERMAL_AMBIENT_C, THERMAL_HORIZON_S);
+        max_step = max(max_step, allowed - next);
+        allowed = next;
+        TEST_ASSERT_TRUE(node.temperature() <= THERMAL_MOTOR_LIMIT_C + 0.01f);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, sustained, allowed);
+    TEST_ASSERT_TRUE(max_step < 0.001f);              // [A per 10 ms tick]
+
+    // Readings: the first replaces the estimate, implausible ones (no NTC) are ignored
+    node.reset(THERMAL_AMBIENT_C);
+    node.correct(-200.0f, THERMAL_DT_S);
+    TEST_ASSERT_FALSE(node.measured());
+    TEST_ASSERT_EQUAL_FLOAT(THERMAL_AMBIENT_C, node.temperature());
+    node.correct(60.0f, THERMAL_DT_S);
+    TEST_ASSERT_TRUE(node.measured());
+    TEST_ASSERT_EQUAL_FLOAT(60.0f, node.temperature());
+    for (int i = 0; i < (int)(THERMAL_CORRECTION_S / THERMAL_DT_S); i++) {
+        node.correct(70.0f, THERMAL_DT_S);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 70.0f - 10.0f / expf(1.0f), node.temperature());
 }
 
 // =============================================================================
 // BATTERY MONITORING TESTS
 // =============================================================================
 
+void test_battery_resistance_estimator(void) {
+    // Pack: 45 V OCV behind 0.25 Ohm, inpVoltage with the VESC's 0.1 V resolution
+    const float ocv = 45.0f, resistance = 0.25f;
+    BatteryResistanceEstimator estimator;
+    TEST_ASSERT_EQUAL_FLOAT(BATTERY_R_NOMINAL_OHM, estimator.resistance());
+
+    unsigned long now = 0;
+    auto sample = [&](float current) {
+        float voltage = roundf((ocv - resistance * current) * 10.0f) / 10.0f;
+        estimator.update(voltage, current, now);
+        now += 20;                                   // VESC_FAST_POLL_MS
+    };
+
+    // Slow drift (pedal stroke ripple) is no step
+    for (int i = 0; i < 100; i++) sample(3.0f + 0.3f * sinf(i * 0.3f));
+    TEST_ASSERT_EQUAL(0, estimator.steps());
+
+    // Motor on / off: 0 -> 2..6 A ramps within a few samples
+    for (int n = 0; n < 20; n++) {
+        float high = 2.0f + (n % 5);
+        for (int i = 0; i < 50; i++) sample(min(high, i * 1.0f));
+        for (int i = 0; i < 50; i++) sample(0.0f);
+    }
+    TEST_ASSERT_TRUE(estimator.steps() >= 20);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f * resistance, resistance, estimator.resistance());
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, ocv, estimator.openCircuitVoltage());
+
+    // A step across a gap (OCV may have moved meanwhile) does not count
+    uint32_t steps = estimator.steps();
+    now += 10000;
+    sample(5.0f);
+    TEST_ASSERT_EQUAL(steps, estimator.steps());
+}
+
 void test_normal_battery_status(void) {
     battery_voltage = 52.0;
     battery_percentage = 80.0;
@@ -441,12 +1675,23 @@ void test_critical_battery_detection(void) {
 void test_battery_led_normal(void) {
     battery_low = false;
     battery_critical = false;
-    mock_millis_value = 2000;
+    hal_set_millis(2000);
     
     update_battery_led();
     
     // LED should be off for normal battery
     TEST_ASSERT_FALSE(battery_led_state);
+    TEST_ASSERT_EQUAL(LOW, hal_get_digital(BATTERY_LED_PIN));
+}
+
+void test_battery_led_blinks_when_low(void) {
+    battery_percentage = 15.0;
+    update_battery_status();
+    TEST_ASSERT_EQUAL(HIGH, hal_get_digital(BATTERY_LED_PIN));
+    
+    hal_set_millis(2000 + BATTERY_LED_BLINK_INTERVAL);
+    update_battery_led();
+    TEST_ASSERT_EQUAL(LOW, hal_get_digital(BATTERY_LED_PIN));
 }
 
 // =============================================================================
@@ -470,8 +1715,8 @@ void test_complete_sensor_fusion_pipeline(void) {
     TEST_ASSERT_TRUE(assist_power_watts <= 350.0); // Should hit motor limit
     
     // Step 3: Check motor status
-    mock_millis_value = 2000;
-    last_pedal_activity = mock_millis_value - 100;
+    hal_set_millis(2000);
+    last_pedal_activity = millis() - 100;
     current_cadence_rpm = 70.0;
     pedal_direction = 1;
     raw_torque_value = TORQUE_STANDSTILL + TORQUE_THRESHOLD + 100;
@@ -504,6 +1749,1273 @@ void test_different_assist_modes(void) {
     TEST_ASSERT_EQUAL_FLOAT(1.1, eco_factor);
 }
 
+// =============================================================================
+// SHARED DATA (SEQLOCK) TESTS
+// =============================================================================
+
+// Payload shaped like SharedVescData; every field carries the same counter so
+// a torn copy (half old, half new) is detectable.
+struct BenchSnapshot {
+    float values[12];
+    uint32_t counter;
+};
+
+static BenchSnapshot make_bench_snapshot(uint32_t counter) {
+    BenchSnapshot snapshot;
+    for (int i = 0; i < 12; i++) snapshot.values[i] = (float)counter;
+    snapshot.counter = counter;
+    return snapshot;
+}
+
+static bool bench_snapshot_consistent(const BenchSnapshot& snapshot) {
+    for (int i = 0; i < 12; i++) {
+        if (snapshot.values[i] != (float)snapshot.counter) return false;
+    }
+    return true;
+}
+
+struct ContentionResult {
+    double writer_avg_us;
+    double writer_max_us;
+    uint32_t skipped_updates;   // Writer gave up (old xSemaphoreTake timeout)
+    uint32_t reads;
+    uint32_t torn_reads;
+};
+
+static void busy_wait_us(int us) {
+    auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    while (std::chrono::steady_clock::now() < end) {}
+}
+
+// Writer publishes BENCH_UPDATES snapshots while BENCH_READERS "handlers" read
+// continuously and spend BENCH_HANDLER_US formatting each reply (JSON/BLE).
+#define BENCH_UPDATES      2000
+#define BENCH_READERS      3
+#define BENCH_HANDLER_US   200
+#define BENCH_PERIOD_US    500
+
+static ContentionResult run_contention_benchmark(bool use_seqlock) {
+    std::timed_mutex mutex;                      // Old dataUpdateSemaphore scheme
+    BenchSnapshot locked_data = make_bench_snapshot(0);
+    SeqlockSnapshot<BenchSnapshot> snapshot;     // New scheme
+    snapshot.publish(make_bench_snapshot(0));
+    
+    std::atomic<bool> running(true);
+    std::atomic<uint32_t> reads(0), torn_reads(0);
+    ContentionResult result = {0.0, 0.0, 0, 0, 0};
+    
+    std::vector<std::thread> readers;
+    for (int r = 0; r < BENCH_READERS; r++) {
+        readers.emplace_back([&]() {
+            while (running.load()) {
+                BenchSnapshot copy;
+                if (use_seqlock) {
+                    copy = snapshot.read();
+                    busy_wait_us(BENCH_HANDLER_US);   // Handler works on its copy
+                } else {
+                    mutex.lock();
+                    copy = locked_data;
+                    busy_wait_us(BENCH_HANDLER_US);   // Handler works under the lock
+                    mutex.unlock();
+                }
+                if (!bench_snapshot_consistent(copy)) torn_reads++;
+                reads++;
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        });
+    }
+    
+    double total_us = 0.0;
+    for (uint32_t i = 1; i <= BENCH_UPDATES; i++) {
+        BenchSnapshot next = make_bench_snapshot(i);
+        auto start = std::chrono::steady_clock::now();
+        if (use_seqlock) {
+            snapshot.publish(next);
+        } else if (mutex.try_lock_for(std::chrono::milliseconds(10))) {
+            locked_data = next;
+            mutex.unlock();
+        } else {
+            result.skipped_updates++;
+        }
+        double us = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count();
+        total_us += us;
+        if (us > result.writer_max_us) result.writer_max_us = us;
+        std::this_thread::sleep_for(std::chrono::microseconds(BENCH_PERIOD_US));
+    }
+    
+    running = false;
+    for (auto& reader : readers) reader.join();
+    
+    result.writer_avg_us = total_us / BENCH_UPDATES;
+    result.reads = reads.load();
+    result.torn_reads = torn_reads.load();
+    return result;
+}
+
+static void print_contention_result(const char* name, const ContentionResult& r) {
+    char line[160];
+    snprintf(line, sizeof(line),
+             "%-7s writer avg %.2f us, max %.1f us, skipped %u/%d | reads %u, torn %u",
+             name, r.writer_avg_us, r.writer_max_us, r.skipped_updates, BENCH_UPDATES,
+             r.reads, r.torn_reads);
+    TEST_MESSAGE(line);
+}
+
+void test_seqlock_publish_and_read(void) {
+    SeqlockSnapshot<BenchSnapshot> snapshot;
+    TEST_ASSERT_EQUAL_UINT32(0, snapshot.read().counter);
+    
+    snapshot.publish(make_bench_snapshot(42));
+    BenchSnapshot copy = snapshot.read();
+    TEST_ASSERT_EQUAL_UINT32(42, copy.counter);
+    TEST_ASSERT_TRUE(bench_snapshot_consistent(copy));
+    TEST_ASSERT_EQUAL_UINT32(1, snapshot.version());
+}
+
+void test_seqlock_contention_benchmark(void) {
+    ContentionResult mutex_result = run_contention_benchmark(false);
+    ContentionResult seqlock_result = run_contention_benchmark(true);
+    
+    print_contention_result("mutex", mutex_result);
+    print_contention_result("seqlock", seqlock_result);
+    
+    // Readers never see a torn snapshot and the writer never drops an update
+    TEST_ASSERT_EQUAL_UINT32(0, mutex_result.torn_reads);
+    TEST_ASSERT_EQUAL_UINT32(0, seqlock_result.torn_reads);
+    TEST_ASSERT_EQUAL_UINT32(0, seqlock_result.skipped_updates);
+    TEST_ASSERT_TRUE(seqlock_result.reads > 0);
+}
+
+// =============================================================================
+// VESC UART (NON-BLOCKING PARSER) TESTS
+// =============================================================================
+
+#define VESC_UART_POLL_MS      2
+#define VESC_TURNAROUND_US     300     // VESC firmware reply delay
+
+static std::vector<uint8_t> vesc_frame(const uint8_t* payload, int len) {
+    std::vector<uint8_t> frame;
+    uint16_t crc = crc16((unsigned char*)payload, len);
+    frame.push_back(2);
+    frame.push_back((uint8_t)len);
+    frame.insert(frame.end(), payload, payload + len);
+    frame.push_back((uint8_t)(crc >> 8));
+    frame.push_back((uint8_t)(crc & 0xFF));
+    frame.push_back(3);
+    return frame;
+}
+
+// Long frame (start byte 3, 16 bit length) as used for payloads > 255 bytes
+static std::vector<uint8_t> vesc_long_frame(const uint8_t* payload, int len) {
+    std::vector<uint8_t> frame;
+    uint16_t crc = crc16((unsigned char*)payload, len);
+    frame.push_back(3);
+    frame.push_back((uint8_t)(len >> 8));
+    frame.push_back((uint8_t)(len & 0xFF));
+    frame.insert(frame.end(), payload, payload + len);
+    frame.push_back((uint8_t)(crc >> 8));
+    frame.push_back((uint8_t)(crc & 0xFF));
+    frame.push_back(3);
+    return frame;
+}
+
+// COMM_GET_VALUES answer as sent by the VESC firmware (59 byte payload)
+static std::vector<uint8_t> vesc_values_frame(float erpm, float voltage, float motor_current) {
+    uint8_t payload[64];
+    int32_t index = 0;
+    payload[index++] = COMM_GET_VALUES;
+    buffer_append_float16(payload, 35.0, 10.0, &index);          // tempMosfet
+    buffer_append_float16(payload, 42.0, 10.0, &index);          // tempMotor
+    buffer_append_float32(payload, motor_current, 100.0, &index);
+    buffer_append_float32(payload, 2.5, 100.0, &index);          // avgInputCurrent
+    buffer_append_int32(payload, 0, &index);                     // avg id
+    buffer_append_int32(payload, 0, &index);                     // avg iq
+    buffer_append_float16(payload, 0.45, 1000.0, &index);        // duty
+    buffer_append_float32(payload, erpm, 1.0, &index);
+    buffer_append_float16(payload, voltage, 10.0, &index);
+    buffer_append_float32(payload, 1.25, 10000.0, &index);       // ampHours
+    buffer_append_float32(payload, 0.0, 10000.0, &index);
+    buffer_append_float32(payload, 60.0, 10000.0, &index);       // wattHours
+    buffer_append_float32(payload, 0.0, 10000.0, &index);
+    buffer_append_int32(payload, 1234, &index);                  // tachometer
+    buffer_append_int32(payload, 5678, &index);                  // tachometerAbs
+    payload[index++] = FAULT_CODE_NONE;
+    buffer_append_float32(payload, 0.0, 1000000.0, &index);      // pidPos
+    payload[index++] = 0;                                        // controller id
+    return vesc_frame(payload, index);
+}
+
+// COMM_GET_VALUES_SELECTIVE answer: echoed mask, then only the selected fields
+static std::vector<uint8_t> vesc_selective_frame(uint32_t mask, float erpm, float voltage, float motor_current) {
+    uint8_t payload[64];
+    int32_t index = 0;
+    payload[index++] = COMM_GET_VALUES_SELECTIVE;
+    buffer_append_uint32(payload, mask, &index);
+    if (mask & SELECT_TEMP_MOSFET)        buffer_append_float16(payload, 35.0, 10.0, &index);
+    if (mask & SELECT_TEMP_MOTOR)         buffer_append_float16(payload, 42.0, 10.0, &index);
+    if (mask & SELECT_AVG_MOTOR_CURRENT)  buffer_append_float32(payload, motor_current, 100.0, &index);
+    if (mask & SELECT_AVG_INPUT_CURRENT)  buffer_append_float32(payload, 2.5, 100.0, &index);
+    if (mask & SELECT_AVG_ID)             buffer_append_int32(payload, 0, &index);
+    if (mask & SELECT_AVG_IQ)             buffer_append_int32(payload, 0, &index);
+    if (mask & SELECT_DUTY_CYCLE)         buffer_append_float16(payload, 0.45, 1000.0, &index);
+    if (mask & SELECT_RPM)                buffer_append_float32(payload, erpm, 1.0, &index);
+    if (mask & SELECT_INPUT_VOLTAGE)      buffer_append_float16(payload, voltage, 10.0, &index);
+    if (mask & SELECT_AMP_HOURS)          buffer_append_float32(payload, 1.25, 10000.0, &index);
+    if (mask & SELECT_AMP_HOURS_CHARGED)  buffer_append_float32(payload, 0.0, 10000.0, &index);
+    if (mask & SELECT_WATT_HOURS)         buffer_append_float32(payload, 60.0, 10000.0, &index);
+    if (mask & SELECT_WATT_HOURS_CHARGED) buffer_append_float32(payload, 0.0, 10000.0, &index);
+    if (mask & SELECT_TACHOMETER)         buffer_append_int32(payload, 1234, &index);
+    if (mask & SELECT_TACHOMETER_ABS)     buffer_append_int32(payload, 5678, &index);
+    if (mask & SELECT_FAULT)              payload[index++] = FAULT_CODE_NONE;
+    if (mask & SELECT_PID_POS)            buffer_append_float32(payload, 0.0, 1000000.0, &index);
+    if (mask & SELECT_CONTROLLER_ID)      payload[index++] = 0;
+    return vesc_frame(payload, index);
+}
+
+// Calls update() every VESC_UART_POLL_MS of virtual time (like vescTask)
+// until the request is answered or timed out
+static VescUart::RequestStatus vesc_poll_until_done(VescUart& vesc, uint8_t packet_id) {
+    for (int i = 0; i < 1000; i++) {
+        hal_advance_time_us(VESC_UART_POLL_MS * 1000);
+        vesc.update();
+        VescUart::RequestStatus status = vesc.pollRequest(packet_id);
+        if (status != VescUart::REQUEST_PENDING) return status;
+    }
+    return VescUart::REQUEST_PENDING;
+}
+
+void test_vesc_parser_decodes_get_values(void) {
+    ScriptedStream uart;
+    VescUart vesc;
+    vesc.setSerialPort(&uart);
+    
+    TEST_ASSERT_TRUE(vesc.requestVescValues());
+    TEST_ASSERT_FALSE(vesc.requestVescValues());    // Already in flight
+    TEST_ASSERT_TRUE(vesc.isPending(COMM_GET_VALUES));
+    
+    // Request frame on the wire: 2, len 1, COMM_GET_VALUES, crc, 3
+    TEST_ASSERT_EQUAL(6, uart.written.size());
+    TEST_ASSERT_EQUAL_UINT8(COMM_GET_VALUES, uart.written[2]);
+    
+    std::vector<uint8_t> reply = vesc_values_frame(1200.0, 50.4, 6.5);
+    uart.scriptAt(hal_time_us() + VESC_TURNAROUND_US, reply.data(), reply.size());
+    
+    // Nothing there yet - update() returns right away
+    TEST_ASSERT_EQUAL(0, vesc.update());
+    TEST_ASSERT_EQUAL(VescUart::REQUEST_PENDING, vesc.pollRequest(COMM_GET_VALUES));
+    
+    TEST_ASSERT_EQUAL(VescUart::REQUEST_DONE, vesc_poll_until_done(vesc, COMM_GET_VALUES));
+    TEST_ASSERT_EQUAL(VescUart::REQUEST_IDLE, vesc.pollRequest(COMM_GET_VALUES));  // Reported once
+    
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 1200.0, vesc.data.rpm);
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 50.4, vesc.data.inpVoltage);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 6.5, vesc.data.avgMotorCurrent);
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 42.0, vesc.data.tempMotor);
+    TEST_ASSERT_EQUAL(5678, vesc.data.tachometerAbs);
+    
+    // 64 byte frame = 5.6ms on the wire, seen by the next 2ms poll
+    TEST_ASSERT_EQUAL_UINT32(1, vesc.linkStats.framesReceived);
+    TEST_ASSERT_EQUAL_UINT32(64, vesc.linkStats.bytesReceived);
+    TEST_ASSERT_TRUE(vesc.linkStats.lastLatencyUs >= VESC_TURNAROUND_US + 64 * uart.byteTimeUs());
+    TEST_ASSERT_TRUE(vesc.linkStats.lastLatencyUs <= VESC_TURNAROUND_US + 64 * uart.byteTimeUs() + VESC_UART_POLL_MS * 1000);
+}
+
+void test_vesc_set_current_overlaps_get_values(void) {
+    ScriptedStream uart;
+    VescUart vesc;
+    vesc.setSerialPort(&uart);
+    
+    TEST_ASSERT_TRUE(vesc.requestVescValues());
+    std::vector<uint8_t> reply = vesc_values_frame(800.0, 48.0, 3.0);
+    uart.scriptAt(hal_time_us() + VESC_TURNAROUND_US, reply.data(), reply.size());
+    
+    // Motor commands keep going out while the answer is still arriving
+    int commands = 0;
+    while (vesc.isPending(COMM_GET_VALUES)) {
+        vesc.setCurrent(2.0 + commands);
+        commands++;
+        hal_advance_time_us(VESC_UART_POLL_MS * 1000);
+        vesc.update();
+        TEST_ASSERT_TRUE(commands < 10);
+    }
+    
+    TEST_ASSERT_TRUE(commands >= 2);
+    TEST_ASSERT_EQUAL(VescUart::REQUEST_DONE, vesc.pollRequest(COMM_GET_VALUES));
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 800.0, vesc.data.rpm);
+    
+    // GET_VALUES (6 bytes) + one SET_CURRENT frame (10 bytes) per command
+    TEST_ASSERT_EQUAL(6 + commands * 10, uart.written.size());
+    TEST_ASSERT_EQUAL_UINT8(COMM_SET_CURRENT, uart.written[6 + 2]);
+}
+
+void test_vesc_parser_resync_and_timeout(void) {
+    ScriptedStream uart;
+    VescUart vesc;
+    vesc.setSerialPort(&uart);
+    
+    // Line noise, a frame with a broken CRC, then the real answer
+    const uint8_t noise[] = {0xFF, 0x00, 0x55, 0x13};
+    std::vector<uint8_t> corrupt = vesc_values_frame(500.0, 47.0, 1.0);
+    corrupt[10] ^= 0x5A;
+    std::vector<uint8_t> reply = vesc_values_frame(640.0, 49.0, 4.0);
+    
+    TEST_ASSERT_TRUE(vesc.requestVescValues());
+    uart.script(noise, sizeof(noise));
+    uart.script(corrupt.data(), corrupt.size());
+    uart.script(reply.data(), reply.size());
+    
+    TEST_ASSERT_EQUAL(VescUart::REQUEST_DONE, vesc_poll_until_done(vesc, COMM_GET_VALUES));
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 640.0, vesc.data.rpm);
+    TEST_ASSERT_EQUAL_UINT32(1, vesc.linkStats.crcErrors);
+    TEST_ASSERT_EQUAL_UINT32(1, vesc.linkStats.framesReceived);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(noise), vesc.linkStats.bytesDiscarded);
+    
+    // No answer at all -> timeout after _TIMEOUT (100ms), slot is free again
+    unsigned long start = millis();
+    TEST_ASSERT_TRUE(vesc.requestVescValues());
+    TEST_ASSERT_EQUAL(VescUart::REQUEST_TIMEOUT, vesc_poll_until_done(vesc, COMM_GET_VALUES));
+    TEST_ASSERT_TRUE(millis() - start >= 100);
+    TEST_ASSERT_EQUAL_UINT32(1, vesc.linkStats.timeouts);
+    TEST_ASSERT_TRUE(vesc.requestVescValues());
+    
+    // Half a frame followed by silence is dropped, the next frame parses
+    std::vector<uint8_t> truncated = vesc_values_frame(100.0, 48.0, 0.0);
+    uart.script(truncated.data(), 20);
+    TEST_ASSERT_EQUAL(VescUart::REQUEST_TIMEOUT, vesc_poll_until_done(vesc, COMM_GET_VALUES));
+    TEST_ASSERT_TRUE(vesc.requestVescValues());
+    uart.script(reply.data(), reply.size());
+    TEST_ASSERT_EQUAL(VescUart::REQUEST_DONE, vesc_poll_until_done(vesc, COMM_GET_VALUES));
+    TEST_ASSERT_EQUAL_UINT32(1, vesc.linkStats.framingErrors);
+}
+
+void test_vesc_late_update_keeps_frame(void) {
+    ScriptedStream uart;
+    VescUart vesc;
+    vesc.setSerialPort(&uart);
+    
+    // First 20 bytes are read, then vescTask stalls 30ms (NVS flash write)
+    // while the rest of the frame arrives on time
+    TEST_ASSERT_TRUE(vesc.requestVescValues());
+    std::vector<uint8_t> reply = vesc_values_frame(720.0, 49.5, 3.5);
+    uart.script(reply.data(), reply.size());
+    hal_advance_time_us(20 * uart.byteTimeUs());
+    vesc.update();
+    TEST_ASSERT_TRUE(vesc.linkStats.bytesReceived > 0);
+    TEST_ASSERT_EQUAL(VescUart::REQUEST_PENDING, vesc.pollRequest(COMM_GET_VALUES));
+    
+    hal_advance_time_us(30 * 1000);
+    TEST_ASSERT_EQUAL(1, vesc.update());
+    TEST_ASSERT_EQUAL(VescUart::REQUEST_DONE, vesc.pollRequest(COMM_GET_VALUES));
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 720.0, vesc.data.rpm);
+    TEST_ASSERT_EQUAL_UINT32(0, vesc.linkStats.framingErrors);
+}
+
+#define VESC_FAST_MASK  (SELECT_RPM | SELECT_AVG_MOTOR_CURRENT | SELECT_INPUT_VOLTAGE)
+#define VESC_SLOW_MASK  (VESC_FAST_MASK | SELECT_TEMP_MOSFET | SELECT_TEMP_MOTOR | SELECT_DUTY_CYCLE | \
+                         SELECT_AMP_HOURS | SELECT_WATT_HOURS | SELECT_TACHOMETER)
+
+void test_vesc_selective_values_decode(void) {
+    ScriptedStream uart;
+    VescUart vesc;
+    vesc.setSerialPort(&uart);
+    vesc.data.tempMotor = -1.0;
+    
+    // Request frame: 2, len 5, COMM_GET_VALUES_SELECTIVE, mask (big endian), crc, 3
+    TEST_ASSERT_TRUE(vesc.requestVescValuesSelective(VESC_FAST_MASK));
+    TEST_ASSERT_EQUAL(10, uart.written.size());
+    TEST_ASSERT_EQUAL_UINT8(COMM_GET_VALUES_SELECTIVE, uart.written[2]);
+    TEST_ASSERT_EQUAL_UINT8((VESC_FAST_MASK >> 8) & 0xFF, uart.written[5]);
+    TEST_ASSERT_EQUAL_UINT8(VESC_FAST_MASK & 0xFF, uart.written[6]);
+    
+    std::vector<uint8_t> reply = vesc_selective_frame(VESC_FAST_MASK, 2400.0, 51.2, 7.25);
+    TEST_ASSERT_EQUAL(VescUart::selectivePayloadSize(VESC_FAST_MASK) + 5, reply.size());
+    uart.script(reply.data(), reply.size());
+    TEST_ASSERT_EQUAL(VescUart::REQUEST_DONE, vesc_poll_until_done(vesc, COMM_GET_VALUES_SELECTIVE));
+    
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 2400.0, vesc.data.rpm);
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 51.2, vesc.data.inpVoltage);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 7.25, vesc.data.avgMotorCurrent);
+    TEST_ASSERT_EQUAL_FLOAT(-1.0, vesc.data.tempMotor);     // Not selected - untouched
+    
+    // Slow poll fills in the rest
+    TEST_ASSERT_TRUE(vesc.requestVescValuesSelective(VESC_SLOW_MASK));
+    reply = vesc_selective_frame(VESC_SLOW_MASK, 2500.0, 51.0, 7.0);
+    uart.script(reply.data(), reply.size());
+    TEST_ASSERT_EQUAL(VescUart::REQUEST_DONE, vesc_poll_until_done(vesc, COMM_GET_VALUES_SELECTIVE));
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 42.0, vesc.data.tempMotor);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 60.0, vesc.data.wattHours);
+    TEST_ASSERT_EQUAL(1234, vesc.data.tachometer);
+    
+    // Answer shorter than its mask announces is not decoded
+    TEST_ASSERT_TRUE(vesc.requestVescValuesSelective(VESC_SLOW_MASK));
+    uint8_t short_payload[9];
+    int32_t index = 0;
+    short_payload[index++] = COMM_GET_VALUES_SELECTIVE;
+    buffer_append_uint32(short_payload, VESC_SLOW_MASK, &index);
+    buffer_append_float32(short_payload, 0.0, 1.0, &index);
+    reply = vesc_frame(short_payload, index);
+    uart.script(reply.data(), reply.size());
+    TEST_ASSERT_EQUAL(VescUart::REQUEST_TIMEOUT, vesc_poll_until_done(vesc, COMM_GET_VALUES_SELECTIVE));
+    TEST_ASSERT_EQUAL_UINT32(1, vesc.linkStats.framingErrors);
+}
+
+void test_vesc_truncated_answers_rejected(void) {
+    ScriptedStream uart;
+    VescUart vesc;
+    vesc.setSerialPort(&uart);
+
+    // Every decoded answer is checked for the bytes it is read from: a full
+    // GET_VALUES cut before the controller id, a firmware version without
+    // the minor number
+    TEST_ASSERT_TRUE(vesc.requestVescValues());
+    std::vector<uint8_t> full = vesc_values_frame(900.0, 48.0, 1.0);
+    std::vector<uint8_t> cut_payload(full.begin() + 2, full.end() - 4);    // 58 of 59 bytes
+    std::vector<uint8_t> reply = vesc_frame(cut_payload.data(), cut_payload.size());
+    uart.script(reply.data(), reply.size());
+    TEST_ASSERT_EQUAL(VescUart::REQUEST_TIMEOUT, vesc_poll_until_done(vesc, COMM_GET_VALUES));
+    TEST_ASSERT_EQUAL_UINT32(1, vesc.linkStats.framingErrors);
+
+    vesc.fw_version.major = 0;
+    TEST_ASSERT_TRUE(vesc.requestFWversion());
+    const uint8_t short_version[] = {COMM_FW_VERSION, 6};
+    reply = vesc_frame(short_version, sizeof(short_version));
+    uart.script(reply.data(), reply.size());
+    TEST_ASSERT_EQUAL(VescUart::REQUEST_TIMEOUT, vesc_poll_until_done(vesc, COMM_FW_VERSION));
+    TEST_ASSERT_EQUAL_UINT32(2, vesc.linkStats.framingErrors);
+    TEST_ASSERT_EQUAL_UINT8(0, vesc.fw_version.major);
+
+    const uint8_t version[] = {COMM_FW_VERSION, 6, 2};
+    TEST_ASSERT_TRUE(vesc.requestFWversion());
+    reply = vesc_frame(version, sizeof(version));
+    uart.script(reply.data(), reply.size());
+    TEST_ASSERT_EQUAL(VescUart::REQUEST_DONE, vesc_poll_until_done(vesc, COMM_FW_VERSION));
+    TEST_ASSERT_EQUAL_UINT8(6, vesc.fw_version.major);
+    TEST_ASSERT_EQUAL_UINT8(2, vesc.fw_version.minor);
+}
+
+// UART bytes for 10s of telemetry: full GET_VALUES at 50Hz vs the
+// update_vesc_data() schedule (fast selective at 50Hz, slow selective at 1Hz)
+static uint32_t run_vesc_polling_schedule(bool selective, uint32_t* polls) {
+    ScriptedStream uart;
+    VescUart vesc;
+    vesc.setSerialPort(&uart);
+    unsigned long last_fast = millis(), last_slow = 0;
+    *polls = 0;
+    
+    for (uint32_t step = 0; step < 10000 / VESC_UART_POLL_MS; step++) {
+        hal_advance_time_us(VESC_UART_POLL_MS * 1000);
+        vesc.update();
+        vesc.pollRequest(COMM_GET_VALUES);
+        vesc.pollRequest(COMM_GET_VALUES_SELECTIVE);
+        
+        unsigned long now = millis();
+        if (vesc.isPending(COMM_GET_VALUES) || vesc.isPending(COMM_GET_VALUES_SELECTIVE) || now - last_fast < 20) {
+            continue;
+        }
+        last_fast = now;
+        std::vector<uint8_t> reply;
+        if (!selective) {
+            vesc.requestVescValues();
+            reply = vesc_values_frame(1000.0, 50.0, 4.0);
+        } else {
+            uint32_t mask = VESC_FAST_MASK;
+            if (now - last_slow >= 1000) {
+                last_slow = now;
+                mask = VESC_SLOW_MASK;
+            }
+            vesc.requestVescValuesSelective(mask);
+            reply = vesc_selective_frame(mask, 1000.0, 50.0, 4.0);
+        }
+        uart.scriptAt(hal_time_us() + VESC_TURNAROUND_US, reply.data(), reply.size());
+        (*polls)++;
+    }
+    
+    TEST_ASSERT_EQUAL_UINT32(0, vesc.linkStats.timeouts);
+    return vesc.linkStats.bytesSent + vesc.linkStats.bytesReceived;
+}
+
+void test_vesc_dual_rate_polling_bytes(void) {
+    uint32_t full_polls = 0, selective_polls = 0;
+    uint32_t full_bytes = run_vesc_polling_schedule(false, &full_polls);
+    uint32_t selective_bytes = run_vesc_polling_schedule(true, &selective_polls);
+    
+    char line[200];
+    snprintf(line, sizeof(line),
+             "UART 10s: full GET_VALUES %u polls, %u bytes (%.1f B per 10ms cycle) | selective %u polls, %u bytes (%.1f B per 10ms cycle)",
+             full_polls, full_bytes, full_bytes / 1000.0, selective_polls, selective_bytes, selective_bytes / 1000.0);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "UART: answer bytes fast %d / slow %d / full 64",
+             VescUart::selectivePayloadSize(VESC_FAST_MASK) + 5, VescUart::selectivePayloadSize(VESC_SLOW_MASK) + 5);
+    TEST_MESSAGE(line);
+    
+    // Same 50Hz rate for the control-relevant fields, at less than half the bytes
+    TEST_ASSERT_TRUE(selective_polls >= 490);
+    TEST_ASSERT_EQUAL_UINT32(full_polls, selective_polls);
+    TEST_ASSERT_TRUE(selective_bytes * 2 < full_bytes);
+}
+
+// Answers without a built-in decoder (COMM_GET_MCCONF) land here
+static uint16_t raw_packet_len = 0;
+static uint32_t raw_packet_sum = 0;
+
+static void capture_raw_packet(uint8_t* payload, uint16_t len) {
+    raw_packet_len = len;
+    raw_packet_sum = 0;
+    for (uint16_t i = 0; i < len; i++) raw_packet_sum += payload[i];
+}
+
+void test_vesc_long_frames(void) {
+    ScriptedStream uart;
+    VescUart vesc;
+    vesc.setSerialPort(&uart);
+    vesc.setPacketHandler(capture_raw_packet);
+    raw_packet_len = 0;
+    
+    // 600 byte COMM_GET_MCCONF answer in one long frame
+    std::vector<uint8_t> mcconf(600);
+    uint32_t expected_sum = 0;
+    mcconf[0] = COMM_GET_MCCONF;
+    for (size_t i = 1; i < mcconf.size(); i++) mcconf[i] = (uint8_t)(i * 7);
+    for (uint8_t b : mcconf) expected_sum += b;
+    
+    TEST_ASSERT_TRUE(vesc.requestPacket(COMM_GET_MCCONF));
+    std::vector<uint8_t> reply = vesc_long_frame(mcconf.data(), mcconf.size());
+    uart.script(reply.data(), reply.size());
+    TEST_ASSERT_EQUAL(VescUart::REQUEST_DONE, vesc_poll_until_done(vesc, COMM_GET_MCCONF));
+    TEST_ASSERT_EQUAL_UINT16(600, raw_packet_len);
+    TEST_ASSERT_EQUAL_UINT32(expected_sum, raw_packet_sum);
+    
+    // Larger than VESCUART_RX_BUFFER_SIZE: rejected, the next frame still parses
+    uint8_t oversize_header[] = {3, (uint8_t)((VESCUART_RX_BUFFER_SIZE + 1) >> 8), (uint8_t)((VESCUART_RX_BUFFER_SIZE + 1) & 0xFF)};
+    TEST_ASSERT_TRUE(vesc.requestVescValues());
+    uart.script(oversize_header, sizeof(oversize_header));
+    reply = vesc_values_frame(900.0, 48.5, 2.0);
+    uart.script(reply.data(), reply.size());
+    TEST_ASSERT_EQUAL(VescUart::REQUEST_DONE, vesc_poll_until_done(vesc, COMM_GET_VALUES));
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 900.0, vesc.data.rpm);
+    TEST_ASSERT_EQUAL_UINT32(1, vesc.linkStats.framingErrors);
+    
+    // Sending: 300 byte payload goes out as long frame, short payloads unchanged
+    uart.written.clear();
+    std::vector<uint8_t> big(300, 0xA5);
+    TEST_ASSERT_EQUAL(306, vesc.packSendPayload(big.data(), big.size()));
+    std::vector<uint8_t> expected = vesc_long_frame(big.data(), big.size());
+    TEST_ASSERT_EQUAL(expected.size(), uart.written.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected.data(), uart.written.data(), expected.size());
+    
+    uart.written.clear();
+    std::vector<uint8_t> max_short(255, 0x11);
+    std::vector<uint8_t> expected_short = vesc_frame(max_short.data(), max_short.size());
+    vesc.packSendPayload(max_short.data(), max_short.size());
+    TEST_ASSERT_EQUAL_UINT8(2, uart.written[0]);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected_short.data(), uart.written.data(), expected_short.size());
+}
+
+// In-memory UART for the decode benchmark (no virtual clock overhead)
+class BenchStream : public Stream {
+public:
+    void load(const uint8_t* bytes, size_t len) { data = bytes; size = len; pos = 0; }
+    int available() override { return (int)(size - pos); }
+    int read() override { return pos < size ? data[pos++] : -1; }
+    int peek() override { return pos < size ? data[pos] : -1; }
+    size_t readBytes(uint8_t* buffer, size_t length) override {
+        size_t count = length < size - pos ? length : size - pos;
+        memcpy(buffer, data + pos, count);
+        pos += count;
+        return count;
+    }
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t*, size_t len) override { return len; }
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0, pos = 0;
+};
+
+// Old receive path for comparison: byte loop into messageReceived[256],
+// memcpy into the caller's payload[256], CRC pass, then field decode
+static float legacy_decode_values(Stream& port) {
+    uint8_t messageReceived[256];
+    uint8_t payload[256];
+    int counter = 0;
+    while (port.available()) messageReceived[counter++] = port.read();
+    int len = messageReceived[1];
+    uint16_t crc_message = (messageReceived[counter - 3] << 8) | messageReceived[counter - 2];
+    memcpy(payload, &messageReceived[2], len);
+    if (crc16(payload, len) != crc_message) return 0.0;
+    
+    uint8_t* message = payload + 1;
+    int32_t index = 0;
+    float sum = buffer_get_float16(message, 10.0, &index);
+    sum += buffer_get_float16(message, 10.0, &index);
+    sum += buffer_get_float32(message, 100.0, &index);
+    sum += buffer_get_float32(message, 100.0, &index);
+    index += 8;
+    sum += buffer_get_float16(message, 1000.0, &index);
+    sum += buffer_get_float32(message, 1.0, &index);
+    sum += buffer_get_float16(message, 10.0, &index);
+    for (int i = 0; i < 4; i++) sum += buffer_get_float32(message, 10000.0, &index);
+    sum += buffer_get_int32(message, &index);
+    sum += buffer_get_int32(message, &index);
+    sum += message[index++];
+    sum += buffer_get_float32(message, 1000000.0, &index);
+    return sum;
+}
+
+#define DECODE_BENCH_FRAMES  50000
+
+void test_vesc_decode_benchmark(void) {
+    std::vector<uint8_t> frame = vesc_values_frame(1500.0, 50.0, 5.0);
+    BenchStream port;
+    VescUart vesc;
+    vesc.setSerialPort(&port);
+    
+    double in_place_ns = 0.0;
+    uint32_t decoded = 0;
+    for (int i = 0; i < DECODE_BENCH_FRAMES; i++) {
+        vesc.requestVescValues();
+        port.load(frame.data(), frame.size());
+        auto start = std::chrono::steady_clock::now();
+        vesc.update();
+        in_place_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (vesc.pollRequest(COMM_GET_VALUES) == VescUart::REQUEST_DONE) decoded++;
+    }
+    
+    double legacy_ns = 0.0;
+    volatile float sink = 0.0;
+    for (int i = 0; i < DECODE_BENCH_FRAMES; i++) {
+        port.load(frame.data(), frame.size());
+        auto start = std::chrono::steady_clock::now();
+        sink = sink + legacy_decode_values(port);
+        legacy_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+    
+    char line[200];
+    snprintf(line, sizeof(line),
+             "Decode GET_VALUES (%u byte frame): in place %.0f ns/frame, old copy+CRC pass %.0f ns/frame (host CPU)",
+             (unsigned)frame.size(), in_place_ns / DECODE_BENCH_FRAMES, legacy_ns / DECODE_BENCH_FRAMES);
+    TEST_MESSAGE(line);
+    
+    TEST_ASSERT_EQUAL_UINT32(DECODE_BENCH_FRAMES, decoded);
+    TEST_ASSERT_EQUAL_UINT32(0, vesc.linkStats.crcErrors);
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 1500.0, vesc.data.rpm);
+}
+
+// vescTask loop on the virtual clock: SET_CURRENT every 10ms (sensorTask
+// rate), GET_VALUES every 100ms, every 20th answer lost. Measures the host
+// CPU time per update() call, parser throughput and the reply latency.
+#define VESC_BENCH_SECONDS     60
+
+void test_vesc_uart_throughput_benchmark(void) {
+    ScriptedStream uart;
+    VescUart vesc;
+    vesc.setSerialPort(&uart);
+    
+    uint32_t requests = 0, answers = 0, lost = 0, overlapped_commands = 0;
+    double update_total_us = 0.0, update_max_us = 0.0;
+    uint32_t update_calls = 0;
+    unsigned long last_request = 0;
+    
+    const uint32_t steps = VESC_BENCH_SECONDS * 1000 / VESC_UART_POLL_MS;
+    for (uint32_t step = 0; step < steps; step++) {
+        hal_advance_time_us(VESC_UART_POLL_MS * 1000);
+        
+        if (step % (10 / VESC_UART_POLL_MS) == 0) {
+            if (vesc.isPending(COMM_GET_VALUES)) overlapped_commands++;
+            vesc.setCurrent(5.0);
+        }
+        
+        auto start = std::chrono::steady_clock::now();
+        vesc.update();
+        double us = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count();
+        update_total_us += us;
+        if (us > update_max_us) update_max_us = us;
+        update_calls++;
+        
+        if (vesc.pollRequest(COMM_GET_VALUES) == VescUart::REQUEST_DONE) answers++;
+        
+        if (!vesc.isPending(COMM_GET_VALUES) && millis() - last_request >= 100) {
+            last_request = millis();
+            TEST_ASSERT_TRUE(vesc.requestVescValues());
+            requests++;
+            if (requests % 20 == 0) {
+                lost++;
+            } else {
+                std::vector<uint8_t> reply = vesc_values_frame(1000.0 + requests, 50.0, 4.0);
+                uart.scriptAt(hal_time_us() + VESC_TURNAROUND_US, reply.data(), reply.size());
+            }
+        }
+    }
+    
+    char line[200];
+    snprintf(line, sizeof(line),
+             "UART: %u requests, %u answers, %u timeouts, %u SET_CURRENT overlapped a pending GET_VALUES",
+             requests, answers, vesc.linkStats.timeouts, overlapped_commands);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line),
+             "UART: reply latency last %u us, worst %u us (old blocking path stalled vescTask up to 200000 us)",
+             vesc.linkStats.lastLatencyUs, vesc.linkStats.maxLatencyUs);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line),
+             "UART: update() avg %.3f us, max %.1f us host CPU, parser %.1f MB/s (%u bytes)",
+             update_total_us / update_calls, update_max_us,
+             vesc.linkStats.bytesReceived / update_total_us, vesc.linkStats.bytesReceived);
+    TEST_MESSAGE(line);
+    
+    // Every answered request decoded, every lost one timed out - none stuck
+    // (the last request may still be in flight)
+    uint32_t in_flight = vesc.isPending(COMM_GET_VALUES) ? 1 : 0;
+    TEST_ASSERT_EQUAL_UINT32(requests, answers + vesc.linkStats.timeouts + in_flight);
+    TEST_ASSERT_TRUE(lost - vesc.linkStats.timeouts <= in_flight);
+    TEST_ASSERT_EQUAL_UINT32(0, vesc.linkStats.crcErrors);
+    TEST_ASSERT_TRUE(overlapped_commands > 0);
+    // Reply is picked up within one poll interval of its last byte
+    TEST_ASSERT_TRUE(vesc.linkStats.maxLatencyUs <= VESC_TURNAROUND_US + 64 * uart.byteTimeUs() + VESC_UART_POLL_MS * 1000);
+}
+
+// =============================================================================
+// DEFERRED LOG TESTS
+// =============================================================================
+
+// Print sink that keeps the drained text
+class CapturePrint : public Print {
+public:
+    std::string text;
+    size_t write(uint8_t value) override { text += (char)value; return 1; }
+};
+
+static void empty_deferred_log() {
+    CapturePrint sink;
+    while (drainDeferredLog(deferredLogRing, sink, DEFERRED_LOG_CAPACITY) > 0) {}
+}
+
+void test_deferred_log_formats_like_printf(void) {
+    empty_deferred_log();
+    for (int id = 0; id < NUM_DEFERRED_LOG_IDS; id++) {
+        TEST_ASSERT_NOT_NULL(DEFERRED_LOG_FORMATS[id].format);  // Table matches the enum
+    }
+    if (logMutex == NULL) {
+        logMutex = xSemaphoreCreateMutex();
+    }
+    int log_count_before = logMessageCount;
+    
+    logDeferred(LOG_POWER_CALC, 20.5f, 62.25f, 133.7f, 1.85f, 247.3f, 3200.0f, 3.175f);
+    logDeferred(LOG_VESC_UART, 1000UL, 2000UL, 30UL, 1UL, 2UL, 3UL, 850UL, 4100UL);
+    logDeferred(LOG_MOTOR_SPEED_EMERGENCY, 47.25);
+    
+    CapturePrint sink;
+    TEST_ASSERT_EQUAL(3, drainDeferredLog(deferredLogRing, sink, DEFERRED_LOG_CAPACITY));
+    
+    char expected[3 * DEFERRED_LOG_LINE_MAX];
+    snprintf(expected, sizeof(expected),
+             "POWER CALC - Torque:%.1fNm Cadence:%.1fRPM Human:%.0fW Factor:%.2f Assist:%.0fW MotorRPM:%.0f Current:%.2fA\r\n"
+             "[VESC] UART - TX: %lu B, RX: %lu B, Frames: %lu, CRC errors: %lu, Framing errors: %lu, Timeouts: %lu, Reply latency: %luus (max %luus)\r\n"
+             "EMERGENCY: Speed limit exceeded (%.1f km/h) - motor stopped!\r\n",
+             20.5f, 62.25f, 133.7f, 1.85f, 247.3f, 3200.0f, 3.175f,
+             1000UL, 2000UL, 30UL, 1UL, 2UL, 3UL, 850UL, 4100UL, 47.25);
+    TEST_ASSERT_EQUAL_STRING(expected, sink.text.c_str());
+    
+    // Only the web_log entry reached the web interface log
+    TEST_ASSERT_EQUAL(log_count_before + 1, logMessageCount);
+    int last = (logMessageIndex + MAX_LOG_MESSAGES - 1) % MAX_LOG_MESSAGES;
+    TEST_ASSERT_NOT_NULL(strstr(logMessages[last].c_str(), "Speed limit exceeded (47.2 km/h)"));
+}
+
+void test_deferred_log_full_ring_drops(void) {
+    static DeferredLogRing ring;
+    DeferredLogArg arg = deferredLogArg(7);
+    
+    int accepted = 0;
+    for (int i = 0; i < DEFERRED_LOG_CAPACITY + 3; i++) {
+        if (ring.push(LOG_PAS_POSITION_OVERFLOW, micros(), &arg, 1)) accepted++;
+    }
+    TEST_ASSERT_EQUAL(DEFERRED_LOG_CAPACITY, accepted);
+    TEST_ASSERT_EQUAL_UINT32(3, ring.stats().dropped);
+    
+    // Drain reports the loss once, after the surviving entries
+    CapturePrint sink;
+    TEST_ASSERT_EQUAL(DEFERRED_LOG_CAPACITY, drainDeferredLog(ring, sink, 1000));
+    TEST_ASSERT_TRUE(sink.text.find("[LOG] 3 log entries dropped") != std::string::npos);
+    sink.text.clear();
+    TEST_ASSERT_EQUAL(0, drainDeferredLog(ring, sink, 1000));
+    TEST_ASSERT_EQUAL_STRING("", sink.text.c_str());
+    
+    // Free slots are reused
+    TEST_ASSERT_TRUE(ring.push(LOG_PAS_STOPPED, micros(), NULL, 0));
+    TEST_ASSERT_EQUAL(1, drainDeferredLog(ring, sink, 1000));
+    TEST_ASSERT_EQUAL_STRING("[PAS] Pedaling stopped\r\n", sink.text.c_str());
+}
+
+// Two producers (sensorTask/vescTask) and the drain task on separate threads:
+// every entry arrives intact and in order per producer, or is counted as dropped
+#define DLOG_STRESS_ENTRIES 50000
+#define DLOG_BENCH_ROUNDS   2000
+
+void test_deferred_log_concurrent_producers(void) {
+    static DeferredLogRing ring;
+    std::atomic<bool> consumer_ready(false);
+    std::atomic<int> finished(0);
+    
+    auto producer = [&](int id) {
+        while (!consumer_ready.load()) {}
+        for (int i = 0; i < DLOG_STRESS_ENTRIES; i++) {
+            DeferredLogArg args[3] = {deferredLogArg(id), deferredLogArg(i), deferredLogArg(i * 0.5f)};
+            ring.push(LOG_PAS_POSITION_OVERFLOW, (uint32_t)i, args, 3);
+            if (i % 16 == 15) std::this_thread::yield();   // Rest of the control tick
+        }
+        finished++;
+    };
+    
+    uint32_t received = 0, corrupt = 0, out_of_order = 0;
+    int last_seen[2] = {-1, -1};
+    std::thread consumer([&]() {
+        DeferredLogEntry entry;
+        consumer_ready = true;
+        for (;;) {
+            bool done = finished.load() == 2;
+            if (!ring.pop(entry)) {
+                if (done) break;
+                continue;
+            }
+            received++;
+            int id = entry.args[0].i, seq = entry.args[1].i;
+            if (entry.num_args != 3 || (id != 0 && id != 1) || entry.args[2].f != seq * 0.5f ||
+                entry.timestamp_us != (uint32_t)seq) {
+                corrupt++;
+                continue;
+            }
+            if (seq <= last_seen[id]) out_of_order++;
+            last_seen[id] = seq;
+        }
+    });
+    
+    std::thread a(producer, 0), b(producer, 1);
+    a.join();
+    b.join();
+    consumer.join();
+    
+    DeferredLogStats stats = ring.stats();
+    TEST_ASSERT_EQUAL_UINT32(0, corrupt);
+    TEST_ASSERT_EQUAL_UINT32(0, out_of_order);
+    TEST_ASSERT_EQUAL_UINT32(2 * DLOG_STRESS_ENTRIES, stats.written + stats.dropped);
+    TEST_ASSERT_EQUAL_UINT32(stats.written, received);
+    TEST_ASSERT_EQUAL_UINT32(received, stats.drained);
+    TEST_ASSERT_TRUE(received > 0);
+    
+    // Cost on the hot path (push) vs. in the drain task (format one line)
+    DeferredLogEntry entry;
+    char line[DEFERRED_LOG_LINE_MAX];
+    double push_ns = 0.0, format_ns = 0.0;
+    for (int round = 0; round < DLOG_BENCH_ROUNDS; round++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < DEFERRED_LOG_CAPACITY; i++) {
+            DeferredLogArg args[7] = {deferredLogArg(20.5f), deferredLogArg(62.3f), deferredLogArg(133.7f),
+                                      deferredLogArg(1.85f), deferredLogArg(247.3f), deferredLogArg(3200.0f),
+                                      deferredLogArg(3.2f)};
+            ring.push(LOG_POWER_CALC, (uint32_t)i, args, 7);
+        }
+        auto pushed = std::chrono::steady_clock::now();
+        while (ring.pop(entry)) {
+            formatDeferredLogEntry(entry, line, sizeof(line));
+        }
+        auto formatted = std::chrono::steady_clock::now();
+        push_ns += std::chrono::duration<double, std::nano>(pushed - start).count();
+        format_ns += std::chrono::duration<double, std::nano>(formatted - pushed).count();
+    }
+    double lines = (double)DLOG_BENCH_ROUNDS * DEFERRED_LOG_CAPACITY;
+    printf("  INFO: deferred log: stress %u/%d entries delivered, %u dropped | push %.0f ns, format %.0f ns per line (host CPU)\n",
+           received, 2 * DLOG_STRESS_ENTRIES, stats.dropped, push_ns / lines, format_ns / lines);
+    printf("  INFO: Serial.printf of the same line at 115200 baud: %.0f us on the wire\n",
+           strlen(line) * 10 * 1e6 / 115200);
+    TEST_ASSERT_EQUAL_UINT32(0, ring.stats().dropped - stats.dropped);
+}
+
+void test_control_cycle_does_not_print(void) {
+    empty_deferred_log();
+    hal_set_millis(millis() + 10000);  // All periodic status lines are due
+    uint32_t written_before = deferredLogRing.stats().written;
+    size_t serial_before = hal_serial_bytes_written();
+    
+    run_sensor_cycle();
+    run_vesc_cycle(NULL);
+    
+    // Status lines were recorded, nothing was written to the UART
+    TEST_ASSERT_EQUAL(serial_before, hal_serial_bytes_written());
+    TEST_ASSERT_TRUE(deferredLogRing.stats().written - written_before >= 6);
+    
+    drainDeferredLog(deferredLogRing, Serial, DEFERRED_LOG_CAPACITY);
+    TEST_ASSERT_TRUE(hal_serial_bytes_written() > serial_before);
+}
+
+// update_vesc_data() every VESC_UART_POLL_MS for ms, the VESC answering
+// each request with its mask or staying silent
+static void run_vesc_link(ScriptedStream& uart, unsigned long ms, bool answer) {
+    for (unsigned long t = 0; t < ms; t += VESC_UART_POLL_MS) {
+        hal_advance_time_us(VESC_UART_POLL_MS * 1000);
+        if (answer && uart.written.size() >= 10) {
+            const std::vector<uint8_t>& req = uart.written;
+            uint32_t mask = ((uint32_t)req[3] << 24) | ((uint32_t)req[4] << 16) | ((uint32_t)req[5] << 8) | req[6];
+            std::vector<uint8_t> reply = vesc_selective_frame(mask, 1000.0, 50.0, 2.0);
+            uart.script(reply.data(), reply.size());
+        }
+        uart.written.clear();
+        update_vesc_data();
+    }
+}
+
+void test_vesc_outage_detected_each_time(void) {
+    static ScriptedStream uart;
+    uart.clear();
+    vescUart.setSerialPort(&uart);
+    run_vesc_link(uart, 200, true);              // Connected, whatever earlier tests left
+    TEST_ASSERT_TRUE(vesc_data_valid);
+
+    for (int outage = 0; outage < 2; outage++) {
+        empty_deferred_log();
+        motor_enabled = true;
+
+        // A single timed-out request: lost, but not yet safe mode
+        run_vesc_link(uart, 300, false);
+        TEST_ASSERT_FALSE(vesc_data_valid);
+        TEST_ASSERT_TRUE(motor_enabled);
+
+        // 5 s without an answer: safe mode, each line logged once
+        run_vesc_link(uart, 5500, false);
+        TEST_ASSERT_FALSE(motor_enabled);
+        CapturePrint sink;
+        drainDeferredLog(deferredLogRing, sink, DEFERRED_LOG_CAPACITY);
+        TEST_ASSERT_NOT_NULL(strstr(sink.text.c_str(), "VESC connection lost"));
+        TEST_ASSERT_NOT_NULL(strstr(sink.text.c_str(), "Motor disabled - VESC connection failed"));
+
+        run_vesc_link(uart, 200, true);          // Reconnect
+        TEST_ASSERT_TRUE(vesc_data_valid);
+    }
+}
+
+// =============================================================================
+// TASK PERF (HISTOGRAM) TESTS
+// =============================================================================
+
+void test_perf_histogram_buckets(void) {
+    // Every value lands in a bucket that contains it; buckets are <= 25% wide
+    for (uint32_t v = 0; v < 2000000; v += (v < 4096 ? 1 : 997)) {
+        uint32_t i = PerfHistogram::bucketIndex(v);
+        TEST_ASSERT_TRUE(PerfHistogram::bucketLower(i) <= v);
+        TEST_ASSERT_TRUE(v <= PerfHistogram::bucketUpper(i));
+        if (v >= 8 && i < PERF_NUM_BUCKETS - 1) {
+            TEST_ASSERT_TRUE(PerfHistogram::bucketUpper(i) - PerfHistogram::bucketLower(i) + 1 <=
+                             PerfHistogram::bucketLower(i) / 4);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(PERF_NUM_BUCKETS - 1, PerfHistogram::bucketIndex(UINT32_MAX));
+    
+    static PerfHistogram h;
+    h.reset();
+    for (uint32_t v = 1; v <= 1000; v++) h.record(v);
+    TEST_ASSERT_EQUAL_UINT32(1000, h.count());
+    TEST_ASSERT_EQUAL_UINT32(1000, h.maxValue());
+    TEST_ASSERT_TRUE(h.percentile(0.5f) >= 500 && h.percentile(0.5f) <= 625);
+    TEST_ASSERT_TRUE(h.percentile(0.99f) >= 990 && h.percentile(0.99f) <= 1000);
+    TEST_ASSERT_FLOAT_WITHIN(25.0, 500.5, h.mean());
+}
+
+// sensorTask-like loop on the virtual clock: 10ms period, 150us iterations,
+// every 10th wake-up 300us late, one 12ms overrun
+void test_task_perf_periodic_loop(void) {
+    taskPerfRegister(TASK_PERF_SENSOR, "sensor", 10000, 10000);
+    hal_set_time_us(5000000);
+    uint64_t grid = hal_time_us();
+    
+    for (int i = 0; i < 100; i++) {
+        uint64_t wake = grid + (i % 10 == 9 ? 300 : 0);
+        if (hal_time_us() < wake) hal_set_time_us(wake);   // vTaskDelayUntil
+        taskPerfBeginPeriodic(TASK_PERF_SENSOR);
+        hal_advance_time_us(i == 50 ? 12000 : 150);
+        taskPerfEnd(TASK_PERF_SENSOR);
+        grid += 10000;
+    }
+    
+    const TaskPerf& perf = taskPerf[TASK_PERF_SENSOR];
+    TEST_ASSERT_EQUAL_UINT32(100, perf.iterations.load());
+    TEST_ASSERT_EQUAL_UINT32(1, perf.deadline_misses.load());
+    TEST_ASSERT_EQUAL_UINT32(12000, perf.run_time_us.maxValue());
+    TEST_ASSERT_EQUAL_UINT32(PerfHistogram::bucketUpper(PerfHistogram::bucketIndex(150)),
+                             perf.run_time_us.percentile(0.5f));
+    // The overrun makes the next iteration start 2ms late (grid is kept)
+    TEST_ASSERT_EQUAL_UINT32(2000, perf.wake_jitter_us.maxValue());
+    TEST_ASSERT_EQUAL_UINT32(89, perf.wake_jitter_us.bucketCount(0));
+    TEST_ASSERT_EQUAL_UINT32(10, perf.wake_jitter_us.bucketCount(PerfHistogram::bucketIndex(300)));
+    
+    char json[PERF_JSON_MAX];
+    size_t length = taskPerfToJson(json, sizeof(json));
+    TEST_ASSERT_TRUE(length < sizeof(json));
+    TEST_ASSERT_NOT_NULL(strstr(json, "{\"name\":\"sensor\",\"period_us\":10000,\"deadline_us\":10000,"
+                                      "\"iterations\":100,\"deadline_misses\":1,"));
+    TEST_ASSERT_NOT_NULL(strstr(json, "\"jitter_us\":{\"n\":100,"));
+    TEST_ASSERT_NOT_NULL(strstr(json, "\"max\":12000,"));
+    
+    // Reset takes effect at the owner's next iteration
+    taskPerfRequestReset();
+    TEST_ASSERT_EQUAL_UINT32(100, perf.iterations.load());
+    taskPerfBeginPeriodic(TASK_PERF_SENSOR);
+    taskPerfEnd(TASK_PERF_SENSOR);
+    TEST_ASSERT_EQUAL_UINT32(1, perf.iterations.load());
+    TEST_ASSERT_EQUAL_UINT32(0, perf.deadline_misses.load());
+}
+
+void test_task_perf_event_driven_and_compact_json(void) {
+    taskPerfRegister(TASK_PERF_VESC, "vesc", 0, VESC_UART_POLL_MS * 1000UL);
+    taskPerfRegister(TASK_PERF_WIFI, "wifi", 1000000, 1000000);
+    taskPerfRegister(TASK_PERF_BLE, "ble", 2000000, 2000000);
+    hal_set_time_us(9000000);
+    
+    // Woken 40us after the mailbox write, 2.5ms of work -> deadline missed
+    uint32_t queued = micros();
+    hal_advance_time_us(40);
+    taskPerfBegin(TASK_PERF_VESC, queued);
+    hal_advance_time_us(2500);
+    taskPerfEnd(TASK_PERF_VESC);
+    // Poll timeout that fired early (tick rounding) counts as on time
+    taskPerfBegin(TASK_PERF_VESC, micros() + 900);
+    hal_advance_time_us(30);
+    taskPerfEnd(TASK_PERF_VESC);
+    
+    const TaskPerf& perf = taskPerf[TASK_PERF_VESC];
+    TEST_ASSERT_EQUAL_UINT32(1, perf.deadline_misses.load());
+    TEST_ASSERT_EQUAL_UINT32(40, perf.wake_jitter_us.maxValue());
+    TEST_ASSERT_EQUAL_UINT32(1, perf.wake_jitter_us.bucketCount(0));
+    
+    // All four tasks fit the BLE attribute even with large values
+    char compact[PERF_JSON_COMPACT_MAX];
+    size_t length = taskPerfToCompactJson(compact, sizeof(compact));
+    TEST_ASSERT_TRUE(length < sizeof(compact));
+    TEST_ASSERT_NOT_NULL(strstr(compact, "[\"vesc\",2,1,"));
+    TEST_ASSERT_NOT_NULL(strstr(compact, "[\"ble\",0,0,0,0,0,0,0]"));
+    
+    for (int i = 0; i < NUM_TASK_PERF; i++) taskPerf[i].name = NULL;
+}
+
+// =============================================================================
+// RIDE SIMULATOR (closed loop around the real control cycles, lib/RideSim)
+// =============================================================================
+
+static void print_ride_kpis(const char* name, const RideKpis& k) {
+    printf("  INFO: %-14s %.0fs %.2f km, avg %.1f / max %.1f km/h | assist latency avg %.0f ms, max %.0f ms (%d/%d starts)\n",
+           name, k.duration_s, k.distance_km, k.avg_speed_kmh, k.max_speed_kmh,
+           k.assist_latency_avg_ms, k.assist_latency_max_ms, k.assisted_starts, k.pedal_starts);
+    printf("  INFO: %-14s start: assist after max %d PAS edges | stop: assist off after avg %.0f ms, max %.0f ms (%d stops)\n",
+           "", k.assist_start_edges_max, k.stop_latency_avg_ms, k.stop_latency_max_ms, k.crank_stops);
+    printf("  INFO: %-14s current peak %.2f A, overshoot %.2f A (%.0f%%), ripple %.0f%% | human %.1f Wh, motor %.1f Wh (ratio %.2f), battery %.1f Wh = %.1f Wh/km, min %.1f V\n",
+           "", k.peak_motor_current_a, k.current_overshoot_a, k.current_overshoot_pct, k.current_ripple_pct,
+           k.human_wh, k.motor_wh, k.motor_human_ratio, k.battery_wh, k.wh_per_km, k.min_battery_voltage);
+    printf("  INFO: %-14s assist requested %.1f Wh, delivered %.0f%% | motor max %.1f C, FET max %.1f C, VESC cutback %.0f s, current limit min %.2f A, %d BMS trips\n",
+           "", k.requested_wh, k.assist_delivery_pct, k.max_motor_temp_c, k.max_fet_temp_c, k.vesc_cutback_s,
+           k.min_current_limit_a, k.bms_trips);
+    printf("  INFO: %-14s %lu SET_CURRENT, %lu UART timeouts | %.1f ms host time = %.0fx real time\n",
+           "", (unsigned long)k.commands_received, (unsigned long)k.uart_timeouts, k.wall_time_ms, k.realtime_factor);
+}
+
+void test_ride_simulator_scenarios(void) {
+    RideSimulator sim;
+    
+    RideKpis hill = sim.run(RIDE_HILL_START);
+    print_ride_kpis(RIDE_HILL_START.name, hill);
+    TEST_ASSERT_EQUAL(1, hill.pedal_starts);
+    TEST_ASSERT_EQUAL(1, hill.assisted_starts);
+    TEST_ASSERT_TRUE(hill.max_speed_kmh > 8.0);
+    
+    RideKpis stop_go = sim.run(RIDE_STOP_AND_GO);
+    print_ride_kpis(RIDE_STOP_AND_GO.name, stop_go);
+    TEST_ASSERT_EQUAL(4, stop_go.pedal_starts);
+    TEST_ASSERT_EQUAL(4, stop_go.assisted_starts);
+    
+    RideKpis cruise = sim.run(RIDE_CRUISE_25);
+    print_ride_kpis(RIDE_CRUISE_25.name, cruise);
+    TEST_ASSERT_FLOAT_WITHIN(2.0, 25.0, sim.speedKmh());
+    TEST_ASSERT_TRUE(cruise.wh_per_km > 0.0 && cruise.wh_per_km < 30.0);
+    // Rider PI without windup: no 30+ km/h overshoot and coasting after the
+    // acceleration, the cruise current follows the pedal strokes only
+    TEST_ASSERT_TRUE(cruise.max_speed_kmh < 28.0);
+    TEST_ASSERT_TRUE(cruise.current_ripple_pct < 20.0);
+    
+    // Feet on the stopped pedals: PAS ends the assist within a few edge
+    // intervals (was PEDAL_TIMEOUT_MS); every start gets assist by the 2nd edge
+    RideKpis pause = sim.run(RIDE_PEDAL_PAUSE);
+    print_ride_kpis(RIDE_PEDAL_PAUSE.name, pause);
+    TEST_ASSERT_EQUAL(3, pause.crank_stops);
+    TEST_ASSERT_TRUE(pause.stop_latency_max_ms < 200.0);
+    TEST_ASSERT_TRUE(hill.assist_start_edges_max <= 2);
+    TEST_ASSERT_TRUE(stop_go.assist_start_edges_max <= 2);
+
+    // Torque averaged over each pedal stroke: the assist no longer surges
+    // with the 70% crank torque ripple (was ~50% current ripple)
+    TEST_ASSERT_TRUE(stop_go.current_ripple_pct < 20.0);
+    TEST_ASSERT_TRUE(pause.current_ripple_pct < 20.0);
+
+    // All three rides (173 s) well ahead of real time - a loose bound: the
+    // factor depends on the optimisation level and host load (~600x at -O0,
+    // a few 1000x optimised), the per-ride figure is in the INFO lines
+    double ride_s = hill.duration_s + stop_go.duration_s + cruise.duration_s;
+    double host_ms = hill.wall_time_ms + stop_go.wall_time_ms + cruise.wall_time_ms;
+    TEST_ASSERT_TRUE(ride_s * 1000.0 / host_ms >= 50.0);
+    
+    // The firmware never commands more than MAX_MOTOR_CURRENT and the VESC
+    // link keeps up (every 10ms tick reaches the VESC or is deduplicated)
+    TEST_ASSERT_TRUE(hill.peak_motor_current_a <= MAX_MOTOR_CURRENT + 0.01);
+    TEST_ASSERT_EQUAL(0, cruise.uart_timeouts);
+}
+
+// Command shaping settings on the same ride: overshoot of the motor
+// current over its settled value and time from the first command to the
+// requested current
+void test_ride_simulator_current_shaping(void) {
+    struct Setting {
+        const char* name;
+        CurrentShaperConfig config;
+    };
+    const Setting settings[] = {
+        {"unshaped",  {0.0f, 0.0f, 0.0f, 0.0f}},
+        {"rate",      {0.0f, CURRENT_RAMP_RATE, CURRENT_FALL_RATE, 0.0f}},
+        {"rate+jerk", {0.0f, CURRENT_RAMP_RATE, CURRENT_FALL_RATE, CURRENT_JERK_LIMIT}},
+        {"default",   current_shaper_default_config()},
+    };
+    const int count = sizeof(settings) / sizeof(settings[0]);
+    RideKpis hill[count], stop_go[count], pause[count];
+
+    RideSimulator sim;
+    for (int i = 0; i < count; i++) {
+        current_shaper_configure(settings[i].config);
+        hill[i] = sim.run(RIDE_HILL_START);
+        stop_go[i] = sim.run(RIDE_STOP_AND_GO);
+        pause[i] = sim.run(RIDE_PEDAL_PAUSE);
+        printf("  INFO: %-10s hill: overshoot %.2f A, to target %.0f ms | stop-and-go: overshoot %.2f A, to target avg %.0f / max %.0f ms, assist latency max %.0f ms | pause: stop %.0f ms\n",
+               settings[i].name, hill[i].current_overshoot_a, hill[i].time_to_target_max_ms,
+               stop_go[i].current_overshoot_a, stop_go[i].time_to_target_avg_ms, stop_go[i].time_to_target_max_ms,
+               stop_go[i].assist_latency_max_ms, pause[i].stop_latency_max_ms);
+    }
+    current_shaper_configure(current_shaper_default_config());
+
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL(4, stop_go[i].assisted_starts);
+        TEST_ASSERT_TRUE(pause[i].stop_latency_max_ms < 200.0);   // Safety cut is not ramped
+    }
+
+    // The shaping itself, in the real cycle: unshaped the VESC follows within
+    // its current loop, the rate limit stretches a start to about
+    // MAX_MOTOR_CURRENT / CURRENT_RAMP_RATE (400 ms to the full 8 A), the jerk
+    // limit rounds the corners off on top of that - and no setting overshoots
+    const float ramp_ms = MAX_MOTOR_CURRENT / CURRENT_RAMP_RATE * 1000.0f;
+    TEST_ASSERT_TRUE(hill[0].time_to_target_max_ms < 50.0f);
+    TEST_ASSERT_TRUE(hill[1].time_to_target_max_ms > 0.7f * ramp_ms);
+    TEST_ASSERT_TRUE(hill[2].time_to_target_max_ms > hill[1].time_to_target_max_ms);
+    TEST_ASSERT_TRUE(hill[3].time_to_target_max_ms >= hill[2].time_to_target_max_ms);
+    TEST_ASSERT_TRUE(hill[3].time_to_target_max_ms < 1.5f * ramp_ms);
+    TEST_ASSERT_TRUE(stop_go[3].time_to_target_max_ms > stop_go[0].time_to_target_max_ms + 0.5f * ramp_ms);
+    TEST_ASSERT_TRUE(stop_go[3].time_to_target_max_ms < 1.5f * ramp_ms);
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_TRUE(hill[i].current_overshoot_a < 0.1f);
+    }
+}
+
+// Motor weaker / stronger than MOTOR_CONSTANT_KT: the tracking loop scales
+// the current until the delivered assist power matches the request
+void test_ride_simulator_kt_error(void) {
+    const float kt_factors[] = {1.0f, 0.8f, 1.25f};
+    float delivery_min = 100.0f, delivery_max = 0.0f;
+    float nominal_scale = 1.0f;
+    for (float kt_factor : kt_factors) {
+        RideParams params;
+        params.kt_wheel = MOTOR_CONSTANT_KT * kt_factor;
+        RideSimulator sim(params);
+        RideKpis cruise = sim.run(RIDE_CRUISE_25);
+        printf("  INFO: Kt x%.2f  cruise: assist requested %.2f Wh, delivered %.0f%%, scale %.2f\n",
+               kt_factor, cruise.requested_wh, cruise.assist_delivery_pct, current_tracker().scale());
+
+        // Learned on top of the nominal motor (the simulated one has no
+        // drag, so the motor map asks a little too much there): 1 / Kt error
+        if (kt_factor == 1.0f) {
+            nominal_scale = current_tracker().scale();
+        }
+        TEST_ASSERT_FLOAT_WITHIN(0.05f, 1.0f / kt_factor, current_tracker().scale() / nominal_scale);
+        delivery_min = min(delivery_min, cruise.assist_delivery_pct);
+        delivery_max = max(delivery_max, cruise.assist_delivery_pct);
+    }
+    // Open loop: 77% / 62% / 95% (the acceleration at MAX_MOTOR_CURRENT
+    // cannot be corrected)
+    TEST_ASSERT_TRUE(delivery_max - delivery_min < 15.0f);
+}
+
+// 15 minutes up a 6% grade on a hot day. Without derating the motor runs at
+// MAX_MOTOR_CURRENT into the VESC's thermal cutback; with it the current
+// eases off ahead of time and the winding stays at its limit.
+void test_ride_simulator_thermal_derating(void) {
+    RideParams params;
+    params.ambient_c = 35.0f;
+
+    RideSimulator sim(params);
+    thermal_derating_enable(false);
+    RideKpis vesc_only = sim.run(RIDE_LONG_CLIMB);
+    thermal_derating_enable(true);
+    print_ride_kpis("climb (VESC)", vesc_only);
+    RideKpis derated = sim.run(RIDE_LONG_CLIMB);
+    print_ride_kpis("climb (derate)", derated);
+
+    TEST_ASSERT_TRUE(vesc_only.max_motor_temp_c > params.vesc_temp_start_c);
+    TEST_ASSERT_TRUE(vesc_only.vesc_cutback_s > 10.0f);
+    TEST_ASSERT_TRUE(derated.max_motor_temp_c <= THERMAL_MOTOR_LIMIT_C + 1.0f);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, derated.vesc_cutback_s);
+    TEST_ASSERT_TRUE(derated.min_current_limit_a < MAX_MOTOR_CURRENT - 0.5f);
+
+    // The price of 8 K less winding temperature: about 5% less distance
+    TEST_ASSERT_TRUE(derated.distance_km > vesc_only.distance_km * 0.9f);
+
+    // Winding heating 40% faster than the model: the VESC reading corrects it
+    params.motor_capacity_j_per_k = THERMAL_MOTOR_CAPACITY_J_PER_K / 1.4f;
+    RideSimulator fast(params);
+    RideKpis fast_derated = fast.run(RIDE_LONG_CLIMB);
+    print_ride_kpis("climb (C/1.4)", fast_derated);
+    TEST_ASSERT_TRUE(fast_derated.max_motor_temp_c <= THERMAL_MOTOR_LIMIT_C + 2.0f);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, fast_derated.vesc_cutback_s);
+}
+
+// Near-empty, aged pack (0.5 Ohm): accelerating to 25 km/h at full current
+// sags it below the BMS trip, which switches the pack off. The estimated
+// resistance lets the firmware cap the current at the cutoff instead.
+void test_ride_simulator_battery_sag(void) {
+    RideParams params;
+    params.initial_soc = 0.02f;
+    params.battery_resistance_ohm = 0.5f;
+    RideSimulator sim(params);
+
+    battery_limit_enable(false);
+    RideKpis unlimited = sim.run(RIDE_CRUISE_25);
+    battery_limit_enable(true);
+    print_ride_kpis("sag (no limit)", unlimited);
+    RideKpis limited = sim.run(RIDE_CRUISE_25);
+    print_ride_kpis("sag (limit)", limited);
+    printf("  INFO: estimated pack resistance %.3f Ohm (%lu steps)\n",
+           battery_estimator().resistance(), (unsigned long)battery_estimator().steps());
+
+    TEST_ASSERT_EQUAL(1, unlimited.bms_trips);
+    TEST_ASSERT_EQUAL(0, limited.bms_trips);
+    TEST_ASSERT_TRUE(limited.min_battery_voltage > BATTERY_CUTOFF_VOLTAGE - 0.5f);
+    TEST_ASSERT_TRUE(limited.motor_wh > unlimited.motor_wh);
+    TEST_ASSERT_FLOAT_WITHIN(0.2f * params.battery_resistance_ohm, params.battery_resistance_ohm,
+                             battery_estimator().resistance());
+}
+
+void test_ride_simulator_repeatable(void) {
+    // Same scenario, same result - nothing depends on the host scheduler
+    RideSimulator sim;
+    RideKpis first = sim.run(RIDE_STOP_AND_GO);
+    RideKpis second = sim.run(RIDE_STOP_AND_GO);
+    
+    TEST_ASSERT_FLOAT_WITHIN(first.distance_km * 0.01, first.distance_km, second.distance_km);
+    TEST_ASSERT_FLOAT_WITHIN(first.battery_wh * 0.02 + 0.01, first.battery_wh, second.battery_wh);
+    TEST_ASSERT_EQUAL(first.assisted_starts, second.assisted_starts);
+}
+
 // =============================================================================
 // MAIN TEST RUNNER
 // =============================================================================
@@ -517,29 +3029,96 @@ int main(void) {
     RUN_TEST(test_torque_sensor_above_threshold);
     RUN_TEST(test_torque_sensor_maximum_forward);
     RUN_TEST(test_torque_sensor_symmetry);
+    RUN_TEST(test_cic_decimator_step_response);
+    RUN_TEST(test_torque_adc_dma_decimates_noise);
+    RUN_TEST(test_torque_zero_boot_calibration_and_tracking);
+    RUN_TEST(test_torque_calibration_table);
+    
+    // PAS Sensor Tests
+    RUN_TEST(test_pas_edge_ring_decodes_every_edge);
+    RUN_TEST(test_pas_edge_ring_bounce_and_overflow);
+    RUN_TEST(test_pas_predictive_stop_and_start);
+    RUN_TEST(test_cadence_estimator_calibrates_uneven_edges);
+    RUN_TEST(test_cadence_estimator_follows_cadence_step);
+    RUN_TEST(test_pas_pcnt_counts_quadrature);
+    RUN_TEST(test_pas_pcnt_stop_and_start);
+    RUN_TEST(test_cadence_estimator_magnet_steps);
+    RUN_TEST(test_crank_torque_average_removes_stroke_pulse);
     
     // Assist Calculation Tests
     RUN_TEST(test_assist_calculation_exact_speed_points);
     RUN_TEST(test_assist_calculation_interpolation);
     RUN_TEST(test_assist_calculation_edge_cases);
+    RUN_TEST(test_assist_table_matches_interpolation);
+    RUN_TEST(test_assist_table_benchmark);
+    RUN_TEST(test_assist_map_interpolation);
+    RUN_TEST(test_assist_map_profile);
+    RUN_TEST(test_assist_map_benchmark);
     RUN_TEST(test_power_calculation);
+    RUN_TEST(test_power_calculation_uses_motor_rpm);
     RUN_TEST(test_power_limits);
+    RUN_TEST(test_motor_map_matches_curve);
+    RUN_TEST(test_motor_map_inversion);
     
     // Motor Control Tests
     RUN_TEST(test_motor_activation_normal_conditions);
+    RUN_TEST(test_motor_activation_uses_learned_zero);
+    RUN_TEST(test_motor_cut_on_stale_vesc_data);
+    RUN_TEST(test_motor_command_dedup_keepalive);
     RUN_TEST(test_motor_deactivation_pas_timeout);
     RUN_TEST(test_motor_deactivation_reverse_pedaling);
     RUN_TEST(test_emergency_speed_cutoff);
+    RUN_TEST(test_current_shaper_s_curve);
+    RUN_TEST(test_current_tracker_learns_kt_error);
+    RUN_TEST(test_thermal_node_forecast);
     
     // Battery Monitoring Tests
+    RUN_TEST(test_battery_resistance_estimator);
     RUN_TEST(test_normal_battery_status);
     RUN_TEST(test_low_battery_detection);
     RUN_TEST(test_critical_battery_detection);
     RUN_TEST(test_battery_led_normal);
+    RUN_TEST(test_battery_led_blinks_when_low);
     
     // Integration Tests
     RUN_TEST(test_complete_sensor_fusion_pipeline);
     RUN_TEST(test_different_assist_modes);
     
+    // Shared Data Tests
+    RUN_TEST(test_seqlock_publish_and_read);
+    RUN_TEST(test_seqlock_contention_benchmark);
+    
+    // Deferred Log Tests
+    RUN_TEST(test_deferred_log_formats_like_printf);
+    RUN_TEST(test_deferred_log_full_ring_drops);
+    RUN_TEST(test_deferred_log_concurrent_producers);
+    RUN_TEST(test_control_cycle_does_not_print);
+    RUN_TEST(test_vesc_outage_detected_each_time);
+    
+    // Task Perf Tests
+    RUN_TEST(test_perf_histogram_buckets);
+    RUN_TEST(test_task_perf_periodic_loop);
+    RUN_TEST(test_task_perf_event_driven_and_compact_json);
+    
+    // VESC UART Tests
+    RUN_TEST(test_vesc_parser_decodes_get_values);
+    RUN_TEST(test_vesc_set_current_overlaps_get_values);
+    RUN_TEST(test_vesc_parser_resync_and_timeout);
+    RUN_TEST(test_vesc_late_update_keeps_frame);
+    RUN_TEST(test_vesc_selective_values_decode);
+    RUN_TEST(test_vesc_truncated_answers_rejected);
+    RUN_TEST(test_vesc_dual_rate_polling_bytes);
+    RUN_TEST(test_vesc_long_frames);
+    RUN_TEST(test_vesc_decode_benchmark);
+    RUN_TEST(test_vesc_uart_throughput_benchmark);
+    
+    // Ride simulator
+    RUN_TEST(test_ride_simulator_scenarios);
+    RUN_TEST(test_ride_simulator_current_shaping);
+    RUN_TEST(test_ride_simulator_kt_error);
+    RUN_TEST(test_ride_simulator_thermal_derating);
+    RUN_TEST(test_ride_simulator_battery_sag);
+    RUN_TEST(test_ride_simulator_repeatable);
+    
     return UNITY_END();
 }
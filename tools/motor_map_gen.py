@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""Generate the motor Kt / efficiency table from load test points.
+
+Each CSV line is one point of a motor load test at the hub (see
+_documentation/Motor/files/Q100C-Curve.csv, from Q100C-Curve.pdf):
+
+    torque_nm,wheel_rpm,voltage_v,current_a,input_w,output_w
+    8.04,213.3,38.27,5.86,224.26,179.59
+
+input_w / output_w may be empty (computed as U * I and T * omega). Lines
+starting with # are comments.
+
+A load test runs at one voltage, so speed and current change together. To
+spread the points over a current x speed grid the tool fits a small motor
+model by least squares:
+
+    losses       P_in - P_out = R * I^2 + P0          (copper + constant drag)
+    loss torque  T_loss(omega) = P0 / max(omega, omega_min)
+    back-EMF     T + T_loss = (k0 + k1 * I) * I
+
+omega_min is the slowest measured point: below it the drag torque is held
+(no data there). From the model:
+
+    Kt(I, rpm)  = T / I = k0 + k1 * I - T_loss / I     (>= 0)
+    eta(I, rpm) = T * omega / (T * omega + R * I^2 + T_loss * omega)
+
+Prints include/motor_map_table.h:
+
+    tools/motor_map_gen.py _documentation/Motor/files/Q100C-Curve.csv > include/motor_map_table.h
+"""
+
+import argparse
+import csv
+import math
+import sys
+
+
+def read_points(path):
+    """[(torque_nm, omega, current_a, input_w, output_w)] from the CSV."""
+    with open(path, newline="") as f:
+        lines = [line for line in f if not line.lstrip().startswith("#")]
+    points = []
+    for line, row in enumerate(csv.DictReader(lines), start=2):
+        try:
+            torque = float(row["torque_nm"])
+            omega = float(row["wheel_rpm"]) * 2.0 * math.pi / 60.0
+            voltage = float(row["voltage_v"])
+            current = float(row["current_a"])
+            input_w = float(row["input_w"]) if row.get("input_w") else voltage * current
+            output_w = float(row["output_w"]) if row.get("output_w") else torque * omega
+        except (KeyError, ValueError) as e:
+            sys.exit("line %d: %s" % (line, e))
+        points.append((torque, omega, current, input_w, output_w))
+    if len(points) < 3:
+        sys.exit("need at least 3 load points")
+    return points
+
+
+def least_squares(rows, values):
+    """Coefficients c minimising sum((row . c - value)^2), normal equations."""
+    n = len(rows[0])
+    a = [[sum(r[i] * r[j] for r in rows) for j in range(n)] + [sum(r[i] * v for r, v in zip(rows, values))]
+         for i in range(n)]
+    for i in range(n):
+        pivot = max(range(i, n), key=lambda k: abs(a[k][i]))
+        a[i], a[pivot] = a[pivot], a[i]
+        if abs(a[i][i]) < 1e-12:
+            sys.exit("load points do not determine the model (all at one current?)")
+        for k in range(n):
+            if k != i:
+                f = a[k][i] / a[i][i]
+                a[k] = [x - f * y for x, y in zip(a[k], a[i])]
+    return [a[i][n] / a[i][i] for i in range(n)]
+
+
+class MotorModel:
+    def __init__(self, points):
+        # Copper resistance and constant drag power
+        self.r, self.p0 = least_squares([(i * i, 1.0) for _, _, i, _, _ in points],
+                                        [p_in - p_out for _, _, _, p_in, p_out in points])
+        self.p0 = max(self.p0, 0.0)
+        self.omega_min = min(omega for _, omega, _, _, _ in points)
+
+        # Torque constant, allowed to change with current
+        self.k0, self.k1 = least_squares([(i, i * i) for _, _, i, _, _ in points],
+                                         [t + self.loss_torque(omega) for t, omega, _, _, _ in points])
+
+    def loss_torque(self, omega):
+        return self.p0 / max(omega, self.omega_min)
+
+    def torque(self, current, omega):
+        return max((self.k0 + self.k1 * current) * current - self.loss_torque(omega), 0.0)
+
+    def kt(self, current, omega):
+        return self.torque(current, omega) / current if current > 0 else 0.0
+
+    def efficiency(self, current, omega):
+        p_out = self.torque(current, omega) * omega
+        p_in = p_out + self.r * current * current + self.loss_torque(omega) * omega
+        return p_out / p_in if p_in > 0 else 0.0
+
+
+def c_rows(values, indent="  "):
+    return ",\n".join(indent + "{" + ", ".join("%.4f" % v for v in row) + "}" for row in values)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("csv", help="load test points")
+    parser.add_argument("--current-step", type=float, default=0.5, help="grid step [A] (default 0.5)")
+    parser.add_argument("--current-points", type=int, default=33, help="current axis points from 0 (default 33)")
+    parser.add_argument("--rpm-step", type=float, default=40.0, help="grid step [wheel rpm] (default 40)")
+    parser.add_argument("--rpm-points", type=int, default=9, help="speed axis points from 0 (default 9)")
+    args = parser.parse_args()
+
+    points = read_points(args.csv)
+    model = MotorModel(points)
+    currents = [i * args.current_step for i in range(args.current_points)]
+    rpms = [j * args.rpm_step for j in range(args.rpm_points)]
+    omegas = [rpm * 2.0 * math.pi / 60.0 for rpm in rpms]
+
+    kt = [[model.kt(i, w) for w in omegas] for i in currents]
+    eta = [[model.efficiency(i, w) for w in omegas] for i in currents]
+
+    # How well the grid reproduces the measurement
+    print("R %.3f Ohm, P0 %.1f W (loss torque %.2f Nm below %.0f rpm), Kt %.3f + %.4f * I Nm/A"
+          % (model.r, model.p0, model.loss_torque(0.0), model.omega_min * 60.0 / (2.0 * math.pi),
+             model.k0, model.k1), file=sys.stderr)
+    for t, omega, i, p_in, p_out in points:
+        print("  %5.2f Nm %5.1f rpm %5.2f A: Kt %.3f (model %.3f), eta %.3f (model %.3f)"
+              % (t, omega * 60.0 / (2.0 * math.pi), i, t / i, model.kt(i, omega), p_out / p_in,
+                 model.efficiency(i, omega)), file=sys.stderr)
+
+    source = args.csv.replace("\\", "/")
+    print("""#ifndef MOTOR_MAP_TABLE_H
+#define MOTOR_MAP_TABLE_H
+
+// Generated by tools/motor_map_gen.py from %s - do not edit.
+// Model: R %.3f Ohm, drag %.1f W (%.2f Nm below %.0f rpm), Kt %.3f + %.4f * I Nm/A
+
+#define MOTOR_MAP_CURRENT_POINTS  %d
+#define MOTOR_MAP_CURRENT_STEP    %.2ff    // [A], axis from 0
+#define MOTOR_MAP_RPM_POINTS      %d
+#define MOTOR_MAP_RPM_STEP        %.1ff    // [wheel rpm], axis from 0
+
+// Hub torque per amp [Nm/A], [current][rpm]
+static const float MOTOR_MAP_KT[MOTOR_MAP_CURRENT_POINTS][MOTOR_MAP_RPM_POINTS] = {
+%s
+};
+
+// Mechanical out / electrical in, [current][rpm]
+static const float MOTOR_MAP_EFFICIENCY[MOTOR_MAP_CURRENT_POINTS][MOTOR_MAP_RPM_POINTS] = {
+%s
+};
+
+#endif // MOTOR_MAP_TABLE_H""" % (source, model.r, model.p0, model.loss_torque(0.0),
+                                  model.omega_min * 60.0 / (2.0 * math.pi), model.k0, model.k1,
+                                  args.current_points, args.current_step, args.rpm_points, args.rpm_step,
+                                  c_rows(kt), c_rows(eta)))
+
+
+if __name__ == "__main__":
+    main()
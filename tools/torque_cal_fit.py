@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""Fit the torque sensor calibration table from calibration weight readings.
+
+Hang known weights on the horizontal crank (forward: pedal pushed down in
+riding direction, backward: pedal pushed down against it) and note the raw
+ADC value (serial monitor, BLE raw_torque) and the zero from /api/torque_zero
+("zero") for each weight. One reading per CSV line:
+
+    direction,mass_kg,arm_m,adc_counts,zero_counts
+    forward,10,0.175,3056,2884
+    forward,20,0.175,3225,2884
+    backward,10,0.175,2710,2884
+
+The crank torque is mass * g * arm. Repeated weights are averaged, points
+closer than 32 ADC counts (the firmware's grid step) are merged and the
+curve is reduced to the 12 points per direction the firmware stores, always
+through (0, 0). Prints the JSON for POST /api/torque_cal:
+
+    tools/torque_cal_fit.py weights.csv > cal.json
+    curl -X POST --data @cal.json http://192.168.4.1/api/torque_cal
+"""
+
+import argparse
+import csv
+import json
+import sys
+
+G = 9.81
+MAX_POINTS = 12         # TORQUE_CAL_MAX_POINTS
+MIN_SPACING = 32.0      # TORQUE_CAL_GRID_STEP [ADC counts]
+MAX_COUNTS = 4095.0
+MAX_NM = 1000.0
+
+
+def read_points(path):
+    """{direction: {torque_nm: [deviation, ...]}} from the CSV."""
+    readings = {"forward": {}, "backward": {}}
+    with open(path, newline="") as f:
+        for line, row in enumerate(csv.DictReader(f), start=2):
+            direction = row["direction"].strip().lower()
+            if direction not in readings:
+                sys.exit("line %d: direction must be forward or backward" % line)
+            torque = round(float(row["mass_kg"]) * G * float(row["arm_m"]), 3)
+            deviation = abs(float(row["adc_counts"]) - float(row["zero_counts"]))
+            readings[direction].setdefault(torque, []).append(deviation)
+    return readings
+
+
+def average(readings):
+    """One (counts, nm) point per torque, sorted, counts made increasing."""
+    points = sorted((sum(d) / len(d), nm) for nm, d in readings.items() if nm > 0)
+    monotonic = []
+    for counts, nm in points:
+        # More torque must mean more deflection - drop readings that contradict
+        # the previous point (slipped weight, wrong zero)
+        if monotonic and nm < monotonic[-1][1]:
+            print("warning: dropped %.1f Nm at %.0f counts (less than %.1f Nm at %.0f counts)"
+                  % (nm, counts, monotonic[-1][1], monotonic[-1][0]), file=sys.stderr)
+            continue
+        monotonic.append((counts, nm))
+    return monotonic
+
+
+def merge_close(points):
+    """Merge neighbours closer than MIN_SPACING, drop points too close to (0, 0)."""
+    points = [p for p in points if p[0] >= MIN_SPACING]
+    while True:
+        gaps = [(points[i + 1][0] - points[i][0], i) for i in range(len(points) - 1)]
+        gap, i = min(gaps, default=(MIN_SPACING, 0))
+        if gap >= MIN_SPACING:
+            return [(0.0, 0.0)] + points
+        points[i:i + 2] = [((points[i][0] + points[i + 1][0]) / 2, (points[i][1] + points[i + 1][1]) / 2)]
+
+
+def interpolation_error(points, i):
+    """Torque error if point i is dropped."""
+    (x0, y0), (x1, y1), (x2, y2) = points[i - 1], points[i], points[i + 1]
+    return abs(y0 + (y2 - y0) * (x1 - x0) / (x2 - x0) - y1)
+
+
+def simplify(points):
+    """Drop the inner points that are best explained by their neighbours."""
+    points = list(points)
+    while len(points) > MAX_POINTS:
+        worst = min(range(1, len(points) - 1), key=lambda i: interpolation_error(points, i))
+        del points[worst]
+    return points
+
+
+def fit(readings, direction):
+    points = simplify(merge_close(average(readings)))
+    if len(points) < 2:
+        sys.exit("%s: need at least one weight more than %.0f counts from the zero" % (direction, MIN_SPACING))
+    for counts, nm in points:
+        if counts > MAX_COUNTS or nm > MAX_NM:
+            sys.exit("%s: point (%.0f, %.1f) out of range" % (direction, counts, nm))
+    return [[round(counts, 1), round(nm, 2)] for counts, nm in points]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("csv", help="calibration weight readings")
+    args = parser.parse_args()
+
+    readings = read_points(args.csv)
+    table = {direction: fit(readings[direction], direction) for direction in ("forward", "backward")}
+    json.dump(table, sys.stdout)
+    print()
+
+
+if __name__ == "__main__":
+    main()